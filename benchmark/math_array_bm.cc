@@ -0,0 +1,198 @@
+// -----------------------------------------------------------------------------
+//
+// Copyright (C) 2021 CERN & University of Surrey for the benefit of the
+// BioDynaMo collaboration. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+//
+// See the LICENSE file distributed with this work for details.
+// See the NOTICE file distributed with this work for additional information
+// regarding copyright ownership.
+//
+// -----------------------------------------------------------------------------
+
+#include <benchmark/benchmark.h>
+#include <vector>
+
+#include "biodynamo.h"
+#include "core/force_kernel.h"
+
+namespace bdm {
+namespace math_array_bm {
+
+// Compares the single array operations of `MathArray` with the batch
+// operations (`DotN`, `NormN`, `NormalizeN`) and the corresponding users in
+// the mechanics (`CalculateSphereBlock`) and diffusion (`GetGradients`).
+
+inline std::vector<Real3> RandomArrays(Simulation* sim, uint64_t n) {
+  auto* random = sim->GetRandom();
+  std::vector<Real3> arrays(n);
+  for (auto& a : arrays) {
+    a = random->UniformArray<3>(-10, 10);
+  }
+  return arrays;
+}
+
+static void DotScalar(benchmark::State& state) {
+  Simulation simulation("DotScalar");
+  auto a = RandomArrays(&simulation, state.range(0));
+  auto b = RandomArrays(&simulation, state.range(0));
+  std::vector<real_t> result(a.size());
+  for (auto _ : state) {
+    for (uint64_t i = 0; i < a.size(); ++i) {
+      result[i] = a[i] * b[i];
+    }
+    benchmark::DoNotOptimize(result.data());
+  }
+  state.SetItemsProcessed(state.iterations() * a.size());
+}
+
+BENCHMARK(DotScalar)->Arg(1 << 10)->Arg(1 << 16);
+
+static void DotBatch(benchmark::State& state) {
+  Simulation simulation("DotBatch");
+  auto a = RandomArrays(&simulation, state.range(0));
+  auto b = RandomArrays(&simulation, state.range(0));
+  std::vector<real_t> result(a.size());
+  for (auto _ : state) {
+    DotN(a.data(), b.data(), a.size(), result.data());
+    benchmark::DoNotOptimize(result.data());
+  }
+  state.SetItemsProcessed(state.iterations() * a.size());
+}
+
+BENCHMARK(DotBatch)->Arg(1 << 10)->Arg(1 << 16);
+
+static void NormScalar(benchmark::State& state) {
+  Simulation simulation("NormScalar");
+  auto a = RandomArrays(&simulation, state.range(0));
+  std::vector<real_t> result(a.size());
+  for (auto _ : state) {
+    for (uint64_t i = 0; i < a.size(); ++i) {
+      result[i] = a[i].Norm();
+    }
+    benchmark::DoNotOptimize(result.data());
+  }
+  state.SetItemsProcessed(state.iterations() * a.size());
+}
+
+BENCHMARK(NormScalar)->Arg(1 << 10)->Arg(1 << 16);
+
+static void NormBatch(benchmark::State& state) {
+  Simulation simulation("NormBatch");
+  auto a = RandomArrays(&simulation, state.range(0));
+  std::vector<real_t> result(a.size());
+  for (auto _ : state) {
+    NormN(a.data(), a.size(), result.data());
+    benchmark::DoNotOptimize(result.data());
+  }
+  state.SetItemsProcessed(state.iterations() * a.size());
+}
+
+BENCHMARK(NormBatch)->Arg(1 << 10)->Arg(1 << 16);
+
+// Forces of all neighbors of one sphere: one virtual call per neighbor vs.
+// one vectorized loop over the neighbors
+static void SphereForcesScalar(benchmark::State& state) {
+  Simulation simulation("SphereForcesScalar");
+  auto positions = RandomArrays(&simulation, state.range(0));
+  std::vector<Cell> neighbors(positions.begin(), positions.end());
+  Cell cell({0, 0, 0});
+  cell.SetDiameter(10);
+  KernelInteractionForce<> force;
+  const InteractionForce* iforce = &force;
+  for (auto _ : state) {
+    Real3 result = {0, 0, 0};
+    for (auto& neighbor : neighbors) {
+      auto f = iforce->Calculate(&cell, &neighbor);
+      result += {f[0], f[1], f[2]};
+    }
+    benchmark::DoNotOptimize(result);
+  }
+  state.SetItemsProcessed(state.iterations() * neighbors.size());
+}
+
+BENCHMARK(SphereForcesScalar)->Arg(16)->Arg(64);
+
+static void SphereForcesBatch(benchmark::State& state) {
+  Simulation simulation("SphereForcesBatch");
+  auto positions = RandomArrays(&simulation, state.range(0));
+  std::vector<Cell> neighbors(positions.begin(), positions.end());
+  Cell cell({0, 0, 0});
+  cell.SetDiameter(10);
+  SphereNeighborBlock block;
+  for (auto& neighbor : neighbors) {
+    block.Add(&neighbor);
+  }
+  KernelInteractionForce<> force;
+  const InteractionForce* iforce = &force;
+  for (auto _ : state) {
+    uint64_t num_non_zero = 0;
+    auto result = iforce->CalculateSphereBlock(&cell, block, &num_non_zero);
+    benchmark::DoNotOptimize(result);
+  }
+  state.SetItemsProcessed(state.iterations() * neighbors.size());
+}
+
+BENCHMARK(SphereForcesBatch)->Arg(16)->Arg(64);
+
+// Normalized gradients at many positions (e.g. for chemotaxis)
+inline DiffusionGrid* InitGradientGrid(Simulation* sim) {
+  auto* param = sim->GetParam();
+  auto* rm = sim->GetResourceManager();
+  rm->AddAgent(new Cell({10, 10, 10}));
+  auto* d_grid = new EulerGrid(0, "Substance", 0.0, 0.0, 50);
+  rm->AddContinuum(d_grid);
+  ModelInitializer::InitializeSubstance(0, [&](real_t x, real_t y, real_t z) {
+    return x * y + z / param->max_bound;
+  });
+  sim->GetScheduler()->Simulate(1);
+  return d_grid;
+}
+
+inline void SetGradientParam(Param* param) {
+  param->bound_space = Param::BoundSpaceMode::kClosed;
+  param->min_bound = 0;
+  param->max_bound = 100;
+}
+
+static void GradientsScalar(benchmark::State& state) {
+  Simulation simulation("GradientsScalar", SetGradientParam);
+  auto* d_grid = InitGradientGrid(&simulation);
+  auto positions = RandomArrays(&simulation, state.range(0));
+  for (auto& p : positions) {
+    p = {std::abs(p[0]) * 9, std::abs(p[1]) * 9, std::abs(p[2]) * 9};
+  }
+  std::vector<Real3> gradients(positions.size());
+  for (auto _ : state) {
+    for (uint64_t i = 0; i < positions.size(); ++i) {
+      d_grid->GetGradient(positions[i], &gradients[i], true);
+    }
+    benchmark::DoNotOptimize(gradients.data());
+  }
+  state.SetItemsProcessed(state.iterations() * positions.size());
+}
+
+BENCHMARK(GradientsScalar)->Arg(1 << 14);
+
+static void GradientsBatch(benchmark::State& state) {
+  Simulation simulation("GradientsBatch", SetGradientParam);
+  auto* d_grid = InitGradientGrid(&simulation);
+  auto positions = RandomArrays(&simulation, state.range(0));
+  for (auto& p : positions) {
+    p = {std::abs(p[0]) * 9, std::abs(p[1]) * 9, std::abs(p[2]) * 9};
+  }
+  std::vector<Real3> gradients(positions.size());
+  for (auto _ : state) {
+    d_grid->GetGradients(positions.data(), positions.size(), gradients.data(),
+                         true);
+    benchmark::DoNotOptimize(gradients.data());
+  }
+  state.SetItemsProcessed(state.iterations() * positions.size());
+}
+
+BENCHMARK(GradientsBatch)->Arg(1 << 14);
+
+}  // namespace math_array_bm
+}  // namespace bdm
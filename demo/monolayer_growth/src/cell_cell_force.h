@@ -16,16 +16,22 @@
 #define CELL_CELL_FORCE_H_
 
 #include "biodynamo.h"
-#include "core/interaction_force.h"
+#include "core/force_kernel.h"
 
 namespace bdm {
 
-class CellCellForce : public InteractionForce {
+/// Custom force. Changed adhesive and repulsive parameters compared to standard
+/// force to achieve quick separation of mother and daughter cells after
+/// division. The force between two cells is still calculated by the inlined
+/// `ForceKernel<Shape::kSphere, Shape::kSphere>`.
+class CellCellForce : public KernelInteractionForce<> {
  public:
-  CellCellForce() {}
+  CellCellForce();
   virtual ~CellCellForce() {}
 
-  virtual Real4 Calculate(const Agent* lhs, const Agent* rhs) const override;
+  InteractionForce* NewCopy() const override {
+    return new CellCellForce(*this);
+  }
 };
 
 }  // namespace bdm
@@ -169,6 +169,23 @@ class Agent {
   /// \see `NeuronSoma::CriticalRegion`
   virtual void CriticalRegion(std::vector<AgentPointer<>>* aptrs) {}
 
+  /// Updates all `AgentPointer` data members in `AgentPointerMode::kDirect`.
+  /// Called by the `ResourceManager` if the `Agent*` of agents has changed
+  /// (e.g. after load balancing), or agents have been removed.\n
+  /// Subclasses with `AgentPointer` data members must override this function
+  /// and call `AgentPointer::Update` for each of them.
+  /// Here an example from NeuronSoma.\n
+  ///
+  ///     void NeuronSoma::UpdateAgentPointers(
+  ///         const AgentPointerUpdate& update) {
+  ///       for (auto& daughter : daughters_) {
+  ///         daughter.Update(update);
+  ///       }
+  ///     }
+  ///
+  /// \see `AgentPointerMode`
+  virtual void UpdateAgentPointers(const AgentPointerUpdate& update) {}
+
   uint32_t GetBoxIdx() const;
 
   void SetBoxIdx(uint32_t idx);
@@ -177,6 +194,8 @@ class Agent {
     is_static_next_ts_ = value;
   }
 
+  bool GetStaticnessNextTimestep() const { return is_static_next_ts_; }
+
   bool GetPropagateStaticness() const {
     return propagate_staticness_neighborhood_;
   }
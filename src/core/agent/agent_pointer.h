@@ -24,6 +24,9 @@
 #include "core/execution_context/execution_context.h"
 #include "core/simulation.h"
 #include "core/util/root.h"
+#if (!defined(__CLING__) || defined(__ROOTCLING__)) && defined(USE_DICT)
+#include "core/simulation_backup.h"
+#endif  // !defined(__CLING__) || defined(__ROOTCLING__)
 
 namespace bdm {
 
@@ -39,6 +42,9 @@ class Agent;
 /// agent might reside in a different address space.
 /// If the `Agent*` of an agent does not change during a simulation,
 /// the direct mode can be used to achieve better performance.
+/// The `ResourceManager` updates direct pointers if agents are copied during
+/// load balancing, removed from the simulation, or restored from a backup
+/// (see `Agent::UpdateAgentPointers`).
 enum AgentPointerMode { kIndirect, kDirect };
 /// Global variable to select the agent pointer mode. \n
 /// Replacing the global variable with an attribute in `Param`
@@ -46,6 +52,28 @@ enum AgentPointerMode { kIndirect, kDirect };
 /// \see AgentPointerMode
 extern AgentPointerMode gAgentPointerMode;
 
+/// Determines the new address of agents whose `Agent*` has changed.
+/// Used to update `AgentPointer`s in `AgentPointerMode::kDirect`.
+/// \see Agent::UpdateAgentPointers
+class AgentPointerUpdate {
+ public:
+  /// \param from_uid `AgentPointer`s hold the uid of the agent instead of the
+  ///        raw pointer. This is the case directly after restoring agents
+  ///        from a backup.
+  explicit AgentPointerUpdate(bool from_uid = false) : from_uid_(from_uid) {}
+
+  virtual ~AgentPointerUpdate() = default;
+
+  /// Returns the agent with the given uid, or nullptr if it has been removed
+  /// from the simulation.
+  virtual Agent* GetAgent(const AgentUid& uid) const = 0;
+
+  bool FromUid() const { return from_uid_; }
+
+ private:
+  bool from_uid_;
+};
+
 /// Agent pointer. Required to point to an agent
 /// throughout the whole simulation. \n
 /// This class provides a common interface for different modes.
@@ -225,6 +253,29 @@ class AgentPointer {
 
   const TAgent* Get() const { return this->operator->(); }
 
+  /// Updates the raw pointer in `AgentPointerMode::kDirect`. Does nothing in
+  /// `AgentPointerMode::kIndirect`.
+  /// In the direct mode the agent this pointer points to must still be alive
+  /// (unless `update.FromUid()` is true), because its uid is used to determine
+  /// the new address.
+  void Update(const AgentPointerUpdate& update) {
+    if (gAgentPointerMode == AgentPointerMode::kIndirect) {
+      return;
+    }
+    AgentUid uid;
+    if (update.FromUid()) {
+      uid = d_.uid;
+    } else if (d_.agent != nullptr) {
+      uid = d_.agent->GetUid();
+    }
+    if (uid == AgentUid()) {
+      d_.agent = nullptr;
+      return;
+    }
+    auto* agent = update.GetAgent(uid);
+    d_.agent = agent != nullptr ? Cast<Agent, TAgent>(agent) : nullptr;
+  }
+
   bool operator<(const AgentPointer& other) const {
     if (gAgentPointerMode == AgentPointerMode::kIndirect) {
       return d_.uid < other.d_.uid;
@@ -267,7 +318,11 @@ inline void AgentPointer<TAgent>::Streamer(TBuffer& R__b) {
     R__b.ReadClassBuffer(AgentPointer::Class(), this);
     AgentUid restored_uid;
     R__b.ReadClassBuffer(AgentUid::Class(), &restored_uid);
-    if (gAgentPointerMode == AgentPointerMode::kIndirect) {
+    if (gAgentPointerMode == AgentPointerMode::kIndirect ||
+        SimulationBackup::restore_in_progress_) {
+      // In the direct mode, the referenced agent might not have been read
+      // yet. The uid is kept until the restored agents have been added to
+      // the ResourceManager, which replaces it with the raw pointer.
       d_.uid = restored_uid;
     } else if (restored_uid != AgentUid()) {
       auto* ctxt = Simulation::GetActive()->GetExecutionContext();
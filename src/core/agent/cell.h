@@ -226,6 +226,10 @@ class Cell : public Agent {
   }
 
   void SetTractorForce(const Real3& tractor_force) {
+    // A static cell is moved by its tractor force
+    if (tractor_force != Real3{0, 0, 0}) {
+      SetPropagateStaticness();
+    }
     tractor_force_ = tractor_force;
   }
 
@@ -305,8 +309,16 @@ class Cell : public Agent {
     uint64_t non_zero_neighbor_forces = 0;
     if (!IsStatic()) {
       auto* ctxt = Simulation::GetActive()->GetExecutionContext();
+      // Sphere neighbors are collected and passed to the force at once, such
+      // that the force is dispatched only once per shape pair.
+      thread_local SphereNeighborBlock sphere_neighbors;
+      sphere_neighbors.clear();
       auto calculate_neighbor_forces =
           L2F([&](Agent* neighbor, real_t squared_distance) {
+            if (neighbor->GetShape() == Shape::kSphere) {
+              sphere_neighbors.Add(neighbor);
+              return;
+            }
             auto neighbor_force = force->Calculate(this, neighbor);
             if (neighbor_force[0] != 0 || neighbor_force[1] != 0 ||
                 neighbor_force[2] != 0) {
@@ -317,6 +329,8 @@ class Cell : public Agent {
             }
           });
       ctxt->ForEachNeighbor(calculate_neighbor_forces, *this, squared_radius);
+      translation_force_on_point_mass += force->CalculateSphereBlock(
+          this, sphere_neighbors, &non_zero_neighbor_forces);
 
       if (non_zero_neighbor_forces > 1) {
         SetStaticnessNextTimestep(false);
@@ -356,6 +370,7 @@ class Cell : public Agent {
 
   void MovePointMass(const Real3& normalized_dir, real_t speed) {
     tractor_force_ += normalized_dir * speed;
+    SetPropagateStaticness();
   }
 
  protected:
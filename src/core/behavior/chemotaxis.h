@@ -22,19 +22,25 @@
 
 namespace bdm {
 
-/// Move cells along the diffusion gradient (from low concentration to high)
+/// Move cells along the diffusion gradient (from low concentration to high).
+/// If `interpolate` is true, the gradient is interpolated trilinearly
+/// between the boxes of the diffusion grid (see `DiffusionGrid::GetGradients`)
+/// instead of using the gradient of the box that contains the cell.
 class Chemotaxis : public Behavior {
-  BDM_BEHAVIOR_HEADER(Chemotaxis, Behavior, 1);
+  BDM_BEHAVIOR_HEADER(Chemotaxis, Behavior, 2);
 
  public:
   Chemotaxis() = default;
-  Chemotaxis(const std::string& substance, real_t speed) : speed_(speed) {
+  Chemotaxis(const std::string& substance, real_t speed,
+             bool interpolate = false)
+      : speed_(speed), interpolate_(interpolate) {
     dgrid_ = Simulation::GetActive()->GetResourceManager()->GetDiffusionGrid(
         substance);
   }
 
-  explicit Chemotaxis(DiffusionGrid* dgrid, real_t speed)
-      : dgrid_(dgrid), speed_(speed) {}
+  explicit Chemotaxis(DiffusionGrid* dgrid, real_t speed,
+                      bool interpolate = false)
+      : dgrid_(dgrid), speed_(speed), interpolate_(interpolate) {}
 
   virtual ~Chemotaxis() = default;
 
@@ -43,19 +49,25 @@ class Chemotaxis : public Behavior {
     auto* other = bdm_static_cast<Chemotaxis*>(event.existing_behavior);
     dgrid_ = other->dgrid_;
     speed_ = other->speed_;
+    interpolate_ = other->interpolate_;
   }
 
   void Run(Agent* agent) override {
     auto* cell = bdm_static_cast<Cell*>(agent);
     auto& position = cell->GetPosition();
     Real3 gradient;
-    dgrid_->GetGradient(position, &gradient);  // returns normalized gradient
+    if (interpolate_) {
+      dgrid_->GetGradients(&position, 1, &gradient, true, true);
+    } else {
+      dgrid_->GetGradient(position, &gradient);  // returns normalized gradient
+    }
     cell->UpdatePosition(gradient * speed_);
   }
 
  private:
   DiffusionGrid* dgrid_ = nullptr;
   real_t speed_;
+  bool interpolate_ = false;
 };
 
 }  // namespace bdm
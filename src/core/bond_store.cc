@@ -0,0 +1,218 @@
+// -----------------------------------------------------------------------------
+//
+// Copyright (C) 2021 CERN & University of Surrey for the benefit of the
+// BioDynaMo collaboration. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+//
+// See the LICENSE file distributed with this work for details.
+// See the NOTICE file distributed with this work for additional information
+// regarding copyright ownership.
+//
+// -----------------------------------------------------------------------------
+
+#include "core/bond_store.h"
+
+#include <algorithm>
+#include <set>
+#include <utility>
+
+#include "core/agent/agent.h"
+#include "core/resource_manager.h"
+#include "core/simulation.h"
+#include "core/util/log.h"
+#include "core/util/thread_info.h"
+
+namespace bdm {
+
+// -----------------------------------------------------------------------------
+BondStore::BondStore() {
+  auto max_threads = ThreadInfo::GetInstance()->GetMaxThreads();
+  to_add_.resize(max_threads);
+  to_break_.resize(max_threads);
+}
+
+// -----------------------------------------------------------------------------
+BondStore::BondTypeId BondStore::AddBondType(const BondType& type) {
+  types_.push_back(type);
+  bonds_.emplace_back();
+  return static_cast<BondTypeId>(types_.size() - 1);
+}
+
+// -----------------------------------------------------------------------------
+void BondStore::AddBond(BondTypeId type, const AgentUid& first,
+                        const AgentUid& second, real_t rest_length) {
+  auto tid = ThreadInfo::GetInstance()->GetMyThreadId();
+  to_add_[tid].push_back({type, first, second, rest_length});
+}
+
+// -----------------------------------------------------------------------------
+void BondStore::BreakBond(BondTypeId type, const AgentUid& first,
+                          const AgentUid& second) {
+  auto tid = ThreadInfo::GetInstance()->GetMyThreadId();
+  to_break_[tid].push_back({type, first, second, 0});
+}
+
+// -----------------------------------------------------------------------------
+void BondStore::BreakBonds(BondTypeId type,
+                           const std::vector<std::vector<uint64_t>>& indices) {
+  std::vector<uint8_t> broken(bonds_[type].size(), 0);
+  bool any = false;
+  for (auto& thread_indices : indices) {
+    for (auto idx : thread_indices) {
+      broken[idx] = 1;
+      any = true;
+    }
+  }
+  if (any) {
+    Remove(type, broken);
+  }
+}
+
+// -----------------------------------------------------------------------------
+void BondStore::Commit() {
+  auto* rm = Simulation::GetActive()->GetResourceManager();
+  const bool remap_all = agent_handle_version_ != rm->GetAgentHandleVersion();
+  agent_handle_version_ = rm->GetAgentHandleVersion();
+
+  // Pending removals are matched independent of the order of the agents
+  std::vector<std::set<std::pair<AgentUid, AgentUid>>> break_requests(
+      types_.size());
+  bool has_break_requests = false;
+  for (auto& requests : to_break_) {
+    for (auto& r : requests) {
+      break_requests[r.type].insert(std::minmax(r.first, r.second));
+      has_break_requests = true;
+    }
+    requests.clear();
+  }
+
+  // Append pending bonds
+  std::vector<uint64_t> num_committed(types_.size());
+  for (uint64_t t = 0; t < types_.size(); ++t) {
+    num_committed[t] = bonds_[t].size();
+  }
+  auto append = [&](const BondRequest& r) {
+    auto& bonds = bonds_[r.type];
+    bonds.first_uid.push_back(r.first);
+    bonds.second_uid.push_back(r.second);
+    bonds.rest_length.push_back(r.rest_length);
+  };
+  // Requests that were deferred in the previous commit are added even if an
+  // agent is still missing (`Remap` breaks them in this case), unless they
+  // have been broken in the meantime
+  for (auto& r : deferred_) {
+    if (!has_break_requests ||
+        break_requests[r.type].count(std::minmax(r.first, r.second)) == 0) {
+      append(r);
+    }
+  }
+  deferred_.clear();
+  for (auto& requests : to_add_) {
+    for (auto& r : requests) {
+      if (r.type >= types_.size()) {
+        Log::Fatal("BondStore::Commit", "Bond type ", r.type,
+                   " has not been added.");
+      }
+      // Agents that have been created in this iteration (e.g. the daughter
+      // of a division) are added to the ResourceManager after this commit
+      if (!rm->ContainsAgent(r.first) || !rm->ContainsAgent(r.second)) {
+        deferred_.push_back(r);
+        continue;
+      }
+      append(r);
+    }
+    requests.clear();
+  }
+
+  std::vector<uint8_t> broken;
+  for (BondTypeId t = 0; t < types_.size(); ++t) {
+    auto& bonds = bonds_[t];
+    const uint64_t num_bonds = bonds.size();
+    bonds.first.resize(num_bonds);
+    bonds.second.resize(num_bonds);
+    broken.assign(num_bonds, 0);
+    Remap(t, remap_all ? 0 : num_committed[t], num_bonds, &broken);
+
+    if (has_break_requests && !break_requests[t].empty()) {
+      const auto& requests = break_requests[t];
+      for (uint64_t i = 0; i < num_bonds; ++i) {
+        auto key = std::minmax(bonds.first_uid[i], bonds.second_uid[i]);
+        if (requests.find(key) != requests.end()) {
+          broken[i] = 1;
+        }
+      }
+    }
+
+    // Only new bonds that survived are reported as created
+    if (types_[t].on_create) {
+      for (uint64_t i = num_committed[t]; i < num_bonds; ++i) {
+        if (!broken[i]) {
+          types_[t].on_create(rm->GetAgent(bonds.first[i]),
+                              rm->GetAgent(bonds.second[i]));
+        }
+      }
+    }
+
+    if (std::find(broken.begin(), broken.end(), 1) != broken.end()) {
+      Remove(t, broken);
+    }
+  }
+}
+
+// -----------------------------------------------------------------------------
+uint64_t BondStore::GetNumBonds() const {
+  uint64_t num_bonds = 0;
+  for (auto& bonds : bonds_) {
+    num_bonds += bonds.size();
+  }
+  return num_bonds;
+}
+
+// -----------------------------------------------------------------------------
+void BondStore::Remap(BondTypeId type, uint64_t start, uint64_t end,
+                      std::vector<uint8_t>* broken) {
+  auto* rm = Simulation::GetActive()->GetResourceManager();
+  auto& bonds = bonds_[type];
+#pragma omp parallel for schedule(static)
+  for (uint64_t i = start; i < end; ++i) {
+    if (!rm->ContainsAgent(bonds.first_uid[i]) ||
+        !rm->ContainsAgent(bonds.second_uid[i])) {
+      (*broken)[i] = 1;
+      continue;
+    }
+    bonds.first[i] = rm->GetAgentHandle(bonds.first_uid[i]);
+    bonds.second[i] = rm->GetAgentHandle(bonds.second_uid[i]);
+  }
+}
+
+// -----------------------------------------------------------------------------
+void BondStore::Remove(BondTypeId type, const std::vector<uint8_t>& broken) {
+  auto* rm = Simulation::GetActive()->GetResourceManager();
+  auto& bonds = bonds_[type];
+  const auto& on_break = types_[type].on_break;
+  uint64_t num_remaining = 0;
+  for (uint64_t i = 0; i < bonds.size(); ++i) {
+    if (broken[i]) {
+      if (on_break) {
+        on_break(rm->GetAgent(bonds.first_uid[i]),
+                 rm->GetAgent(bonds.second_uid[i]));
+      }
+      continue;
+    }
+    bonds.first_uid[num_remaining] = bonds.first_uid[i];
+    bonds.second_uid[num_remaining] = bonds.second_uid[i];
+    bonds.first[num_remaining] = bonds.first[i];
+    bonds.second[num_remaining] = bonds.second[i];
+    bonds.rest_length[num_remaining] = bonds.rest_length[i];
+    num_remaining++;
+  }
+  bonds.first_uid.resize(num_remaining);
+  bonds.second_uid.resize(num_remaining);
+  bonds.first.resize(num_remaining);
+  bonds.second.resize(num_remaining);
+  bonds.rest_length.resize(num_remaining);
+}
+
+}  // namespace bdm
@@ -0,0 +1,158 @@
+// -----------------------------------------------------------------------------
+//
+// Copyright (C) 2021 CERN & University of Surrey for the benefit of the
+// BioDynaMo collaboration. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+//
+// See the LICENSE file distributed with this work for details.
+// See the NOTICE file distributed with this work for additional information
+// regarding copyright ownership.
+//
+// -----------------------------------------------------------------------------
+
+#ifndef CORE_BOND_STORE_H_
+#define CORE_BOND_STORE_H_
+
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "core/agent/agent_handle.h"
+#include "core/agent/agent_uid.h"
+#include "core/real_t.h"
+
+namespace bdm {
+
+class Agent;
+
+/// Parameters that are shared by all bonds of one type
+struct BondType {
+  std::string name;
+  /// Spring constant of the bond
+  real_t stiffness = 1;
+  /// A bond breaks if it is stretched beyond this length
+  real_t breaking_length = std::numeric_limits<real_t>::infinity();
+  /// Is called for each bond of this type after it has been created.
+  std::function<void(Agent*, Agent*)> on_create;
+  /// Is called for each bond of this type after it has been broken.
+  /// If the bond broke because an agent has been removed from the
+  /// simulation, the corresponding argument is nullptr.
+  std::function<void(Agent*, Agent*)> on_break;
+};
+
+/// Stores persistent links between pairs of agents (e.g. adhesion bonds or
+/// springs).
+///
+/// The bonds of each type are stored as an edge list in contiguous arrays.
+/// Besides the uids of the two agents, each bond caches their
+/// `AgentHandle`s, such that operations over all bonds stream through the
+/// arrays and access agents without uid lookups. The handles are remapped in
+/// bulk in `Commit()` if they have been invalidated by the `ResourceManager`
+/// (e.g. after load balancing or removal of agents). Bonds of removed agents
+/// are broken at the same time.
+///
+/// Bonds can be created and broken from multiple threads (e.g. inside a
+/// behavior). These requests are buffered per thread and applied in
+/// `Commit()`, which is called by the "bond forces" operation after the
+/// agent operations of each iteration. Agents that have been created in the
+/// same iteration (e.g. the daughter of a division) are only added to the
+/// `ResourceManager` at the end of the iteration. Bonds to such agents are
+/// therefore kept pending and added in the subsequent call to `Commit()`:
+///
+///     auto* bonds = simulation.GetBondStore();
+///     BondType adhesion;
+///     adhesion.stiffness = 2;
+///     adhesion.breaking_length = 15;
+///     auto type = bonds->AddBondType(adhesion);
+///     ...
+///     bonds->AddBond(type, cell->GetUid(), neighbor->GetUid(), 10);
+class BondStore {
+ public:
+  using BondTypeId = uint32_t;
+
+  /// Edge list of all bonds of one type
+  struct BondList {
+    std::vector<AgentUid> first_uid;
+    std::vector<AgentUid> second_uid;
+    std::vector<AgentHandle> first;
+    std::vector<AgentHandle> second;
+    /// Length at which the bond does not exert any force
+    std::vector<real_t> rest_length;
+
+    uint64_t size() const { return first_uid.size(); }  // NOLINT
+  };
+
+  BondStore();
+
+  BondTypeId AddBondType(const BondType& type);
+
+  const BondType& GetBondType(BondTypeId type) const { return types_[type]; }
+
+  uint64_t GetNumBondTypes() const { return types_.size(); }
+
+  /// Requests a new bond between the agents `first` and `second`.
+  /// Thread-safe. The bond is added in the next call to `Commit()`, or in the
+  /// one after if an agent is not yet in the `ResourceManager` (see above).
+  void AddBond(BondTypeId type, const AgentUid& first, const AgentUid& second,
+               real_t rest_length);
+
+  /// Requests to break all bonds of the given type between the agents
+  /// `first` and `second` (in any order). Thread-safe. The bonds are removed
+  /// in the next call to `Commit()`.
+  void BreakBond(BondTypeId type, const AgentUid& first,
+                 const AgentUid& second);
+
+  /// Breaks the bonds of the given type with the given indices in
+  /// `GetBonds(type)`. Indices may be distributed over several vectors (e.g.
+  /// one per thread). Not thread-safe.
+  void BreakBonds(BondTypeId type,
+                  const std::vector<std::vector<uint64_t>>& indices);
+
+  /// Applies all pending requests, breaks the bonds of agents that have been
+  /// removed from the simulation, and remaps the cached agent handles if
+  /// they have been invalidated. Not thread-safe.
+  void Commit();
+
+  /// Returns all bonds of the given type. The cached agent handles are only
+  /// valid after `Commit()` and until the `ResourceManager` invalidates them.
+  const BondList& GetBonds(BondTypeId type) const { return bonds_[type]; }
+
+  /// Returns the number of committed bonds of all types
+  uint64_t GetNumBonds() const;
+
+ private:
+  struct BondRequest {
+    BondTypeId type;
+    AgentUid first;
+    AgentUid second;
+    real_t rest_length;
+  };
+
+  std::vector<BondType> types_;
+  std::vector<BondList> bonds_;
+  /// Pending requests for each thread
+  std::vector<std::vector<BondRequest>> to_add_;
+  std::vector<std::vector<BondRequest>> to_break_;
+  /// Requests of agents that were not yet in the `ResourceManager` during
+  /// the last commit
+  std::vector<BondRequest> deferred_;
+  /// `ResourceManager::GetAgentHandleVersion` of the cached handles
+  uint64_t agent_handle_version_ = std::numeric_limits<uint64_t>::max();
+
+  /// Updates the cached agent handles of the bonds in [start, end) of `type`
+  /// and marks bonds of removed agents in `broken`.
+  void Remap(BondTypeId type, uint64_t start, uint64_t end,
+             std::vector<uint8_t>* broken);
+
+  /// Removes all bonds of `type` that are marked in `broken` and calls the
+  /// `on_break` callback for each of them.
+  void Remove(BondTypeId type, const std::vector<uint8_t>& broken);
+};
+
+}  // namespace bdm
+
+#endif  // CORE_BOND_STORE_H_
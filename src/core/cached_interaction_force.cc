@@ -0,0 +1,131 @@
+// -----------------------------------------------------------------------------
+//
+// Copyright (C) 2021 CERN & University of Surrey for the benefit of the
+// BioDynaMo collaboration. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+//
+// See the LICENSE file distributed with this work for details.
+// See the NOTICE file distributed with this work for additional information
+// regarding copyright ownership.
+//
+// -----------------------------------------------------------------------------
+
+#include "core/cached_interaction_force.h"
+
+#include <algorithm>
+
+#include "core/agent/agent.h"
+#include "core/agent/agent_uid_generator.h"
+#include "core/shape.h"
+#include "core/simulation.h"
+#include "core/util/thread_info.h"
+
+namespace bdm {
+
+// -----------------------------------------------------------------------------
+CachedInteractionForce::CachedInteractionForce(InteractionForce* force,
+                                               real_t tolerance)
+    : force_(force),
+      squared_tolerance_(tolerance * tolerance),
+      tolerance_(tolerance),
+      hits_(ThreadInfo::GetInstance()->GetMaxThreads(), {{0}}) {}
+
+// -----------------------------------------------------------------------------
+CachedInteractionForce::CachedInteractionForce(
+    const CachedInteractionForce& other)
+    : InteractionForce(other),
+      squared_tolerance_(other.squared_tolerance_),
+      tolerance_(other.tolerance_),
+      hits_(ThreadInfo::GetInstance()->GetMaxThreads(), {{0}}) {
+  if (other.force_) {
+    force_ = other.force_->NewCopy();
+  }
+}
+
+// -----------------------------------------------------------------------------
+CachedInteractionForce::~CachedInteractionForce() { delete force_; }
+
+// -----------------------------------------------------------------------------
+Real4 CachedInteractionForce::Calculate(const Agent* lhs,
+                                        const Agent* rhs) const {
+  const auto& lhs_uid = lhs->GetUid();
+  if (lhs->GetShape() != Shape::kSphere || rhs->GetShape() != Shape::kSphere ||
+      lhs_uid.GetIndex() >= cache_.size()) {
+    return force_->Calculate(lhs, rhs);
+  }
+
+  auto& list = cache_[lhs_uid.GetIndex()];
+  if (list.lhs != lhs_uid) {
+    // the uid index has been reused
+    list.lhs = lhs_uid;
+    list.entries.clear();
+  }
+  if (list.iteration != iteration_) {
+    // remove pairs that did not interact in the last iteration
+    list.iteration = iteration_;
+    auto last_iteration = iteration_ - 1;
+    list.entries.erase(
+        std::remove_if(list.entries.begin(), list.entries.end(),
+                       [&](const Entry& e) {
+                         return e.last_used < last_iteration;
+                       }),
+        list.entries.end());
+  }
+
+  const auto& lhs_position = lhs->GetPosition();
+  const auto& rhs_position = rhs->GetPosition();
+  const auto lhs_diameter = lhs->GetDiameter();
+  const auto rhs_diameter = rhs->GetDiameter();
+  const auto& rhs_uid = rhs->GetUid();
+  auto it = std::find_if(list.entries.begin(), list.entries.end(),
+                         [&](const Entry& e) { return e.rhs == rhs_uid; });
+  if (it != list.entries.end()) {
+    auto& entry = *it;
+    entry.last_used = iteration_;
+    auto lhs_moved = lhs_position - entry.lhs_position;
+    auto rhs_moved = rhs_position - entry.rhs_position;
+    if (lhs_diameter == entry.lhs_diameter &&
+        rhs_diameter == entry.rhs_diameter &&
+        lhs_moved * lhs_moved <= squared_tolerance_ &&
+        rhs_moved * rhs_moved <= squared_tolerance_) {
+      hits_[ThreadInfo::GetInstance()->GetMyThreadId()][0]++;
+      return entry.force;
+    }
+    entry.lhs_position = lhs_position;
+    entry.rhs_position = rhs_position;
+    entry.lhs_diameter = lhs_diameter;
+    entry.rhs_diameter = rhs_diameter;
+    entry.force = force_->Calculate(lhs, rhs);
+    return entry.force;
+  }
+
+  auto force = force_->Calculate(lhs, rhs);
+  list.entries.push_back({rhs_uid, lhs_position, rhs_position, lhs_diameter,
+                          rhs_diameter, force, iteration_});
+  return force;
+}
+
+// -----------------------------------------------------------------------------
+void CachedInteractionForce::Update() {
+  InteractionForce::Update();
+  force_->Update();
+  auto* uid_generator = Simulation::GetActive()->GetAgentUidGenerator();
+  auto size = uid_generator->GetHighestIndex() + 1;
+  if (cache_.size() < size) {
+    cache_.resize(size);
+  }
+  iteration_++;
+}
+
+// -----------------------------------------------------------------------------
+uint64_t CachedInteractionForce::GetNumHits() const {
+  uint64_t hits = 0;
+  for (auto& thread_hits : hits_) {
+    hits += thread_hits[0];
+  }
+  return hits;
+}
+
+}  // namespace bdm
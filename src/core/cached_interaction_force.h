@@ -0,0 +1,107 @@
+// -----------------------------------------------------------------------------
+//
+// Copyright (C) 2021 CERN & University of Surrey for the benefit of the
+// BioDynaMo collaboration. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+//
+// See the LICENSE file distributed with this work for details.
+// See the NOTICE file distributed with this work for additional information
+// regarding copyright ownership.
+//
+// -----------------------------------------------------------------------------
+
+#ifndef CORE_CACHED_INTERACTION_FORCE_H_
+#define CORE_CACHED_INTERACTION_FORCE_H_
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "core/agent/agent_uid.h"
+#include "core/container/math_array.h"
+#include "core/interaction_force.h"
+
+namespace bdm {
+
+/// Interaction force that reuses the sphere-sphere forces of the last
+/// iterations for quasi-static neighborhoods.
+///
+/// Each agent has a persistent list of the neighbors it interacted with.
+/// Every entry stores the force together with the positions and diameters of
+/// both agents it was calculated from. The stored force is reused as long as
+/// the diameters did not change and neither agent moved further than
+/// `tolerance` away from the stored position. Otherwise, the force is
+/// recalculated with the wrapped force. Entries of pairs that did not
+/// interact in the last iteration are removed.
+///
+/// This complements `Param::detect_static_agents` for agents that jitter
+/// slightly but never stop moving. Interactions that involve other shapes
+/// are not cached.
+///
+///     auto* op = scheduler->GetOps("mechanical forces")[0];
+///     op->GetImplementation<MechanicalForcesOp>()->SetInteractionForce(
+///         new CachedInteractionForce(new KernelInteractionForce<>(), 0.01));
+///
+/// The cache of agent `lhs` is modified in `Calculate(lhs, rhs)`. As in the
+/// mechanical forces operations, the forces on one agent must therefore be
+/// calculated by one thread at a time.
+/// Since all pairs are visited through `Calculate`, sphere neighbors are no
+/// longer processed in one vectorized loop (see `CalculateSphereBlock`).
+class CachedInteractionForce : public InteractionForce {
+ public:
+  /// Takes ownership of `force`
+  CachedInteractionForce(InteractionForce* force, real_t tolerance);
+  CachedInteractionForce(const CachedInteractionForce& other);
+  ~CachedInteractionForce() override;
+
+  Real4 Calculate(const Agent* lhs, const Agent* rhs) const override;
+
+  /// Grows the cache for new agents and removes the entries of pairs that
+  /// did not interact in the last iteration. Not thread-safe.
+  void Update() override;
+
+  InteractionForce* NewCopy() const override {
+    return new CachedInteractionForce(*this);
+  }
+
+  real_t GetTolerance() const { return tolerance_; }
+
+  /// Returns the number of forces that were reused since the construction of
+  /// this object
+  uint64_t GetNumHits() const;
+
+ private:
+  struct Entry {
+    AgentUid rhs;
+    Real3 lhs_position;
+    Real3 rhs_position;
+    real_t lhs_diameter;
+    real_t rhs_diameter;
+    Real4 force;
+    uint64_t last_used;
+  };
+
+  /// Persistent neighbor list of one agent
+  struct NeighborList {
+    AgentUid lhs;
+    /// Iteration in which the list was last accessed
+    uint64_t iteration = 0;
+    std::vector<Entry> entries;
+  };
+
+  InteractionForce* force_ = nullptr;
+  real_t squared_tolerance_;
+  real_t tolerance_;
+  /// Is incremented in each call to `Update`
+  uint64_t iteration_ = 1;
+  /// Index: `AgentUid::GetIndex()` of the lhs agent
+  mutable std::vector<NeighborList> cache_;
+  /// Number of reused forces for each thread (padded to avoid false sharing)
+  mutable std::vector<std::array<uint64_t, 8>> hits_;
+};
+
+}  // namespace bdm
+
+#endif  // CORE_CACHED_INTERACTION_FORCE_H_
@@ -18,6 +18,7 @@
 #include <algorithm>
 #include <cassert>
 #include <cmath>
+#include <cstdint>
 #include <numeric>
 #include <ostream>
 #include <stdexcept>
@@ -347,19 +348,22 @@ class MathArray {  // NOLINT
     return true;
   }
 
-  /// Compute the norm of the array's content.
-  /// \return array's norm.
-  T Norm() const {
+  /// Compute the squared norm of the array's content.
+  /// Avoids the square root if only distances are compared.
+  /// \return array's squared norm.
+  T SquaredNorm() const {
     T result = 0;
 #pragma omp simd
     for (size_t i = 0; i < N; i++) {
       result += data_[i] * data_[i];
     }
-    result = std::sqrt(result);
-
     return result;
   }
 
+  /// Compute the norm of the array's content.
+  /// \return array's norm.
+  T Norm() const { return std::sqrt(SquaredNorm()); }
+
   /// Normalize the array in-place.
   void Normalize() {
     T norm = Norm();
@@ -430,6 +434,75 @@ MathArray<T, N> operator*(T const& scalar, MathArray<T, N> array) {
   return array *= scalar;
 }
 
+// -----------------------------------------------------------------------------
+// Batch operations
+//
+// The functions below process `n` arrays in one loop that is vectorized over
+// the arrays (instead of over the N elements of a single array, which does
+// not fill a vector register for N = 3). Use them if the same operation is
+// applied to many arrays, e.g. all displacements or gradients of one
+// iteration.
+
+/// Calculates the dot products `result[i] = a[i] * b[i]` for i in [0, n).
+template <class T, std::size_t N>
+void DotN(const MathArray<T, N>* a, const MathArray<T, N>* b, uint64_t n,
+          T* result) {
+#pragma omp simd
+  for (uint64_t i = 0; i < n; ++i) {
+    T dot = 0;
+    for (size_t j = 0; j < N; ++j) {
+      dot += a[i][j] * b[i][j];
+    }
+    result[i] = dot;
+  }
+}
+
+/// Calculates the squared norms `result[i] = a[i].SquaredNorm()` for i in
+/// [0, n).
+template <class T, std::size_t N>
+void SquaredNormN(const MathArray<T, N>* a, uint64_t n, T* result) {
+#pragma omp simd
+  for (uint64_t i = 0; i < n; ++i) {
+    T squared_norm = 0;
+    for (size_t j = 0; j < N; ++j) {
+      squared_norm += a[i][j] * a[i][j];
+    }
+    result[i] = squared_norm;
+  }
+}
+
+/// Calculates the norms `result[i] = a[i].Norm()` for i in [0, n).
+template <class T, std::size_t N>
+void NormN(const MathArray<T, N>* a, uint64_t n, T* result) {
+#pragma omp simd
+  for (uint64_t i = 0; i < n; ++i) {
+    T squared_norm = 0;
+    for (size_t j = 0; j < N; ++j) {
+      squared_norm += a[i][j] * a[i][j];
+    }
+    result[i] = std::sqrt(squared_norm);
+  }
+}
+
+/// Normalizes the arrays `a[0..n)` in-place. Arrays with a norm smaller
+/// than or equal to `min_norm` are not modified (contrary to
+/// `MathArray::Normalize`, which aborts for a zero vector).
+template <class T, std::size_t N>
+void NormalizeN(MathArray<T, N>* a, uint64_t n, T min_norm = 0) {
+#pragma omp simd
+  for (uint64_t i = 0; i < n; ++i) {
+    T squared_norm = 0;
+    for (size_t j = 0; j < N; ++j) {
+      squared_norm += a[i][j] * a[i][j];
+    }
+    T norm = std::sqrt(squared_norm);
+    T factor = norm > min_norm ? 1 / norm : 1;
+    for (size_t j = 0; j < N; ++j) {
+      a[i][j] *= factor;
+    }
+  }
+}
+
 /// Aliases for a size 3 MathArray
 using Real3 = MathArray<real_t, 3>;
 using Float3 = MathArray<float, 3>;
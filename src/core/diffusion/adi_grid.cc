@@ -0,0 +1,257 @@
+// -----------------------------------------------------------------------------
+//
+// Copyright (C) 2021 CERN & University of Surrey for the benefit of the
+// BioDynaMo collaboration. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+//
+// See the LICENSE file distributed with this work for details.
+// See the NOTICE file distributed with this work for additional information
+// regarding copyright ownership.
+//
+// -----------------------------------------------------------------------------
+
+#include "core/diffusion/adi_grid.h"
+#include <array>
+#include <cmath>
+#include "core/util/log.h"
+
+namespace bdm {
+
+void ADIGrid::DiffuseWithClosedEdge(real_t dt) {
+  Log::Fatal(
+      "ADIGrid::DiffuseWithClosedEdge",
+      "Closed Edge Diffusion is not implemented, please use the EulerGrid.");
+}
+
+void ADIGrid::DiffuseWithOpenEdge(real_t dt) {
+  Log::Fatal(
+      "ADIGrid::DiffuseWithOpenEdge",
+      "Open Edge Diffusion is not implemented, please use the EulerGrid.");
+}
+
+void ADIGrid::DiffuseWithDirichlet(real_t dt) { Integrate(dt, true); }
+
+void ADIGrid::DiffuseWithNeumann(real_t dt) { Integrate(dt, false); }
+
+ADIGrid::Factorization ADIGrid::Factorize(real_t r, size_t n,
+                                          bool dirichlet) const {
+  // (1 - r L) with the second difference L
+  Factorization f;
+  f.lower.resize(n);
+  f.upper.resize(n);
+  f.inv_diagonal.resize(n);
+  for (size_t i = 0; i < n; i++) {
+    real_t lower = -r;
+    real_t upper = -r;
+    real_t diagonal = 1 + 2 * r;
+    if (dirichlet && (i == 0 || i == n - 1)) {
+      // fixed value
+      lower = 0;
+      upper = 0;
+      diagonal = 1;
+    } else if (!dirichlet) {
+      // boxes on the boundary have one neighbor less along this axis
+      if (i == 0) {
+        lower = 0;
+        diagonal -= r;
+      }
+      if (i == n - 1) {
+        upper = 0;
+        diagonal -= r;
+      }
+    }
+    real_t denominator = diagonal;
+    if (i > 0) {
+      denominator -= lower * f.upper[i - 1];
+    }
+    f.lower[i] = lower;
+    f.inv_diagonal[i] = 1 / denominator;
+    f.upper[i] = upper * f.inv_diagonal[i];
+  }
+  return f;
+}
+
+void ADIGrid::Integrate(real_t dt, bool dirichlet) {
+  const size_t nx = num_boxes_axis_[0];
+  const size_t ny = num_boxes_axis_[1];
+  const size_t nz = num_boxes_axis_[2];
+  const size_t nxy = nx * ny;
+  const std::array<size_t, 3> n = {nx, ny, nz};
+  const real_t r = (1 - dc_[0]) * dt / (box_length_ * box_length_);
+  const real_t theta = theta_;
+  const auto sim_time = GetSimulatedTime();
+  const std::array<Factorization, 3> f = {Factorize(theta * r, nx, dirichlet),
+                                          Factorize(theta * r, ny, dirichlet),
+                                          Factorize(theta * r, nz, dirichlet)};
+  const std::array<size_t, 3> strides = {1, nx, nxy};
+
+  auto is_boundary = [&n](size_t x, size_t y, size_t z) {
+    return x == 0 || x == n[0] - 1 || y == 0 || y == n[1] - 1 || z == 0 ||
+           z == n[2] - 1;
+  };
+  auto evaluate_boundary = [&](size_t x, size_t y, size_t z) {
+    return boundary_condition_->Evaluate(grid_dimensions_[0] + x * box_length_,
+                                         grid_dimensions_[2] + y * box_length_,
+                                         grid_dimensions_[4] + z * box_length_,
+                                         sim_time);
+  };
+
+  // Calculates the right hand side (1 + (1 - theta) r L) src of the stage
+  // along `axis` for all boxes of the row (y, z) and stores it in dst
+  auto right_hand_side = [&](int axis, const real_t* src, real_t* dst,
+                             size_t y, size_t z) {
+    const size_t stride = strides[axis];
+    size_t c = y * nx + z * nxy;
+    for (size_t x = 0; x < nx; x++, c++) {
+      const std::array<size_t, 3> coord = {x, y, z};
+      if (!is_boundary(x, y, z)) {
+        dst[c] = src[c] + (1 - theta) * r *
+                              (src[c - stride] - 2 * src[c] + src[c + stride]);
+        continue;
+      }
+      if (dirichlet) {
+        // The first stage sets the boundary values, which are kept by the
+        // following stages
+        dst[c] = axis == 0 ? evaluate_boundary(x, y, z) : src[c];
+        continue;
+      }
+      // Neumann: neighbors outside of the grid are replaced by
+      // -box_length * value and do not contribute to the center
+      // (see `EulerGrid::DiffuseWithNeumann`)
+      const size_t i = coord[axis];
+      const bool first = i == 0;
+      const bool last = i == n[axis] - 1;
+      real_t second_difference = 0;
+      if (!first) {
+        second_difference += src[c - stride] - src[c];
+      }
+      if (!last) {
+        second_difference += src[c + stride] - src[c];
+      }
+      dst[c] = src[c] + (1 - theta) * r * second_difference;
+      if (first || last) {
+        dst[c] -= r * (first + last) * box_length_ * evaluate_boundary(x, y, z);
+      }
+    }
+  };
+
+  // Range of the lines that are not fixed by Dirichlet boundary conditions
+  const size_t begin = dirichlet ? 1 : 0;
+  std::array<size_t, 3> end;
+  for (int i = 0; i < 3; i++) {
+    end[i] = dirichlet ? n[i] - 1 : n[i];
+  }
+
+  real_t* u = c1_.data();
+  real_t* u1 = c2_.data();
+  real_t* u2 = c3_.data();
+
+  // Stage 1: implicit solves along the contiguous x lines
+#pragma omp parallel for collapse(2)
+  for (size_t z = 0; z < nz; z++) {
+    for (size_t y = 0; y < ny; y++) {
+      right_hand_side(0, u, u1, y, z);
+      if (y < begin || y >= end[1] || z < begin || z >= end[2]) {
+        continue;
+      }
+      const real_t* lower = f[0].lower.data();
+      const real_t* upper = f[0].upper.data();
+      const real_t* inv_diagonal = f[0].inv_diagonal.data();
+      real_t* d = u1 + y * nx + z * nxy;
+      d[0] *= inv_diagonal[0];
+      for (size_t i = 1; i < nx; i++) {
+        d[i] = (d[i] - lower[i] * d[i - 1]) * inv_diagonal[i];
+      }
+      for (size_t i = nx - 1; i-- > 0;) {
+        d[i] -= upper[i] * d[i + 1];
+      }
+    }
+  }
+
+  // Stage 2: implicit solves along y. The lines of one xy-plane are solved
+  // together, such that the inner loop processes contiguous x rows.
+#pragma omp parallel for
+  for (size_t z = 0; z < nz; z++) {
+    for (size_t y = 0; y < ny; y++) {
+      right_hand_side(1, u1, u2, y, z);
+    }
+    if (z < begin || z >= end[2]) {
+      continue;
+    }
+    const real_t* lower = f[1].lower.data();
+    const real_t* upper = f[1].upper.data();
+    const real_t* inv_diagonal = f[1].inv_diagonal.data();
+    real_t* d = u2 + z * nxy;
+#pragma omp simd
+    for (size_t x = begin; x < end[0]; x++) {
+      d[x] *= inv_diagonal[0];
+    }
+    for (size_t y = 1; y < ny; y++) {
+#pragma omp simd
+      for (size_t x = begin; x < end[0]; x++) {
+        d[x + y * nx] =
+            (d[x + y * nx] - lower[y] * d[x + (y - 1) * nx]) * inv_diagonal[y];
+      }
+    }
+    for (size_t y = ny - 1; y-- > 0;) {
+#pragma omp simd
+      for (size_t x = begin; x < end[0]; x++) {
+        d[x + y * nx] -= upper[y] * d[x + (y + 1) * nx];
+      }
+    }
+  }
+
+  // Stage 3: implicit solves along z. The lines with the same y coordinate
+  // are solved together.
+#pragma omp parallel for
+  for (size_t y = 0; y < ny; y++) {
+    for (size_t z = 0; z < nz; z++) {
+      right_hand_side(2, u2, u1, y, z);
+    }
+    if (y < begin || y >= end[1]) {
+      continue;
+    }
+    const real_t* lower = f[2].lower.data();
+    const real_t* upper = f[2].upper.data();
+    const real_t* inv_diagonal = f[2].inv_diagonal.data();
+    real_t* d = u1 + y * nx;
+#pragma omp simd
+    for (size_t x = begin; x < end[0]; x++) {
+      d[x] *= inv_diagonal[0];
+    }
+    for (size_t z = 1; z < nz; z++) {
+#pragma omp simd
+      for (size_t x = begin; x < end[0]; x++) {
+        d[x + z * nxy] = (d[x + z * nxy] - lower[z] * d[x + (z - 1) * nxy]) *
+                         inv_diagonal[z];
+      }
+    }
+    for (size_t z = nz - 1; z-- > 0;) {
+#pragma omp simd
+      for (size_t x = begin; x < end[0]; x++) {
+        d[x + z * nxy] -= upper[z] * d[x + (z + 1) * nxy];
+      }
+    }
+  }
+
+  // Decay (boxes with Dirichlet boundary conditions keep their value)
+  if (mu_ != 0) {
+    const real_t decay = std::exp(-mu_ * dt);
+#pragma omp parallel for collapse(2)
+    for (size_t z = 0; z < nz; z++) {
+      for (size_t y = 0; y < ny; y++) {
+        size_t c = y * nx + z * nxy;
+        for (size_t x = 0; x < nx; x++, c++) {
+          if (!dirichlet || !is_boundary(x, y, z)) {
+            u1[c] *= decay;
+          }
+        }
+      }
+    }
+  }
+  c1_.swap(c2_);
+}
+
+}  // namespace bdm
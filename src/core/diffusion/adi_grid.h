@@ -0,0 +1,131 @@
+// -----------------------------------------------------------------------------
+//
+// Copyright (C) 2021 CERN & University of Surrey for the benefit of the
+// BioDynaMo collaboration. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+//
+// See the LICENSE file distributed with this work for details.
+// See the NOTICE file distributed with this work for additional information
+// regarding copyright ownership.
+//
+// -----------------------------------------------------------------------------
+
+#ifndef CORE_DIFFUSION_ADI_GRID_H_
+#define CORE_DIFFUSION_ADI_GRID_H_
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "core/diffusion/diffusion_grid.h"
+#include "core/util/root.h"
+
+namespace bdm {
+
+/** @brief Continuum model for the 3D heat equation with exponential decay
+           \f$ \partial_t u = \nabla D \nabla u - \mu u \f$.
+
+  The diffusion term is integrated with an alternating direction implicit
+  (ADI) scheme. Each step is split into one implicit theta step per axis
+  (locally one-dimensional splitting):
+
+  \f[
+  \begin{aligned}
+  (1 - \theta r L_x) u^* &= (1 + (1 - \theta) r L_x) u^n \\
+  (1 - \theta r L_y) u^{**} &= (1 + (1 - \theta) r L_y) u^* \\
+  (1 - \theta r L_z) u^{n+1} &= (1 + (1 - \theta) r L_z) u^{**}
+  \end{aligned}
+  \f]
+
+  with \f$ r = D \Delta t / \Delta x^2 \f$ and the second differences
+  \f$ L_x, L_y, L_z \f$. The scheme is unconditionally stable for
+  \f$ \theta \geq 1/2 \f$. Thus, the time step is not limited by the
+  stability condition of the `EulerGrid`. The default \f$ \theta = 1 \f$
+  (implicit Euler) damps all modes and keeps the concentrations positive for
+  any time step. \f$ \theta = 1/2 \f$ (Crank-Nicolson) is more accurate for
+  smooth solutions, but sharp peaks may oscillate for time steps far beyond
+  the explicit limit (see `SetTheta`).
+
+  Each stage consists of independent tridiagonal systems along the lines of
+  one axis, which are solved with the Thomas algorithm. Lines along y and z
+  are solved in batches of neighboring lines, such that the inner loop runs
+  over contiguous memory. The decay is applied as exact factor
+  \f$ e^{-\mu \Delta t} \f$ after the diffusion.
+
+  Supports Dirichlet and Neumann boundary conditions with the same
+  discretization as the `EulerGrid`. Select it with
+  `Param::diffusion_method = "adi"`.
+*/
+class ADIGrid : public DiffusionGrid {
+ public:
+  ADIGrid() = default;
+  ADIGrid(int substance_id, std::string substance_name, real_t dc, real_t mu,
+          int resolution = 10)
+      : DiffusionGrid(substance_id, std::move(substance_name), dc, mu,
+                      resolution) {}
+
+  void Initialize() override {
+    DiffusionGrid::Initialize();
+    c3_.resize(total_num_boxes_);
+  }
+
+  void Update() override {
+    DiffusionGrid::Update();
+    c3_.resize(total_num_boxes_);
+  }
+
+  /// Not implemented for ADIGrid
+  void DiffuseWithClosedEdge(real_t dt) override;
+  /// Not implemented for ADIGrid
+  void DiffuseWithOpenEdge(real_t dt) override;
+  void DiffuseWithDirichlet(real_t dt) override;
+  void DiffuseWithNeumann(real_t dt) override;
+
+  /// Sets the implicitness of the scheme (0.5 <= theta <= 1)
+  void SetTheta(real_t theta) {
+    if (theta < 0.5 || theta > 1) {
+      Log::Fatal("ADIGrid::SetTheta", "Theta must be in [0.5, 1] (", theta,
+                 ").");
+    }
+    theta_ = theta;
+  }
+
+  real_t GetTheta() const { return theta_; }
+
+ protected:
+  /// The scheme is unconditionally stable and the decay is integrated
+  /// exactly. Thus, there is no restriction on `dt`.
+  void ParametersCheck(real_t dt) override {}
+
+ private:
+  /// Tridiagonal matrix (1 - r L) along one axis, factorized for the
+  /// Thomas algorithm
+  struct Factorization {
+    /// Lower diagonal
+    std::vector<real_t> lower;
+    /// Modified upper diagonal
+    std::vector<real_t> upper;
+    /// Inverse of the modified diagonal
+    std::vector<real_t> inv_diagonal;
+  };
+
+  /// Factorizes (1 - r L) for lines with `n` boxes. If `dirichlet` is true,
+  /// the first and last box are fixed.
+  Factorization Factorize(real_t r, size_t n, bool dirichlet) const;
+
+  /// Performs one ADI step
+  void Integrate(real_t dt, bool dirichlet);
+
+  /// Implicitness of the scheme (1: implicit Euler, 0.5: Crank-Nicolson)
+  real_t theta_ = 1;
+  /// Buffer for the intermediate solution of the second stage
+  ParallelResizeVector<real_t> c3_ = {};
+
+  BDM_CLASS_DEF_OVERRIDE(ADIGrid, 1);
+};
+
+}  // namespace bdm
+
+#endif  // CORE_DIFFUSION_ADI_GRID_H_
@@ -0,0 +1,538 @@
+// -----------------------------------------------------------------------------
+//
+// Copyright (C) 2021 CERN & University of Surrey for the benefit of the
+// BioDynaMo collaboration. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+//
+// See the LICENSE file distributed with this work for details.
+// See the NOTICE file distributed with this work for additional information
+// regarding copyright ownership.
+//
+// -----------------------------------------------------------------------------
+
+#include "core/diffusion/amr_grid.h"
+#include <algorithm>
+#include <cmath>
+#include <mutex>
+#include "core/agent/agent.h"
+#include "core/diffusion/grid_util.h"
+#include "core/param/param.h"
+#include "core/resource_manager.h"
+#include "core/simulation.h"
+#include "core/util/log.h"
+
+namespace bdm {
+
+namespace {
+
+/// Returns the argument with the smaller magnitude if both have the same
+/// sign and zero otherwise
+inline real_t MinMod(real_t a, real_t b) {
+  if (a * b <= 0) {
+    return 0;
+  }
+  return std::abs(a) < std::abs(b) ? a : b;
+}
+
+}  // namespace
+
+AMRGrid::AMRGrid(int substance_id, const std::string& substance_name,
+                 real_t dc, real_t mu, int resolution, int block_size,
+                 int refinement)
+    : dc_(dc),
+      mu_(mu),
+      resolution_(resolution),
+      block_size_(block_size),
+      refinement_(refinement) {
+  SetContinuumId(substance_id);
+  SetContinuumName(substance_name);
+}
+
+void AMRGrid::Initialize() {
+  if (resolution_ < 2 || block_size_ == 0 ||
+      resolution_ % block_size_ != 0) {
+    Log::Fatal("AMRGrid::Initialize", "The resolution (", resolution_,
+               ") must be at least 2 and a multiple of the block size (",
+               block_size_, "). (substance '", GetContinuumName(), "')");
+  }
+  if (refinement_ == 0) {
+    Log::Fatal("AMRGrid::Initialize", "The refinement must be at least 1. ",
+               "(substance '", GetContinuumName(), "')");
+  }
+  if (Simulation::GetActive()->GetParam()->non_cubic_diffusion_grid) {
+    Log::Fatal("AMRGrid::Initialize",
+               "Non-cubic grids (Param::non_cubic_diffusion_grid) are not ",
+               "supported. (substance '", GetContinuumName(), "')");
+  }
+
+  grid_dimensions_ =
+      GetCubicGridBounds("AMRGrid::Initialize", GetContinuumName());
+  box_length_ = (grid_dimensions_[1] - grid_dimensions_[0]) /
+                static_cast<real_t>(resolution_);
+  num_blocks_axis_ = resolution_ / block_size_;
+  fine_block_size_ = block_size_ * refinement_;
+
+  const size_t n = resolution_;
+  coarse1_.resize(n * n * n);
+  coarse2_.resize(n * n * n);
+  locks_.resize(n * n * n);
+  block_slots_.assign(num_blocks_axis_ * num_blocks_axis_ * num_blocks_axis_,
+                      -1);
+  refined_blocks_.clear();
+
+  for (auto& initializer : initializers_) {
+#pragma omp parallel for collapse(2)
+    for (size_t z = 0; z < n; z++) {
+      for (size_t y = 0; y < n; y++) {
+        for (size_t x = 0; x < n; x++) {
+          coarse1_[x + (y + z * n) * n] += EvaluateAtBoxCenter(
+              initializer, grid_dimensions_[0], box_length_, x, y, z);
+        }
+      }
+    }
+  }
+  initializers_.clear();
+
+  Regrid();
+}
+
+void AMRGrid::Update() {
+  if (coarse1_.size() != 0) {
+    Regrid();
+  }
+}
+
+void AMRGrid::Step(real_t dt) {
+  if (regrid_interval_ != 0 && ++steps_since_regrid_ >= regrid_interval_) {
+    Regrid();
+  }
+
+  // Split `dt` such that the finest boxes satisfy the stability condition
+  // of the explicit scheme (see `DiffusionGrid::ParametersCheck`)
+  const real_t h =
+      refined_blocks_.empty() ? box_length_ : GetFineBoxLength();
+  const auto num_substeps = GetNumStableSubsteps(dc_, mu_, h, dt);
+  for (uint64_t i = 0; i < num_substeps; i++) {
+    Integrate(dt / num_substeps);
+  }
+}
+
+void AMRGrid::Integrate(real_t dt) {
+  const int64_t nc = resolution_;
+  const int64_t nb = num_blocks_axis_;
+  const int64_t r = refinement_;
+  const int64_t f = fine_block_size_;
+  const int64_t f3 = f * f * f;
+  const real_t hc = box_length_;
+  const real_t hf = hc / r;
+  const real_t decay = 1 - mu_ * dt;
+  // Coefficients of the fluxes between two coarse boxes, two fine boxes, and
+  // a fine and a coarse box (applied to the fine and to the coarse box). The
+  // distance between the centers of a fine and a coarse box is (hc + hf) / 2.
+  const real_t cc = dc_ * dt / (hc * hc);
+  const real_t ff = dc_ * dt / (hf * hf);
+  const real_t dist = (hc + hf) / 2;
+  const real_t fc = dc_ * dt / (dist * hf);
+  const real_t cf = dc_ * dt * hf * hf / (dist * hc * hc * hc);
+
+  // Fine level
+  const int64_t num_slots = refined_blocks_.size();
+#pragma omp parallel for collapse(2)
+  for (int64_t s = 0; s < num_slots; s++) {
+    for (int64_t k = 0; k < f; k++) {
+      const int64_t block = refined_blocks_[s];
+      const std::array<int64_t, 3> origin = {
+          (block % nb) * f, (block / nb % nb) * f, (block / (nb * nb)) * f};
+      const real_t* in = fine1_.data() + s * f3;
+      real_t* out = fine2_.data() + s * f3;
+      for (int64_t j = 0; j < f; j++) {
+        for (int64_t i = 0; i < f; i++) {
+          const int64_t idx = i + f * (j + f * k);
+          const real_t c = in[idx];
+          if (i > 0 && i < f - 1 && j > 0 && j < f - 1 && k > 0 &&
+              k < f - 1) {
+            out[idx] = c * decay + ff * (in[idx - 1] + in[idx + 1] +
+                                         in[idx - f] + in[idx + f] +
+                                         in[idx - f * f] + in[idx + f * f] -
+                                         6 * c);
+            continue;
+          }
+          // Boxes at the faces of the block may have neighbors in other
+          // blocks or on the coarse level
+          real_t flux = 0;
+          for (int axis = 0; axis < 3; axis++) {
+            for (int64_t dir : {-1, 1}) {
+              std::array<int64_t, 3> local = {i, j, k};
+              local[axis] += dir;
+              if (local[axis] >= 0 && local[axis] < f) {
+                flux += ff * (in[local[0] + f * (local[1] + f * local[2])] - c);
+                continue;
+              }
+              std::array<int64_t, 3> g;
+              for (int a = 0; a < 3; a++) {
+                g[a] = origin[a] + local[a];
+              }
+              if (g[axis] < 0 || g[axis] >= nc * r) {
+                // No flux over the boundary
+                continue;
+              }
+              const int64_t nblock = g[0] / f + (g[1] / f + g[2] / f * nb) * nb;
+              const int32_t nslot = block_slots_[nblock];
+              if (nslot >= 0) {
+                const int64_t nidx =
+                    g[0] % f + f * (g[1] % f + f * (g[2] % f));
+                flux += ff * (fine1_[nslot * f3 + nidx] - c);
+              } else {
+                const int64_t cidx = g[0] / r + (g[1] / r + g[2] / r * nc) * nc;
+                flux += fc * (coarse1_[cidx] - c);
+              }
+            }
+          }
+          out[idx] = c * decay + flux;
+        }
+      }
+    }
+  }
+
+  // Coarse level. Boxes of refined blocks are restricted afterwards.
+#pragma omp parallel for collapse(2)
+  for (int64_t z = 0; z < nc; z++) {
+    for (int64_t y = 0; y < nc; y++) {
+      for (int64_t x = 0; x < nc; x++) {
+        if (block_slots_[GetBlockIndex(x, y, z)] >= 0) {
+          continue;
+        }
+        const int64_t idx = x + (y + z * nc) * nc;
+        const real_t c = coarse1_[idx];
+        real_t flux = 0;
+        for (int axis = 0; axis < 3; axis++) {
+          for (int64_t dir : {-1, 1}) {
+            std::array<int64_t, 3> n = {x, y, z};
+            n[axis] += dir;
+            if (n[axis] < 0 || n[axis] >= nc) {
+              continue;
+            }
+            const auto nblock = GetBlockIndex(n[0], n[1], n[2]);
+            const int32_t nslot = block_slots_[nblock];
+            if (nslot < 0) {
+              flux += cc * (coarse1_[n[0] + (n[1] + n[2] * nc) * nc] - c);
+              continue;
+            }
+            // Sum over the fine boxes of the neighbor that share a face with
+            // this box
+            const real_t* fine = fine1_.data() + nslot * f3;
+            std::array<int64_t, 3> base;
+            for (int a = 0; a < 3; a++) {
+              base[a] = (n[a] * r) % f;
+            }
+            base[axis] += dir > 0 ? 0 : r - 1;
+            const int a1 = (axis + 1) % 3;
+            const int a2 = (axis + 2) % 3;
+            real_t sum = 0;
+            for (int64_t u = 0; u < r; u++) {
+              for (int64_t v = 0; v < r; v++) {
+                auto local = base;
+                local[a1] += u;
+                local[a2] += v;
+                sum += fine[local[0] + f * (local[1] + f * local[2])] - c;
+              }
+            }
+            flux += cf * sum;
+          }
+        }
+        coarse2_[idx] = c * decay + flux;
+      }
+    }
+  }
+
+  coarse1_.swap(coarse2_);
+  fine1_.swap(fine2_);
+  Restrict();
+}
+
+void AMRGrid::Restrict() {
+  const size_t nc = resolution_;
+  const size_t nb = num_blocks_axis_;
+  const size_t b = block_size_;
+  const size_t r = refinement_;
+  const size_t f = fine_block_size_;
+  const real_t inv_children = 1 / static_cast<real_t>(r * r * r);
+  const size_t num_slots = refined_blocks_.size();
+
+#pragma omp parallel for
+  for (size_t s = 0; s < num_slots; s++) {
+    const size_t block = refined_blocks_[s];
+    const real_t* fine = fine1_.data() + s * f * f * f;
+    const std::array<size_t, 3> origin = {
+        (block % nb) * b, (block / nb % nb) * b, (block / (nb * nb)) * b};
+    for (size_t z = 0; z < b; z++) {
+      for (size_t y = 0; y < b; y++) {
+        for (size_t x = 0; x < b; x++) {
+          real_t sum = 0;
+          for (size_t k = z * r; k < (z + 1) * r; k++) {
+            for (size_t j = y * r; j < (y + 1) * r; j++) {
+              for (size_t i = x * r; i < (x + 1) * r; i++) {
+                sum += fine[i + f * (j + f * k)];
+              }
+            }
+          }
+          const size_t idx =
+              origin[0] + x + (origin[1] + y + (origin[2] + z) * nc) * nc;
+          coarse1_[idx] = sum * inv_children;
+        }
+      }
+    }
+  }
+}
+
+void AMRGrid::Regrid() {
+  const size_t nc = resolution_;
+  const size_t nb = num_blocks_axis_;
+  const size_t b = block_size_;
+  const size_t f = fine_block_size_;
+  const size_t f3 = f * f * f;
+  const size_t num_blocks = nb * nb * nb;
+  steps_since_regrid_ = 0;
+
+  std::vector<uint8_t> flags(num_blocks, 0);
+  auto* rm = Simulation::GetActive()->GetResourceManager();
+  rm->ForEachAgent([&](Agent* agent) {
+    const auto& pos = agent->GetPosition();
+    auto idx = GetCoarseIndex(pos);
+    if (idx < coarse1_.size()) {
+      flags[GetBlockIndex(idx % nc, idx / nc % nc, idx / (nc * nc))] = 1;
+    }
+  });
+
+  if (gradient_threshold_ != std::numeric_limits<real_t>::infinity()) {
+    // Central differences on the coarse level (one-sided at the boundary)
+    const real_t threshold2 = gradient_threshold_ * gradient_threshold_;
+    const real_t ibl = 1 / box_length_;
+#pragma omp parallel for
+    for (size_t block = 0; block < num_blocks; block++) {
+      if (flags[block]) {
+        continue;
+      }
+      const std::array<size_t, 3> origin = {
+          (block % nb) * b, (block / nb % nb) * b, (block / (nb * nb)) * b};
+      for (size_t i = 0; i < b * b * b && !flags[block]; i++) {
+        const std::array<size_t, 3> coord = {origin[0] + i % b,
+                                             origin[1] + i / b % b,
+                                             origin[2] + i / (b * b)};
+        const size_t idx = coord[0] + (coord[1] + coord[2] * nc) * nc;
+        const std::array<size_t, 3> stride = {1, nc, nc * nc};
+        real_t norm2 = 0;
+        for (int a = 0; a < 3; a++) {
+          const size_t lo = coord[a] == 0 ? idx : idx - stride[a];
+          const size_t hi = coord[a] == nc - 1 ? idx : idx + stride[a];
+          const real_t g = (coarse1_[hi] - coarse1_[lo]) * ibl /
+                           ((coord[a] != 0) + (coord[a] != nc - 1));
+          norm2 += g * g;
+        }
+        if (norm2 > threshold2) {
+          flags[block] = 1;
+        }
+      }
+    }
+  }
+
+  std::vector<int32_t> slots(num_blocks, -1);
+  std::vector<uint32_t> refined;
+  for (size_t block = 0; block < num_blocks; block++) {
+    if (flags[block]) {
+      slots[block] = static_cast<int32_t>(refined.size());
+      refined.push_back(static_cast<uint32_t>(block));
+    }
+  }
+
+  // Refined blocks keep their fine boxes. Coarsened blocks need no update,
+  // because their coarse boxes are restricted after each change.
+  ParallelResizeVector<real_t> fine;
+  fine.resize(refined.size() * f3);
+#pragma omp parallel for
+  for (size_t s = 0; s < refined.size(); s++) {
+    const auto block = refined[s];
+    const auto old_slot = block_slots_[block];
+    if (old_slot >= 0) {
+      std::copy(fine1_.data() + old_slot * f3,
+                fine1_.data() + (old_slot + 1) * f3, fine.data() + s * f3);
+    } else {
+      Prolongate(block, fine.data() + s * f3);
+    }
+  }
+  fine1_.swap(fine);
+  fine2_.resize(fine1_.size());
+  block_slots_.swap(slots);
+  refined_blocks_.swap(refined);
+}
+
+void AMRGrid::Prolongate(size_t block, real_t* fine) const {
+  const size_t nc = resolution_;
+  const size_t nb = num_blocks_axis_;
+  const size_t b = block_size_;
+  const size_t r = refinement_;
+  const size_t f = fine_block_size_;
+  const std::array<size_t, 3> origin = {
+      (block % nb) * b, (block / nb % nb) * b, (block / (nb * nb)) * b};
+  const std::array<size_t, 3> stride = {1, nc, nc * nc};
+
+  for (size_t z = 0; z < b; z++) {
+    for (size_t y = 0; y < b; y++) {
+      for (size_t x = 0; x < b; x++) {
+        const std::array<size_t, 3> coord = {origin[0] + x, origin[1] + y,
+                                             origin[2] + z};
+        const size_t idx = coord[0] + (coord[1] + coord[2] * nc) * nc;
+        const real_t c = coarse1_[idx];
+        // Limited differences per coarse box. The offsets of the fine boxes
+        // from the coarse center sum up to zero, which conserves the amount.
+        Real3 slope = {0, 0, 0};
+        for (int a = 0; a < 3; a++) {
+          if (coord[a] != 0 && coord[a] != nc - 1) {
+            slope[a] = MinMod(c - coarse1_[idx - stride[a]],
+                              coarse1_[idx + stride[a]] - c);
+          }
+        }
+        for (size_t k = 0; k < r; k++) {
+          for (size_t j = 0; j < r; j++) {
+            for (size_t i = 0; i < r; i++) {
+              const real_t ox = (i + 0.5) / r - 0.5;
+              const real_t oy = (j + 0.5) / r - 0.5;
+              const real_t oz = (k + 0.5) / r - 0.5;
+              const size_t fidx =
+                  x * r + i + f * (y * r + j + f * (z * r + k));
+              fine[fidx] =
+                  c + slope[0] * ox + slope[1] * oy + slope[2] * oz;
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+void AMRGrid::ChangeConcentrationBy(const Real3& position, real_t amount) {
+  auto idx = GetCoarseIndex(position);
+  if (idx >= coarse1_.size()) {
+    Log::Error("AMRGrid::ChangeConcentrationBy",
+               "You tried to change the concentration outside the bounds of "
+               "the diffusion grid! The change was ignored.");
+    return;
+  }
+  const size_t nc = resolution_;
+  const auto slot =
+      block_slots_[GetBlockIndex(idx % nc, idx / nc % nc, idx / (nc * nc))];
+  std::lock_guard<Spinlock> guard(locks_[idx]);
+  if (slot < 0) {
+    coarse1_[idx] += amount;
+    return;
+  }
+  // The fine box is r^3 times smaller than the coarse box. Its concentration
+  // is changed r^3 times more to add the same amount of substance, and the
+  // coarse box stays the average of its fine boxes.
+  fine1_[GetFineIndex(position, slot)] +=
+      amount * refinement_ * refinement_ * refinement_;
+  coarse1_[idx] += amount;
+}
+
+real_t AMRGrid::GetValue(const Real3& position) const {
+  auto idx = GetCoarseIndex(position);
+  if (idx >= coarse1_.size()) {
+    Log::Error("AMRGrid::GetValue",
+               "You tried to get the concentration outside the bounds of "
+               "the diffusion grid!");
+    return 0;
+  }
+  std::lock_guard<Spinlock> guard(locks_[idx]);
+  return ValueAt(position);
+}
+
+Real3 AMRGrid::GetGradient(const Real3& position) const {
+  if (GetCoarseIndex(position) >= coarse1_.size()) {
+    Log::Error("AMRGrid::GetGradient",
+               "You tried to get the gradient outside the bounds of "
+               "the diffusion grid! Returning zero gradient.");
+    return {0, 0, 0};
+  }
+  const real_t h = IsRefined(position) ? GetFineBoxLength() : box_length_;
+  // Sample points are kept inside the boxes at the boundary
+  const real_t lower = grid_dimensions_[0] + h / 2;
+  const real_t upper = grid_dimensions_[1] - h / 2;
+  Real3 gradient = {0, 0, 0};
+  for (int a = 0; a < 3; a++) {
+    auto minus = position;
+    auto plus = position;
+    minus[a] = std::max(position[a] - h, lower);
+    plus[a] = std::min(position[a] + h, upper);
+    if (plus[a] > minus[a]) {
+      gradient[a] = (ValueAt(plus) - ValueAt(minus)) / (plus[a] - minus[a]);
+    }
+  }
+  return gradient;
+}
+
+bool AMRGrid::IsRefined(const Real3& position) const {
+  auto idx = GetCoarseIndex(position);
+  if (idx >= coarse1_.size()) {
+    return false;
+  }
+  const size_t nc = resolution_;
+  return block_slots_[GetBlockIndex(idx % nc, idx / nc % nc,
+                                    idx / (nc * nc))] >= 0;
+}
+
+real_t AMRGrid::GetTotalAmount() const {
+  // The coarse boxes of refined blocks hold the average of their fine boxes
+  real_t sum = 0;
+#pragma omp parallel for reduction(+ : sum)
+  for (size_t i = 0; i < coarse1_.size(); i++) {
+    sum += coarse1_[i];
+  }
+  return sum * box_length_ * box_length_ * box_length_;
+}
+
+size_t AMRGrid::GetCoarseIndex(const Real3& position) const {
+  const size_t n = resolution_;
+  std::array<size_t, 3> box_coord;
+  if (!GetCubicBoxCoordinates(position, grid_dimensions_[0], box_length_, n,
+                              &box_coord)) {
+    return n * n * n;
+  }
+  return box_coord[0] + (box_coord[1] + box_coord[2] * n) * n;
+}
+
+size_t AMRGrid::GetBlockIndex(size_t x, size_t y, size_t z) const {
+  const size_t nb = num_blocks_axis_;
+  return x / block_size_ + (y / block_size_ + z / block_size_ * nb) * nb;
+}
+
+size_t AMRGrid::GetFineIndex(const Real3& position, int32_t slot) const {
+  const size_t f = fine_block_size_;
+  const real_t hf = GetFineBoxLength();
+  const int64_t r = refinement_;
+  std::array<size_t, 3> local;
+  for (size_t i = 0; i < 3; i++) {
+    // Keep the fine box inside the coarse box of `position` in case of
+    // rounding errors
+    const real_t offset = position[i] - grid_dimensions_[0];
+    const auto coarse = static_cast<int64_t>(std::floor(offset / box_length_));
+    auto coord = static_cast<int64_t>(std::floor(offset / hf));
+    coord = std::min(std::max(coord, coarse * r), coarse * r + r - 1);
+    local[i] = coord % f;
+  }
+  return slot * f * f * f + local[0] + f * (local[1] + f * local[2]);
+}
+
+real_t AMRGrid::ValueAt(const Real3& position) const {
+  const size_t nc = resolution_;
+  auto idx = GetCoarseIndex(position);
+  const auto slot =
+      block_slots_[GetBlockIndex(idx % nc, idx / nc % nc, idx / (nc * nc))];
+  if (slot < 0) {
+    return coarse1_[idx];
+  }
+  return fine1_[GetFineIndex(position, slot)];
+}
+
+}  // namespace bdm
@@ -0,0 +1,194 @@
+// -----------------------------------------------------------------------------
+//
+// Copyright (C) 2021 CERN & University of Surrey for the benefit of the
+// BioDynaMo collaboration. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+//
+// See the LICENSE file distributed with this work for details.
+// See the NOTICE file distributed with this work for additional information
+// regarding copyright ownership.
+//
+// -----------------------------------------------------------------------------
+
+#ifndef CORE_DIFFUSION_AMR_GRID_H_
+#define CORE_DIFFUSION_AMR_GRID_H_
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "core/container/math_array.h"
+#include "core/container/parallel_resize_vector.h"
+#include "core/diffusion/continuum_interface.h"
+#include "core/util/root.h"
+#include "core/util/spinlock.h"
+
+namespace bdm {
+
+/// @brief Diffusion grid with block-structured adaptive mesh refinement.
+///
+/// A uniform `DiffusionGrid` must resolve the whole domain with the box
+/// length that is required near the agents. This scalar field uses a coarse
+/// grid with `resolution` boxes per axis instead, which is divided into
+/// blocks of `block_size`^3 boxes. Blocks that contain an agent, or in which
+/// the magnitude of the concentration gradient exceeds a threshold, are
+/// refined by `refinement` along each axis:
+///
+///     // 1 um boxes near the cells, 8 um boxes elsewhere
+///     auto* grid = new AMRGrid(kOxygen, "Oxygen", 100, 0.01, 125, 5, 8);
+///     grid->SetGradientThreshold(0.5);
+///     rm->AddContinuum(grid);
+///
+/// The diffusion equation is integrated with an explicit finite volume
+/// scheme on the composite grid. The fluxes over the faces between a fine
+/// and a coarse box are computed once and applied to both boxes, hence the
+/// total amount of substance only changes through decay and
+/// `ChangeConcentrationBy`. Both levels are updated in parallel from the
+/// same state. Afterwards, the coarse boxes of refined blocks are set to the
+/// average of their fine boxes (restriction). New fine boxes are initialized
+/// with a limited linear interpolation of the coarse boxes (prolongation),
+/// which conserves the amount of substance as well. The blocks are adapted
+/// in `Update` and every `regrid_interval` steps. `Step` splits `dt` into
+/// substeps if it exceeds the stability limit of the finest box length.
+///
+/// The domain is static: the grid covers the cube given by the dimension
+/// thresholds of the environment in `Initialize` and does not grow with the
+/// simulation space (`Update` only adapts the refined blocks). Use a bound
+/// space (`Param::bound_space`) such that the agents stay inside the grid.
+/// Non-cubic grids (`Param::non_cubic_diffusion_grid`) are not supported.
+/// The boundaries are closed for fluxes (homogeneous Neumann).
+class AMRGrid : public ScalarField {
+ public:
+  AMRGrid() = default;
+  explicit AMRGrid(const TRootIOCtor*) {}
+  AMRGrid(int substance_id, const std::string& substance_name, real_t dc,
+          real_t mu, int resolution = 16, int block_size = 4,
+          int refinement = 2);
+  ~AMRGrid() override = default;
+
+  /// Adds an initializer that is evaluated on the coarse level in
+  /// `Initialize` (see `DiffusionGrid::AddInitializer`)
+  template <typename F>
+  void AddInitializer(F function) {
+    initializers_.push_back(function);
+  }
+
+  void Initialize() override;
+
+  /// Adapts the refined blocks to the current agents and gradients
+  void Update() override;
+
+  void Step(real_t dt) override;
+
+  /// Increases the concentration in the coarse box at `position` by
+  /// `amount`. If the block at `position` is refined, the same amount of
+  /// substance is added to the fine box at `position` only, i.e. its
+  /// concentration increases by `amount` times `refinement`^3.
+  /// Thread-safe.
+  void ChangeConcentrationBy(const Real3& position, real_t amount);
+
+  /// Returns the concentration of the finest box at `position`
+  real_t GetValue(const Real3& position) const override;
+
+  /// Returns the gradient at `position`. It is computed with central
+  /// differences with the box length of the finest box at `position`.
+  Real3 GetGradient(const Real3& position) const override;
+
+  /// Blocks in which the magnitude of the gradient on the coarse level
+  /// exceeds `threshold` are refined. By default, only blocks with agents are
+  /// refined.
+  void SetGradientThreshold(real_t threshold) {
+    gradient_threshold_ = threshold;
+  }
+
+  /// Sets the number of steps after which the refined blocks are adapted.
+  /// Zero disables the adaptation in `Step`.
+  void SetRegridInterval(uint64_t interval) { regrid_interval_ = interval; }
+
+  /// Returns true if the block at `position` is refined
+  bool IsRefined(const Real3& position) const;
+
+  size_t GetNumRefinedBlocks() const { return refined_blocks_.size(); }
+
+  /// Returns the integral of the concentration over the domain
+  real_t GetTotalAmount() const;
+
+  real_t GetCoarseBoxLength() const { return box_length_; }
+
+  real_t GetFineBoxLength() const { return box_length_ / refinement_; }
+
+  size_t GetResolution() const { return resolution_; }
+
+ private:
+  /// Returns the index of the coarse box at `position`, or the total number
+  /// of coarse boxes if `position` is outside of the grid
+  size_t GetCoarseIndex(const Real3& position) const;
+
+  /// Returns the index of the block that contains the coarse box
+  /// (`x`, `y`, `z`)
+  size_t GetBlockIndex(size_t x, size_t y, size_t z) const;
+
+  /// Returns the index of the fine box at `position` within the fine storage
+  /// of `slot`
+  size_t GetFineIndex(const Real3& position, int32_t slot) const;
+
+  /// Returns the value of the finest box at `position` without checks
+  real_t ValueAt(const Real3& position) const;
+
+  /// Refines all blocks with agents or with steep gradients and coarsens
+  /// all others
+  void Regrid();
+
+  /// Initializes the fine boxes of `block` from the coarse level
+  void Prolongate(size_t block, real_t* fine) const;
+
+  /// Performs one explicit step on both levels
+  void Integrate(real_t dt);
+
+  /// Sets the coarse boxes of refined blocks to the average of their fine
+  /// boxes
+  void Restrict();
+
+  real_t dc_ = 0;
+  real_t mu_ = 0;
+  size_t resolution_ = 0;
+  size_t block_size_ = 0;
+  size_t refinement_ = 0;
+  /// Number of blocks along each axis
+  size_t num_blocks_axis_ = 0;
+  /// Number of fine boxes along each axis of a block
+  size_t fine_block_size_ = 0;
+  real_t box_length_ = 0;
+  std::array<int32_t, 2> grid_dimensions_ = {{0, 0}};
+  real_t gradient_threshold_ = std::numeric_limits<real_t>::infinity();
+  uint64_t regrid_interval_ = 10;
+  uint64_t steps_since_regrid_ = 0;
+
+  /// Concentrations of the coarse level
+  ParallelResizeVector<real_t> coarse1_ = {};
+  ParallelResizeVector<real_t> coarse2_ = {};
+  /// Concentrations of the fine level. The boxes of each refined block are
+  /// stored contiguously in the order of `refined_blocks_`.
+  ParallelResizeVector<real_t> fine1_ = {};
+  ParallelResizeVector<real_t> fine2_ = {};
+  /// Position of each block in `refined_blocks_`, or -1 if the block is not
+  /// refined
+  std::vector<int32_t> block_slots_ = {};
+  /// Indices of the refined blocks
+  std::vector<uint32_t> refined_blocks_ = {};
+  /// One lock per coarse box (including its fine boxes)
+  mutable ParallelResizeVector<Spinlock> locks_ = {};  //!
+  std::vector<std::function<real_t(real_t, real_t, real_t)>>
+      initializers_ = {};  //!
+
+  BDM_CLASS_DEF_OVERRIDE(AMRGrid, 1);
+};
+
+}  // namespace bdm
+
+#endif  // CORE_DIFFUSION_AMR_GRID_H_
@@ -0,0 +1,357 @@
+// -----------------------------------------------------------------------------
+//
+// Copyright (C) 2021 CERN & University of Surrey for the benefit of the
+// BioDynaMo collaboration. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+//
+// See the LICENSE file distributed with this work for details.
+// See the NOTICE file distributed with this work for additional information
+// regarding copyright ownership.
+//
+// -----------------------------------------------------------------------------
+
+#include "core/diffusion/bricked_grid.h"
+#include <morton/morton.h>  // NOLINT
+#include <cmath>
+#include <mutex>
+#include <utility>
+#include "core/diffusion/grid_util.h"
+#include "core/simulation.h"
+#include "core/util/log.h"
+
+namespace bdm {
+
+constexpr uint32_t BrickedGrid::kBrickSize;
+constexpr uint32_t BrickedGrid::kBrickVolume;
+
+BrickedGrid::BrickedGrid(int substance_id, const std::string& substance_name,
+                         real_t dc, real_t mu, int resolution)
+    : dc_(dc), mu_(mu), resolution_(resolution) {
+  SetContinuumId(substance_id);
+  SetContinuumName(substance_name);
+}
+
+void BrickedGrid::Initialize() {
+  if (resolution_ < 2) {
+    Log::Fatal("BrickedGrid::Initialize", "The resolution (", resolution_,
+               ") must be at least 2. (substance '", GetContinuumName(),
+               "')");
+  }
+  grid_dimensions_ =
+      GetCubicGridBounds("BrickedGrid::Initialize", GetContinuumName());
+  box_length_ = (grid_dimensions_[1] - grid_dimensions_[0]) /
+                static_cast<real_t>(resolution_);
+  AllocateBricks();
+
+  for (auto& initializer : initializers_) {
+    ForEachBrick([&](size_t slot, const std::array<uint32_t, 3>& origin,
+                     const std::array<uint32_t, 3>& extent) {
+      real_t* data = c1_.data() + slot * kBrickVolume;
+      for (uint32_t k = 0; k < extent[2]; k++) {
+        for (uint32_t j = 0; j < extent[1]; j++) {
+          for (uint32_t i = 0; i < extent[0]; i++) {
+            data[i + kBrickSize * (j + kBrickSize * k)] += EvaluateAtBoxCenter(
+                initializer, grid_dimensions_[0], box_length_, origin[0] + i,
+                origin[1] + j, origin[2] + k);
+          }
+        }
+      }
+    });
+  }
+  initializers_.clear();
+}
+
+void BrickedGrid::Update() {
+  if (c1_.size() == 0) {
+    return;
+  }
+  auto bounds = GetCubicGridBounds("BrickedGrid::Update", GetContinuumName());
+  if (bounds[0] >= grid_dimensions_[0] && bounds[1] <= grid_dimensions_[1]) {
+    return;
+  }
+
+  // Boxes are added on the lattice of the old grid, such that the old boxes
+  // keep their position in space (see `DiffusionGrid::Update`)
+  const auto below = RoundUpNumBoxes(
+      std::max<int64_t>(0, GetNumBoxesToCover(grid_dimensions_[0] - bounds[0],
+                                              box_length_)),
+      GetIntegerLengthNumBoxes(box_length_));
+  const auto above = std::max<int64_t>(
+      0, GetNumBoxesToCover(bounds[1] - grid_dimensions_[0], box_length_) -
+             resolution_);
+  const size_t old_resolution = resolution_;
+  std::vector<real_t> old_concentrations(GetNumBoxes());
+  CopyConcentrations(old_concentrations.data());
+
+  resolution_ += below + above;
+  grid_dimensions_[0] -= static_cast<int32_t>(std::lround(below * box_length_));
+  grid_dimensions_[1] =
+      grid_dimensions_[0] +
+      static_cast<int32_t>(std::ceil(resolution_ * box_length_ - 1e-9));
+  c1_.clear();
+  c2_.clear();
+  AllocateBricks();
+
+  const int64_t n = old_resolution;
+#pragma omp parallel for collapse(2)
+  for (int64_t z = 0; z < n; z++) {
+    for (int64_t y = 0; y < n; y++) {
+      for (int64_t x = 0; x < n; x++) {
+        c1_[GetStorageIndex(x + below, y + below, z + below)] =
+            old_concentrations[x + (y + z * n) * n];
+      }
+    }
+  }
+}
+
+void BrickedGrid::AllocateBricks() {
+  num_bricks_axis_ = (resolution_ + kBrickSize - 1) / kBrickSize;
+
+  // Sort the bricks by their Morton code
+  const uint32_t nb = num_bricks_axis_;
+  const uint32_t num_bricks = nb * nb * nb;
+  std::vector<std::pair<uint64_t, uint32_t>> codes(num_bricks);
+  for (uint32_t b = 0; b < num_bricks; b++) {
+    codes[b] = {libmorton::morton3D_64_encode(b % nb, b / nb % nb,
+                                              b / (nb * nb)),
+                b};
+  }
+  std::sort(codes.begin(), codes.end());
+  bricks_.resize(num_bricks);
+  brick_slots_.resize(num_bricks);
+  for (uint32_t s = 0; s < num_bricks; s++) {
+    bricks_[s] = codes[s].second;
+    brick_slots_[codes[s].second] = s;
+  }
+  brick_neighbors_.resize(6 * num_bricks);
+  for (uint32_t s = 0; s < num_bricks; s++) {
+    const uint32_t b = bricks_[s];
+    const std::array<int64_t, 3> coord = {b % nb, b / nb % nb, b / (nb * nb)};
+    for (int axis = 0; axis < 3; axis++) {
+      for (int dir = 0; dir < 2; dir++) {
+        auto n = coord;
+        n[axis] += dir == 0 ? -1 : 1;
+        int32_t slot = -1;
+        if (n[axis] >= 0 && n[axis] < nb) {
+          slot = brick_slots_[n[0] + (n[1] + n[2] * nb) * nb];
+        }
+        brick_neighbors_[6 * s + 2 * axis + dir] = slot;
+      }
+    }
+  }
+
+  c1_.resize(static_cast<size_t>(num_bricks) * kBrickVolume);
+  c2_.resize(static_cast<size_t>(num_bricks) * kBrickVolume);
+  locks_.resize(num_bricks);
+  // All bricks are updated in the first step
+  brick_changes_.assign(num_bricks, 0);
+  brick_sources_.assign(num_bricks, 1);
+  brick_active_.assign(num_bricks, 1);
+  brick_synced_.assign(num_bricks, 0);
+}
+
+void BrickedGrid::Step(real_t dt) {
+  // Split `dt` such that the stability condition of the explicit scheme is
+  // satisfied
+  const auto num_substeps = GetNumStableSubsteps(dc_, mu_, box_length_, dt);
+  for (uint64_t i = 0; i < num_substeps; i++) {
+    Integrate(dt / num_substeps);
+  }
+}
+
+void BrickedGrid::UpdateActivity() {
+  const int64_t num_bricks = bricks_.size();
+  size_t num_active = 0;
+#pragma omp parallel for reduction(+ : num_active)
+  for (int64_t s = 0; s < num_bricks; s++) {
+    bool active = activity_threshold_ < 0 || brick_sources_[s] ||
+                  brick_changes_[s] > activity_threshold_;
+    for (int i = 0; i < 6 && !active; i++) {
+      const int32_t n = brick_neighbors_[6 * s + i];
+      // Flux leaves a source through the faces of its brick, hence the
+      // neighbors of a source must be updated as well
+      active = n >= 0 && (brick_sources_[n] ||
+                          brick_changes_[n] > activity_threshold_);
+    }
+    brick_active_[s] = active;
+    num_active += active;
+  }
+  num_active_bricks_ = num_active;
+}
+
+void BrickedGrid::Integrate(real_t dt) {
+  constexpr int64_t b = kBrickSize;
+  const real_t decay = 1 - mu_ * dt;
+  const real_t d = dc_ * dt / (box_length_ * box_length_);
+  const real_t* all = c1_.data();
+
+  UpdateActivity();
+  ForEachBrick([&](size_t slot, const std::array<uint32_t, 3>&,
+                   const std::array<uint32_t, 3>& extent) {
+    const real_t* in = all + slot * kBrickVolume;
+    real_t* out = c2_.data() + slot * kBrickVolume;
+    if (!brick_active_[slot]) {
+      // The values of skipped bricks are carried over to the next step. The
+      // copy is only required in the first step after an update.
+      if (!brick_synced_[slot]) {
+        std::copy(in, in + kBrickVolume, out);
+        brick_synced_[slot] = 1;
+      }
+      brick_changes_[slot] = 0;
+      return;
+    }
+    real_t change = 0;
+    const int32_t* neighbors = brick_neighbors_.data() + 6 * slot;
+    const std::array<int64_t, 3> e = {extent[0], extent[1], extent[2]};
+    for (int64_t k = 0; k < e[2]; k++) {
+      for (int64_t j = 0; j < e[1]; j++) {
+        const bool inner_row = j > 0 && j < e[1] - 1 && k > 0 && k < e[2] - 1;
+        for (int64_t i = 0; i < e[0]; i++) {
+          const int64_t idx = i + b * (j + b * k);
+          const real_t c = in[idx];
+          if (inner_row && i > 0 && i < e[0] - 1) {
+            out[idx] = c * decay + d * (in[idx - 1] + in[idx + 1] +
+                                        in[idx - b] + in[idx + b] +
+                                        in[idx - b * b] + in[idx + b * b] -
+                                        6 * c);
+            change = std::max(change, std::abs(out[idx] - c));
+            continue;
+          }
+          // Boxes at the faces of the brick read their neighbors from the
+          // adjacent bricks
+          real_t sum = 0;
+          for (int axis = 0; axis < 3; axis++) {
+            for (int dir = 0; dir < 2; dir++) {
+              std::array<int64_t, 3> local = {i, j, k};
+              local[axis] += dir == 0 ? -1 : 1;
+              if (local[axis] >= 0 && local[axis] < e[axis]) {
+                sum += in[local[0] + b * (local[1] + b * local[2])] - c;
+                continue;
+              }
+              const int32_t nslot = neighbors[2 * axis + dir];
+              if (local[axis] != -1 && local[axis] != b) {
+                // Upper boundary of the grid inside of this brick
+                continue;
+              }
+              if (nslot < 0) {
+                // No flux over the boundary
+                continue;
+              }
+              local[axis] = (local[axis] + b) % b;
+              sum += all[nslot * kBrickVolume + local[0] +
+                         b * (local[1] + b * local[2])] -
+                     c;
+            }
+          }
+          out[idx] = c * decay + d * sum;
+          change = std::max(change, std::abs(out[idx] - c));
+        }
+      }
+    }
+    brick_changes_[slot] = change;
+    brick_sources_[slot] = 0;
+    brick_synced_[slot] = 0;
+  });
+
+  c1_.swap(c2_);
+}
+
+void BrickedGrid::ChangeConcentrationBy(const Real3& position,
+                                        real_t amount) {
+  std::array<uint32_t, 3> box;
+  if (!GetCubicBoxCoordinates(position, grid_dimensions_[0], box_length_,
+                              resolution_, &box)) {
+    Log::Error("BrickedGrid::ChangeConcentrationBy",
+               "You tried to change the concentration outside the bounds of "
+               "the diffusion grid! The change was ignored.");
+    return;
+  }
+  const auto idx = GetStorageIndex(box[0], box[1], box[2]);
+  std::lock_guard<Spinlock> guard(locks_[idx / kBrickVolume]);
+  c1_[idx] += amount;
+  brick_sources_[idx / kBrickVolume] = 1;
+}
+
+real_t BrickedGrid::GetValue(const Real3& position) const {
+  std::array<uint32_t, 3> box;
+  if (!GetCubicBoxCoordinates(position, grid_dimensions_[0], box_length_,
+                              resolution_, &box)) {
+    Log::Error("BrickedGrid::GetValue",
+               "You tried to get the concentration outside the bounds of "
+               "the diffusion grid!");
+    return 0;
+  }
+  const auto idx = GetStorageIndex(box[0], box[1], box[2]);
+  std::lock_guard<Spinlock> guard(locks_[idx / kBrickVolume]);
+  return c1_[idx];
+}
+
+Real3 BrickedGrid::GetGradient(const Real3& position) const {
+  std::array<uint32_t, 3> box;
+  if (!GetCubicBoxCoordinates(position, grid_dimensions_[0], box_length_,
+                              resolution_, &box)) {
+    Log::Error("BrickedGrid::GetGradient",
+               "You tried to get the gradient outside the bounds of "
+               "the diffusion grid! Returning zero gradient.");
+    return {0, 0, 0};
+  }
+  return GradientAt(box[0], box[1], box[2]);
+}
+
+void BrickedGrid::CopyConcentrations(real_t* dest) const {
+  ForEachBox([dest](size_t idx, real_t value) { dest[idx] = value; });
+}
+
+void BrickedGrid::CopyGradients(real_t* dest) const {
+  const size_t n = resolution_;
+  ForEachBrick([&](size_t, const std::array<uint32_t, 3>& origin,
+                   const std::array<uint32_t, 3>& extent) {
+    for (uint32_t k = 0; k < extent[2]; k++) {
+      for (uint32_t j = 0; j < extent[1]; j++) {
+        for (uint32_t i = 0; i < extent[0]; i++) {
+          const uint32_t x = origin[0] + i;
+          const uint32_t y = origin[1] + j;
+          const uint32_t z = origin[2] + k;
+          const auto gradient = GradientAt(x, y, z);
+          const size_t idx = x + (y + z * n) * n;
+          for (int a = 0; a < 3; a++) {
+            dest[3 * idx + a] = gradient[a];
+          }
+        }
+      }
+    }
+  });
+}
+
+real_t BrickedGrid::GetTotalAmount() const {
+  // Boxes of the bricks that lie outside of the grid are always zero
+  real_t sum = 0;
+#pragma omp parallel for reduction(+ : sum)
+  for (size_t i = 0; i < c1_.size(); i++) {
+    sum += c1_[i];
+  }
+  return sum * box_length_ * box_length_ * box_length_;
+}
+
+Real3 BrickedGrid::GradientAt(uint32_t x, uint32_t y, uint32_t z) const {
+  const std::array<uint32_t, 3> box = {x, y, z};
+  Real3 gradient = {0, 0, 0};
+  for (int a = 0; a < 3; a++) {
+    auto minus = box;
+    auto plus = box;
+    if (minus[a] > 0) {
+      minus[a]--;
+    }
+    if (plus[a] < resolution_ - 1) {
+      plus[a]++;
+    }
+    gradient[a] = (c1_[GetStorageIndex(plus[0], plus[1], plus[2])] -
+                   c1_[GetStorageIndex(minus[0], minus[1], minus[2])]) /
+                  ((plus[a] - minus[a]) * box_length_);
+  }
+  return gradient;
+}
+
+}  // namespace bdm
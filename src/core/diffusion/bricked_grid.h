@@ -0,0 +1,274 @@
+// -----------------------------------------------------------------------------
+//
+// Copyright (C) 2021 CERN & University of Surrey for the benefit of the
+// BioDynaMo collaboration. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+//
+// See the LICENSE file distributed with this work for details.
+// See the NOTICE file distributed with this work for additional information
+// regarding copyright ownership.
+//
+// -----------------------------------------------------------------------------
+
+#ifndef CORE_DIFFUSION_BRICKED_GRID_H_
+#define CORE_DIFFUSION_BRICKED_GRID_H_
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "core/container/math_array.h"
+#include "core/container/parallel_resize_vector.h"
+#include "core/diffusion/continuum_interface.h"
+#include "core/util/root.h"
+#include "core/util/spinlock.h"
+
+namespace bdm {
+
+/// @brief Diffusion grid that stores the boxes in bricks of 8^3 boxes.
+///
+/// `DiffusionGrid` stores the concentrations in one array with x as the
+/// fastest index. The neighbors of a box in z direction are `nx * ny`
+/// elements apart, and the boxes around an agent are spread over many pages.
+/// This scalar field stores the boxes of each brick contiguously (x fastest
+/// within the brick), and the bricks in Morton order. Neighboring boxes are
+/// thus mostly in the same brick, and bricks that are close in space are
+/// close in memory:
+///
+///     auto* grid = new BrickedGrid(kOxygen, "Oxygen", 100, 0.01, 256);
+///     rm->AddContinuum(grid);
+///
+/// The diffusion equation is integrated with the explicit Euler method. The
+/// stencil reads the boxes of adjacent bricks directly, i.e. no ghost layers
+/// are copied. Bricks are distributed among the threads in Morton order,
+/// such that each thread works on a compact region of the grid. `Step`
+/// splits `dt` into substeps if it exceeds the stability limit.
+///
+/// Bricks in steady state are skipped. A brick is updated only if the
+/// concentration in it or in one of its six neighbors changed by more than
+/// the activity threshold during the previous step, or if
+/// `ChangeConcentrationBy` modified it or one of its six neighbors since.
+/// With the default threshold of zero, only bricks whose update would not
+/// change them are skipped (e.g. empty regions far away from the sources),
+/// hence the result is the same as without skipping. Larger thresholds also
+/// freeze regions that are close to equilibrium, and the cost of a step
+/// becomes proportional to the volume in which the concentration still
+/// changes.
+///
+/// `ForEachBrick` and `ForEachBox` iterate over the storage, and
+/// `CopyConcentrations` and `CopyGradients` write the x-fastest layout of
+/// `DiffusionGrid::GetAllConcentrations` and
+/// `DiffusionGrid::GetAllGradients` for consumers that require it (e.g. the
+/// export to ParaView).
+///
+/// The grid covers the cube given by the dimension thresholds of the
+/// environment. If the simulation space grows, `Update` adds boxes on the
+/// lattice of the existing ones, such that the boxes keep their position in
+/// space. The boundaries are closed for fluxes (homogeneous Neumann).
+///
+/// `ParaviewAdaptor` exports the grid like a `DiffusionGrid` if its name is
+/// listed in `Param::visualize_diffusion`.
+///
+/// Limitation: this grid is not a `DiffusionGrid`. It can not be selected
+/// with `Param::diffusion_method` in `ModelInitializer::DefineSubstance`, and
+/// it can not be used by `ModelInitializer::InitializeSubstance` or by
+/// behaviors that require a `DiffusionGrid` (e.g. `Secretion` and
+/// `Chemotaxis`). Models add it with `ResourceManager::AddContinuum` as
+/// shown above, and access it in their own behaviors:
+///
+///     auto* rm = Simulation::GetActive()->GetResourceManager();
+///     auto* grid = bdm_static_cast<BrickedGrid*>(rm->GetContinuum(kOxygen));
+///     grid->ChangeConcentrationBy(agent->GetPosition(), 1);
+///     auto gradient = grid->GetGradient(agent->GetPosition());
+class BrickedGrid : public ScalarField {
+ public:
+  /// Number of boxes along each axis of a brick
+  static constexpr uint32_t kBrickSize = 8;
+  static constexpr uint32_t kBrickVolume = kBrickSize * kBrickSize * kBrickSize;
+
+  BrickedGrid() = default;
+  explicit BrickedGrid(const TRootIOCtor*) {}
+  BrickedGrid(int substance_id, const std::string& substance_name, real_t dc,
+              real_t mu, int resolution = 16);
+  ~BrickedGrid() override = default;
+
+  /// Adds an initializer (see `DiffusionGrid::AddInitializer`)
+  template <typename F>
+  void AddInitializer(F function) {
+    initializers_.push_back(function);
+  }
+
+  void Initialize() override;
+
+  /// Grows the grid if the simulation space outgrew it
+  void Update() override;
+
+  void Step(real_t dt) override;
+
+  /// Increases the concentration in the box at `position` by `amount`.
+  /// Thread-safe.
+  void ChangeConcentrationBy(const Real3& position, real_t amount);
+
+  real_t GetValue(const Real3& position) const override;
+
+  /// Returns the gradient of the box at `position` (central differences,
+  /// one-sided at the boundaries)
+  Real3 GetGradient(const Real3& position) const override;
+
+  /// Bricks that changed at most by `threshold` in the previous step are not
+  /// updated if their neighbors did not change either (see above). A negative
+  /// threshold updates all bricks in every step.
+  void SetActivityThreshold(real_t threshold) {
+    activity_threshold_ = threshold;
+  }
+
+  /// Returns the number of bricks that were updated in the last step
+  size_t GetNumActiveBricks() const { return num_active_bricks_; }
+
+  /// Returns the concentration of box (`x`, `y`, `z`)
+  real_t GetConcentration(uint32_t x, uint32_t y, uint32_t z) const {
+    return c1_[GetStorageIndex(x, y, z)];
+  }
+
+  /// Returns the index of box (`x`, `y`, `z`) in the bricked storage
+  size_t GetStorageIndex(uint32_t x, uint32_t y, uint32_t z) const {
+    const uint32_t nb = num_bricks_axis_;
+    const uint32_t brick =
+        x / kBrickSize + (y / kBrickSize + z / kBrickSize * nb) * nb;
+    return static_cast<size_t>(brick_slots_[brick]) * kBrickVolume +
+           x % kBrickSize +
+           kBrickSize * (y % kBrickSize + kBrickSize * (z % kBrickSize));
+  }
+
+  /// Calls `f(slot, origin, extent)` for each brick in parallel. The boxes
+  /// of the brick are stored in x-fastest order starting at
+  /// `slot * kBrickVolume`, and `origin` are the coordinates of its first
+  /// box. `extent` is the number of boxes along each axis that lie inside
+  /// the grid, which is smaller than `kBrickSize` for the bricks at the
+  /// upper boundary if the resolution is not a multiple of `kBrickSize`.
+  template <typename F>
+  void ForEachBrick(F f) const {
+    const int64_t num_bricks = bricks_.size();
+#pragma omp parallel for schedule(static)
+    for (int64_t slot = 0; slot < num_bricks; slot++) {
+      const auto origin = GetBrickOrigin(slot);
+      std::array<uint32_t, 3> extent;
+      for (int i = 0; i < 3; i++) {
+        extent[i] = std::min(kBrickSize, resolution_ - origin[i]);
+      }
+      f(static_cast<size_t>(slot), origin, extent);
+    }
+  }
+
+  /// Calls `f(idx, concentration)` for each box in parallel, where `idx` is
+  /// the index of the box in the x-fastest layout of `DiffusionGrid`
+  template <typename F>
+  void ForEachBox(F f) const {
+    const size_t n = resolution_;
+    ForEachBrick([&](size_t slot, const std::array<uint32_t, 3>& origin,
+                     const std::array<uint32_t, 3>& extent) {
+      const real_t* data = c1_.data() + slot * kBrickVolume;
+      for (uint32_t k = 0; k < extent[2]; k++) {
+        for (uint32_t j = 0; j < extent[1]; j++) {
+          const size_t row =
+              origin[0] + (origin[1] + j + (origin[2] + k) * n) * n;
+          const real_t* src = data + kBrickSize * (j + kBrickSize * k);
+          for (uint32_t i = 0; i < extent[0]; i++) {
+            f(row + i, src[i]);
+          }
+        }
+      }
+    });
+  }
+
+  /// Writes the concentrations in the layout of
+  /// `DiffusionGrid::GetAllConcentrations` to `dest`, which must hold
+  /// `GetNumBoxes()` elements
+  void CopyConcentrations(real_t* dest) const;
+
+  /// Writes the gradients in the layout of `DiffusionGrid::GetAllGradients`
+  /// to `dest`, which must hold `3 * GetNumBoxes()` elements
+  void CopyGradients(real_t* dest) const;
+
+  /// Returns the integral of the concentration over the domain
+  real_t GetTotalAmount() const;
+
+  size_t GetNumBoxes() const {
+    return static_cast<size_t>(resolution_) * resolution_ * resolution_;
+  }
+
+  size_t GetNumBricks() const { return bricks_.size(); }
+
+  uint32_t GetResolution() const { return resolution_; }
+
+  real_t GetBoxLength() const { return box_length_; }
+
+  /// Returns the bounds [lower, upper] of the grid along each axis
+  std::array<int32_t, 2> GetDimensions() const { return grid_dimensions_; }
+
+ private:
+  /// Returns the coordinates of the first box of the brick in `slot`
+  std::array<uint32_t, 3> GetBrickOrigin(size_t slot) const {
+    const uint32_t nb = num_bricks_axis_;
+    const uint32_t brick = bricks_[slot];
+    return {brick % nb * kBrickSize, brick / nb % nb * kBrickSize,
+            brick / (nb * nb) * kBrickSize};
+  }
+
+  /// Sorts the bricks of a grid with `resolution_` boxes per axis and
+  /// allocates zero-initialized storage for them
+  void AllocateBricks();
+
+  /// Returns the gradient of box (`x`, `y`, `z`)
+  Real3 GradientAt(uint32_t x, uint32_t y, uint32_t z) const;
+
+  /// Determines the bricks that must be updated in the next step
+  void UpdateActivity();
+
+  /// Performs one explicit Euler step
+  void Integrate(real_t dt);
+
+  real_t dc_ = 0;
+  real_t mu_ = 0;
+  uint32_t resolution_ = 0;
+  /// Number of bricks along each axis
+  uint32_t num_bricks_axis_ = 0;
+  real_t box_length_ = 0;
+  std::array<int32_t, 2> grid_dimensions_ = {{0, 0}};
+  real_t activity_threshold_ = 0;
+  size_t num_active_bricks_ = 0;
+
+  /// Concentrations, stored brick by brick in the order of `bricks_`
+  ParallelResizeVector<real_t> c1_ = {};
+  ParallelResizeVector<real_t> c2_ = {};
+  /// Indices of the bricks (x fastest) in Morton order
+  std::vector<uint32_t> bricks_ = {};
+  /// Position of each brick in `bricks_`
+  std::vector<uint32_t> brick_slots_ = {};
+  /// Slots of the six neighbors (-x, +x, -y, +y, -z, +z) of each slot, or -1
+  /// at the boundary
+  std::vector<int32_t> brick_neighbors_ = {};
+  /// Largest change of a box of each slot in the last step
+  std::vector<real_t> brick_changes_ = {};
+  /// Slots that were modified by `ChangeConcentrationBy` since the last step
+  std::vector<uint8_t> brick_sources_ = {};
+  /// Slots that are updated in the next step
+  std::vector<uint8_t> brick_active_ = {};
+  /// Slots for which `c1_` and `c2_` contain the same values
+  std::vector<uint8_t> brick_synced_ = {};
+  /// One lock per brick
+  mutable ParallelResizeVector<Spinlock> locks_ = {};  //!
+  std::vector<std::function<real_t(real_t, real_t, real_t)>>
+      initializers_ = {};  //!
+
+  BDM_CLASS_DEF_OVERRIDE(BrickedGrid, 1);
+};
+
+}  // namespace bdm
+
+#endif  // CORE_DIFFUSION_BRICKED_GRID_H_
@@ -40,8 +40,8 @@ void Continuum::IntegrateTimeAsynchronously(real_t dt) {
       n_steps++;
     }
     // Simulate for the appropriate number of time steps
-    for (int i = 0; i < n_steps; i++) {
-      Step(time_step_);
+    if (n_steps > 0) {
+      MultiStep(time_step_, n_steps);
     }
     // Update the total simulated time
     simulated_time_ += n_steps * time_step_;
@@ -55,6 +55,12 @@ void Continuum::IntegrateTimeAsynchronously(real_t dt) {
   }
 }
 
+void Continuum::MultiStep(real_t dt, uint64_t num_steps) {
+  for (uint64_t i = 0; i < num_steps; i++) {
+    Step(dt);
+  }
+}
+
 void Continuum::SetTimeStep(real_t dt) { time_step_ = dt; }
 
 real_t Continuum::GetTimeStep() const {
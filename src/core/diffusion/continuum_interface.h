@@ -16,6 +16,7 @@
 #define CONTINUUM_INTERFACE_H_
 
 #include <array>
+#include <cstdint>
 #include <limits>
 #include <string>
 #include "core/container/math_array.h"
@@ -83,6 +84,12 @@ class Continuum {
   /// to verify them in this method.
   virtual void Step(real_t dt) = 0;
 
+  /// Integrates the continuum `num_steps` times by `dt`. Is called by
+  /// `IntegrateTimeAsynchronously`. The default implementation calls `Step`
+  /// `num_steps` times. Implementations may override it to fuse several steps
+  /// (see `DiffusionGrid::MultiStep`).
+  virtual void MultiStep(real_t dt, uint64_t num_steps);
+
   /// Returns the ID of the continuum.
   int GetContinuumId() const { return continuum_id_; }
 
@@ -13,10 +13,14 @@
 // -----------------------------------------------------------------------------
 
 #include "core/diffusion/diffusion_grid.h"
+#include <algorithm>
+#include <cmath>
 #include <mutex>
+#include "core/diffusion/grid_util.h"
 #include "core/environment/environment.h"
 #include "core/simulation.h"
 #include "core/util/log.h"
+#include "core/util/thread_info.h"
 
 namespace bdm {
 
@@ -76,20 +80,21 @@ void DiffusionGrid::Initialize() {
   }
 
   // Get neighbor grid dimensions
-  auto* env = Simulation::GetActive()->GetEnvironment();
-  auto bounds = env->GetDimensionThresholds();
-
-  grid_dimensions_ = {bounds[0], bounds[1]};
-  if (bounds[0] > bounds[1]) {
-    Log::Fatal("DiffusionGrid::Initialize",
-               "The grid dimensions are not correct. Lower bound is greater",
-               " than upper bound. (substance '", GetContinuumName(), "')");
+  auto bounds = GetDomainBounds();
+  int32_t max_length = 0;
+  for (int i = 0; i < 3; i++) {
+    if (bounds[2 * i] > bounds[2 * i + 1]) {
+      Log::Fatal("DiffusionGrid::Initialize",
+                 "The grid dimensions are not correct. Lower bound is greater",
+                 " than upper bound. (substance '", GetContinuumName(), "')");
+    }
+    max_length = std::max(max_length, bounds[2 * i + 1] - bounds[2 * i]);
   }
+  grid_dimensions_ = bounds;
 
   auto adjusted_res =
       resolution_ == 1 ? 2 : resolution_;  // avoid division by 0
-  box_length_ = (grid_dimensions_[1] - grid_dimensions_[0]) /
-                static_cast<real_t>(adjusted_res);
+  box_length_ = max_length / static_cast<real_t>(adjusted_res);
 
   // Check if box length is not too small
   if (box_length_ <= 1e-13) {
@@ -99,12 +104,38 @@ void DiffusionGrid::Initialize() {
                GetContinuumName(), "'");
   }
 
+  // The boxes are cubes. Shorter axes are covered by fewer boxes (at least
+  // two) and the upper bound is extended to a multiple of the box length.
+  for (int i = 0; i < 3; i++) {
+    const int32_t length = bounds[2 * i + 1] - bounds[2 * i];
+    if (length == max_length) {
+      num_boxes_axis_[i] = resolution_;
+      continue;
+    }
+    auto num_boxes =
+        static_cast<size_t>(std::ceil(length / box_length_ - 1e-9));
+    num_boxes = std::max(num_boxes, std::min<size_t>(resolution_, 2));
+    num_boxes_axis_[i] = num_boxes;
+    grid_dimensions_[2 * i + 1] =
+        bounds[2 * i] +
+        static_cast<int32_t>(std::ceil(num_boxes * box_length_ - 1e-9));
+  }
+
   box_volume_ = box_length_ * box_length_ * box_length_;
-  parity_ = resolution_ % 2;
-  total_num_boxes_ = resolution_ * resolution_ * resolution_;
+  total_num_boxes_ =
+      num_boxes_axis_[0] * num_boxes_axis_[1] * num_boxes_axis_[2];
 
-  // Allocate memory for the concentration and gradient arrays
-  locks_.resize(total_num_boxes_);
+  // Allocate memory for the concentration and gradient arrays. Buffered
+  // changes are applied without locks.
+  auto* param = Simulation::GetActive()->GetParam();
+  defer_changes_ = param->deferred_concentration_changes;
+  if (defer_changes_) {
+    auto max_threads = ThreadInfo::GetInstance()->GetMaxThreads();
+    deferred_changes_.resize(max_threads);
+    sorted_changes_.resize(max_threads);
+  } else {
+    locks_.resize(total_num_boxes_);
+  }
   c1_.resize(total_num_boxes_);
   c2_.resize(total_num_boxes_);
   gradients_.resize(total_num_boxes_);
@@ -116,7 +147,38 @@ void DiffusionGrid::Initialize() {
   }
 }
 
+std::array<int32_t, 6> DiffusionGrid::GetDomainBounds() const {
+  auto* sim = Simulation::GetActive();
+  auto* env = sim->GetEnvironment();
+  auto thresholds = env->GetDimensionThresholds();
+  if (!sim->GetParam()->non_cubic_diffusion_grid) {
+    return {thresholds[0], thresholds[1], thresholds[0],
+            thresholds[1], thresholds[0], thresholds[1]};
+  }
+  auto bounds = env->GetDimensions();
+  if (sim->GetParam()->bound_space) {
+    // The environment may extend beyond the bounded space
+    for (auto& bound : bounds) {
+      bound = std::min(std::max(bound, thresholds[0]), thresholds[1]);
+    }
+  }
+  return bounds;
+}
+
+bool DiffusionGrid::CoversDomain() const {
+  const auto bounds = GetDomainBounds();
+  for (int i = 0; i < 3; i++) {
+    if (bounds[2 * i] < grid_dimensions_[2 * i] ||
+        bounds[2 * i + 1] > grid_dimensions_[2 * i + 1]) {
+      return false;
+    }
+  }
+  return true;
+}
+
 void DiffusionGrid::Diffuse(real_t dt) {
+  ApplyDeferredChanges();
+
   // check if diffusion coefficient and decay constant are 0
   // i.e. if we don't need to calculate diffusion update
   if (IsFixedSubstance()) {
@@ -145,66 +207,297 @@ void DiffusionGrid::Diffuse(real_t dt) {
   }
 }
 
-void DiffusionGrid::Update() {
-  // Get neighbor grid dimensions
-  auto* env = Simulation::GetActive()->GetEnvironment();
-  auto bounds = env->GetDimensionThresholds();
-  // Update the grid dimensions such that each dimension ranges from
-  // {bounds[0] - bounds[1]}
-  grid_dimensions_ = {bounds[0], bounds[1]};
-
-  // If the grid is not perfectly divisible along each dimension by the
-  // box length, extend the grid so that it is
-  int dimension_length = bounds[1] - bounds[0];
-  for (int i = 0; i < 1; i++) {
-    int r = fmod(dimension_length, box_length_);
-    if (r > 1e-9) {
-      // std::abs for the case that box_length_ > dimension_length
-      grid_dimensions_[2 * i + 1] += (box_length_ - r);
+void DiffusionGrid::MultiStep(real_t dt, uint64_t num_steps) {
+  ApplyDeferredChanges();
+  auto* param = Simulation::GetActive()->GetParam();
+  const uint64_t max_fused_steps = param->diffusion_temporal_blocking;
+  ExplicitStencil stencil;
+  if (max_fused_steps < 2 || num_steps < 2 || IsFixedSubstance() ||
+      !GetExplicitStencil(dt, &stencil)) {
+    Continuum::MultiStep(dt, num_steps);
+    return;
+  }
+
+  last_dt_ = dt;
+  ParametersCheck(dt);
+  for (uint64_t done = 0; done < num_steps;) {
+    auto fused_steps = std::min(max_fused_steps, num_steps - done);
+    DiffuseTemporallyBlocked(fused_steps, stencil);
+    done += fused_steps;
+  }
+}
+
+namespace {
+
+/// Box range [lo, hi) along each axis
+struct BoxRange {
+  std::array<int64_t, 3> lo;
+  std::array<int64_t, 3> hi;
+
+  /// Returns this range extended by `halo` boxes and clamped to [0, n)
+  BoxRange Extend(int64_t halo, const std::array<int64_t, 3>& n) const {
+    BoxRange result;
+    for (int i = 0; i < 3; ++i) {
+      result.lo[i] = std::max<int64_t>(lo[i] - halo, 0);
+      result.hi[i] = std::min<int64_t>(hi[i] + halo, n[i]);
     }
+    return result;
   }
+};
 
-  // Calculate new_dimension_length and new_resolution
-  int new_dimension_length = grid_dimensions_[1] - grid_dimensions_[0];
-  size_t new_resolution = std::ceil(new_dimension_length / box_length_);
+/// Concentration array that stores the boxes of a range in x-fastest order
+struct ConcentrationView {
+  real_t* data;
+  std::array<int64_t, 3> origin;
+  int64_t stride_y;
+  int64_t stride_z;
 
-  if (new_resolution > resolution_) {
-    // Store the old number of boxes along each axis for comparison
-    size_t tmp_resolution = resolution_;
+  int64_t Index(int64_t x, int64_t y, int64_t z) const {
+    return (x - origin[0]) + (y - origin[1]) * stride_y +
+           (z - origin[2]) * stride_z;
+  }
+};
 
-    // Set new resolution
-    resolution_ = new_resolution;
+}  // namespace
 
-    // We need to maintain the parity of the number of boxes along each
-    // dimension, otherwise copying of the substances to the increases grid
-    // will not be symmetrically done; resulting in shifting of boxes
-    // We add a box in the negative direction, because the only way the parity
-    // could have changed is because of adding a box in the positive direction
-    // (due to the grid not being perfectly divisible; see above)
-    if (resolution_ % 2 != parity_) {
-      grid_dimensions_[0] -= box_length_;
-      resolution_++;
+void DiffusionGrid::DiffuseTemporallyBlocked(uint64_t num_steps,
+                                             const ExplicitStencil& stencil) {
+  auto* param = Simulation::GetActive()->GetParam();
+  const std::array<int64_t, 3> n = {static_cast<int64_t>(num_boxes_axis_[0]),
+                                    static_cast<int64_t>(num_boxes_axis_[1]),
+                                    static_cast<int64_t>(num_boxes_axis_[2])};
+  const int64_t nx = n[0];
+  const int64_t nxy = n[0] * n[1];
+  const int64_t tile = std::max<int64_t>(
+      1, std::min<int64_t>(param->diffusion_tile_size,
+                           *std::max_element(n.begin(), n.end())));
+  // Halo of the first step. Each step shrinks the computed range by one box
+  // until the last step only covers the tile itself.
+  const int64_t halo = static_cast<int64_t>(num_steps) - 1;
+  std::array<int64_t, 3> num_tiles;
+  int64_t max_tile_boxes = 1;
+  for (int i = 0; i < 3; ++i) {
+    num_tiles[i] = (n[i] + tile - 1) / tile;
+    max_tile_boxes *= std::min(tile + 2 * halo, n[i]);
+  }
+
+  const real_t decay = stencil.decay;
+  const real_t diffusion = stencil.diffusion;
+  const real_t* sink = stencil.sink.empty() ? nullptr : stencil.sink.data();
+  const auto bc_type = bc_type_;
+  const auto sim_time = GetSimulatedTime();
+
+  // Updates a box on the boundary of the grid. Neighbors outside the grid
+  // are never accessed.
+  auto update_boundary = [&](int64_t x, int64_t y, int64_t z,
+                             const ConcentrationView& src) -> real_t {
+    const real_t c = src.data[src.Index(x, y, z)];
+    const real_t sink_term = sink ? sink[x + y * nx + z * nxy] * c : 0;
+    if (bc_type == BoundaryConditionType::kClosedBoundaries) {
+      return c;
+    }
+    const real_t real_x = grid_dimensions_[0] + x * box_length_;
+    const real_t real_y = grid_dimensions_[2] + y * box_length_;
+    const real_t real_z = grid_dimensions_[4] + z * box_length_;
+    if (bc_type == BoundaryConditionType::kDirichlet) {
+      return boundary_condition_->Evaluate(real_x, real_y, real_z, sim_time) -
+             sink_term;
+    }
+    // Neumann: neighbors outside the grid are replaced by the boundary value
+    // and do not contribute to the center
+    const real_t outside = -box_length_ * boundary_condition_->Evaluate(
+                                              real_x, real_y, real_z, sim_time);
+    real_t center_factor = 6;
+    real_t sum = 0;
+    const std::array<int64_t, 3> coord = {x, y, z};
+    for (int axis = 0; axis < 3; ++axis) {
+      for (int64_t dir : {-1, 1}) {
+        auto neighbor = coord;
+        neighbor[axis] += dir;
+        if (neighbor[axis] < 0 || neighbor[axis] >= n[axis]) {
+          sum += outside;
+          center_factor -= 1;
+        } else {
+          sum += src.data[src.Index(neighbor[0], neighbor[1], neighbor[2])];
+        }
+      }
+    }
+    return c * decay + diffusion * (sum - center_factor * c) - sink_term;
+  };
+
+  // Calculates one step for all boxes in `range`
+  auto update_range = [&](const BoxRange& range, const ConcentrationView& src,
+                          const ConcentrationView& dst) {
+    for (int64_t z = range.lo[2]; z < range.hi[2]; ++z) {
+      for (int64_t y = range.lo[1]; y < range.hi[1]; ++y) {
+        int64_t x_begin = range.lo[0];
+        int64_t x_end = range.hi[0];
+        if (y == 0 || y == n[1] - 1 || z == 0 || z == n[2] - 1) {
+          for (int64_t x = x_begin; x < x_end; ++x) {
+            dst.data[dst.Index(x, y, z)] = update_boundary(x, y, z, src);
+          }
+          continue;
+        }
+        if (x_begin == 0) {
+          dst.data[dst.Index(0, y, z)] = update_boundary(0, y, z, src);
+          x_begin = 1;
+        }
+        if (x_end == nx) {
+          dst.data[dst.Index(nx - 1, y, z)] =
+              update_boundary(nx - 1, y, z, src);
+          x_end = nx - 1;
+        }
+        if (x_begin >= x_end) {
+          continue;
+        }
+        const real_t* c = src.data + src.Index(x_begin, y, z);
+        real_t* out = dst.data + dst.Index(x_begin, y, z);
+        const real_t* s = sink ? sink + x_begin + y * nx + z * nxy : nullptr;
+        const int64_t sy = src.stride_y;
+        const int64_t sz = src.stride_z;
+        const int64_t len = x_end - x_begin;
+        if (s) {
+#pragma omp simd
+          for (int64_t i = 0; i < len; ++i) {
+            out[i] = c[i] * decay +
+                     diffusion * (c[i - 1] + c[i + 1] + c[i - sy] + c[i + sy] +
+                                  c[i - sz] + c[i + sz] - 6 * c[i]) -
+                     s[i] * c[i];
+          }
+        } else {
+#pragma omp simd
+          for (int64_t i = 0; i < len; ++i) {
+            out[i] = c[i] * decay +
+                     diffusion * (c[i - 1] + c[i + 1] + c[i - sy] + c[i + sy] +
+                                  c[i - sz] + c[i + sz] - 6 * c[i]);
+          }
+        }
+      }
+    }
+  };
+
+  const ConcentrationView global_c1 = {c1_.data(), {0, 0, 0}, nx, nxy};
+  const ConcentrationView global_c2 = {c2_.data(), {0, 0, 0}, nx, nxy};
+
+#pragma omp parallel
+  {
+    // Intermediate steps of one tile (including the halo)
+    std::vector<real_t> buffer[2];
+    if (num_steps > 1) {
+      buffer[0].resize(max_tile_boxes);
+      buffer[1].resize(max_tile_boxes);
     }
 
-    // Temporarily save previous grid data
-    auto tmp_c1 = c1_;
-    auto tmp_gradients = gradients_;
+#pragma omp for collapse(3) schedule(dynamic, 1)
+    for (int64_t tz = 0; tz < num_tiles[2]; ++tz) {
+      for (int64_t ty = 0; ty < num_tiles[1]; ++ty) {
+        for (int64_t tx = 0; tx < num_tiles[0]; ++tx) {
+          BoxRange tile_range;
+          tile_range.lo = {tx * tile, ty * tile, tz * tile};
+          tile_range.hi = {std::min(tile_range.lo[0] + tile, n[0]),
+                           std::min(tile_range.lo[1] + tile, n[1]),
+                           std::min(tile_range.lo[2] + tile, n[2])};
+          const auto first_range = tile_range.Extend(halo, n);
+          const int64_t ex = first_range.hi[0] - first_range.lo[0];
+          const int64_t ey = first_range.hi[1] - first_range.lo[1];
+
+          ConcentrationView src = global_c1;
+          for (uint64_t step = 1; step <= num_steps; ++step) {
+            const auto range = tile_range.Extend(num_steps - step, n);
+            ConcentrationView dst = global_c2;
+            if (step != num_steps) {
+              dst = {buffer[(step - 1) % 2].data(), first_range.lo, ex,
+                     ex * ey};
+            }
+            update_range(range, src, dst);
+            src = dst;
+          }
+        }
+      }
+    }
+  }
+  c1_.swap(c2_);
+}
 
-    c1_.clear();
+void DiffusionGrid::Update() {
+  // Buffered changes refer to the boxes of the current grid
+  ApplyDeferredChanges();
+
+  // Get neighbor grid dimensions
+  auto bounds = GetDomainBounds();
+  auto* param = Simulation::GetActive()->GetParam();
+  const real_t margin = param->diffusion_grid_growth_margin;
+
+  const auto old_dimensions = grid_dimensions_;
+  const auto old_num_boxes = num_boxes_axis_;
+  const auto step = GetIntegerLengthNumBoxes(box_length_);
+  bool grown = false;
+  for (int i = 0; i < 3; i++) {
+    const int32_t old_lower = old_dimensions[2 * i];
+    if (bounds[2 * i] >= old_lower &&
+        bounds[2 * i + 1] <= old_dimensions[2 * i + 1]) {
+      // Axes that are still covered keep their extent and margin
+      continue;
+    }
+    grown = true;
+
+    // Boxes are added on the lattice of the old grid, such that the old boxes
+    // keep their position in space (see CopyOldData). The grid never shrinks.
+    const auto below = std::max<int64_t>(
+        0, GetNumBoxesToCover(old_lower - bounds[2 * i], box_length_));
+    const auto above_lower =
+        GetNumBoxesToCover(bounds[2 * i + 1] - old_lower, box_length_);
+    const auto num_boxes =
+        below + std::max<int64_t>(old_num_boxes[i], above_lower);
+
+    // Extend the grid by about the same number of boxes on both sides, such
+    // that further growth of the simulation space within this margin does not
+    // reallocate the grid
+    int64_t pad = 0;
+    if (margin > 0) {
+      pad = static_cast<int64_t>(std::ceil(margin * num_boxes / 2));
+    }
+    // The lower bound is an integer. It stays on the lattice of the old grid
+    // only if the boxes added below have an integer length.
+    const auto added_below = RoundUpNumBoxes(below + pad, step);
+    num_boxes_axis_[i] = added_below + (num_boxes - below) + pad;
+    grid_dimensions_[2 * i] =
+        old_lower -
+        static_cast<int32_t>(std::lround(added_below * box_length_));
+    grid_dimensions_[2 * i + 1] =
+        grid_dimensions_[2 * i] +
+        static_cast<int32_t>(
+            std::ceil(num_boxes_axis_[i] * box_length_ - 1e-9));
+  }
+
+  if (grown) {
+    resolution_ = *std::max_element(num_boxes_axis_.begin(),
+                                    num_boxes_axis_.end());
+
+    // Move the previous grid data out of the way instead of copying it. The
+    // new arrays are allocated and zero-initialized in parallel.
+    ParallelResizeVector<real_t> old_c1;
+    ParallelResizeVector<Real3> old_gradients;
+    old_c1.swap(c1_);
+    old_gradients.swap(gradients_);
     c2_.clear();
-    gradients_.clear();
 
-    total_num_boxes_ = resolution_ * resolution_ * resolution_;
+    total_num_boxes_ =
+        num_boxes_axis_[0] * num_boxes_axis_[1] * num_boxes_axis_[2];
 
-    CopyOldData(tmp_c1, tmp_gradients, tmp_resolution);
+    CopyOldData(old_c1, old_gradients, old_num_boxes, old_dimensions);
   }
 }
 
 void DiffusionGrid::CopyOldData(
     const ParallelResizeVector<real_t>& old_c1,
-    const ParallelResizeVector<Real3>& old_gradients, size_t old_resolution) {
+    const ParallelResizeVector<Real3>& old_gradients,
+    const std::array<size_t, 3>& old_num_boxes,
+    const std::array<int32_t, 6>& old_dimensions) {
   // Allocate more memory for the grid data arrays
-  locks_.resize(total_num_boxes_);
+  if (!defer_changes_) {
+    locks_.resize(total_num_boxes_);
+  }
   c1_.resize(total_num_boxes_);
   c2_.resize(total_num_boxes_);
   gradients_.resize(total_num_boxes_);
@@ -219,23 +512,43 @@ void DiffusionGrid::CopyOldData(
       "grid values are mostly zero this is likely to work fine. Evaluate your "
       "results carefully.");
 
-  auto incr_num_boxes = resolution_ - old_resolution;
-  int off_dim = incr_num_boxes / 2;
-
-  int num_box_xy = resolution_ * resolution_;
-  int old_box_xy = old_resolution * old_resolution;
-  int new_origin = off_dim * num_box_xy + off_dim * resolution_ + off_dim;
-  for (size_t k = 0; k < old_resolution; k++) {
-    int offset = new_origin + k * num_box_xy;
-    for (size_t j = 0; j < old_resolution; j++) {
-      if (j != 0) {
-        offset += resolution_;
-      }
-      for (size_t i = 0; i < old_resolution; i++) {
-        auto idx = k * old_box_xy + j * old_resolution + i;
-        c1_[offset + i] = old_c1[idx];
-        gradients_[offset + i] = old_gradients[idx];
-      }
+  // The old boxes keep their position in space. The grid may grow by a
+  // different number of boxes on each side, or shift (e.g. if only one side
+  // of an axis grows), hence the offset of the old grid is computed from the
+  // origins. Old boxes that fall outside of the new grid are dropped.
+  const auto& nb = num_boxes_axis_;
+  std::array<int64_t, 3> off_dim;
+  std::array<size_t, 3> first;
+  std::array<size_t, 3> last;
+  for (int i = 0; i < 3; i++) {
+    off_dim[i] = std::lround((old_dimensions[2 * i] - grid_dimensions_[2 * i]) /
+                             box_length_);
+    const int64_t lo = std::max<int64_t>(0, -off_dim[i]);
+    const int64_t hi = std::min<int64_t>(old_num_boxes[i],
+                                         static_cast<int64_t>(nb[i]) -
+                                             off_dim[i]);
+    if (hi <= lo) {
+      return;
+    }
+    first[i] = lo;
+    last[i] = hi;
+  }
+
+  // Copy the old grid row by row
+  const size_t num_box_xy = nb[0] * nb[1];
+  const size_t old_box_xy = old_num_boxes[0] * old_num_boxes[1];
+  const size_t row_length = last[0] - first[0];
+#pragma omp parallel for collapse(2)
+  for (size_t k = first[2]; k < last[2]; k++) {
+    for (size_t j = first[1]; j < last[1]; j++) {
+      const size_t offset = (k + off_dim[2]) * num_box_xy +
+                            (j + off_dim[1]) * nb[0] + first[0] + off_dim[0];
+      const size_t idx = k * old_box_xy + j * old_num_boxes[0] + first[0];
+      std::copy(old_c1.data() + idx, old_c1.data() + idx + row_length,
+                c1_.data() + offset);
+      std::copy(old_gradients.data() + idx,
+                old_gradients.data() + idx + row_length,
+                gradients_.data() + offset);
     }
   }
   // TODO: here we also need to copy c1_ into c2_ such that the boundaries are
@@ -251,7 +564,7 @@ void DiffusionGrid::RunInitializers() {
 
   // Define variables for loop bounds & boundary condition check
   const auto kNumBoxes = total_num_boxes_;
-  const auto kGridSize = resolution_;
+  const auto& kGridSize = num_boxes_axis_;
   // For certain boudaries, we also need to copy the values to the c2_ array
   const bool kCopyToC2 =
       (bc_type_ == BoundaryConditionType::kDirichlet ||
@@ -268,7 +581,7 @@ void DiffusionGrid::RunInitializers() {
     std::array<real_t, 3> real_coord;
 #pragma omp simd
     for (size_t i = 0; i < 3; i++) {
-      real_coord[i] = grid_dimensions_[0] +
+      real_coord[i] = grid_dimensions_[2 * i] +
                       static_cast<real_t>(box_coord[i]) * box_length_ +
                       box_length_ / 2.0;
     }
@@ -276,9 +589,9 @@ void DiffusionGrid::RunInitializers() {
     // Calculate the value of the substance in the box
     real_t value{0};
     if (bc_type_ == BoundaryConditionType::kDirichlet &&
-        (box_coord[0] == 0 || box_coord[0] == kGridSize - 1 ||
-         box_coord[1] == 0 || box_coord[1] == kGridSize - 1 ||
-         box_coord[2] == 0 || box_coord[2] == kGridSize - 1)) {
+        (box_coord[0] == 0 || box_coord[0] == kGridSize[0] - 1 ||
+         box_coord[1] == 0 || box_coord[1] == kGridSize[1] - 1 ||
+         box_coord[2] == 0 || box_coord[2] == kGridSize[2] - 1)) {
       // Evaluate the boundary condition in case of Dirichlet boundary
       value = boundary_condition_->Evaluate(real_coord[0], real_coord[1],
                                             real_coord[2], 0);
@@ -317,11 +630,14 @@ void DiffusionGrid::CalculateGradient() {
     return;
   }
 
+  const auto nx = num_boxes_axis_[0];
+  const auto ny = num_boxes_axis_[1];
+  const auto nz = num_boxes_axis_[2];
 #pragma omp parallel for collapse(2)
-  for (uint32_t z = 0; z < resolution_; z++) {
-    for (uint32_t y = 0; y < resolution_; y++) {
-      for (uint32_t x = 0; x < resolution_; x++) {
-        size_t idx = x + y * resolution_ + z * resolution_ * resolution_;
+  for (uint32_t z = 0; z < nz; z++) {
+    for (uint32_t y = 0; y < ny; y++) {
+      for (uint32_t x = 0; x < nx; x++) {
+        size_t idx = x + y * nx + z * nx * ny;
         const std::array<uint32_t, 3> box_coord = {x, y, z};
         // Get the neighboring boxes
         const auto neighbors = GetNeighboringBoxes(idx, box_coord);
@@ -366,8 +682,18 @@ void DiffusionGrid::ChangeConcentrationBy(size_t idx, real_t amount,
     // volume of box
     amount /= box_length_ * box_length_ * box_length_;
   }
+  if (defer_changes_) {
+    auto tid = ThreadInfo::GetInstance()->GetMyThreadId();
+    deferred_changes_[tid].push_back({idx, amount, mode});
+    return;
+  }
   std::lock_guard<Spinlock> guard(locks_[idx]);
   assert(idx < locks_.size());
+  ApplyChange(idx, amount, mode);
+}
+
+void DiffusionGrid::ApplyChange(size_t idx, real_t amount,
+                                InteractionMode mode) {
   switch (mode) {
     case InteractionMode::kAdditive:
       c1_[idx] += amount;
@@ -395,6 +721,58 @@ void DiffusionGrid::ChangeConcentrationBy(size_t idx, real_t amount,
   }
 }
 
+void DiffusionGrid::ApplyDeferredChanges() {
+  uint64_t num_changes = 0;
+  for (auto& changes : deferred_changes_) {
+    num_changes += changes.size();
+  }
+  if (num_changes == 0) {
+    return;
+  }
+
+  // Each thread owns a contiguous range of boxes. First, the changes of each
+  // buffer are sorted by owner (counting sort). Then, each owner applies
+  // the changes to its boxes from all buffers. Hence, no box is modified by
+  // two threads and no locks are needed.
+  const uint64_t num_buffers = deferred_changes_.size();
+  const uint64_t num_ranges = num_buffers;
+  const uint64_t range_size = (total_num_boxes_ + num_ranges - 1) / num_ranges;
+  std::vector<std::vector<uint64_t>> offsets(
+      num_buffers, std::vector<uint64_t>(num_ranges + 1, 0));
+
+#pragma omp parallel for schedule(dynamic, 1)
+  for (uint64_t b = 0; b < num_buffers; b++) {
+    const auto& changes = deferred_changes_[b];
+    auto& offset = offsets[b];
+    for (auto& change : changes) {
+      offset[change.idx / range_size + 1]++;
+    }
+    for (uint64_t r = 0; r < num_ranges; r++) {
+      offset[r + 1] += offset[r];
+    }
+    auto& sorted = sorted_changes_[b];
+    sorted.resize(changes.size());
+    auto position = offset;
+    for (auto& change : changes) {
+      sorted[position[change.idx / range_size]++] = change;
+    }
+  }
+
+#pragma omp parallel for schedule(dynamic, 1)
+  for (uint64_t r = 0; r < num_ranges; r++) {
+    for (uint64_t b = 0; b < num_buffers; b++) {
+      const auto& sorted = sorted_changes_[b];
+      for (uint64_t i = offsets[b][r]; i < offsets[b][r + 1]; i++) {
+        ApplyChange(sorted[i].idx, sorted[i].amount, sorted[i].mode);
+      }
+    }
+  }
+
+  for (auto& changes : deferred_changes_) {
+    changes.clear();
+  }
+}
+
 /// Get the concentration at specified position
 real_t DiffusionGrid::GetValue(const Real3& position) const {
   auto idx = GetBoxIndex(position);
@@ -409,6 +787,14 @@ real_t DiffusionGrid::GetConcentration(const size_t idx) const {
                "the diffusion grid!");
     return 0;
   }
+  return ReadConcentration(idx);
+}
+
+real_t DiffusionGrid::ReadConcentration(size_t idx) const {
+  if (defer_changes_) {
+    // Changes are only applied between the agent operations
+    return c1_[idx];
+  }
   assert(idx < locks_.size());
   std::lock_guard<Spinlock> guard(locks_[idx]);
   return c1_[idx];
@@ -424,32 +810,7 @@ void DiffusionGrid::GetGradient(const Real3& position, Real3* gradient,
                "the diffusion grid! Returning zero gradient.");
     return;
   }
-  if (init_gradient_) {
-    *gradient = gradients_[idx];
-  } else {
-    // Get the neighboring boxes
-    const auto neighbors = GetNeighboringBoxes(idx);
-    std::array<int, 6> comparison;  // array to determine discretization h
-    std::transform(neighbors.begin(), neighbors.end(), comparison.begin(),
-                   [idx](size_t n) { return (n == idx) ? 0 : 1; });
-
-    // Calculate the gradient (GetConcentration for thread safety)
-    const real_t x_minus = GetConcentration(neighbors[0]);
-    const real_t x_plus = GetConcentration(neighbors[1]);
-    const real_t y_minus = GetConcentration(neighbors[2]);
-    const real_t y_plus = GetConcentration(neighbors[3]);
-    const real_t z_minus = GetConcentration(neighbors[4]);
-    const real_t z_plus = GetConcentration(neighbors[5]);
-
-    real_t grad_x =
-        (x_plus - x_minus) / ((comparison[1] + comparison[0]) * box_length_);
-    real_t grad_y =
-        (y_plus - y_minus) / ((comparison[3] + comparison[2]) * box_length_);
-    real_t grad_z =
-        (z_plus - z_minus) / ((comparison[5] + comparison[4]) * box_length_);
-
-    *gradient = Real3({grad_x, grad_y, grad_z});
-  }
+  *gradient = GetBoxGradient(idx);
   if (normalize) {
     auto norm = gradient->Norm();
     if (norm > 1e-10) {
@@ -458,6 +819,188 @@ void DiffusionGrid::GetGradient(const Real3& position, Real3* gradient,
   }
 }
 
+Real3 DiffusionGrid::GetBoxGradient(size_t idx) const {
+  if (init_gradient_) {
+    return gradients_[idx];
+  }
+  // Get the neighboring boxes
+  const auto neighbors = GetNeighboringBoxes(idx);
+  std::array<int, 6> comparison;  // array to determine discretization h
+  std::transform(neighbors.begin(), neighbors.end(), comparison.begin(),
+                 [idx](size_t n) { return (n == idx) ? 0 : 1; });
+
+  // Calculate the gradient (ReadConcentration for thread safety)
+  const real_t x_minus = ReadConcentration(neighbors[0]);
+  const real_t x_plus = ReadConcentration(neighbors[1]);
+  const real_t y_minus = ReadConcentration(neighbors[2]);
+  const real_t y_plus = ReadConcentration(neighbors[3]);
+  const real_t z_minus = ReadConcentration(neighbors[4]);
+  const real_t z_plus = ReadConcentration(neighbors[5]);
+
+  real_t grad_x =
+      (x_plus - x_minus) / ((comparison[1] + comparison[0]) * box_length_);
+  real_t grad_y =
+      (y_plus - y_minus) / ((comparison[3] + comparison[2]) * box_length_);
+  real_t grad_z =
+      (z_plus - z_minus) / ((comparison[5] + comparison[4]) * box_length_);
+
+  return {grad_x, grad_y, grad_z};
+}
+
+namespace {
+
+/// Number of positions whose box indices are computed before the grid is
+/// accessed in `GetValues` and `GetGradients`
+constexpr uint64_t kSamplingBatchSize = 64;
+
+/// Returns the trilinear interpolation weight of corner `c` (see
+/// `DiffusionGrid::GetInterpolationStencil`)
+inline real_t CornerWeight(int c, const Real3& w) {
+  return (c & 1 ? w[0] : 1 - w[0]) * (c & 2 ? w[1] : 1 - w[1]) *
+         (c & 4 ? w[2] : 1 - w[2]);
+}
+
+}  // namespace
+
+void DiffusionGrid::GetValues(const Real3* positions, uint64_t n,
+                              real_t* values, bool interpolate) const {
+  uint64_t num_outside = 0;
+  if (interpolate) {
+    std::array<size_t, 8> boxes;
+    Real3 weights;
+    for (uint64_t i = 0; i < n; ++i) {
+      values[i] = 0;
+      if (!GetInterpolationStencil(positions[i], &boxes, &weights)) {
+        num_outside++;
+        continue;
+      }
+      for (int c = 0; c < 8; ++c) {
+        values[i] += CornerWeight(c, weights) * ReadConcentration(boxes[c]);
+      }
+    }
+  } else {
+    // The box indices of a batch are computed first, such that the loads of
+    // the gather loop are independent
+    size_t idx[kSamplingBatchSize];
+    for (uint64_t start = 0; start < n; start += kSamplingBatchSize) {
+      const uint64_t size = std::min(kSamplingBatchSize, n - start);
+      GetBoxIndices(positions + start, size, idx);
+      for (uint64_t i = 0; i < size; ++i) {
+        if (idx[i] >= total_num_boxes_) {
+          values[start + i] = 0;
+          num_outside++;
+          continue;
+        }
+        values[start + i] = ReadConcentration(idx[i]);
+      }
+    }
+  }
+  if (num_outside != 0) {
+    Log::Error("DiffusionGrid::GetValues", num_outside,
+               " positions are outside the bounds of the diffusion grid! ",
+               "Returning zero for them.");
+  }
+}
+
+void DiffusionGrid::GetGradients(const Real3* positions, uint64_t n,
+                                 Real3* gradients, bool normalize,
+                                 bool interpolate) const {
+  uint64_t num_outside = 0;
+  if (interpolate) {
+    std::array<size_t, 8> boxes;
+    Real3 weights;
+    for (uint64_t i = 0; i < n; ++i) {
+      gradients[i] = {0, 0, 0};
+      if (!GetInterpolationStencil(positions[i], &boxes, &weights)) {
+        num_outside++;
+        continue;
+      }
+      for (int c = 0; c < 8; ++c) {
+        gradients[i] += GetBoxGradient(boxes[c]) * CornerWeight(c, weights);
+      }
+    }
+  } else {
+    size_t idx[kSamplingBatchSize];
+    for (uint64_t start = 0; start < n; start += kSamplingBatchSize) {
+      const uint64_t size = std::min(kSamplingBatchSize, n - start);
+      GetBoxIndices(positions + start, size, idx);
+      for (uint64_t i = 0; i < size; ++i) {
+        if (idx[i] >= total_num_boxes_) {
+          gradients[start + i] = {0, 0, 0};
+          num_outside++;
+          continue;
+        }
+        gradients[start + i] = GetBoxGradient(idx[i]);
+      }
+    }
+  }
+  if (num_outside != 0) {
+    Log::Error("DiffusionGrid::GetGradients", num_outside,
+               " positions are outside the bounds of the diffusion grid! ",
+               "Returning zero gradients for them.");
+  }
+  if (normalize) {
+    NormalizeN(gradients, n, static_cast<real_t>(1e-10));
+  }
+}
+
+void DiffusionGrid::GetBoxIndices(const Real3* positions, uint64_t n,
+                                  size_t* indices) const {
+  const real_t lower[3] = {static_cast<real_t>(grid_dimensions_[0]),
+                           static_cast<real_t>(grid_dimensions_[2]),
+                           static_cast<real_t>(grid_dimensions_[4])};
+  const auto nx = num_boxes_axis_[0];
+  const auto ny = num_boxes_axis_[1];
+  const auto nz = num_boxes_axis_[2];
+#pragma omp simd
+  for (uint64_t i = 0; i < n; ++i) {
+    const real_t x = (positions[i][0] - lower[0]) / box_length_;
+    const real_t y = (positions[i][1] - lower[1]) / box_length_;
+    const real_t z = (positions[i][2] - lower[2]) / box_length_;
+    const bool inside =
+        x >= 0 && x <= nx && y >= 0 && y <= ny && z >= 0 && z <= nz;
+    // The upper bound belongs to the last box
+    const size_t bx = std::min(static_cast<size_t>(inside ? x : 0), nx - 1);
+    const size_t by = std::min(static_cast<size_t>(inside ? y : 0), ny - 1);
+    const size_t bz = std::min(static_cast<size_t>(inside ? z : 0), nz - 1);
+    indices[i] = inside ? bx + (by + bz * ny) * nx : total_num_boxes_;
+  }
+}
+
+bool DiffusionGrid::GetInterpolationStencil(const Real3& position,
+                                            std::array<size_t, 8>* boxes,
+                                            Real3* weights) const {
+  std::array<size_t, 3> lo;
+  std::array<size_t, 3> hi;
+  for (int a = 0; a < 3; ++a) {
+    const real_t rel = (position[a] - grid_dimensions_[2 * a]) / box_length_;
+    const auto n = num_boxes_axis_[a];
+    if (!(rel >= 0 && rel <= n)) {
+      return false;
+    }
+    // Position relative to the box centers
+    const real_t t = rel - static_cast<real_t>(0.5);
+    if (t <= 0) {
+      lo[a] = hi[a] = 0;
+      (*weights)[a] = 0;
+    } else if (t >= n - 1) {
+      lo[a] = hi[a] = n - 1;
+      (*weights)[a] = 0;
+    } else {
+      lo[a] = static_cast<size_t>(t);
+      hi[a] = lo[a] + 1;
+      (*weights)[a] = t - lo[a];
+    }
+  }
+  const auto nx = num_boxes_axis_[0];
+  const auto nxy = num_boxes_axis_[0] * num_boxes_axis_[1];
+  for (int c = 0; c < 8; ++c) {
+    (*boxes)[c] = (c & 1 ? hi[0] : lo[0]) + (c & 2 ? hi[1] : lo[1]) * nx +
+                  (c & 4 ? hi[2] : lo[2]) * nxy;
+  }
+  return true;
+}
+
 std::array<uint32_t, 3> DiffusionGrid::GetBoxCoordinates(
     const Real3& position) const {
   std::array<uint32_t, 3> box_coord;
@@ -465,17 +1008,17 @@ std::array<uint32_t, 3> DiffusionGrid::GetBoxCoordinates(
   for (size_t i = 0; i < 3; i++) {
 // Check if position is within boundaries
 #ifndef NDEBUG
-    assert((position[i] >= grid_dimensions_[0]) &&
+    assert((position[i] >= grid_dimensions_[2 * i]) &&
            "You tried to get the box coordinates outside the bounds of the "
            "diffusion grid!");
-    assert((position[i] <= grid_dimensions_[1]) &&
+    assert((position[i] <= grid_dimensions_[2 * i + 1]) &&
            "You tried to get the box coordinates outside the bounds of the "
            "diffusion grid!");
 #endif  // NDEBUG
     // Get box coords (Note: conversion to uint32_t should be save for typical
     // grid sizes)
     box_coord[i] = static_cast<uint32_t>(
-        std::floor((position[i] - grid_dimensions_[0]) / box_length_));
+        std::floor((position[i] - grid_dimensions_[2 * i]) / box_length_));
   }
   return box_coord;
 }
@@ -485,17 +1028,19 @@ std::array<uint32_t, 3> DiffusionGrid::GetBoxCoordinates(
   // Resolution must be smaller than uint32_t max for the box coordinates to be
   // representable
   assert(resolution_ < std::numeric_limits<uint32_t>::max());
+  const auto nx = num_boxes_axis_[0];
+  const auto ny = num_boxes_axis_[1];
   std::array<uint32_t, 3> box_coord;
-  box_coord[0] = static_cast<uint32_t>(idx % resolution_);
-  box_coord[1] = static_cast<uint32_t>((idx / resolution_) % resolution_);
-  box_coord[2] = static_cast<uint32_t>(idx / (resolution_ * resolution_));
+  box_coord[0] = static_cast<uint32_t>(idx % nx);
+  box_coord[1] = static_cast<uint32_t>((idx / nx) % ny);
+  box_coord[2] = static_cast<uint32_t>(idx / (nx * ny));
   return box_coord;
 }
 
 size_t DiffusionGrid::GetBoxIndex(
     const std::array<uint32_t, 3>& box_coord) const {
-  size_t ret = box_coord[2] * resolution_ * resolution_ +
-               box_coord[1] * resolution_ + box_coord[0];
+  size_t ret = box_coord[2] * num_boxes_axis_[0] * num_boxes_axis_[1] +
+               box_coord[1] * num_boxes_axis_[0] + box_coord[0];
   return ret;
 }
 
@@ -513,16 +1058,14 @@ std::array<size_t, 6> DiffusionGrid::GetNeighboringBoxes(size_t index) const {
 std::array<size_t, 6> DiffusionGrid::GetNeighboringBoxes(
     size_t index, const std::array<uint32_t, 3>& box_coord) const {
   std::array<size_t, 6> neighbors;
+  const auto nx = num_boxes_axis_[0];
+  const auto nxy = num_boxes_axis_[0] * num_boxes_axis_[1];
   neighbors[0] = (box_coord[0] == 0) ? index : index - 1;
-  neighbors[1] = (box_coord[0] == resolution_ - 1) ? index : index + 1;
-  neighbors[2] = (box_coord[1] == 0) ? index : index - resolution_;
-  neighbors[3] =
-      (box_coord[1] == resolution_ - 1) ? index : index + resolution_;
-  neighbors[4] =
-      (box_coord[2] == 0) ? index : index - resolution_ * resolution_;
-  neighbors[5] = (box_coord[2] == resolution_ - 1)
-                     ? index
-                     : index + resolution_ * resolution_;
+  neighbors[1] = (box_coord[0] == nx - 1) ? index : index + 1;
+  neighbors[2] = (box_coord[1] == 0) ? index : index - nx;
+  neighbors[3] = (box_coord[1] == num_boxes_axis_[1] - 1) ? index : index + nx;
+  neighbors[4] = (box_coord[2] == 0) ? index : index - nxy;
+  neighbors[5] = (box_coord[2] == num_boxes_axis_[2] - 1) ? index : index + nxy;
   return neighbors;
 }
 
@@ -569,7 +1112,7 @@ void DiffusionGrid::PrintInfo(std::ostream& out) {
   auto domain = GetDimensions();
   auto umin = GetLowerThreshold();
   auto umax = GetUpperThreshold();
-  auto resolution = GetResolution();
+  auto num_boxes_axis = GetNumBoxesArray();
   auto num_boxes = GetNumBoxes();
 
   // Print the info
@@ -582,8 +1125,8 @@ void DiffusionGrid::PrintInfo(std::ostream& out) {
   out << "    domain     : "
       << "[" << domain[0] << ", " << domain[1] << "] x [" << domain[2] << ", "
       << domain[3] << "] x [" << domain[4] << ", " << domain[5] << "]\n";
-  out << "    resolution : " << resolution << " x " << resolution << " x "
-      << resolution << "\n";
+  out << "    resolution : " << num_boxes_axis[0] << " x " << num_boxes_axis[1]
+      << " x " << num_boxes_axis[2] << "\n";
   out << "    num boxes  : " << num_boxes << "\n";
   out << "    boundary   : " << BoundaryTypeToString(bc_type_) << "\n";
 };
@@ -109,6 +109,33 @@ class DiffusionGrid : public ScalarField {
   void Step(real_t dt) override { Diffuse(dt); }
   void Diffuse(real_t dt);
 
+  /// Performs `num_steps` diffusion steps. If
+  /// `Param::diffusion_temporal_blocking` is larger than one and the grid
+  /// provides an explicit stencil (see `GetExplicitStencil`), up to that many
+  /// steps are fused: the grid is split into tiles and each tile is advanced
+  /// by several steps while it resides in the cache (overlapped temporal
+  /// tiling). Otherwise, `Diffuse` is called `num_steps` times.
+  void MultiStep(real_t dt, uint64_t num_steps) override;
+
+  /// Coefficients of one explicit diffusion step
+  ///     c2[c] = decay * c1[c] + diffusion * (sum of neighbors - 6 * c1[c])
+  ///             - sink[c] * c1[c]
+  /// Boundary boxes are updated according to the boundary condition type.
+  struct ExplicitStencil {
+    real_t decay = 1;
+    real_t diffusion = 0;
+    /// Optional sink term for each box (empty if there is none)
+    std::vector<real_t> sink;
+  };
+
+  /// Returns false if a step with time step `dt` can not be expressed as
+  /// `ExplicitStencil` for the current boundary condition type. In this
+  /// case, the grid does not support temporal blocking. Implementations
+  /// return true for the supported cases.
+  virtual bool GetExplicitStencil(real_t dt, ExplicitStencil* stencil) const {
+    return false;
+  }
+
   [[deprecated("Use Neumann / Dirichlet instead")]] virtual void
   DiffuseWithClosedEdge(real_t dt) = 0;
   [[deprecated("Use Neumann / Dirichlet instead")]] virtual void
@@ -152,6 +179,9 @@ class DiffusionGrid : public ScalarField {
   /// for instance, [mg] but the diffusion grid is in units of [mg / um^3]. It's
   /// helpful to model this way to obtain similar/identical results independent
   /// of the resolution of the diffusion grid.
+  /// If `Param::deferred_concentration_changes` is set, the change is stored
+  /// in a buffer of the calling thread instead and applied in
+  /// `ApplyDeferredChanges`. Until then, it is not visible to `GetValue`.
   void ChangeConcentrationBy(const Real3& position, real_t amount,
                              InteractionMode mode = InteractionMode::kAdditive,
                              bool scale_with_resolution = false);
@@ -161,6 +191,13 @@ class DiffusionGrid : public ScalarField {
                              InteractionMode mode = InteractionMode::kAdditive,
                              bool scale_with_resolution = false);
 
+  /// Applies the changes that were buffered by `ChangeConcentrationBy` if
+  /// `Param::deferred_concentration_changes` is set. The changes of each
+  /// thread are applied in the order in which they were made. Is called by
+  /// `ContinuumOp` in each iteration and before each diffusion step.
+  /// Not thread-safe.
+  void ApplyDeferredChanges();
+
   /// @brief  Get the value of the scalar field at specified position
   /// @param position 3D position of
   /// @return c1_[idx[position]]
@@ -206,6 +243,24 @@ class DiffusionGrid : public ScalarField {
   virtual void GetGradient(const Real3& position, Real3* gradient,
                            bool normalize = true) const;
 
+  /// Get the values at `n` positions. The box indices of all positions are
+  /// computed in one vectorized loop before the concentrations are gathered.
+  /// Positions outside of the grid yield zero and are reported in one error
+  /// message per call. If `interpolate` is true, the values are interpolated
+  /// trilinearly between the centers of the eight closest boxes (constant
+  /// within half a box of the boundary). Positions that are sorted by box
+  /// (e.g. agents after load balancing) access the grid in memory order.
+  void GetValues(const Real3* positions, uint64_t n, real_t* values,
+                 bool interpolate = false) const;
+
+  /// Get the gradients at `n` positions. Same as calling
+  /// `GetGradient(positions[i], &gradients[i], normalize)` for each position,
+  /// but the gradients are normalized in one vectorized loop (see
+  /// `NormalizeN`). If `interpolate` is true, the gradients of the boxes are
+  /// interpolated trilinearly (see `GetValues`).
+  void GetGradients(const Real3* positions, uint64_t n, Real3* gradients,
+                    bool normalize = true, bool interpolate = false) const;
+
   /// Get the coordinates of the box at the specified position
   std::array<uint32_t, 3> GetBoxCoordinates(const Real3& position) const;
 
@@ -255,13 +310,8 @@ class DiffusionGrid : public ScalarField {
 
   const real_t* GetAllGradients() const { return gradients_.data()->data(); }
 
-  std::array<size_t, 3> GetNumBoxesArray() const {
-    std::array<size_t, 3> ret;
-    ret[0] = resolution_;
-    ret[1] = resolution_;
-    ret[2] = resolution_;
-    return ret;
-  }
+  /// Returns the number of boxes along each axis [x, y, z]
+  std::array<size_t, 3> GetNumBoxesArray() const { return num_boxes_axis_; }
 
   size_t GetNumBoxes() const { return total_num_boxes_; }
 
@@ -280,27 +330,25 @@ class DiffusionGrid : public ScalarField {
 
   const int32_t* GetDimensionsPtr() const { return grid_dimensions_.data(); }
 
-  std::array<int32_t, 6> GetDimensions() const {
-    std::array<int32_t, 6> ret;
-    ret[0] = grid_dimensions_[0];
-    ret[1] = grid_dimensions_[1];
-    ret[2] = grid_dimensions_[0];
-    ret[3] = grid_dimensions_[1];
-    ret[4] = grid_dimensions_[0];
-    ret[5] = grid_dimensions_[1];
-    return ret;
-  }
+  /// Returns the bounds of the grid [xmin, xmax, ymin, ymax, zmin, zmax]
+  std::array<int32_t, 6> GetDimensions() const { return grid_dimensions_; }
+
+  /// Returns true if the grid covers the domain along each axis, i.e. if
+  /// `Update` does not need to grow it
+  bool CoversDomain() const;
 
   std::array<int32_t, 3> GetGridSize() const {
     std::array<int32_t, 3> ret;
     ret[0] = grid_dimensions_[1] - grid_dimensions_[0];
-    ret[1] = grid_dimensions_[1] - grid_dimensions_[0];
-    ret[2] = grid_dimensions_[1] - grid_dimensions_[0];
+    ret[1] = grid_dimensions_[3] - grid_dimensions_[2];
+    ret[2] = grid_dimensions_[5] - grid_dimensions_[4];
     return ret;
   }
 
   const std::array<real_t, 7>& GetDiffusionCoefficients() const { return dc_; }
 
+  /// Returns the number of boxes along the longest axis. For cubic grids,
+  /// this is the number of boxes along each axis.
   size_t GetResolution() const { return resolution_; }
 
   real_t GetBoxVolume() const { return box_volume_; }
@@ -347,12 +395,18 @@ class DiffusionGrid : public ScalarField {
   void TurnOffGradientCalculation() { precompute_gradients_ = false; }
 
  private:
+  friend class ADIGrid;
   friend class RungeKuttaGrid;
   friend class EulerGrid;
   friend class EulerDepletionGrid;
   friend class TestGrid;  // class used for testing (e.g. initialization)
 
-  void ParametersCheck(real_t dt);
+  virtual void ParametersCheck(real_t dt);
+
+  /// Performs `num_steps` explicit steps with overlapped temporal tiling
+  /// (see `MultiStep`)
+  void DiffuseTemporallyBlocked(uint64_t num_steps,
+                                const ExplicitStencil& stencil);
 
   /// Copies the concentration and gradients values to the new
   /// (larger) grid. In the 2D case it looks like the following:
@@ -362,21 +416,66 @@ class DiffusionGrid : public ScalarField {
   ///               [v3 v4]  -->  [0 v3 v4 0]
   ///                             [0 0  0  0]
   ///
-  /// The dimensions are doubled in this case from 2x2 to 4x4
-  /// If the dimensions would be increased from 2x2 to 3x3, it will still
-  /// be increased to 4x4 in order for GetBoxIndex to function correctly
-  ///
+  /// The old boxes keep their position in space, i.e. their offset in the new
+  /// grid is given by the distance between the old and the new lower bounds
+  /// (`old_dimensions` and `grid_dimensions_`). If only one side of an axis
+  /// grows, the zeros are added on that side only. `Update` adds boxes below
+  /// the grid in multiples of `GetIntegerLengthNumBoxes`, such that this
+  /// distance is a whole number of boxes also if `box_length_` is not an
+  /// integer.
   void CopyOldData(const ParallelResizeVector<real_t>& old_c1,
                    const ParallelResizeVector<Real3>& old_gradients,
-                   size_t old_resolution);
+                   const std::array<size_t, 3>& old_num_boxes,
+                   const std::array<int32_t, 6>& old_dimensions);
+
+  /// Changes the concentration of box `idx` without locking
+  void ApplyChange(size_t idx, real_t amount, InteractionMode mode);
+
+  /// Returns the concentration of box `idx` without bounds check. Locks the
+  /// box unless changes are deferred.
+  real_t ReadConcentration(size_t idx) const;
+
+  /// Returns the gradient of box `idx` (see `GetGradient`)
+  Real3 GetBoxGradient(size_t idx) const;
+
+  /// Computes the indices of the boxes at `n` positions. Positions outside of
+  /// the grid get the index `total_num_boxes_`.
+  void GetBoxIndices(const Real3* positions, uint64_t n,
+                     size_t* indices) const;
+
+  /// Computes the eight boxes around `position` and the interpolation
+  /// weights along each axis. Corner `i` lies at the upper side of axis `a`
+  /// if bit `a` of `i` is set. Returns false if `position` is outside of the
+  /// grid.
+  bool GetInterpolationStencil(const Real3& position,
+                               std::array<size_t, 8>* boxes,
+                               Real3* weights) const;
+
+  /// Returns the bounds of the domain that the grid must cover
+  /// [xmin, xmax, ymin, ymax, zmin, zmax]. The bounds are the same along each
+  /// axis unless `Param::non_cubic_diffusion_grid` is set.
+  std::array<int32_t, 6> GetDomainBounds() const;
 
   /// The side length of each box
   real_t box_length_ = 0;
   /// the volume of each box
   real_t box_volume_ = 0;
   /// Lock for each voxel used to prevent race conditions between
-  /// multiple threads
+  /// multiple threads. Not allocated if the changes are deferred.
   mutable ParallelResizeVector<Spinlock> locks_ = {};  //!
+  /// A change of the concentration that has not been applied yet
+  struct DeferredChange {
+    size_t idx;
+    real_t amount;
+    InteractionMode mode;
+  };
+  /// See `Param::deferred_concentration_changes`
+  bool defer_changes_ = false;
+  /// Buffered changes of each thread
+  std::vector<std::vector<DeferredChange>> deferred_changes_ = {};  //!
+  /// The buffered changes of each thread sorted by the thread that applies
+  /// them in `ApplyDeferredChanges`
+  std::vector<std::vector<DeferredChange>> sorted_changes_ = {};  //!
   /// The array of concentration values
   ParallelResizeVector<real_t> c1_ = {};
   /// An extra concentration data buffer for faster value updating
@@ -391,19 +490,18 @@ class DiffusionGrid : public ScalarField {
   std::array<real_t, 7> dc_ = {{0}};
   /// The decay constant
   real_t mu_ = 0;
-  /// The grid dimensions of the diffusion grid (cubic shaped)
-  std::array<int32_t, 2> grid_dimensions_ = {{0}};
-  /// The number of boxes at each axis [x, y, z] (same along each axis)
-  uint64_t num_boxes_axis_ = 0;
+  /// The grid dimensions of the diffusion grid
+  /// [xmin, xmax, ymin, ymax, zmin, zmax]
+  std::array<int32_t, 6> grid_dimensions_ = {{0}};
+  /// The number of boxes at each axis [x, y, z]
+  std::array<size_t, 3> num_boxes_axis_ = {{0}};
   /// The total number of boxes in the diffusion grid
   size_t total_num_boxes_ = 0;
-  /// The resolution of the diffusion grid (i.e. number of boxes along each
-  /// axis)
+  /// The resolution of the diffusion grid (i.e. number of boxes along the
+  /// longest axis)
   size_t resolution_ = 0;
   /// The last timestep `dt` used for the diffusion grid update `Diffuse(dt)`
   real_t last_dt_ = 0.0;
-  /// If false, grid dimensions are even; if true, they are odd
-  bool parity_ = false;
   /// A list of functions that initialize this diffusion grid
   /// ROOT currently doesn't support IO of std::function
   std::vector<std::function<real_t(real_t, real_t, real_t)>> initializers_ =
@@ -423,7 +521,7 @@ class DiffusionGrid : public ScalarField {
   /// are used but the gradient is only needed for one of them.)
   bool precompute_gradients_ = true;
 
-  BDM_CLASS_DEF_OVERRIDE(DiffusionGrid, 1);
+  BDM_CLASS_DEF_OVERRIDE(DiffusionGrid, 4);
 };
 
 }  // namespace bdm
@@ -36,10 +36,10 @@ void EulerDepletionGrid::ApplyDepletion(real_t dt) {
       continue;
     }
 
-    size_t depleting_boxes =
-        rm->GetDiffusionGrid(binding_substances_[s])->GetNumBoxes();
+    auto depleting_boxes =
+        rm->GetDiffusionGrid(binding_substances_[s])->GetNumBoxesArray();
 
-    if (depleting_boxes != GetNumBoxes()) {
+    if (depleting_boxes != GetNumBoxesArray()) {
       Log::Fatal(
           "EulerDepletionGrid::ApplyDepletion()",
           "The number of voxels of the depleting diffusion grid ",
@@ -60,6 +60,38 @@ void EulerDepletionGrid::ApplyDepletion(real_t dt) {
   std::swap(c1_, c2_);
 }
 
+bool EulerDepletionGrid::GetExplicitStencil(real_t dt,
+                                            ExplicitStencil* stencil) const {
+  if (!EulerGrid::GetExplicitStencil(dt, stencil)) {
+    return false;
+  }
+  const auto* rm = Simulation::GetActive()->GetResourceManager();
+  for (size_t s = 0; s < binding_substances_.size(); s++) {
+    if (binding_coefficients_[s] == 0.0) {
+      continue;
+    }
+    auto* depleting_grid = rm->GetDiffusionGrid(binding_substances_[s]);
+    if (bc_type_ == BoundaryConditionType::kClosedBoundaries ||
+        depleting_grid->GetNumBoxesArray() != GetNumBoxesArray()) {
+      // Fall back to ApplyDepletion, which also reports the error for
+      // mismatching resolutions
+      return false;
+    }
+    if (stencil->sink.empty()) {
+      stencil->sink.resize(total_num_boxes_, 0);
+    }
+    const auto* depleting_concentration =
+        depleting_grid->GetAllConcentrations();
+    const real_t factor = binding_coefficients_[s] * dt;
+    auto* sink = stencil->sink.data();
+#pragma omp parallel for simd
+    for (size_t c = 0; c < total_num_boxes_; c++) {
+      sink[c] += factor * depleting_concentration[c];
+    }
+  }
+  return true;
+}
+
 void EulerDepletionGrid::DiffuseWithClosedEdge(real_t dt) {
   // Update concentration without depletion (c1 is modified)
   EulerGrid::DiffuseWithClosedEdge(dt);
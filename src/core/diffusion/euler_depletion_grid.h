@@ -59,6 +59,11 @@ class EulerDepletionGrid : public EulerGrid {
   /// binding_coefficients_. See ApplyDepletion for details.
   void DiffuseWithNeumann(real_t dt) override;
 
+  /// The depletion is expressed as sink term, which is constant during the
+  /// fused steps. Not supported for closed boundaries, since their boxes are
+  /// depleted but not diffused, and for open boundaries (see `EulerGrid`).
+  bool GetExplicitStencil(real_t dt, ExplicitStencil* stencil) const override;
+
   // To avoid missing substances or coefficients, name of the sub and binding
   // coefficient must be set at the same time
 
@@ -31,9 +31,9 @@ inline size_t Clamp(size_t val, size_t min, size_t max) {
 }
 
 void EulerGrid::DiffuseWithClosedEdge(real_t dt) {
-  const auto nx = resolution_;
-  const auto ny = resolution_;
-  const auto nz = resolution_;
+  const auto nx = num_boxes_axis_[0];
+  const auto ny = num_boxes_axis_[1];
+  const auto nz = num_boxes_axis_[2];
 
   const real_t ibl2 = 1 / (box_length_ * box_length_);
   const real_t d = 1 - dc_[0];
@@ -79,9 +79,9 @@ void EulerGrid::DiffuseWithClosedEdge(real_t dt) {
 }
 
 void EulerGrid::DiffuseWithOpenEdge(real_t dt) {
-  const auto nx = resolution_;
-  const auto ny = resolution_;
-  const auto nz = resolution_;
+  const auto nx = num_boxes_axis_[0];
+  const auto ny = num_boxes_axis_[1];
+  const auto nz = num_boxes_axis_[2];
 
   const real_t ibl2 = 1 / (box_length_ * box_length_);
   const real_t d = 1 - dc_[0];
@@ -167,9 +167,9 @@ void EulerGrid::DiffuseWithOpenEdge(real_t dt) {
 }
 
 void EulerGrid::DiffuseWithDirichlet(real_t dt) {
-  const auto nx = resolution_;
-  const auto ny = resolution_;
-  const auto nz = resolution_;
+  const auto nx = num_boxes_axis_[0];
+  const auto ny = num_boxes_axis_[1];
+  const auto nz = num_boxes_axis_[2];
 
   const real_t ibl2 = 1 / (box_length_ * box_length_);
   const real_t d = 1 - dc_[0];
@@ -198,8 +198,8 @@ void EulerGrid::DiffuseWithDirichlet(real_t dt) {
               z == (nz - 1)) {
             // For all boxes on the boundary, we simply evaluate the boundary
             real_t real_x = grid_dimensions_[0] + x * box_length_;
-            real_t real_y = grid_dimensions_[0] + y * box_length_;
-            real_t real_z = grid_dimensions_[0] + z * box_length_;
+            real_t real_y = grid_dimensions_[2] + y * box_length_;
+            real_t real_z = grid_dimensions_[4] + z * box_length_;
             c2_[c] =
                 boundary_condition_->Evaluate(real_x, real_y, real_z, sim_time);
           } else {
@@ -223,9 +223,9 @@ void EulerGrid::DiffuseWithDirichlet(real_t dt) {
 }
 
 void EulerGrid::DiffuseWithNeumann(real_t dt) {
-  const auto nx = resolution_;
-  const auto ny = resolution_;
-  const auto nz = resolution_;
+  const auto nx = num_boxes_axis_[0];
+  const auto ny = num_boxes_axis_[1];
+  const auto nz = num_boxes_axis_[2];
   const auto num_boxes = nx * ny * nz;
 
   const real_t ibl2 = 1 / (box_length_ * box_length_);
@@ -270,8 +270,8 @@ void EulerGrid::DiffuseWithNeumann(real_t dt) {
           if (x == 0 || x == (nx - 1) || y == 0 || y == (ny - 1) || z == 0 ||
               z == (nz - 1)) {
             real_t real_x = grid_dimensions_[0] + x * box_length_;
-            real_t real_y = grid_dimensions_[0] + y * box_length_;
-            real_t real_z = grid_dimensions_[0] + z * box_length_;
+            real_t real_y = grid_dimensions_[2] + y * box_length_;
+            real_t real_z = grid_dimensions_[4] + z * box_length_;
             real_t boundary_value =
                 -box_length_ *
                 boundary_condition_->Evaluate(real_x, real_y, real_z, sim_time);
@@ -313,4 +313,15 @@ void EulerGrid::DiffuseWithNeumann(real_t dt) {
   c1_.swap(c2_);
 }
 
+bool EulerGrid::GetExplicitStencil(real_t dt,
+                                   ExplicitStencil* stencil) const {
+  if (bc_type_ == BoundaryConditionType::kOpenBoundaries) {
+    return false;
+  }
+  stencil->decay = 1 - mu_ * dt;
+  stencil->diffusion = (1 - dc_[0]) * dt / (box_length_ * box_length_);
+  stencil->sink.clear();
+  return true;
+}
+
 }  // namespace bdm
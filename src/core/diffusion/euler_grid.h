@@ -53,6 +53,11 @@ class EulerGrid : public DiffusionGrid {
   void DiffuseWithDirichlet(real_t dt) override;
   void DiffuseWithNeumann(real_t dt) override;
 
+  /// Supports all boundary condition types except open boundaries, which
+  /// `DiffuseWithOpenEdge` treats differently along the x axis than along y
+  /// and z.
+  bool GetExplicitStencil(real_t dt, ExplicitStencil* stencil) const override;
+
  private:
   BDM_CLASS_DEF_OVERRIDE(EulerGrid, 1);
 };
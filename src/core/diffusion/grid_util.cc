@@ -0,0 +1,34 @@
+// -----------------------------------------------------------------------------
+//
+// Copyright (C) 2021 CERN & University of Surrey for the benefit of the
+// BioDynaMo collaboration. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+//
+// See the LICENSE file distributed with this work for details.
+// See the NOTICE file distributed with this work for additional information
+// regarding copyright ownership.
+//
+// -----------------------------------------------------------------------------
+
+#include "core/diffusion/grid_util.h"
+#include "core/environment/environment.h"
+#include "core/simulation.h"
+#include "core/util/log.h"
+
+namespace bdm {
+
+std::array<int32_t, 2> GetCubicGridBounds(const std::string& caller,
+                                          const std::string& name) {
+  auto* env = Simulation::GetActive()->GetEnvironment();
+  auto bounds = env->GetDimensionThresholds();
+  if (bounds[0] >= bounds[1]) {
+    Log::Fatal(caller,
+               "The grid dimensions are not correct. Lower bound is not ",
+               "smaller than upper bound. (substance '", name, "')");
+  }
+  return bounds;
+}
+
+}  // namespace bdm
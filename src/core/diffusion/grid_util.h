@@ -0,0 +1,112 @@
+// -----------------------------------------------------------------------------
+//
+// Copyright (C) 2021 CERN & University of Surrey for the benefit of the
+// BioDynaMo collaboration. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+//
+// See the LICENSE file distributed with this work for details.
+// See the NOTICE file distributed with this work for additional information
+// regarding copyright ownership.
+//
+// -----------------------------------------------------------------------------
+
+#ifndef CORE_DIFFUSION_GRID_UTIL_H_
+#define CORE_DIFFUSION_GRID_UTIL_H_
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <string>
+
+#include "core/container/math_array.h"
+#include "core/real_t.h"
+
+namespace bdm {
+
+// Helper functions for the scalar fields with cubic grids (`AMRGrid`,
+// `BrickedGrid` and `MultiSubstanceGrid`). The grid has `resolution` boxes
+// along each axis and starts at `lower` along each axis.
+
+/// Returns the bounds [lower, upper] of the cube that a grid must cover, i.e.
+/// the dimension thresholds of the environment. `caller` and `name` are
+/// reported if the cube is empty.
+std::array<int32_t, 2> GetCubicGridBounds(const std::string& caller,
+                                          const std::string& name);
+
+/// Computes the coordinates of the box at `position`. Returns false if
+/// `position` is outside of the grid.
+template <typename T>
+inline bool GetCubicBoxCoordinates(const Real3& position, real_t lower,
+                                   real_t box_length, size_t resolution,
+                                   std::array<T, 3>* box) {
+  for (size_t i = 0; i < 3; i++) {
+    const real_t coord = std::floor((position[i] - lower) / box_length);
+    if (!(coord >= 0 && coord < resolution)) {
+      return false;
+    }
+    (*box)[i] = static_cast<T>(coord);
+  }
+  return true;
+}
+
+/// Evaluates the initializer `f(x, y, z)` at the center of box (`x`, `y`,
+/// `z`), like `DiffusionGrid::RunInitializers`
+template <typename TFunction>
+inline real_t EvaluateAtBoxCenter(const TFunction& f, real_t lower,
+                                  real_t box_length, size_t x, size_t y,
+                                  size_t z) {
+  return f(lower + (x + 0.5) * box_length, lower + (y + 0.5) * box_length,
+           lower + (z + 0.5) * box_length);
+}
+
+/// Returns true if an explicit Euler step of length `dt` is stable and keeps
+/// the concentrations positive (see `DiffusionGrid::ParametersCheck`)
+inline bool IsStableEulerStep(real_t dc, real_t mu, real_t box_length,
+                              real_t dt) {
+  const real_t ibl2 = 1 / (box_length * box_length);
+  return (mu + 12 * dc * ibl2) * dt <= 2 && 1 - (mu + 6 * dc * ibl2) * dt >= 0;
+}
+
+/// Returns the number of substeps into which `dt` must be split such that
+/// each explicit Euler step is stable (see `IsStableEulerStep`)
+inline uint64_t GetNumStableSubsteps(real_t dc, real_t mu, real_t box_length,
+                                     real_t dt) {
+  const real_t rate = mu + 6 * dc / (box_length * box_length);
+  if (rate * dt <= 1) {
+    return 1;
+  }
+  return static_cast<uint64_t>(std::ceil(rate * dt));
+}
+
+/// Returns the number of boxes that are needed to cover `length`
+inline int64_t GetNumBoxesToCover(real_t length, real_t box_length) {
+  return static_cast<int64_t>(std::ceil(length / box_length - 1e-9));
+}
+
+/// Returns the smallest number of boxes whose total length is an integer.
+/// The grid bounds are integers, hence a grid can only be extended by a
+/// multiple of this number of boxes without shifting the old boxes by a
+/// fraction of `box_length`. Box lengths that are computed as the ratio of
+/// two integers (see `DiffusionGrid::Initialize`) always have such a number.
+/// For other box lengths, 1 is returned.
+inline int64_t GetIntegerLengthNumBoxes(real_t box_length) {
+  constexpr int64_t kMaxNumBoxes = 1 << 16;
+  for (int64_t n = 1; n <= kMaxNumBoxes; n++) {
+    const real_t length = n * box_length;
+    if (std::abs(length - std::round(length)) < 1e-6 * box_length) {
+      return n;
+    }
+  }
+  return 1;
+}
+
+/// Rounds `num_boxes` up to a multiple of `step`
+inline int64_t RoundUpNumBoxes(int64_t num_boxes, int64_t step) {
+  return (num_boxes + step - 1) / step * step;
+}
+
+}  // namespace bdm
+
+#endif  // CORE_DIFFUSION_GRID_UTIL_H_
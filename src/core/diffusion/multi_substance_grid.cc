@@ -0,0 +1,318 @@
+// -----------------------------------------------------------------------------
+//
+// Copyright (C) 2021 CERN & University of Surrey for the benefit of the
+// BioDynaMo collaboration. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+//
+// See the LICENSE file distributed with this work for details.
+// See the NOTICE file distributed with this work for additional information
+// regarding copyright ownership.
+//
+// -----------------------------------------------------------------------------
+
+#include "core/diffusion/multi_substance_grid.h"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <mutex>
+#include "core/diffusion/grid_util.h"
+#include "core/environment/environment.h"
+#include "core/param/param.h"
+#include "core/simulation.h"
+#include "core/util/log.h"
+
+namespace bdm {
+
+MultiSubstanceGrid::MultiSubstanceGrid(int continuum_id,
+                                       const std::string& name,
+                                       int resolution)
+    : resolution_(resolution) {
+  SetContinuumId(continuum_id);
+  SetContinuumName(name);
+}
+
+SubstanceField* MultiSubstanceGrid::AddSubstance(int substance_id,
+                                                 const std::string& name,
+                                                 real_t dc, real_t mu) {
+  if (total_num_boxes_ != 0) {
+    Log::Fatal("MultiSubstanceGrid::AddSubstance",
+               "Substances must be added before the grid is initialized. ",
+               "(substance '", name, "')");
+  }
+  auto* field = new SubstanceField(this, substances_.size());
+  field->SetContinuumId(substance_id);
+  field->SetContinuumName(name);
+  substances_.push_back({dc, mu});
+  return field;
+}
+
+void MultiSubstanceGrid::Initialize() {
+  if (substances_.empty()) {
+    Log::Fatal("MultiSubstanceGrid::Initialize", "No substances were added ",
+               "to the grid '", GetContinuumName(), "'");
+  }
+  if (resolution_ < 2) {
+    Log::Fatal("MultiSubstanceGrid::Initialize",
+               "Resolution must be at least 2. (grid '", GetContinuumName(),
+               "')");
+  }
+
+  grid_dimensions_ =
+      GetCubicGridBounds("MultiSubstanceGrid::Initialize", GetContinuumName());
+  box_length_ = (grid_dimensions_[1] - grid_dimensions_[0]) /
+                static_cast<real_t>(resolution_);
+  total_num_boxes_ = resolution_ * resolution_ * resolution_;
+
+  const auto num_values = total_num_boxes_ * substances_.size();
+  c1_.resize(num_values);
+  c2_.resize(num_values);
+  gradients_.resize(num_values);
+  locks_.resize(total_num_boxes_);
+
+  const auto ns = substances_.size();
+  for (auto& initializer : initializers_) {
+    if (initializer.first >= ns) {
+      Log::Fatal("MultiSubstanceGrid::Initialize", "Initializer for unknown ",
+                 "substance ", initializer.first);
+    }
+#pragma omp parallel for collapse(2)
+    for (size_t z = 0; z < resolution_; z++) {
+      for (size_t y = 0; y < resolution_; y++) {
+        for (size_t x = 0; x < resolution_; x++) {
+          auto idx = x + (y + z * resolution_) * resolution_;
+          c1_[idx * ns + initializer.first] += EvaluateAtBoxCenter(
+              initializer.second, grid_dimensions_[0], box_length_, x, y, z);
+        }
+      }
+    }
+  }
+  initializers_.clear();
+}
+
+void MultiSubstanceGrid::Update() {
+  auto* env = Simulation::GetActive()->GetEnvironment();
+  auto bounds = env->GetDimensionThresholds();
+  if (bounds[0] < grid_dimensions_[0] || bounds[1] > grid_dimensions_[1]) {
+    Log::Fatal("MultiSubstanceGrid::Update", "The grid '", GetContinuumName(),
+               "' cannot grow with the simulation space. Please use a bound ",
+               "space.");
+  }
+}
+
+void MultiSubstanceGrid::Step(real_t dt) {
+  const auto* param = Simulation::GetActive()->GetParam();
+  ParametersCheck(dt);
+  Integrate(dt, param->calculate_gradients);
+}
+
+void MultiSubstanceGrid::MultiStep(real_t dt, uint64_t num_steps) {
+  const auto* param = Simulation::GetActive()->GetParam();
+  ParametersCheck(dt);
+  // Gradients are only needed for the state after the last step
+  for (uint64_t i = 0; i < num_steps; i++) {
+    Integrate(dt, param->calculate_gradients && i == num_steps - 1);
+  }
+}
+
+void MultiSubstanceGrid::Integrate(real_t dt, bool gradients) {
+  const size_t ns = substances_.size();
+  const size_t nx = resolution_;
+  const size_t ny = resolution_;
+  const size_t nz = resolution_;
+  const size_t row = nx * ns;
+  const size_t plane = row * ny;
+  const bool closed = bc_type_ == BoundaryConditionType::kClosedBoundaries;
+  const real_t ibl = 1 / box_length_;
+
+  // Coefficients of the stencil for each value of a row
+  std::vector<real_t> decay(row);
+  std::vector<real_t> diffusion(row);
+  for (size_t i = 0; i < row; i++) {
+    const auto& substance = substances_[i % ns];
+    decay[i] = 1 - substance.mu * dt;
+    diffusion[i] = substance.dc * dt * ibl * ibl;
+  }
+
+#pragma omp parallel for collapse(2)
+  for (size_t z = 0; z < nz; z++) {
+    for (size_t y = 0; y < ny; y++) {
+      const size_t offset = z * plane + y * row;
+      const real_t* in = c1_.data() + offset;
+      real_t* out = c2_.data() + offset;
+
+      // Neighboring rows. Rows outside the grid are replaced by the row
+      // itself. For Neumann boundaries this results in zero flux over the
+      // boundary.
+      const bool has_north = y != 0;
+      const bool has_south = y != ny - 1;
+      const bool has_bottom = z != 0;
+      const bool has_top = z != nz - 1;
+      const real_t* north = has_north ? in - row : in;
+      const real_t* south = has_south ? in + row : in;
+      const real_t* bottom = has_bottom ? in - plane : in;
+      const real_t* top = has_top ? in + plane : in;
+
+      if (gradients) {
+        // One-sided differences at the boundary (see
+        // `DiffusionGrid::CalculateGradient`)
+        Real3* grad = gradients_.data() + offset;
+        const real_t gy = ibl / (has_north + has_south);
+        const real_t gz = ibl / (has_bottom + has_top);
+        for (size_t i = 0; i < ns; i++) {
+          const size_t j = row - ns + i;
+          grad[i] = {(in[i + ns] - in[i]) * ibl, (south[i] - north[i]) * gy,
+                     (top[i] - bottom[i]) * gz};
+          grad[j] = {(in[j] - in[j - ns]) * ibl, (south[j] - north[j]) * gy,
+                     (top[j] - bottom[j]) * gz};
+        }
+#pragma omp simd
+        for (size_t i = ns; i < row - ns; i++) {
+          grad[i][0] = (in[i + ns] - in[i - ns]) * ibl / 2;
+          grad[i][1] = (south[i] - north[i]) * gy;
+          grad[i][2] = (top[i] - bottom[i]) * gz;
+        }
+      }
+
+      // Closed edges keep the values at the boundary
+      if (closed && !(has_north && has_south && has_bottom && has_top)) {
+        std::copy(in, in + row, out);
+        continue;
+      }
+      for (size_t i = 0; i < ns; i++) {
+        const size_t j = row - ns + i;
+        if (closed) {
+          out[i] = in[i];
+          out[j] = in[j];
+          continue;
+        }
+        out[i] = in[i] * decay[i] +
+                 diffusion[i] * (in[i + ns] + north[i] + south[i] +
+                                 bottom[i] + top[i] - 5 * in[i]);
+        out[j] = in[j] * decay[j] +
+                 diffusion[j] * (in[j - ns] + north[j] + south[j] +
+                                 bottom[j] + top[j] - 5 * in[j]);
+      }
+#pragma omp simd
+      for (size_t i = ns; i < row - ns; i++) {
+        out[i] = in[i] * decay[i] +
+                 diffusion[i] * (in[i - ns] + in[i + ns] + north[i] +
+                                 south[i] + bottom[i] + top[i] - 6 * in[i]);
+      }
+    }
+  }
+  c1_.swap(c2_);
+}
+
+void MultiSubstanceGrid::CalculateGradient() {
+  const size_t ns = substances_.size();
+  const size_t n = resolution_;
+  const real_t ibl = 1 / box_length_;
+
+#pragma omp parallel for collapse(2)
+  for (size_t z = 0; z < n; z++) {
+    for (size_t y = 0; y < n; y++) {
+      for (size_t x = 0; x < n; x++) {
+        const size_t idx = x + (y + z * n) * n;
+        // Neighboring boxes in each direction. One-sided differences at the
+        // boundary (see `DiffusionGrid::CalculateGradient`)
+        const size_t left = x == 0 ? idx : idx - 1;
+        const size_t right = x == n - 1 ? idx : idx + 1;
+        const size_t north = y == 0 ? idx : idx - n;
+        const size_t south = y == n - 1 ? idx : idx + n;
+        const size_t bottom = z == 0 ? idx : idx - n * n;
+        const size_t top = z == n - 1 ? idx : idx + n * n;
+        const real_t gx = ibl / ((x != 0) + (x != n - 1));
+        const real_t gy = ibl / ((y != 0) + (y != n - 1));
+        const real_t gz = ibl / ((z != 0) + (z != n - 1));
+        for (size_t i = 0; i < ns; i++) {
+          gradients_[idx * ns + i] = {
+              (c1_[right * ns + i] - c1_[left * ns + i]) * gx,
+              (c1_[south * ns + i] - c1_[north * ns + i]) * gy,
+              (c1_[top * ns + i] - c1_[bottom * ns + i]) * gz};
+        }
+      }
+    }
+  }
+}
+
+void MultiSubstanceGrid::SetBoundaryConditionType(
+    BoundaryConditionType bc_type) {
+  if (bc_type != BoundaryConditionType::kClosedBoundaries &&
+      bc_type != BoundaryConditionType::kNeumann) {
+    Log::Fatal("MultiSubstanceGrid::SetBoundaryConditionType",
+               "Only closed and Neumann boundaries are supported.");
+  }
+  bc_type_ = bc_type;
+}
+
+void MultiSubstanceGrid::ChangeConcentrationBy(size_t substance,
+                                               const Real3& position,
+                                               real_t amount) {
+  auto idx = GetBoxIndex(position);
+  if (idx >= total_num_boxes_) {
+    Log::Error("MultiSubstanceGrid::ChangeConcentrationBy",
+               "You tried to change the concentration outside the bounds of "
+               "the diffusion grid! The change was ignored.");
+    return;
+  }
+  std::lock_guard<Spinlock> guard(locks_[idx]);
+  c1_[idx * substances_.size() + substance] += amount;
+}
+
+real_t MultiSubstanceGrid::GetValue(size_t substance,
+                                    const Real3& position) const {
+  return GetConcentration(substance, GetBoxIndex(position));
+}
+
+real_t MultiSubstanceGrid::GetConcentration(size_t substance,
+                                            size_t idx) const {
+  if (idx >= total_num_boxes_) {
+    Log::Error("MultiSubstanceGrid::GetConcentration",
+               "You tried to get the concentration outside the bounds of "
+               "the diffusion grid!");
+    return 0;
+  }
+  std::lock_guard<Spinlock> guard(locks_[idx]);
+  return c1_[idx * substances_.size() + substance];
+}
+
+Real3 MultiSubstanceGrid::GetGradient(size_t substance,
+                                      const Real3& position) const {
+  auto idx = GetBoxIndex(position);
+  if (idx >= total_num_boxes_) {
+    Log::Error("MultiSubstanceGrid::GetGradient",
+               "You tried to get the gradient outside the bounds of "
+               "the diffusion grid! Returning zero gradient.");
+    return {0, 0, 0};
+  }
+  return gradients_[idx * substances_.size() + substance];
+}
+
+size_t MultiSubstanceGrid::GetBoxIndex(const Real3& position) const {
+  std::array<size_t, 3> box_coord;
+  if (!GetCubicBoxCoordinates(position, grid_dimensions_[0], box_length_,
+                              resolution_, &box_coord)) {
+    return total_num_boxes_;
+  }
+  return box_coord[0] + (box_coord[1] + box_coord[2] * resolution_) *
+                            resolution_;
+}
+
+void MultiSubstanceGrid::ParametersCheck(real_t dt) const {
+  // See `DiffusionGrid::ParametersCheck`
+  for (size_t i = 0; i < substances_.size(); i++) {
+    const auto& s = substances_[i];
+    if (!IsStableEulerStep(s.dc, s.mu, box_length_, dt)) {
+      Log::Fatal("MultiSubstanceGrid", "Stability condition violated for ",
+                 "substance ", i, " of grid [", GetContinuumName(),
+                 "] (diffusion coefficient = ", s.dc,
+                 ", resolution = ", resolution_, ", decay constant = ", s.mu,
+                 ", dt = ", dt, "). Please refer to the user guide for more ",
+                 "information.");
+    }
+  }
+}
+
+}  // namespace bdm
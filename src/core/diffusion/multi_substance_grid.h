@@ -0,0 +1,205 @@
+// -----------------------------------------------------------------------------
+//
+// Copyright (C) 2021 CERN & University of Surrey for the benefit of the
+// BioDynaMo collaboration. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+//
+// See the LICENSE file distributed with this work for details.
+// See the NOTICE file distributed with this work for additional information
+// regarding copyright ownership.
+//
+// -----------------------------------------------------------------------------
+
+#ifndef CORE_DIFFUSION_MULTI_SUBSTANCE_GRID_H_
+#define CORE_DIFFUSION_MULTI_SUBSTANCE_GRID_H_
+
+#include <array>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "core/container/math_array.h"
+#include "core/container/parallel_resize_vector.h"
+#include "core/diffusion/continuum_interface.h"
+#include "core/diffusion/diffusion_grid.h"
+#include "core/util/root.h"
+#include "core/util/spinlock.h"
+
+namespace bdm {
+
+class SubstanceField;
+
+/// @brief Diffuses several substances on the same grid in one traversal.
+///
+/// Each `DiffusionGrid` sweeps over its own concentration array. With many
+/// substances, the neighbor lookups, loop overhead and parallel regions are
+/// repeated for each of them. This continuum stores the concentrations of
+/// all substances interleaved per voxel (`c[voxel * n + substance]`) and
+/// updates all of them with the explicit Euler stencil in one pass. The last
+/// step of each `ContinuumOp` call also computes the gradients of all
+/// substances while the rows are in cache. These gradients are calculated
+/// from the concentrations at the beginning of this step, i.e. they lag one
+/// time step behind. Call `CalculateGradient` for exact gradients.
+///
+/// Each substance is exposed as `SubstanceField`, which implements the
+/// `ScalarField` interface and can be retrieved from the `ResourceManager`
+/// with the substance id:
+///
+///     auto* grid = new MultiSubstanceGrid(kNutrients, "Nutrients", 20);
+///     rm->AddContinuum(grid);
+///     rm->AddContinuum(grid->AddSubstance(kOxygen, "Oxygen", 10, 0.1));
+///     rm->AddContinuum(grid->AddSubstance(kGlucose, "Glucose", 2, 0.01));
+///     ...
+///     auto* oxygen = dynamic_cast<ScalarField*>(rm->GetContinuum(kOxygen));
+///
+/// The `ResourceManager` owns the grid and the fields. The grid supports
+/// closed and homogeneous Neumann boundaries (no flux). All substances use
+/// the same boundary condition and are integrated with the time step of the
+/// grid.
+class MultiSubstanceGrid : public Continuum {
+ public:
+  MultiSubstanceGrid() = default;
+  explicit MultiSubstanceGrid(const TRootIOCtor*) {}
+  MultiSubstanceGrid(int continuum_id, const std::string& name,
+                     int resolution = 10);
+  ~MultiSubstanceGrid() override = default;
+
+  MultiSubstanceGrid(const MultiSubstanceGrid&) = delete;
+  MultiSubstanceGrid& operator=(const MultiSubstanceGrid&) = delete;
+
+  /// Adds a substance with diffusion coefficient `dc` and decay constant
+  /// `mu` to the grid. Must be called before `Initialize`. Returns the field
+  /// of the new substance. The caller takes ownership (e.g. by passing it to
+  /// `ResourceManager::AddContinuum`).
+  SubstanceField* AddSubstance(int substance_id, const std::string& name,
+                               real_t dc, real_t mu);
+
+  /// Adds an initializer for the substance with the given index
+  /// (see `DiffusionGrid::AddInitializer`)
+  template <typename F>
+  void AddInitializer(size_t substance, F function) {
+    initializers_.push_back({substance, function});
+  }
+
+  void Initialize() override;
+
+  /// The grid does not grow with the simulation space. Use a bound space.
+  void Update() override;
+
+  void Step(real_t dt) override;
+
+  void MultiStep(real_t dt, uint64_t num_steps) override;
+
+  /// Calculates the gradients of all substances from the current
+  /// concentrations
+  void CalculateGradient();
+
+  /// Supports `kClosedBoundaries` and `kNeumann`. Neumann boundaries are
+  /// homogeneous (no flux over the boundary).
+  void SetBoundaryConditionType(BoundaryConditionType bc_type);
+
+  BoundaryConditionType GetBoundaryConditionType() const { return bc_type_; }
+
+  /// Increases the concentration of `substance` in the box at `position` by
+  /// `amount`. Thread-safe.
+  void ChangeConcentrationBy(size_t substance, const Real3& position,
+                             real_t amount);
+
+  real_t GetValue(size_t substance, const Real3& position) const;
+
+  real_t GetConcentration(size_t substance, size_t idx) const;
+
+  Real3 GetGradient(size_t substance, const Real3& position) const;
+
+  /// Returns the index of the box at `position`, or the number of boxes if
+  /// `position` is outside of the grid
+  size_t GetBoxIndex(const Real3& position) const;
+
+  size_t GetNumSubstances() const { return substances_.size(); }
+
+  size_t GetNumBoxes() const { return total_num_boxes_; }
+
+  size_t GetResolution() const { return resolution_; }
+
+  real_t GetBoxLength() const { return box_length_; }
+
+ private:
+  struct Substance {
+    real_t dc;
+    real_t mu;
+  };
+
+  /// Performs one explicit Euler step for all substances. Calculates the
+  /// gradients of the concentrations before the step if `gradients` is true.
+  void Integrate(real_t dt, bool gradients);
+
+  /// Checks the stability condition of each substance for `dt`
+  void ParametersCheck(real_t dt) const;
+
+  std::vector<Substance> substances_;
+  std::vector<std::pair<size_t, std::function<real_t(real_t, real_t, real_t)>>>
+      initializers_;  //!
+  BoundaryConditionType bc_type_ = BoundaryConditionType::kNeumann;
+  size_t resolution_ = 0;
+  size_t total_num_boxes_ = 0;
+  real_t box_length_ = 0;
+  std::array<int32_t, 2> grid_dimensions_ = {{0, 0}};
+  /// Concentrations of all substances, interleaved per box
+  ParallelResizeVector<real_t> c1_ = {};
+  ParallelResizeVector<real_t> c2_ = {};
+  /// Gradients of all substances, interleaved per box
+  ParallelResizeVector<Real3> gradients_ = {};
+  mutable ParallelResizeVector<Spinlock> locks_ = {};  //!
+
+  BDM_CLASS_DEF_OVERRIDE(MultiSubstanceGrid, 1);
+};
+
+/// One substance of a `MultiSubstanceGrid`. Time integration is carried out
+/// by the grid, hence `Step` does nothing.
+class SubstanceField : public ScalarField {
+ public:
+  SubstanceField() = default;
+  explicit SubstanceField(const TRootIOCtor*) {}
+  SubstanceField(MultiSubstanceGrid* grid, size_t substance)
+      : grid_(grid), substance_(substance) {}
+  ~SubstanceField() override = default;
+
+  void Initialize() override {}
+  void Update() override {}
+  void Step(real_t dt) override {}
+
+  real_t GetValue(const Real3& position) const override {
+    return grid_->GetValue(substance_, position);
+  }
+
+  Real3 GetGradient(const Real3& position) const override {
+    return grid_->GetGradient(substance_, position);
+  }
+
+  /// Thread-safe
+  void ChangeConcentrationBy(const Real3& position, real_t amount) {
+    grid_->ChangeConcentrationBy(substance_, position, amount);
+  }
+
+  real_t GetConcentration(size_t idx) const {
+    return grid_->GetConcentration(substance_, idx);
+  }
+
+  MultiSubstanceGrid* GetGrid() const { return grid_; }
+
+  /// Returns the index of this substance in the grid
+  size_t GetSubstanceIndex() const { return substance_; }
+
+ private:
+  MultiSubstanceGrid* grid_ = nullptr;
+  size_t substance_ = 0;
+
+  BDM_CLASS_DEF_OVERRIDE(SubstanceField, 1);
+};
+
+}  // namespace bdm
+
+#endif  // CORE_DIFFUSION_MULTI_SUBSTANCE_GRID_H_
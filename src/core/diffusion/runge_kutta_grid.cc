@@ -18,9 +18,9 @@
 namespace bdm {
 
 void RungeKuttaGrid::DiffuseWithClosedEdge(real_t dt) {
-  const auto nx = resolution_;
-  const auto ny = resolution_;
-  const auto nz = resolution_;
+  const auto nx = num_boxes_axis_[0];
+  const auto ny = num_boxes_axis_[1];
+  const auto nz = num_boxes_axis_[2];
 
   const real_t ibl2 = 1 / (box_length_ * box_length_);
   const real_t d = 1 - dc_[0];
@@ -76,6 +76,18 @@ void RungeKuttaGrid::DiffuseWithClosedEdge(real_t dt) {
   }
 }
 
+bool RungeKuttaGrid::GetExplicitStencil(real_t dt,
+                                        ExplicitStencil* stencil) const {
+  if (bc_type_ != BoundaryConditionType::kClosedBoundaries ||
+      diffusion_step_ != 1) {
+    return false;
+  }
+  stencil->decay = 1;
+  stencil->diffusion = (1 - dc_[0]) * dt / (box_length_ * box_length_);
+  stencil->sink.clear();
+  return true;
+}
+
 void RungeKuttaGrid::DiffuseWithOpenEdge(real_t dt) {
   Log::Fatal(
       "RungeKuttaGrid::DiffuseWithOpenEdge",
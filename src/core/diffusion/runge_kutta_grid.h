@@ -59,6 +59,11 @@ class RungeKuttaGrid : public DiffusionGrid {
   /// Not implemented for RungeKuttaGrid
   void DiffuseWithNeumann(real_t dt) override;
 
+  /// Supported for closed boundaries. Both stages of `DiffuseWithClosedEdge`
+  /// evaluate the Laplacian of `c1_`, thus, one step is the explicit stencil
+  /// without decay.
+  bool GetExplicitStencil(real_t dt, ExplicitStencil* stencil) const override;
+
  private:
   /// Buffers for Runge Kutta
   ParallelResizeVector<real_t> r1_ = {};
@@ -84,6 +84,17 @@ class Environment {
                                real_t squared_radius,
                                const Agent* query_agent = nullptr) = 0;
 
+  /// Iterates over the neighbors of the cylinder-shaped agent `query`
+  /// (`Shape::kCylinder`). Environments that are aware of the extent of
+  /// cylinders return all agents whose surface touches `query`. The default
+  /// implementation forwards to `ForEachNeighbor`.
+  /// \see `Param::cylinder_neighbor_search`
+  virtual void ForEachNeighborOfCylinder(Functor<void, Agent*, real_t>& lambda,
+                                         const Agent& query,
+                                         real_t squared_radius) {
+    ForEachNeighbor(lambda, query, squared_radius);
+  }
+
   virtual void Clear() = 0;
 
   virtual std::array<int32_t, 6> GetDimensions() const = 0;
@@ -122,6 +133,11 @@ class Environment {
 
   bool HasGrown() const { return has_grown_; }
 
+  /// Returns true if neither `agent` nor any agent in its surrounding moved
+  /// or changed in the last iteration. Operations can skip such agents
+  /// (see `Param::detect_static_regions`).
+  virtual bool IsInFrozenRegion(const Agent& agent) const { return false; }
+
  protected:
   bool has_grown_ = false;
   /// The size of the largest object in the simulation
@@ -32,6 +32,30 @@ struct KDTreeEnvironment::NanoflannImpl {
   bdm_kd_tree_t* index_ = nullptr;
 };
 
+// -----------------------------------------------------------------------------
+struct CopyPositionsFunctor : public Functor<void, Agent*, AgentHandle> {
+  CopyPositionsFunctor(const AgentFlatIdxMap& flat_idx_map,
+                       std::vector<Real3>* points)
+      : flat_idx_map_(flat_idx_map), points_(points) {}
+
+  void operator()(Agent* agent, AgentHandle ah) override {
+    (*points_)[flat_idx_map_.GetFlatIdx(ah)] = agent->GetPosition();
+  }
+
+  const AgentFlatIdxMap& flat_idx_map_;
+  std::vector<Real3>* points_;
+};
+
+// -----------------------------------------------------------------------------
+void NanoFlannAdapter::Update(const std::array<real_t, 6>& bbox) {
+  points_.resize(rm_->GetNumAgents());
+  CopyPositionsFunctor copy_positions(flat_idx_map_, &points_);
+  rm_->ForEachAgentParallel(1000, copy_positions);
+  bbox_ = bbox;
+  bbox_valid_ = true;
+}
+
+// -----------------------------------------------------------------------------
 KDTreeEnvironment::KDTreeEnvironment() {
   auto* param = Simulation::GetActive()->GetParam();
   nf_adapter_ = new NanoFlannAdapter();
@@ -58,6 +82,7 @@ void KDTreeEnvironment::UpdateImplementation() {
     CalcSimDimensionsAndLargestAgent(&tmp_dim);
     RoundOffGridDimensions(tmp_dim);
     CheckGridGrowth();
+    nf_adapter_->Update(tmp_dim);
     impl_->index_->buildIndex();
   } else {
     // There are no sim objects in this simulation
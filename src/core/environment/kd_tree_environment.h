@@ -15,6 +15,9 @@
 #ifndef CORE_ENVIRONMENT_KD_TREE_ENVIRONMENT_
 #define CORE_ENVIRONMENT_KD_TREE_ENVIRONMENT_
 
+#include <array>
+#include <vector>
+
 #include "core/container/agent_flat_idx_map.h"
 #include "core/container/math_array.h"
 #include "core/environment/environment.h"
@@ -22,6 +25,14 @@
 
 namespace bdm {
 
+/// Data source of the nanoflann kd-tree.
+/// Agent positions are copied into the contiguous array `points_` whenever the
+/// environment is updated. Building and querying the tree therefore reads
+/// coordinates directly from memory instead of going through
+/// `AgentFlatIdxMap`, the ResourceManager and the virtual
+/// `Agent::GetPosition()` for every single coordinate access.
+/// The index of a point in `points_` is the flat agent index defined by
+/// `flat_idx_map_`.
 struct NanoFlannAdapter {
   using coord_t = Real3;
   using idx_t = uint64_t;
@@ -29,42 +40,55 @@ struct NanoFlannAdapter {
   NanoFlannAdapter() { rm_ = Simulation::GetActive()->GetResourceManager(); }
 
   /// Must return the number of data points
-  inline size_t kdtree_get_point_count() const {
-    return Simulation::GetActive()->GetResourceManager()->GetNumAgents();
-  }
+  inline size_t kdtree_get_point_count() const { return points_.size(); }
 
-  /// Returns the distance between the vector "p1[0:size-1]" and the data point
-  /// with index "idx_p2" stored in the class:
+  /// Returns the squared distance between the vector "p1[0:size-1]" and the
+  /// data point with index "idx_p2" stored in the class:
   inline real_t kdtree_distance(const coord_t& p1, const idx_t idx_p2,
                                 size_t /*size*/) const {
-    AgentHandle ah = flat_idx_map_.GetAgentHandle(idx_p2);
-    auto& p2 = rm_->GetAgent(ah)->GetPosition();
-    return p1 * p2;
+    const auto& p2 = points_[idx_p2];
+    const real_t dx = p1[0] - p2[0];
+    const real_t dy = p1[1] - p2[1];
+    const real_t dz = p1[2] - p2[2];
+    return dx * dx + dy * dy + dz * dz;
   }
 
   /// Returns the dim'th component of the idx'th point in the class:
   /// Since this is inlined and the "dim" argument is typically an immediate
   /// value, the "if/else's" are actually solved at compile time.
   inline real_t kdtree_get_pt(const idx_t idx, int dim) const {
-    AgentHandle ah = flat_idx_map_.GetAgentHandle(idx);
-    auto& pos = rm_->GetAgent(ah)->GetPosition();
-    return pos[dim];
+    return points_[idx][dim];
   }
 
   /// Optional bounding-box computation: return false to default to a standard
   /// bbox computation loop.
-  ///   Return true if the BBOX was already computed by the class and returned
-  ///   in
-  ///   "bb" so it can be avoided to redo it again.
-  ///   Look at bb.size() to find out the expected dimensionality (e.g. 2 or 3
-  ///   for point clouds)
+  /// The bounding box has already been determined in
+  /// `Environment::CalcSimDimensionsAndLargestAgent` and is stored in `bbox_`.
+  /// Hence, nanoflann does not need to iterate over all points again.
   template <class BBOX>
-  bool kdtree_get_bbox(BBOX&) const {
-    return false;
+  bool kdtree_get_bbox(BBOX& bb) const {
+    if (!bbox_valid_) {
+      return false;
+    }
+    for (size_t i = 0; i < 3; i++) {
+      bb[i].low = bbox_[2 * i];
+      bb[i].high = bbox_[2 * i + 1];
+    }
+    return true;
   }
 
+  /// Copies the positions of all agents into `points_` (in parallel) and
+  /// stores the given bounding box {x_min, x_max, y_min, y_max, z_min, z_max}.
+  /// `flat_idx_map_` must be up to date.
+  void Update(const std::array<real_t, 6>& bbox);
+
   AgentFlatIdxMap flat_idx_map_;
   ResourceManager* rm_ = nullptr;
+  /// Snapshot of all agent positions indexed by flat agent index.
+  std::vector<Real3> points_;
+  /// Bounding box of `points_`: {x_min, x_max, y_min, y_max, z_min, z_max}
+  std::array<real_t, 6> bbox_;
+  bool bbox_valid_ = false;
 };
 
 class KDTreeEnvironment : public Environment {
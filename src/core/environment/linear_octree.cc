@@ -0,0 +1,417 @@
+// -----------------------------------------------------------------------------
+//
+// Copyright (C) 2021 CERN & University of Surrey for the benefit of the
+// BioDynaMo collaboration. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+//
+// See the LICENSE file distributed with this work for details.
+// See the NOTICE file distributed with this work for additional information
+// regarding copyright ownership.
+//
+// -----------------------------------------------------------------------------
+
+#include "core/environment/linear_octree.h"
+
+#include <morton/morton.h>  // NOLINT
+#include <omp.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#ifdef LINUX
+#include <parallel/algorithm>
+#endif  // LINUX
+#include <utility>
+
+namespace bdm {
+
+// -----------------------------------------------------------------------------
+void LinearOctree::Build(const std::vector<Real3>& points,
+                         const std::array<real_t, 6>& bbox,
+                         uint32_t bucket_size) {
+  bucket_size_ = std::max(bucket_size, 1u);
+  num_rebuilt_subtrees_ = 0;
+  nodes_.clear();
+  auto num_points = points.size();
+  assert(num_points <= std::numeric_limits<uint32_t>::max());
+  point_idx_.resize(num_points);
+  sorted_points_.resize(num_points);
+  codes_.resize(num_points);
+  if (num_points == 0) {
+    num_nodes_after_build_ = 0;
+    return;
+  }
+
+  // Enlarge the cube slightly, such that small movements of the outermost
+  // points do not require a rebuild.
+  real_t length = std::max(bbox[1] - bbox[0],
+                           std::max(bbox[3] - bbox[2], bbox[5] - bbox[4]));
+  length = length * 1.1 + 2;
+  for (int i = 0; i < 3; ++i) {
+    origin_[i] = (bbox[2 * i] + bbox[2 * i + 1] - length) / 2;
+  }
+  cell_length_ = length / static_cast<real_t>(1ull << kMaxLevel);
+
+  std::vector<std::pair<uint64_t, uint32_t>> keys(num_points);
+#pragma omp parallel for
+  for (uint64_t i = 0; i < num_points; ++i) {
+    keys[i] = {GetMortonCode(points[i]), static_cast<uint32_t>(i)};
+  }
+#ifdef LINUX
+  __gnu_parallel::sort(keys.begin(), keys.end());
+#else
+  std::sort(keys.begin(), keys.end());
+#endif  // LINUX
+#pragma omp parallel for
+  for (uint64_t i = 0; i < num_points; ++i) {
+    codes_[i] = keys[i].first;
+    point_idx_[i] = keys[i].second;
+    sorted_points_[i] = points[keys[i].second];
+  }
+
+  parallel_threshold_ = std::max<uint64_t>(
+      bucket_size_, num_points / (16 * omp_get_max_threads()));
+
+  Node root;
+  root.end = static_cast<uint32_t>(num_points);
+  nodes_.push_back(root);
+  BuildParallel(0);
+  num_nodes_after_build_ = nodes_.size();
+}
+
+// -----------------------------------------------------------------------------
+bool LinearOctree::Refit(const std::vector<Real3>& points) {
+  num_rebuilt_subtrees_ = 0;
+  if (nodes_.empty() || points.size() != point_idx_.size()) {
+    return false;
+  }
+  // Rebuilt subtrees are appended. Trigger a full rebuild if too many unused
+  // nodes have accumulated.
+  if (nodes_.size() > 2 * num_nodes_after_build_) {
+    return false;
+  }
+
+  auto num_points = point_idx_.size();
+  bool outside = false;
+#pragma omp parallel for reduction(|| : outside)
+  for (uint64_t i = 0; i < num_points; ++i) {
+    const auto& position = points[point_idx_[i]];
+    sorted_points_[i] = position;
+    outside = outside || !ContainedInRoot(position);
+    codes_[i] = GetMortonCode(position);
+  }
+  if (outside) {
+    return false;
+  }
+
+  // Determine the top nodes that are processed serially (in breadth-first
+  // order) and the subtrees that are refitted in parallel.
+  std::vector<uint32_t> top_nodes;
+  std::vector<uint32_t> subtrees;
+  top_nodes.push_back(0);
+  for (uint64_t i = 0; i < top_nodes.size(); ++i) {
+    const auto& node = nodes_[top_nodes[i]];
+    for (uint32_t c = 0; c < node.num_children; ++c) {
+      auto child = node.first_child + c;
+      const auto& cnode = nodes_[child];
+      if (cnode.IsLeaf() || cnode.end - cnode.begin <= parallel_threshold_) {
+        subtrees.push_back(child);
+      } else {
+        top_nodes.push_back(child);
+      }
+    }
+  }
+  if (nodes_[0].IsLeaf()) {
+    top_nodes.clear();
+    subtrees.push_back(0);
+  }
+
+  // consistent[i] is true if all points of nodes_[i] are still inside the
+  // node's octant
+  std::vector<char> consistent(nodes_.size(), 1);
+  std::vector<SubtreeList> rebuilt(omp_get_max_threads());
+#pragma omp parallel for schedule(dynamic, 1)
+  for (uint64_t i = 0; i < subtrees.size(); ++i) {
+    auto tid = omp_get_thread_num();
+    consistent[subtrees[i]] = RefitSubtree(subtrees[i], &rebuilt[tid]);
+  }
+  for (auto& rebuilt_subtrees : rebuilt) {
+    num_rebuilt_subtrees_ += rebuilt_subtrees.size();
+    InsertSubtrees(rebuilt_subtrees);
+  }
+
+  // Top nodes contain many points. Rebuilding one of them uses all threads.
+  for (auto it = top_nodes.rbegin(); it != top_nodes.rend(); ++it) {
+    auto& node = nodes_[*it];
+    bool children_consistent = true;
+    for (uint32_t c = 0; c < node.num_children; ++c) {
+      children_consistent =
+          children_consistent && consistent[node.first_child + c];
+    }
+    if (children_consistent) {
+      FitInnerNode(&node, &nodes_[node.first_child]);
+    } else if (ContainsItsPoints(node)) {
+      SortRange(node.begin, node.end, true);
+      BuildParallel(*it);
+      num_rebuilt_subtrees_++;
+    } else {
+      consistent[*it] = 0;
+    }
+  }
+  // All points are inside the root cube. Therefore, the root node is always
+  // consistent after the loop above.
+  return true;
+}
+
+// -----------------------------------------------------------------------------
+uint64_t LinearOctree::GetMortonCode(const Real3& position) const {
+  static constexpr int64_t kMaxCoord = (1ll << kMaxLevel) - 1;
+  std::array<uint_fast32_t, 3> coord;
+  for (int i = 0; i < 3; ++i) {
+    auto c = static_cast<int64_t>(
+        std::floor((position[i] - origin_[i]) / cell_length_));
+    c = std::min(std::max(c, int64_t{0}), kMaxCoord);
+    coord[i] = static_cast<uint_fast32_t>(c);
+  }
+  return libmorton::morton3D_64_encode(coord[0], coord[1], coord[2]);
+}
+
+// -----------------------------------------------------------------------------
+bool LinearOctree::ContainedInRoot(const Real3& position) const {
+  const real_t length = cell_length_ * static_cast<real_t>(1ull << kMaxLevel);
+  for (int i = 0; i < 3; ++i) {
+    if (position[i] < origin_[i] || position[i] >= origin_[i] + length) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// -----------------------------------------------------------------------------
+void LinearOctree::SortRange(uint32_t begin, uint32_t end, bool parallel) {
+  std::vector<std::pair<uint64_t, uint32_t>> keys(end - begin);
+  for (uint32_t i = begin; i < end; ++i) {
+    keys[i - begin] = {codes_[i], i};
+  }
+#ifdef LINUX
+  if (parallel) {
+    __gnu_parallel::sort(keys.begin(), keys.end());
+  } else {
+    std::sort(keys.begin(), keys.end());
+  }
+#else
+  std::sort(keys.begin(), keys.end());
+#endif  // LINUX
+
+  std::vector<uint32_t> point_idx(keys.size());
+  std::vector<Real3> sorted_points(keys.size());
+  for (uint64_t i = 0; i < keys.size(); ++i) {
+    point_idx[i] = point_idx_[keys[i].second];
+    sorted_points[i] = sorted_points_[keys[i].second];
+  }
+  for (uint64_t i = 0; i < keys.size(); ++i) {
+    codes_[begin + i] = keys[i].first;
+    point_idx_[begin + i] = point_idx[i];
+    sorted_points_[begin + i] = sorted_points[i];
+  }
+}
+
+// -----------------------------------------------------------------------------
+void LinearOctree::BuildParallel(uint32_t node_idx) {
+  // Split the top levels serially. Children are appended after their parents.
+  std::vector<uint32_t> top_nodes;
+  SubtreeList subtrees;
+  std::vector<Node> children;
+  top_nodes.push_back(node_idx);
+  for (uint64_t i = 0; i < top_nodes.size(); ++i) {
+    auto idx = top_nodes[i];
+    const Node node = nodes_[idx];
+    if (node.end - node.begin <= parallel_threshold_ ||
+        node.level == kMaxLevel) {
+      subtrees.push_back({idx, {}});
+      continue;
+    }
+    Split(node, &children);
+    nodes_[idx].first_child = static_cast<uint32_t>(nodes_.size());
+    nodes_[idx].num_children = static_cast<uint8_t>(children.size());
+    for (auto& child : children) {
+      top_nodes.push_back(static_cast<uint32_t>(nodes_.size()));
+      nodes_.push_back(child);
+    }
+  }
+
+#pragma omp parallel for schedule(dynamic, 1)
+  for (uint64_t i = 0; i < subtrees.size(); ++i) {
+    BuildSubtree(nodes_[subtrees[i].first], &subtrees[i].second);
+  }
+  InsertSubtrees(subtrees);
+
+  for (auto it = top_nodes.rbegin(); it != top_nodes.rend(); ++it) {
+    auto& node = nodes_[*it];
+    if (!node.IsLeaf()) {
+      FitInnerNode(&node, &nodes_[node.first_child]);
+    }
+  }
+}
+
+// -----------------------------------------------------------------------------
+void LinearOctree::BuildSubtree(const Node& root,
+                                std::vector<Node>* nodes) const {
+  nodes->clear();
+  nodes->push_back(root);
+  std::vector<Node> children;
+  // breadth-first: children are always stored after their parent
+  for (uint64_t i = 0; i < nodes->size(); ++i) {
+    const Node node = (*nodes)[i];
+    if (node.end - node.begin <= bucket_size_ || node.level == kMaxLevel) {
+      (*nodes)[i].num_children = 0;
+      FitLeaf(&(*nodes)[i]);
+      continue;
+    }
+    Split(node, &children);
+    (*nodes)[i].first_child = static_cast<uint32_t>(nodes->size());
+    (*nodes)[i].num_children = static_cast<uint8_t>(children.size());
+    nodes->insert(nodes->end(), children.begin(), children.end());
+  }
+  for (auto it = nodes->rbegin(); it != nodes->rend(); ++it) {
+    if (!it->IsLeaf()) {
+      FitInnerNode(&(*it), &(*nodes)[it->first_child]);
+    }
+  }
+}
+
+// -----------------------------------------------------------------------------
+void LinearOctree::InsertSubtrees(const SubtreeList& subtrees) {
+  if (subtrees.empty()) {
+    return;
+  }
+  // The root of each subtree replaces an existing node. All other nodes are
+  // appended.
+  std::vector<uint64_t> offsets(subtrees.size());
+  uint64_t size = nodes_.size();
+  for (uint64_t i = 0; i < subtrees.size(); ++i) {
+    offsets[i] = size;
+    size += subtrees[i].second.size() - 1;
+  }
+  assert(size <= std::numeric_limits<uint32_t>::max());
+  nodes_.resize(size);
+
+#pragma omp parallel for schedule(dynamic, 1)
+  for (uint64_t i = 0; i < subtrees.size(); ++i) {
+    const auto& subtree = subtrees[i].second;
+    // subtree[j] is stored at nodes_[offsets[i] + j - 1] for j > 0
+    auto shift = static_cast<uint32_t>(offsets[i] - 1);
+    for (uint64_t j = 0; j < subtree.size(); ++j) {
+      Node node = subtree[j];
+      if (!node.IsLeaf()) {
+        node.first_child += shift;
+      }
+      if (j == 0) {
+        nodes_[subtrees[i].first] = node;
+      } else {
+        nodes_[shift + j] = node;
+      }
+    }
+  }
+}
+
+// -----------------------------------------------------------------------------
+void LinearOctree::Split(const Node& node, std::vector<Node>* children) const {
+  children->clear();
+  // number of bits of the Morton code below the level of the children
+  const uint32_t shift = 3 * (kMaxLevel - node.level - 1);
+  auto begin = codes_.begin() + node.begin;
+  auto end = codes_.begin() + node.end;
+  for (uint64_t octant = 0; octant < 8; ++octant) {
+    uint64_t child_prefix = (node.prefix << 3) | octant;
+    auto child_end = std::lower_bound(begin, end, (child_prefix + 1) << shift);
+    if (child_end != begin) {
+      Node child;
+      child.prefix = child_prefix;
+      child.level = node.level + 1;
+      child.begin = static_cast<uint32_t>(begin - codes_.begin());
+      child.end = static_cast<uint32_t>(child_end - codes_.begin());
+      children->push_back(child);
+    }
+    begin = child_end;
+  }
+}
+
+// -----------------------------------------------------------------------------
+void LinearOctree::FitLeaf(Node* node) const {
+  auto inf = std::numeric_limits<real_t>::max();
+  node->min = {inf, inf, inf};
+  node->max = {-inf, -inf, -inf};
+  for (uint32_t i = node->begin; i < node->end; ++i) {
+    const auto& p = sorted_points_[i];
+    for (int d = 0; d < 3; ++d) {
+      node->min[d] = std::min(node->min[d], p[d]);
+      node->max[d] = std::max(node->max[d], p[d]);
+    }
+  }
+}
+
+// -----------------------------------------------------------------------------
+void LinearOctree::FitInnerNode(Node* node, const Node* children) {
+  node->min = children[0].min;
+  node->max = children[0].max;
+  for (uint32_t c = 1; c < node->num_children; ++c) {
+    for (int d = 0; d < 3; ++d) {
+      node->min[d] = std::min(node->min[d], children[c].min[d]);
+      node->max[d] = std::max(node->max[d], children[c].max[d]);
+    }
+  }
+}
+
+// -----------------------------------------------------------------------------
+bool LinearOctree::RefitSubtree(uint32_t node_idx,
+                                SubtreeList* rebuilt_subtrees) {
+  // No nodes are added to nodes_ during the refit. Therefore, it is safe to
+  // hold a reference.
+  auto& node = nodes_[node_idx];
+  if (node.IsLeaf()) {
+    FitLeaf(&node);
+    return ContainsItsPoints(node);
+  }
+
+  auto num_rebuilt = rebuilt_subtrees->size();
+  bool children_consistent = true;
+  for (uint32_t c = 0; c < node.num_children; ++c) {
+    if (!RefitSubtree(node.first_child + c, rebuilt_subtrees)) {
+      children_consistent = false;
+    }
+  }
+  if (children_consistent) {
+    FitInnerNode(&node, &nodes_[node.first_child]);
+    return true;
+  }
+  if (!ContainsItsPoints(node)) {
+    return false;
+  }
+
+  // Points moved between children of this node: rebuild the subtree.
+  // Subtrees that have been rebuilt below this node are obsolete.
+  rebuilt_subtrees->resize(num_rebuilt);
+  SortRange(node.begin, node.end, false);
+  rebuilt_subtrees->push_back({node_idx, {}});
+  auto& subtree = rebuilt_subtrees->back().second;
+  BuildSubtree(node, &subtree);
+  // Parent nodes need the bounding box before the subtree is inserted.
+  node.min = subtree[0].min;
+  node.max = subtree[0].max;
+  return true;
+}
+
+// -----------------------------------------------------------------------------
+bool LinearOctree::ContainsItsPoints(const Node& node) const {
+  const uint32_t shift = 3 * (kMaxLevel - node.level);
+  for (uint32_t i = node.begin; i < node.end; ++i) {
+    if ((codes_[i] >> shift) != node.prefix) {
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace bdm
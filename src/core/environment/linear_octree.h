@@ -0,0 +1,201 @@
+// -----------------------------------------------------------------------------
+//
+// Copyright (C) 2021 CERN & University of Surrey for the benefit of the
+// BioDynaMo collaboration. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+//
+// See the LICENSE file distributed with this work for details.
+// See the NOTICE file distributed with this work for additional information
+// regarding copyright ownership.
+//
+// -----------------------------------------------------------------------------
+
+#ifndef CORE_ENVIRONMENT_LINEAR_OCTREE_H_
+#define CORE_ENVIRONMENT_LINEAR_OCTREE_H_
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "core/container/math_array.h"
+#include "core/real_t.h"
+
+namespace bdm {
+
+/// Pointer-free octree over a point cloud.
+///
+/// Points are sorted by their Morton code (linear octree). Each node covers a
+/// contiguous range of the sorted points and all points whose Morton code
+/// starts with the node's prefix. Nodes additionally store the tight
+/// axis-aligned bounding box of their points, which is used to prune the
+/// search.
+///
+/// `Build` creates the tree from scratch. The top levels are built serially,
+/// the remaining subtrees in parallel.
+/// `Refit` reuses the tree structure for updated positions of the same points.
+/// Bounding boxes are recomputed bottom-up. Only subtrees in which points left
+/// their leaf are rebuilt; rebuilding such a subtree also splits or merges
+/// leaves whose occupancy crosses the bucket size.
+class LinearOctree {
+ public:
+  struct Node {
+    /// Tight bounding box of all points in this node
+    Real3 min;
+    Real3 max;
+    /// Morton code prefix of this node (3 bits per level)
+    uint64_t prefix = 0;
+    /// Range of the sorted points `[begin, end)` covered by this node
+    uint32_t begin = 0;
+    uint32_t end = 0;
+    /// Index of the first child in `nodes_`. Children are stored contiguously.
+    uint32_t first_child = 0;
+    uint8_t num_children = 0;
+    uint8_t level = 0;
+
+    bool IsLeaf() const { return num_children == 0; }
+  };
+
+  /// Number of Morton code bits per axis
+  static constexpr uint32_t kMaxLevel = 21;
+
+  /// Builds the octree from scratch.
+  /// \param points positions; the returned point indices refer to this vector
+  /// \param bbox bounding box of `points` {x_min, x_max, y_min, y_max, z_min,
+  ///        z_max}
+  /// \param bucket_size maximum number of points in a leaf
+  void Build(const std::vector<Real3>& points,
+             const std::array<real_t, 6>& bbox, uint32_t bucket_size);
+
+  /// Updates the tree for new positions of the same points that have been
+  /// passed to the last call of `Build`.
+  /// Returns false if the tree cannot be refitted and must be rebuilt
+  /// (e.g. if a point left the root node).
+  bool Refit(const std::vector<Real3>& points);
+
+  /// Calls `lambda(point_idx, squared_distance)` for each point whose squared
+  /// distance to `query` is smaller than `squared_radius`.
+  template <typename TLambda>
+  void ForEachPointInRadius(const Real3& query, real_t squared_radius,
+                            TLambda&& lambda) const {
+    if (nodes_.empty()) {
+      return;
+    }
+    // every level can push at most eight children
+    std::array<uint32_t, 8 * (kMaxLevel + 1)> stack;
+    int64_t top = 0;
+    stack[0] = 0;
+    while (top >= 0) {
+      const auto& node = nodes_[stack[top--]];
+      if (SquaredDistanceToBox(query, node) >= squared_radius) {
+        continue;
+      }
+      if (!node.IsLeaf()) {
+        for (uint32_t c = 0; c < node.num_children; ++c) {
+          stack[++top] = node.first_child + c;
+        }
+        continue;
+      }
+      for (uint32_t i = node.begin; i < node.end; ++i) {
+        const auto& p = sorted_points_[i];
+        const real_t dx = p[0] - query[0];
+        const real_t dy = p[1] - query[1];
+        const real_t dz = p[2] - query[2];
+        const real_t squared_distance = dx * dx + dy * dy + dz * dz;
+        if (squared_distance < squared_radius) {
+          lambda(point_idx_[i], squared_distance);
+        }
+      }
+    }
+  }
+
+  /// Returns the number of points passed to the last call of `Build`
+  uint64_t GetNumPoints() const { return point_idx_.size(); }
+
+  /// Returns the number of subtrees that have been rebuilt during the last
+  /// call of `Refit`.
+  uint64_t GetNumRebuiltSubtrees() const { return num_rebuilt_subtrees_; }
+
+  const std::vector<Node>& GetNodes() const { return nodes_; }
+
+ private:
+  /// Nodes in the tree; `nodes_[0]` is the root.
+  std::vector<Node> nodes_;
+  /// Index of the point stored at each position of the sorted order
+  std::vector<uint32_t> point_idx_;
+  /// Positions in Morton order
+  std::vector<Real3> sorted_points_;
+  /// Morton codes in the same order as `sorted_points_`
+  std::vector<uint64_t> codes_;
+  /// Number of nodes after the last call to `Build`. Rebuilding subtrees
+  /// appends nodes; if the tree grows too much, it is rebuilt from scratch.
+  uint64_t num_nodes_after_build_ = 0;
+  uint64_t num_rebuilt_subtrees_ = 0;
+  uint32_t bucket_size_ = 16;
+  /// Cube that is subdivided by the octree
+  Real3 origin_;
+  real_t cell_length_ = 1;
+
+  /// Subtrees with more points are split serially before the remaining
+  /// subtrees are processed in parallel
+  uint64_t parallel_threshold_ = 0;
+
+  using SubtreeList = std::vector<std::pair<uint32_t, std::vector<Node>>>;
+
+  uint64_t GetMortonCode(const Real3& position) const;
+
+  /// Returns true if `position` lies within the cube covered by the root node
+  bool ContainedInRoot(const Real3& position) const;
+
+  /// Sorts the points in the range [begin, end) according to their Morton code
+  void SortRange(uint32_t begin, uint32_t end, bool parallel);
+
+  /// Splits the top levels of the subtree of `node_idx` serially into
+  /// subtrees with at most `parallel_threshold_` points and builds those in
+  /// parallel.
+  void BuildParallel(uint32_t node_idx);
+
+  /// Builds the subtree of `root` into `nodes`. `nodes->front()` is the root
+  /// of the subtree; `first_child` of all nodes is relative to `nodes`.
+  void BuildSubtree(const Node& root, std::vector<Node>* nodes) const;
+
+  /// Appends the subtrees that were built with `BuildSubtree` to `nodes_` and
+  /// replaces the node they have been built for with their root.
+  void InsertSubtrees(const SubtreeList& subtrees);
+
+  /// Splits `node` into its (non empty) octants.
+  void Split(const Node& node, std::vector<Node>* children) const;
+
+  /// Sets the bounding box of a leaf
+  void FitLeaf(Node* node) const;
+
+  /// Sets the bounding box of an inner node from the boxes of its children
+  static void FitInnerNode(Node* node, const Node* children);
+
+  /// Bottom-up refit of the subtree of `node_idx`. Subtrees in which points
+  /// left their leaf are rebuilt into `rebuilt_subtrees`.
+  /// Returns false if at least one point left the octant of `node_idx`.
+  bool RefitSubtree(uint32_t node_idx, SubtreeList* rebuilt_subtrees);
+
+  /// Returns true if all points in the range of `node` belong to its octant
+  bool ContainsItsPoints(const Node& node) const;
+
+  static real_t SquaredDistanceToBox(const Real3& query, const Node& node) {
+    real_t squared_distance = 0;
+    for (int i = 0; i < 3; ++i) {
+      real_t d = 0;
+      if (query[i] < node.min[i]) {
+        d = node.min[i] - query[i];
+      } else if (query[i] > node.max[i]) {
+        d = query[i] - node.max[i];
+      }
+      squared_distance += d * d;
+    }
+    return squared_distance;
+  }
+};
+
+}  // namespace bdm
+
+#endif  // CORE_ENVIRONMENT_LINEAR_OCTREE_H_
@@ -13,36 +13,47 @@
 // -----------------------------------------------------------------------------
 
 #include <algorithm>
+#include <atomic>
 
 #include "core/environment/octree_environment.h"
 
-#include "unibn_octree.h"
-
 namespace bdm {
 
-struct OctreeEnvironment::UnibnImpl {
-  unibn::Octree<Real3, AgentContainer>* octree_ = nullptr;
+// -----------------------------------------------------------------------------
+struct UpdatePositionsFunctor : public Functor<void, Agent*, AgentHandle> {
+  UpdatePositionsFunctor(const AgentFlatIdxMap& flat_idx_map,
+                         std::vector<Real3>* positions,
+                         std::vector<AgentUid>* uids)
+      : flat_idx_map_(flat_idx_map), positions_(positions), uids_(uids) {}
+
+  void operator()(Agent* agent, AgentHandle ah) override {
+    auto idx = flat_idx_map_.GetFlatIdx(ah);
+    (*positions_)[idx] = agent->GetPosition();
+    const auto& uid = agent->GetUid();
+    if ((*uids_)[idx] != uid) {
+      (*uids_)[idx] = uid;
+      agents_changed_.store(true, std::memory_order_relaxed);
+    }
+  }
+
+  const AgentFlatIdxMap& flat_idx_map_;
+  std::vector<Real3>* positions_;
+  std::vector<AgentUid>* uids_;
+  std::atomic<bool> agents_changed_{false};
 };
 
-OctreeEnvironment::OctreeEnvironment() {
-  impl_ = std::unique_ptr<OctreeEnvironment::UnibnImpl>(
-      new OctreeEnvironment::UnibnImpl());
-  impl_->octree_ = new unibn::Octree<Real3, AgentContainer>();
-  container_ = new AgentContainer();
-}
+// -----------------------------------------------------------------------------
+OctreeEnvironment::OctreeEnvironment() = default;
 
-OctreeEnvironment::~OctreeEnvironment() {
-  delete impl_->octree_;
-  delete container_;
-}
+OctreeEnvironment::~OctreeEnvironment() = default;
 
 void OctreeEnvironment::UpdateImplementation() {
-  container_->rm_ = Simulation::GetActive()->GetResourceManager();
+  auto* rm = Simulation::GetActive()->GetResourceManager();
   auto* param = Simulation::GetActive()->GetParam();
 
   // Update the flattened indices map
-  container_->flat_idx_map_.Update();
-  if (container_->rm_->GetNumAgents() != 0) {
+  flat_idx_map_.Update();
+  if (rm->GetNumAgents() != 0) {
     Clear();
     auto inf = Math::kInfinity;
     std::array<real_t, 6> tmp_dim = {{inf, -inf, inf, -inf, inf, -inf}};
@@ -50,15 +61,13 @@ void OctreeEnvironment::UpdateImplementation() {
     RoundOffGridDimensions(tmp_dim);
     CheckGridGrowth();
 
-    unibn::OctreeParams params;
-    params.bucketSize = param->unibn_bucketsize;
-
-    impl_->octree_->initialize(*container_, params);
+    bool same_agents = UpdatePositions();
+    if (!same_agents || !octree_.Refit(positions_)) {
+      octree_.Build(positions_, tmp_dim, param->unibn_bucketsize);
+    }
   } else {
     // There are no sim objects in this simulation
-    auto* param = Simulation::GetActive()->GetParam();
-
-    bool uninitialized = impl_->octree_ == nullptr;
+    bool uninitialized = octree_.GetNumPoints() == 0;
     if (uninitialized && param->bound_space) {
       // Simulation has never had any simulation objects
       // Initialize grid dimensions with `Param::min_bound_` and
@@ -85,6 +94,18 @@ void OctreeEnvironment::UpdateImplementation() {
   }
 }
 
+bool OctreeEnvironment::UpdatePositions() {
+  auto* rm = Simulation::GetActive()->GetResourceManager();
+  auto num_agents = rm->GetNumAgents();
+  bool same_size = num_agents == positions_.size();
+  positions_.resize(num_agents);
+  uids_.resize(num_agents);
+
+  UpdatePositionsFunctor functor(flat_idx_map_, &positions_, &uids_);
+  rm->ForEachAgentParallel(1000, functor);
+  return same_size && !functor.agents_changed_.load();
+}
+
 void OctreeEnvironment::ForEachNeighbor(Functor<void, Agent*, real_t>& lambda,
                                         const Agent& query,
                                         real_t squared_radius) {
@@ -95,23 +116,15 @@ void OctreeEnvironment::ForEachNeighbor(Functor<void, Agent*, real_t>& lambda,
                                         const Real3& query_position,
                                         real_t squared_radius,
                                         const Agent* query_agent) {
-  std::vector<uint32_t> neighbors;
-  std::vector<double> distances;
-
-  // Find neighbors
-  impl_->octree_->radiusNeighbors<unibn::L2Distance<Real3>>(
-      query_position, static_cast<double>(std::sqrt(squared_radius)), neighbors,
-      distances);
-
   auto* rm = Simulation::GetActive()->GetResourceManager();
-  int i = 0;
-  for (auto& n : neighbors) {
-    Agent* nb_so = rm->GetAgent(container_->flat_idx_map_.GetAgentHandle(n));
-    if (nb_so != query_agent) {
-      lambda(nb_so, static_cast<real_t>(distances[i]));
-    }
-    i++;
-  }
+  octree_.ForEachPointInRadius(
+      query_position, squared_radius,
+      [&](uint32_t idx, real_t squared_distance) {
+        Agent* nb_so = rm->GetAgent(flat_idx_map_.GetAgentHandle(idx));
+        if (nb_so != query_agent) {
+          lambda(nb_so, squared_distance);
+        }
+      });
 }
 
 void OctreeEnvironment::ForEachNeighbor(Functor<void, Agent*>& lambda,
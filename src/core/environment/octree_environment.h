@@ -15,35 +15,24 @@
 #ifndef CORE_ENVIRONMENT_OCTREE_ENVIRONMENT_
 #define CORE_ENVIRONMENT_OCTREE_ENVIRONMENT_
 
+#include <vector>
+
 #include "core/agent/agent_uid.h"
 #include "core/container/agent_flat_idx_map.h"
 #include "core/container/math_array.h"
 #include "core/environment/environment.h"
+#include "core/environment/linear_octree.h"
 #include "core/simulation.h"
 
 namespace bdm {
 
-/// This class acts as a contiguous container of simulation object positions for
-/// the Unibn octree API
-class AgentContainer {
- public:
-  AgentContainer() { rm_ = Simulation::GetActive()->GetResourceManager(); }
-
-  size_t size() const { return rm_->GetNumAgents(); }
-
-  const Real3& operator[](size_t idx) const {
-    AgentHandle ah = flat_idx_map_.GetAgentHandle(idx);
-    return rm_->GetAgent(ah)->GetPosition();
-  }
-
-  AgentFlatIdxMap flat_idx_map_;
-  ResourceManager* rm_ = nullptr;
-};
-
+/// Environment based on a linear octree (see `LinearOctree`).
+/// If the agents of the simulation did not change since the last update, the
+/// octree is refitted to the new agent positions instead of being rebuilt.
+/// The maximum number of agents per leaf is set with
+/// `Param::unibn_bucketsize`.
 class OctreeEnvironment : public Environment {
  public:
-  struct UnibnImpl;
-
   OctreeEnvironment();
 
   ~OctreeEnvironment() override;
@@ -72,9 +61,13 @@ class OctreeEnvironment : public Environment {
   void UpdateImplementation() override;
 
  private:
-  // Hide unibn-specific types from header (pimpl idiom)
-  std::unique_ptr<UnibnImpl> impl_;
-  AgentContainer* container_ = nullptr;
+  LinearOctree octree_;
+  AgentFlatIdxMap flat_idx_map_;
+  /// Snapshot of the agent positions indexed by flat agent index
+  std::vector<Real3> positions_;
+  /// Uids of the agents in `positions_`. Used to detect if the octree can be
+  /// refitted.
+  std::vector<AgentUid> uids_;
   /// Cube which contains all simulation objects
   /// {x_min, x_max, y_min, y_max, z_min, z_max}
   std::array<int32_t, 6> grid_dimensions_;
@@ -85,6 +78,11 @@ class OctreeEnvironment : public Environment {
   void RoundOffGridDimensions(const std::array<real_t, 6>& grid_dimensions);
 
   void CheckGridGrowth();
+
+  /// Copies the agent positions into `positions_`.
+  /// Returns true if the agents are the same (and in the same order) as in
+  /// the last call.
+  bool UpdatePositions();
 };
 
 }  // namespace bdm
@@ -0,0 +1,529 @@
+// -----------------------------------------------------------------------------
+//
+// Copyright (C) 2021 CERN & University of Surrey for the benefit of the
+// BioDynaMo collaboration. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+//
+// See the LICENSE file distributed with this work for details.
+// See the NOTICE file distributed with this work for additional information
+// regarding copyright ownership.
+//
+// -----------------------------------------------------------------------------
+
+#include "core/environment/sparse_grid_environment.h"
+
+#include <algorithm>
+#include <mutex>
+#ifdef LINUX
+#include <parallel/algorithm>
+#endif  // LINUX
+#include <utility>
+
+#include <morton/morton.h>  // NOLINT
+
+#include "core/environment/uniform_grid_environment.h"
+#include "core/util/log.h"
+#include "core/util/thread_info.h"
+
+namespace bdm {
+
+// -----------------------------------------------------------------------------
+struct SparseGridEnvironment::AssignToBoxesFunctor
+    : public Functor<void, Agent*, AgentHandle> {
+  explicit AssignToBoxesFunctor(SparseGridEnvironment* grid) : grid_(grid) {}
+
+  void operator()(Agent* agent, AgentHandle ah) override {
+    std::array<uint64_t, 3> box_coord;
+    bool valid = grid_->GetBoxCoordinates(agent->GetPosition(), &box_coord);
+    assert(valid && "Agent outside of the sparse grid");
+    (void)valid;
+    auto slot = grid_->FindOrInsertBox(GetKey(box_coord));
+    auto& box = grid_->boxes_[slot];
+    {
+      std::lock_guard<Spinlock> lock_guard(box.lock_);
+      if (box.length_ != 0) {
+        grid_->successors_[ah] = box.start_;
+      }
+      box.start_ = ah;
+      box.length_++;
+    }
+    assert(slot <= std::numeric_limits<uint32_t>::max());
+    agent->SetBoxIdx(static_cast<uint32_t>(slot));
+  }
+
+ private:
+  SparseGridEnvironment* grid_;
+};
+
+// -----------------------------------------------------------------------------
+/// Iterates over the agents in the boxes `sorted_slots[box]`,
+/// `sorted_slots[box + 1]`, ... starting with the `discard`th agent.
+struct SparseGridEnvironment::AgentHandleIteratorSG
+    : public Iterator<AgentHandle> {
+  AgentHandleIteratorSG(const SparseGridEnvironment* grid, uint64_t start,
+                        uint64_t end, uint64_t box, uint64_t discard,
+                        const std::vector<uint64_t>& sorted_slots)
+      : grid_(grid),
+        start_(start),
+        end_(end),
+        box_(box),
+        sorted_slots_(sorted_slots) {
+    LoadBox();
+    for (uint64_t i = 0; i < discard; ++i) {
+      Advance();
+    }
+  }
+
+  bool HasNext() const override { return start_ < end_; }
+
+  AgentHandle Next() override {
+    while (remaining_ == 0) {
+      box_++;
+      LoadBox();
+    }
+    auto ret = current_;
+    Advance();
+    start_++;
+    return ret;
+  }
+
+ private:
+  const SparseGridEnvironment* grid_;
+  uint64_t start_;
+  uint64_t end_;
+  uint64_t box_;
+  const std::vector<uint64_t>& sorted_slots_;
+  AgentHandle current_;
+  uint32_t remaining_ = 0;
+
+  void LoadBox() {
+    const auto& box = grid_->boxes_[sorted_slots_[box_]];
+    current_ = box.start_;
+    remaining_ = box.length_;
+  }
+
+  void Advance() {
+    remaining_--;
+    if (remaining_ > 0) {
+      current_ = grid_->successors_[current_];
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Orders the non-empty boxes along a space filling curve (Morton order).
+class SparseGridEnvironment::LoadBalanceInfoSG : public LoadBalanceInfo {
+ public:
+  explicit LoadBalanceInfoSG(SparseGridEnvironment* grid) : grid_(grid) {}
+
+  ~LoadBalanceInfoSG() override = default;
+
+  void Update() {
+    std::vector<std::pair<uint64_t, uint64_t>> codes;
+    codes.reserve(grid_->num_occupied_boxes_);
+    for (uint64_t slot = 0; slot < grid_->boxes_.size(); ++slot) {
+      auto key = grid_->boxes_[slot].key_.load(std::memory_order_relaxed);
+      if (key == kEmptyKey) {
+        continue;
+      }
+      auto c = GetBoxCoordinates(key);
+      auto code = libmorton::morton3D_64_encode(
+          static_cast<uint_fast32_t>(c[0]), static_cast<uint_fast32_t>(c[1]),
+          static_cast<uint_fast32_t>(c[2]));
+      codes.emplace_back(code, slot);
+    }
+#ifdef LINUX
+    __gnu_parallel::sort(codes.begin(), codes.end());
+#else
+    std::sort(codes.begin(), codes.end());
+#endif  // LINUX
+
+    sorted_slots_.resize(codes.size());
+    offsets_.resize(codes.size() + 1);
+    offsets_[0] = 0;
+    for (uint64_t i = 0; i < codes.size(); ++i) {
+      sorted_slots_[i] = codes[i].second;
+      offsets_[i + 1] = offsets_[i] + grid_->boxes_[codes[i].second].length_;
+    }
+  }
+
+  void CallHandleIteratorConsumer(
+      uint64_t start, uint64_t end,
+      Functor<void, Iterator<AgentHandle>*>& f) const override {
+    if (sorted_slots_.empty() || end <= start) {
+      return;
+    }
+    // last box whose first agent is not after `start`
+    auto box = static_cast<uint64_t>(
+        std::upper_bound(offsets_.begin(), offsets_.end(), start) -
+        offsets_.begin() - 1);
+    AgentHandleIteratorSG it(grid_, start, end, box, start - offsets_[box],
+                             sorted_slots_);
+    f(&it);
+  }
+
+ private:
+  SparseGridEnvironment* grid_;
+  /// Slots of the non-empty boxes in Morton order
+  std::vector<uint64_t> sorted_slots_;
+  /// `offsets_[i]` is the number of agents in the boxes before
+  /// `sorted_slots_[i]`
+  std::vector<uint64_t> offsets_;
+};
+
+// -----------------------------------------------------------------------------
+/// Locks the non-empty boxes in the Moore neighborhood of a box
+/// (see `UniformGridEnvironment::GridNeighborMutexBuilder`).
+class SparseGridEnvironment::SparseGridNeighborMutexBuilder
+    : public Environment::NeighborMutexBuilder {
+ public:
+  class SparseGridNeighborMutex
+      : public Environment::NeighborMutexBuilder::NeighborMutex {
+   public:
+    explicit SparseGridNeighborMutex(SparseGridNeighborMutexBuilder* builder)
+        : builder_(builder) {}
+
+    ~SparseGridNeighborMutex() override = default;
+
+    void lock() override {  // NOLINT
+      for (auto idx : mutex_indices_) {
+        builder_->mutexes_[idx].lock();
+      }
+    }
+
+    void unlock() override {  // NOLINT
+      for (auto idx : mutex_indices_) {
+        builder_->mutexes_[idx].unlock();
+      }
+    }
+
+    void SetMutexIndices(const FixedSizeVector<uint64_t, 27>& indices) {
+      mutex_indices_ = indices;
+      // Deadlocks occur if multiple threads try to acquire the same locks,
+      // but in different order.
+      // -> sort to avoid deadlocks - see lock ordering
+      std::sort(mutex_indices_.begin(), mutex_indices_.end());
+    }
+
+   private:
+    FixedSizeVector<uint64_t, 27> mutex_indices_;
+    SparseGridNeighborMutexBuilder* builder_;
+  };
+
+  explicit SparseGridNeighborMutexBuilder(SparseGridEnvironment* grid)
+      : grid_(grid) {}
+
+  ~SparseGridNeighborMutexBuilder() override = default;
+
+  void Update() {
+    mutexes_.resize(grid_->boxes_.size());
+    auto num_threads = ThreadInfo::GetInstance()->GetMaxThreads();
+    thread_mutexes_.resize(num_threads, SparseGridNeighborMutex(this));
+  }
+
+  NeighborMutex* GetMutex(uint64_t box_idx) override {
+    FixedSizeVector<uint64_t, 27> slots;
+    if (box_idx < grid_->boxes_.size()) {
+      auto key = grid_->boxes_[box_idx].key_.load(std::memory_order_relaxed);
+      grid_->GetMooreBoxSlots(GetBoxCoordinates(key), &slots);
+    }
+    auto tid = ThreadInfo::GetInstance()->GetMyThreadId();
+    auto* mutex = &thread_mutexes_[tid];
+    mutex->SetMutexIndices(slots);
+    return mutex;
+  }
+
+ private:
+  SparseGridEnvironment* grid_;
+  /// One mutex for each slot in `SparseGridEnvironment::boxes_`
+  std::vector<Spinlock> mutexes_;
+  /// One `NeighborMutex` per thread
+  std::vector<SparseGridNeighborMutex> thread_mutexes_;
+};
+
+// -----------------------------------------------------------------------------
+SparseGridEnvironment::SparseGridEnvironment()
+    : lbi_(std::make_unique<LoadBalanceInfoSG>(this)),
+      nb_mutex_builder_(
+          std::make_unique<SparseGridNeighborMutexBuilder>(this)) {}
+
+// -----------------------------------------------------------------------------
+SparseGridEnvironment::~SparseGridEnvironment() = default;
+
+// -----------------------------------------------------------------------------
+bool SparseGridEnvironment::ReplaceUniformGridIfSparse(Simulation* sim) {
+  auto* param = sim->GetParam();
+  auto* rm = sim->GetResourceManager();
+  // The periodic neighborhood and the GPU implementations require the
+  // UniformGridEnvironment.
+  if (param->sparse_grid_occupancy_threshold <= 0 ||
+      param->environment != "uniform_grid" ||
+      param->bound_space == Param::BoundSpaceMode::kTorus ||
+      param->compute_target != "cpu" || rm->GetNumAgents() == 0) {
+    return false;
+  }
+  auto* uniform_grid =
+      dynamic_cast<UniformGridEnvironment*>(sim->GetEnvironment());
+  if (uniform_grid == nullptr) {
+    return false;
+  }
+
+  // Determining the occupancy only requires a pass over the agents.
+  // The dense grid is not allocated.
+  auto sparse_grid = std::make_unique<SparseGridEnvironment>();
+  if (uniform_grid->HasCustomBoxLength()) {
+    sparse_grid->SetBoxLength(uniform_grid->GetBoxLength());
+  }
+  sparse_grid->ForcedUpdate();
+  real_t occupancy = static_cast<real_t>(sparse_grid->GetNumOccupiedBoxes()) /
+                     static_cast<real_t>(sparse_grid->GetNumDenseBoxes());
+  if (occupancy >= param->sparse_grid_occupancy_threshold) {
+    return false;
+  }
+  Log::Info("SparseGridEnvironment", "Only ", occupancy * 100,
+            "% of the uniform grid boxes are occupied. Switching to the "
+            "sparse grid environment.");
+  sim->SetEnvironment(sparse_grid.release());
+  return true;
+}
+
+// -----------------------------------------------------------------------------
+void SparseGridEnvironment::UpdateImplementation() {
+  auto* rm = Simulation::GetActive()->GetResourceManager();
+  auto* param = Simulation::GetActive()->GetParam();
+
+  if (rm->GetNumAgents() != 0) {
+    Clear();
+    auto inf = Math::kInfinity;
+    std::array<real_t, 6> tmp_dim = {{inf, -inf, inf, -inf, inf, -inf}};
+    CalcSimDimensionsAndLargestAgent(&tmp_dim);
+    RoundOffGridDimensions(tmp_dim);
+
+    // If the box_length_ is not set manually, we set it to the largest agent
+    // size
+    if (!is_custom_box_length_) {
+      auto los = ceil(GetLargestAgentSize());
+      assert(los > 0 &&
+             "The largest object size was found to be 0. Please check if your "
+             "cells are correctly initialized.");
+      box_length_ = static_cast<int32_t>(los);
+    }
+    box_length_squared_ = box_length_ * box_length_;
+
+    // Leave one empty box on each side, such that the coordinates of all
+    // boxes in the Moore neighborhood of an agent are valid.
+    for (int i = 0; i < 3; i++) {
+      origin_[i] = grid_dimensions_[2 * i] - box_length_;
+      auto length = grid_dimensions_[2 * i + 1] - origin_[i];
+      num_boxes_axis_[i] = static_cast<uint64_t>(length / box_length_ + 2);
+      if (num_boxes_axis_[i] > kMaxBoxesPerAxis) {
+        Log::Fatal("SparseGridEnvironment",
+                   "The simulation space is too large for the box length (",
+                   box_length_, "). At most ", kMaxBoxesPerAxis,
+                   " boxes per axis are supported.");
+      }
+      grid_dimensions_[2 * i] = origin_[i];
+      grid_dimensions_[2 * i + 1] =
+          origin_[i] + static_cast<int32_t>(num_boxes_axis_[i]) * box_length_;
+    }
+    CheckGridGrowth();
+
+    // There is at most one box per agent. Keep the load factor of the hash
+    // table below 0.5 to keep the probe sequences short.
+    uint64_t min_capacity = 2 * rm->GetNumAgents();
+    if (boxes_.size() < min_capacity || boxes_.size() > 8 * min_capacity) {
+      capacity_log2_ = 1;
+      while ((uint64_t{1} << capacity_log2_) < min_capacity) {
+        capacity_log2_++;
+      }
+      boxes_.resize(uint64_t{1} << capacity_log2_);
+    }
+    const uint64_t capacity = boxes_.size();
+#pragma omp parallel for
+    for (uint64_t i = 0; i < capacity; ++i) {
+      boxes_[i].key_.store(kEmptyKey, std::memory_order_relaxed);
+      boxes_[i].length_ = 0;
+    }
+
+    successors_.reserve();
+
+    // Assign agents to boxes
+    AssignToBoxesFunctor functor(this);
+    rm->ForEachAgentParallel(param->scheduling_batch_size, functor);
+
+    uint64_t num_occupied_boxes = 0;
+#pragma omp parallel for reduction(+ : num_occupied_boxes)
+    for (uint64_t i = 0; i < capacity; ++i) {
+      num_occupied_boxes += boxes_[i].length_ != 0;
+    }
+    num_occupied_boxes_ = num_occupied_boxes;
+
+    if (param->bound_space) {
+      int min = param->min_bound;
+      int max = param->max_bound;
+      threshold_dimensions_ = {min, max};
+    }
+
+    if (param->thread_safety_mechanism ==
+        Param::ThreadSafetyMechanism::kAutomatic) {
+      nb_mutex_builder_->Update();
+    }
+  } else {
+    // There are no agents in this simulation
+    bool uninitialized = boxes_.empty();
+    if (uninitialized && param->bound_space) {
+      // Simulation has never had any agents
+      // Initialize grid dimensions with `Param::min_bound` and
+      // `Param::max_bound`
+      // This is required for the DiffusionGrid
+      int min = param->min_bound;
+      int max = param->max_bound;
+      grid_dimensions_ = {min, max, min, max, min, max};
+      threshold_dimensions_ = {min, max};
+      has_grown_ = true;
+    } else if (!uninitialized) {
+      // all agents have been removed in the last iteration
+      // grid state remains the same, but we have to set has_grown_ to false
+      // otherwise the DiffusionGrid will attempt to resize
+      has_grown_ = false;
+    } else {
+      Log::Fatal(
+          "SparseGridEnvironment",
+          "You tried to initialize an empty simulation without bound space. "
+          "Therefore we cannot determine the size of the simulation space. "
+          "Please add agents, or set Param::bound_space, "
+          "Param::min_bound, and Param::max_bound.");
+    }
+  }
+}
+
+// -----------------------------------------------------------------------------
+uint64_t SparseGridEnvironment::FindOrInsertBox(uint64_t key) {
+  const uint64_t mask = boxes_.size() - 1;
+  for (uint64_t slot = GetSlot(key);; slot = (slot + 1) & mask) {
+    auto& slot_key = boxes_[slot].key_;
+    auto current = slot_key.load(std::memory_order_acquire);
+    if (current == kEmptyKey &&
+        slot_key.compare_exchange_strong(current, key,
+                                         std::memory_order_acq_rel)) {
+      return slot;
+    }
+    // If the exchange failed, `current` contains the key that has been
+    // inserted by another thread.
+    if (current == key) {
+      return slot;
+    }
+  }
+}
+
+// -----------------------------------------------------------------------------
+void SparseGridEnvironment::ForEachNeighbor(
+    Functor<void, Agent*, real_t>& lambda, const Agent& query,
+    real_t squared_radius) {
+  ForEachNeighbor(lambda, query.GetPosition(), squared_radius, &query);
+}
+
+// -----------------------------------------------------------------------------
+void SparseGridEnvironment::ForEachNeighbor(
+    Functor<void, Agent*, real_t>& lambda, const Real3& query_position,
+    real_t squared_radius, const Agent* query_agent) {
+  if (squared_radius > box_length_squared_) {
+    Log::Fatal(
+        "SparseGridEnvironment::ForEachNeighbor",
+        "The requested search radius (", std::sqrt(squared_radius), ")",
+        " of the neighborhood search exceeds the "
+        "box length (",
+        box_length_, "). The resulting neighborhood would be incomplete.");
+  }
+  // Agents that have been created after the last update do not have a valid
+  // box index. In this case the box is determined from the position.
+  uint64_t box_idx = kNoBox;
+  if (query_agent != nullptr) {
+    box_idx = query_agent->GetBoxIdx();
+  }
+  ForEachAgentInMooreBoxes(query_position, box_idx, [&](Agent* agent) {
+    if (agent == query_agent) {
+      return;
+    }
+    const auto& pos = agent->GetPosition();
+    const real_t dx = pos[0] - query_position[0];
+    const real_t dy = pos[1] - query_position[1];
+    const real_t dz = pos[2] - query_position[2];
+    const real_t squared_distance = dx * dx + dy * dy + dz * dz;
+    if (squared_distance < squared_radius) {
+      lambda(agent, squared_distance);
+    }
+  });
+}
+
+// -----------------------------------------------------------------------------
+void SparseGridEnvironment::ForEachNeighbor(Functor<void, Agent*>& lambda,
+                                            const Agent& query,
+                                            void* criteria) {
+  ForEachAgentInMooreBoxes(query.GetPosition(), query.GetBoxIdx(),
+                           [&](Agent* agent) {
+                             if (agent != &query) {
+                               lambda(agent);
+                             }
+                           });
+}
+
+// -----------------------------------------------------------------------------
+LoadBalanceInfo* SparseGridEnvironment::GetLoadBalanceInfo() {
+  lbi_->Update();
+  return lbi_.get();
+}
+
+// -----------------------------------------------------------------------------
+Environment::NeighborMutexBuilder*
+SparseGridEnvironment::GetNeighborMutexBuilder() {
+  return nb_mutex_builder_.get();
+}
+
+// -----------------------------------------------------------------------------
+void SparseGridEnvironment::Clear() {
+  if (!is_custom_box_length_) {
+    box_length_ = 1;
+  }
+  box_length_squared_ = 1;
+  num_boxes_axis_ = {{0, 0, 0}};
+  num_occupied_boxes_ = 0;
+  int32_t inf = std::numeric_limits<int32_t>::max();
+  grid_dimensions_ = {inf, -inf, inf, -inf, inf, -inf};
+  threshold_dimensions_ = {inf, -inf};
+  successors_.clear();
+  has_grown_ = false;
+}
+
+// -----------------------------------------------------------------------------
+void SparseGridEnvironment::RoundOffGridDimensions(
+    const std::array<real_t, 6>& grid_dimensions) {
+  grid_dimensions_[0] = static_cast<int32_t>(floor(grid_dimensions[0]));
+  grid_dimensions_[2] = static_cast<int32_t>(floor(grid_dimensions[2]));
+  grid_dimensions_[4] = static_cast<int32_t>(floor(grid_dimensions[4]));
+  grid_dimensions_[1] = static_cast<int32_t>(ceil(grid_dimensions[1]));
+  grid_dimensions_[3] = static_cast<int32_t>(ceil(grid_dimensions[3]));
+  grid_dimensions_[5] = static_cast<int32_t>(ceil(grid_dimensions[5]));
+}
+
+// -----------------------------------------------------------------------------
+void SparseGridEnvironment::CheckGridGrowth() {
+  // Determine if the grid dimensions have changed (changed in the sense that
+  // the grid has grown outwards)
+  auto min_gd =
+      *std::min_element(grid_dimensions_.begin(), grid_dimensions_.end());
+  auto max_gd =
+      *std::max_element(grid_dimensions_.begin(), grid_dimensions_.end());
+  if (min_gd < threshold_dimensions_[0]) {
+    threshold_dimensions_[0] = min_gd;
+    has_grown_ = true;
+  }
+  if (max_gd > threshold_dimensions_[1]) {
+    threshold_dimensions_[1] = max_gd;
+    has_grown_ = true;
+  }
+}
+
+}  // namespace bdm
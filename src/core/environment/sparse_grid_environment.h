@@ -0,0 +1,280 @@
+// -----------------------------------------------------------------------------
+//
+// Copyright (C) 2021 CERN & University of Surrey for the benefit of the
+// BioDynaMo collaboration. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+//
+// See the LICENSE file distributed with this work for details.
+// See the NOTICE file distributed with this work for additional information
+// regarding copyright ownership.
+//
+// -----------------------------------------------------------------------------
+
+#ifndef CORE_ENVIRONMENT_SPARSE_GRID_ENVIRONMENT_H_
+#define CORE_ENVIRONMENT_SPARSE_GRID_ENVIRONMENT_H_
+
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <vector>
+
+#include "core/container/agent_vector.h"
+#include "core/container/fixed_size_vector.h"
+#include "core/container/math_array.h"
+#include "core/environment/environment.h"
+#include "core/load_balance_info.h"
+#include "core/simulation.h"
+#include "core/util/spinlock.h"
+
+namespace bdm {
+
+/// Uniform grid that only stores non-empty boxes.
+///
+/// `UniformGridEnvironment` allocates all boxes of the bounding box of the
+/// agents. If a few clusters of agents are spread over a large domain, almost
+/// all of these boxes are empty. This environment stores the boxes in an
+/// open-addressing hash table that is keyed by the box coordinates. Its size
+/// only depends on the number of agents and not on the size of the domain.
+/// Box assignment, neighbor search, thread safety and load balancing follow
+/// `UniformGridEnvironment`.
+///
+/// The environment is selected with `Param::environment = "sparse_grid"`, or
+/// automatically if the uniform grid would be sparsely occupied
+/// (see `Param::sparse_grid_occupancy_threshold`).
+class SparseGridEnvironment : public Environment {
+ public:
+  /// Box coordinates are stored with 21 bits per axis
+  static constexpr uint64_t kMaxBoxesPerAxis = uint64_t{1} << 21;
+  /// Key of an unused slot in the hash table
+  static constexpr uint64_t kEmptyKey = std::numeric_limits<uint64_t>::max();
+  /// Returned by `FindBox` if there is no box with the given key
+  static constexpr uint64_t kNoBox = std::numeric_limits<uint64_t>::max();
+
+  /// A slot of the hash table. Agents inside a box form a linked list
+  /// (see `successors_`).
+  struct Box {
+    /// Packed box coordinates; `kEmptyKey` if the slot is not used
+    std::atomic<uint64_t> key_;
+    Spinlock lock_;
+    /// Number of agents in this box
+    uint32_t length_ = 0;
+    /// Start of the linked list of agents inside this box.
+    AgentHandle start_;
+
+    Box() : key_(kEmptyKey) {}
+    /// Copy constructor required for `boxes_.resize()`.
+    /// Slots are reset before they are used.
+    Box(const Box& other) : Box() {}
+  };
+
+  SparseGridEnvironment();
+
+  SparseGridEnvironment(const SparseGridEnvironment&) = delete;
+  void operator=(const SparseGridEnvironment&) = delete;
+
+  ~SparseGridEnvironment() override;
+
+  /// Replaces the `UniformGridEnvironment` of `sim` with a
+  /// `SparseGridEnvironment` if the fraction of non-empty boxes of the uniform
+  /// grid would be smaller than `Param::sparse_grid_occupancy_threshold`.
+  /// Returns true if the environment has been replaced.
+  static bool ReplaceUniformGridIfSparse(Simulation* sim);
+
+  void SetBoxLength(int32_t bl) {
+    box_length_ = bl;
+    is_custom_box_length_ = true;
+  }
+
+  int32_t GetBoxLength() const { return box_length_; }
+
+  /// Returns the number of boxes that contain at least one agent
+  uint64_t GetNumOccupiedBoxes() const { return num_occupied_boxes_; }
+
+  /// Returns the number of boxes a `UniformGridEnvironment` with the same box
+  /// length would allocate for the current agents.
+  uint64_t GetNumDenseBoxes() const {
+    return num_boxes_axis_[0] * num_boxes_axis_[1] * num_boxes_axis_[2];
+  }
+
+  /// Returns the number of slots in the hash table
+  uint64_t GetCapacity() const { return boxes_.size(); }
+
+  std::array<int32_t, 6> GetDimensions() const override {
+    return grid_dimensions_;
+  }
+
+  std::array<int32_t, 2> GetDimensionThresholds() const override {
+    return threshold_dimensions_;
+  }
+
+  LoadBalanceInfo* GetLoadBalanceInfo() override;
+
+  NeighborMutexBuilder* GetNeighborMutexBuilder() override;
+
+  void Clear() override;
+
+  void ForEachNeighbor(Functor<void, Agent*, real_t>& lambda,
+                       const Agent& query, real_t squared_radius) override;
+
+  /// Applies the given functor to each agent that is in the same box as the
+  /// query agent or in the 26 surrounding boxes.
+  /// `criteria` is ignored. Pass a nullptr.
+  void ForEachNeighbor(Functor<void, Agent*>& lambda, const Agent& query,
+                       void* criteria) override;
+
+  void ForEachNeighbor(Functor<void, Agent*, real_t>& lambda,
+                       const Real3& query_position, real_t squared_radius,
+                       const Agent* query_agent = nullptr) override;
+
+ protected:
+  void UpdateImplementation() override;
+
+ private:
+  struct AssignToBoxesFunctor;
+  struct AgentHandleIteratorSG;
+  class LoadBalanceInfoSG;
+  class SparseGridNeighborMutexBuilder;
+
+  /// Hash table of the boxes. The size is a power of two.
+  std::vector<Box> boxes_;
+  /// log2(boxes_.size())
+  uint32_t capacity_log2_ = 1;
+  uint64_t num_occupied_boxes_ = 0;
+  /// Implements the linked lists of the boxes - array index = key,
+  /// value: next element
+  AgentVector<AgentHandle> successors_;
+  /// Length of a box
+  int32_t box_length_ = 1;
+  /// Length of a box squared
+  int32_t box_length_squared_ = 1;
+  /// True when the box length was set manually
+  bool is_custom_box_length_ = false;
+  /// Position of the lower corner of box (0, 0, 0)
+  std::array<int32_t, 3> origin_ = {{0, 0, 0}};
+  /// Number of boxes along each axis of the equivalent dense grid
+  std::array<uint64_t, 3> num_boxes_axis_ = {{0, 0, 0}};
+  /// Cube which contains all agents (including one empty box on each side)
+  /// {x_min, x_max, y_min, y_max, z_min, z_max}
+  std::array<int32_t, 6> grid_dimensions_ = {{0, 0, 0, 0, 0, 0}};
+  /// Stores the min / max dimension value that need to be surpassed in order
+  /// to trigger a diffusion grid change
+  std::array<int32_t, 2> threshold_dimensions_ = {{0, 0}};
+
+  std::unique_ptr<LoadBalanceInfoSG> lbi_;
+  std::unique_ptr<SparseGridNeighborMutexBuilder> nb_mutex_builder_;
+
+  static uint64_t GetKey(const std::array<uint64_t, 3>& box_coord) {
+    return box_coord[0] | (box_coord[1] << 21) | (box_coord[2] << 42);
+  }
+
+  static std::array<uint64_t, 3> GetBoxCoordinates(uint64_t key) {
+    constexpr uint64_t kMask = kMaxBoxesPerAxis - 1;
+    return {key & kMask, (key >> 21) & kMask, key >> 42};
+  }
+
+  /// Returns false if `position` lies outside of the range of box
+  /// coordinates. In this case there are no agents in its neighborhood.
+  bool GetBoxCoordinates(const Real3& position,
+                         std::array<uint64_t, 3>* box_coord) const {
+    for (int i = 0; i < 3; ++i) {
+      auto c = (static_cast<int64_t>(std::floor(position[i])) - origin_[i]) /
+               box_length_;
+      if (c < 0 || c >= static_cast<int64_t>(kMaxBoxesPerAxis)) {
+        return false;
+      }
+      (*box_coord)[i] = static_cast<uint64_t>(c);
+    }
+    return true;
+  }
+
+  /// Fibonacci hashing of the packed box coordinates
+  uint64_t GetSlot(uint64_t key) const {
+    return (key * 0x9E3779B97F4A7C15ull) >> (64 - capacity_log2_);
+  }
+
+  /// Returns the slot of the box with `key` or `kNoBox`.
+  uint64_t FindBox(uint64_t key) const {
+    if (boxes_.empty()) {
+      return kNoBox;
+    }
+    const uint64_t mask = boxes_.size() - 1;
+    for (uint64_t slot = GetSlot(key);; slot = (slot + 1) & mask) {
+      auto current = boxes_[slot].key_.load(std::memory_order_relaxed);
+      if (current == key) {
+        return slot;
+      } else if (current == kEmptyKey) {
+        return kNoBox;
+      }
+    }
+  }
+
+  /// Returns the slot of the box with `key` and inserts the box if it does
+  /// not exist yet. Can be called in parallel.
+  uint64_t FindOrInsertBox(uint64_t key);
+
+  /// Adds the slots of all non-empty boxes in the Moore neighborhood of
+  /// `box_coord` (including the box itself).
+  void GetMooreBoxSlots(const std::array<uint64_t, 3>& box_coord,
+                        FixedSizeVector<uint64_t, 27>* slots) const {
+    for (int64_t dz = -1; dz <= 1; ++dz) {
+      for (int64_t dy = -1; dy <= 1; ++dy) {
+        for (int64_t dx = -1; dx <= 1; ++dx) {
+          const std::array<int64_t, 3> offset = {dx, dy, dz};
+          std::array<uint64_t, 3> coord;
+          bool valid = true;
+          for (int i = 0; i < 3; ++i) {
+            auto c = static_cast<int64_t>(box_coord[i]) + offset[i];
+            valid &= c >= 0 && c < static_cast<int64_t>(kMaxBoxesPerAxis);
+            coord[i] = static_cast<uint64_t>(c);
+          }
+          if (!valid) {
+            continue;
+          }
+          auto slot = FindBox(GetKey(coord));
+          if (slot != kNoBox) {
+            slots->push_back(slot);
+          }
+        }
+      }
+    }
+  }
+
+  /// Calls `lambda(agent)` for each agent in the Moore neighborhood of the
+  /// box that contains `position` (or of box `box_idx` if it is valid).
+  template <typename TLambda>
+  void ForEachAgentInMooreBoxes(const Real3& position, uint64_t box_idx,
+                                TLambda&& lambda) {
+    std::array<uint64_t, 3> box_coord;
+    if (box_idx < boxes_.size()) {
+      box_coord = GetBoxCoordinates(boxes_[box_idx].key_.load());
+    } else if (!GetBoxCoordinates(position, &box_coord)) {
+      return;
+    }
+    FixedSizeVector<uint64_t, 27> slots;
+    GetMooreBoxSlots(box_coord, &slots);
+    auto* rm = Simulation::GetActive()->GetResourceManager();
+    for (auto slot : slots) {
+      const auto& box = boxes_[slot];
+      auto ah = box.start_;
+      for (uint32_t i = 0; i < box.length_; ++i) {
+        lambda(rm->GetAgent(ah));
+        if (i + 1 < box.length_) {
+          ah = successors_[ah];
+        }
+      }
+    }
+  }
+
+  void RoundOffGridDimensions(const std::array<real_t, 6>& grid_dimensions);
+
+  void CheckGridGrowth();
+};
+
+}  // namespace bdm
+
+#endif  // CORE_ENVIRONMENT_SPARSE_GRID_ENVIRONMENT_H_
@@ -14,10 +14,44 @@
 
 #include "core/environment/uniform_grid_environment.h"
 #include <morton/morton.h>  // NOLINT
+#include <numeric>
+#include <utility>
 #include "core/algorithm.h"
+#include "core/functor.h"
+#include "core/util/math.h"
+#include "core/util/thread_info.h"
+#include "core/util/type.h"
+#include "neuroscience/neurite_element.h"
 
 namespace bdm {
 
+using neuroscience::NeuriteElement;
+
+namespace {
+
+/// Returns the end points of the axis of cylinder-shaped agents. Both end
+/// points of other agents are at their position.
+inline void GetAxis(const Agent* agent, Real3* proximal, Real3* distal) {
+  if (agent->GetShape() == Shape::kCylinder) {
+    auto* cylinder = bdm_static_cast<const NeuriteElement*>(agent);
+    *proximal = cylinder->ProximalEnd();
+    *distal = cylinder->GetMassLocation();
+  } else {
+    *proximal = agent->GetPosition();
+    *distal = *proximal;
+  }
+}
+
+inline Real3 ElementwiseMin(const Real3& a, const Real3& b) {
+  return {std::min(a[0], b[0]), std::min(a[1], b[1]), std::min(a[2], b[2])};
+}
+
+inline Real3 ElementwiseMax(const Real3& a, const Real3& b) {
+  return {std::max(a[0], b[0]), std::max(a[1], b[1]), std::max(a[2], b[2])};
+}
+
+}  // namespace
+
 // -----------------------------------------------------------------------------
 UniformGridEnvironment::LoadBalanceInfoUG::LoadBalanceInfoUG(
     UniformGridEnvironment* grid)
@@ -152,35 +186,40 @@ void UniformGridEnvironment::UpdateImplementation() {
       this->largest_object_size_squared_ = box_length_squared_;
     }
 
-    for (int i = 0; i < 3; i++) {
-      int dimension_length =
-          grid_dimensions_[2 * i + 1] - grid_dimensions_[2 * i];
-      int r = dimension_length % box_length_;
-      // If the grid is not perfectly divisible along each dimension by the
-      // resolution, extend the grid so that it is
-      if (r != 0) {
-        // std::abs for the case that box_length_ > dimension_length
-        grid_dimensions_[2 * i + 1] += (box_length_ - r);
-      } else {
-        // Else extend the grid dimension with one row, because the outmost
-        // object lies exactly on the border
-        grid_dimensions_[2 * i + 1] += box_length_;
+    periodic_ = param->bound_space == Param::BoundSpaceMode::kTorus;
+    if (periodic_) {
+      InitializePeriodicGrid(param->min_bound, param->max_bound);
+    } else {
+      for (int i = 0; i < 3; i++) {
+        int dimension_length =
+            grid_dimensions_[2 * i + 1] - grid_dimensions_[2 * i];
+        int r = dimension_length % box_length_;
+        // If the grid is not perfectly divisible along each dimension by the
+        // resolution, extend the grid so that it is
+        if (r != 0) {
+          // std::abs for the case that box_length_ > dimension_length
+          grid_dimensions_[2 * i + 1] += (box_length_ - r);
+        } else {
+          // Else extend the grid dimension with one row, because the outmost
+          // object lies exactly on the border
+          grid_dimensions_[2 * i + 1] += box_length_;
+        }
       }
-    }
 
-    // Pad the grid to avoid out of bounds check when search neighbors
-    for (int i = 0; i < 3; i++) {
-      grid_dimensions_[2 * i] -= box_length_;
-      grid_dimensions_[2 * i + 1] += box_length_;
-    }
+      // Pad the grid to avoid out of bounds check when search neighbors
+      for (int i = 0; i < 3; i++) {
+        grid_dimensions_[2 * i] -= box_length_;
+        grid_dimensions_[2 * i + 1] += box_length_;
+      }
 
-    // Calculate how many boxes fit along each dimension
-    for (int i = 0; i < 3; i++) {
-      int dimension_length =
-          grid_dimensions_[2 * i + 1] - grid_dimensions_[2 * i];
-      assert((dimension_length % box_length_ == 0) &&
-             "The grid dimensions are not a multiple of its box length");
-      num_boxes_axis_[i] = dimension_length / box_length_;
+      // Calculate how many boxes fit along each dimension
+      for (int i = 0; i < 3; i++) {
+        int dimension_length =
+            grid_dimensions_[2 * i + 1] - grid_dimensions_[2 * i];
+        assert((dimension_length % box_length_ == 0) &&
+               "The grid dimensions are not a multiple of its box length");
+        num_boxes_axis_[i] = dimension_length / box_length_;
+      }
     }
 
     num_boxes_xy_ = num_boxes_axis_[0] * num_boxes_axis_[1];
@@ -201,6 +240,8 @@ void UniformGridEnvironment::UpdateImplementation() {
     // Assign agents to boxes
     AssignToBoxesFunctor functor(this);
     rm->ForEachAgentParallel(param->scheduling_batch_size, functor);
+    UpdateFrozenBoxes();
+    UpdateCylinderIndex();
     if (param->bound_space) {
       int min = param->min_bound;
       int max = param->max_bound;
@@ -231,6 +272,10 @@ void UniformGridEnvironment::UpdateImplementation() {
       // grid state remains the same, but we have to set has_grown_ to false
       // otherwise the DiffusionGrid will attempt to resize
       has_grown_ = false;
+      box_frozen_.clear();
+      num_frozen_boxes_ = 0;
+      cylinder_start_.clear();
+      cylinders_.clear();
     } else {
       Log::Fatal(
           "UniformGridEnvironment",
@@ -242,6 +287,207 @@ void UniformGridEnvironment::UpdateImplementation() {
   }
 }
 
+// -----------------------------------------------------------------------------
+void UniformGridEnvironment::UpdateFrozenBoxes() {
+  auto* param = Simulation::GetActive()->GetParam();
+  num_frozen_boxes_ = 0;
+  if (!param->detect_static_agents || !param->detect_static_regions) {
+    box_frozen_.clear();
+    return;
+  }
+
+  const uint64_t num_boxes = boxes_.size();
+  box_frozen_.resize(num_boxes);
+  uint64_t num_frozen_boxes = 0;
+#pragma omp parallel for schedule(static) reduction(+ : num_frozen_boxes)
+  for (uint64_t i = 0; i < num_boxes; ++i) {
+    bool frozen = false;
+    // Empty boxes are not considered, because their Moore neighborhood can
+    // reach beyond the grid.
+    if (!boxes_[i].IsEmpty(timestamp_) && !boxes_[i].active_) {
+      FixedSizeVector<uint64_t, 27> neighbor_boxes;
+      GetMooreBoxIndices(&neighbor_boxes, i);
+      frozen = true;
+      for (size_t j = 0; j < neighbor_boxes.size(); ++j) {
+        const auto& box = boxes_[neighbor_boxes[j]];
+        if (!box.IsEmpty(timestamp_) && box.active_) {
+          frozen = false;
+          break;
+        }
+      }
+    }
+    box_frozen_[i] = frozen;
+    num_frozen_boxes += frozen;
+  }
+  num_frozen_boxes_ = num_frozen_boxes;
+}
+
+// -----------------------------------------------------------------------------
+void UniformGridEnvironment::ForEachAgentInActiveBoxes(
+    Functor<void, Agent*>& functor) {
+  auto* rm = Simulation::GetActive()->GetResourceManager();
+  if (!HasFrozenRegions()) {
+    rm->ForEachAgentParallel(functor);
+    return;
+  }
+  const uint64_t num_boxes = boxes_.size();
+#pragma omp parallel for schedule(dynamic, 64)
+  for (uint64_t i = 0; i < num_boxes; ++i) {
+    const auto& box = boxes_[i];
+    if (box.IsEmpty(timestamp_) || !box.active_) {
+      continue;
+    }
+    for (auto it = box.begin(this); !it.IsAtEnd(); ++it) {
+      functor(rm->GetAgent(*it));
+    }
+  }
+}
+
+// -----------------------------------------------------------------------------
+void UniformGridEnvironment::UpdateCylinderIndex() {
+  auto* param = Simulation::GetActive()->GetParam();
+  cylinder_start_.clear();
+  cylinders_.clear();
+  if (!param->cylinder_neighbor_search || periodic_) {
+    return;
+  }
+
+  auto* rm = Simulation::GetActive()->GetResourceManager();
+  auto* tinfo = ThreadInfo::GetInstance();
+  // (box index, entry) for each thread
+  std::vector<std::vector<std::pair<uint64_t, CylinderEntry>>> entries(
+      tinfo->GetMaxThreads());
+  auto register_cylinder = L2F([&](Agent* agent, AgentHandle ah) {
+    if (agent->GetShape() != Shape::kCylinder) {
+      return;
+    }
+    Real3 proximal, distal;
+    GetAxis(agent, &proximal, &distal);
+    auto lo = GetClampedBoxCoordinates(ElementwiseMin(proximal, distal));
+    auto hi = GetClampedBoxCoordinates(ElementwiseMax(proximal, distal));
+    auto& thread_entries = entries[tinfo->GetMyThreadId()];
+    for (uint64_t z = lo[2]; z <= hi[2]; ++z) {
+      for (uint64_t y = lo[1]; y <= hi[1]; ++y) {
+        for (uint64_t x = lo[0]; x <= hi[0]; ++x) {
+          auto idx = GetBoxIndex(std::array<uint64_t, 3>{x, y, z});
+          thread_entries.push_back({idx, CylinderEntry{ah, lo}});
+        }
+      }
+    }
+  });
+  rm->ForEachAgentParallel(param->scheduling_batch_size, register_cylinder);
+
+  // sort the entries by box (counting sort)
+  cylinder_start_.assign(boxes_.size() + 1, 0);
+  for (auto& thread_entries : entries) {
+    for (auto& entry : thread_entries) {
+      cylinder_start_[entry.first + 1]++;
+    }
+  }
+  std::partial_sum(cylinder_start_.begin(), cylinder_start_.end(),
+                   cylinder_start_.begin());
+  cylinders_.resize(cylinder_start_.back());
+  std::vector<uint64_t> next(cylinder_start_.begin(),
+                             cylinder_start_.end() - 1);
+  for (auto& thread_entries : entries) {
+    for (auto& entry : thread_entries) {
+      cylinders_[next[entry.first]++] = entry.second;
+    }
+  }
+}
+
+// -----------------------------------------------------------------------------
+void UniformGridEnvironment::ForEachNeighborOfCylinder(
+    Functor<void, Agent*, real_t>& lambda, const Agent& query,
+    real_t squared_radius) {
+  if (!HasCylinderIndex() || query.GetShape() != Shape::kCylinder) {
+    ForEachNeighbor(lambda, query, squared_radius);
+    return;
+  }
+
+  Real3 proximal, distal;
+  GetAxis(&query, &proximal, &distal);
+  const real_t query_radius = query.GetDiameter() / 2;
+  // The axis (or center) of each agent that touches the query is closer to
+  // the axis of the query than this margin.
+  const real_t margin = query_radius + largest_object_size_ / 2;
+  const Real3 margin3 = {margin, margin, margin};
+  auto lo =
+      GetClampedBoxCoordinates(ElementwiseMin(proximal, distal) - margin3);
+  auto hi =
+      GetClampedBoxCoordinates(ElementwiseMax(proximal, distal) + margin3);
+
+  auto* rm = Simulation::GetActive()->GetResourceManager();
+  auto process = [&](Agent* neighbor) {
+    if (neighbor == &query) {
+      return;
+    }
+    Real3 neighbor_proximal, neighbor_distal;
+    GetAxis(neighbor, &neighbor_proximal, &neighbor_distal);
+    auto squared_distance = Math::SquaredSegmentDistance(
+        proximal, distal, neighbor_proximal, neighbor_distal);
+    auto contact_distance = query_radius + neighbor->GetDiameter() / 2;
+    if (squared_distance < contact_distance * contact_distance) {
+      lambda(neighbor, squared_distance);
+    }
+  };
+
+  for (uint32_t z = lo[2]; z <= hi[2]; ++z) {
+    for (uint32_t y = lo[1]; y <= hi[1]; ++y) {
+      for (uint32_t x = lo[0]; x <= hi[0]; ++x) {
+        auto idx = GetBoxIndex(std::array<uint64_t, 3>{x, y, z});
+        // Other agents are stored at the box of their position
+        for (auto it = boxes_[idx].begin(this); !it.IsAtEnd(); ++it) {
+          auto* neighbor = rm->GetAgent(*it);
+          if (neighbor->GetShape() != Shape::kCylinder) {
+            process(neighbor);
+          }
+        }
+        for (uint64_t i = cylinder_start_[idx]; i < cylinder_start_[idx + 1];
+             ++i) {
+          // A cylinder can overlap several boxes of the search region.
+          // Only visit it in the first one.
+          const auto& first_box = cylinders_[i].first_box;
+          if (x != std::max(first_box[0], lo[0]) ||
+              y != std::max(first_box[1], lo[1]) ||
+              z != std::max(first_box[2], lo[2])) {
+            continue;
+          }
+          process(rm->GetAgent(cylinders_[i].ah));
+        }
+      }
+    }
+  }
+}
+
+// -----------------------------------------------------------------------------
+void UniformGridEnvironment::InitializePeriodicGrid(real_t min_bound,
+                                                    real_t max_bound) {
+  if (max_bound <= min_bound) {
+    Log::Fatal("UniformGridEnvironment",
+               "Periodic boundaries require Param::max_bound (", max_bound,
+               ") to be larger than Param::min_bound (", min_bound, ").");
+  }
+  periodic_origin_ = min_bound;
+  periodic_length_ = max_bound - min_bound;
+  inverse_periodic_length_ = 1 / periodic_length_;
+  num_periodic_boxes_ = std::max(
+      uint64_t{1}, static_cast<uint64_t>(periodic_length_ / box_length_));
+  periodic_box_length_ = periodic_length_ / num_periodic_boxes_;
+
+  // Boxes are at least box_length_ wide. Hence, the Moore neighborhood of a
+  // box contains all neighbors within box_length_ (see CheckSearchRadius).
+  // Agents are never assigned to the padding boxes, but the padding keeps the
+  // same layout as the non-periodic grid.
+  for (int i = 0; i < 3; i++) {
+    grid_dimensions_[2 * i] =
+        static_cast<int32_t>(floor(min_bound)) - box_length_;
+    grid_dimensions_[2 * i + 1] =
+        static_cast<int32_t>(ceil(max_bound)) + box_length_;
+    num_boxes_axis_[i] = num_periodic_boxes_ + 2;
+  }
+}
+
 // -----------------------------------------------------------------------------
 void UniformGridEnvironment::LoadBalanceInfoUG::CallHandleIteratorConsumer(
     uint64_t start, uint64_t end,
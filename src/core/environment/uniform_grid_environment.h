@@ -68,6 +68,9 @@ class UniformGridEnvironment : public Environment {
   /// A single unit cube of the grid
   struct Box {
     Spinlock lock_;
+    /// False if none of the agents in this box moved or changed in the last
+    /// iteration (see `Param::detect_static_regions`)
+    bool active_;
     /// length of the linked list (i.e. number of agents)
     /// uint64_t, because sizeof(Box) = 16, for uint16_t and uint64_t
     uint16_t length_;
@@ -77,7 +80,7 @@ class UniformGridEnvironment : public Environment {
     /// Next element can be found at `successors_[start_]`
     AgentHandle start_;
 
-    Box() : length_(0), timestamp_(0), start_(AgentHandle()) {}
+    Box() : active_(true), length_(0), timestamp_(0), start_(AgentHandle()) {}
     /// Copy Constructor required for boxes_.resize()
     /// Since box values will be overwritten afterwards it forwards to the
     /// default ctor
@@ -88,6 +91,7 @@ class UniformGridEnvironment : public Environment {
       // length_ = other.length_.load(std::memory_order_relaxed);
       start_ = other.start_;
       length_ = other.length_;
+      active_ = other.active_;
       return *this;
     }
 
@@ -106,18 +110,22 @@ class UniformGridEnvironment : public Environment {
     ///
     /// @param[in]  agent       The object's identifier
     /// @param   AddObject   successors   The successors
+    /// @param[in]  active      False if the agent is static and did not
+    ///                         change in the last iteration
     void AddObject(AgentHandle ah, AgentVector<AgentHandle>* successors,
-                   UniformGridEnvironment* grid) {
+                   UniformGridEnvironment* grid, bool active = true) {
       std::lock_guard<Spinlock> lock_guard(lock_);
 
       if (timestamp_ != grid->timestamp_) {
         timestamp_ = grid->timestamp_;
         length_ = 1;
         start_ = ah;
+        active_ = active;
       } else {
         length_++;
         (*successors)[ah] = start_;
         start_ = ah;
+        active_ = active_ || active;
       }
     }
 
@@ -247,6 +255,10 @@ class UniformGridEnvironment : public Environment {
     grid_dimensions_ = {inf, -inf, inf, -inf, inf, -inf};
     threshold_dimensions_ = {inf, -inf};
     successors_.clear();
+    box_frozen_.clear();
+    num_frozen_boxes_ = 0;
+    cylinder_start_.clear();
+    cylinders_.clear();
     has_grown_ = false;
   }
 
@@ -257,7 +269,11 @@ class UniformGridEnvironment : public Environment {
       const auto& position = agent->GetPosition();
       auto idx = grid_->GetBoxIndex(position);
       auto box = grid_->GetBoxPointer(idx);
-      box->AddObject(ah, &(grid_->successors_), grid_);
+      // An agent is quiescent if it was static in the last iteration and
+      // neither moved nor changed afterwards.
+      bool active = !agent->IsStatic() || !agent->GetStaticnessNextTimestep() ||
+                    agent->GetPropagateStaticness();
+      box->AddObject(ah, &(grid_->successors_), grid_, active);
       assert(idx <= std::numeric_limits<uint32_t>::max());
       agent->SetBoxIdx(static_cast<uint32_t>(idx));
     }
@@ -275,6 +291,9 @@ class UniformGridEnvironment : public Environment {
 
   int32_t GetBoxLength() const { return box_length_; }
 
+  /// Returns true if the box length has been set with `SetBoxLength`
+  bool HasCustomBoxLength() const { return is_custom_box_length_; }
+
   /// @brief      Calculates the squared euclidean distance between two points
   ///             in 3D
   ///
@@ -324,6 +343,13 @@ class UniformGridEnvironment : public Environment {
   /// @return     The box index.
   ///
   size_t GetBoxIndex(const Real3& position) const {
+    if (periodic_) {
+      // skip the padding box
+      return GetBoxIndex(std::array<uint64_t, 3>{
+          GetPeriodicBoxCoordinate(position[0]) + 1,
+          GetPeriodicBoxCoordinate(position[1]) + 1,
+          GetPeriodicBoxCoordinate(position[2]) + 1});
+    }
     // Check if conversion can be done without losing information
     assert(floor(position[0]) <= std::numeric_limits<int32_t>::max());
     assert(floor(position[1]) <= std::numeric_limits<int32_t>::max());
@@ -342,6 +368,20 @@ class UniformGridEnvironment : public Environment {
     return GetBoxIndex(box_coord);
   }
 
+  /// Returns true if the grid is periodic along all axes
+  /// (`Param::bound_space` is `kTorus`).
+  bool IsPeriodic() const { return periodic_; }
+
+  /// Returns the shortest distance along one axis between two coordinates
+  /// whose difference is `d`. For periodic grids, the nearest periodic image
+  /// is used (minimum image convention); otherwise `d` is returned unchanged.
+  real_t GetMinimumImage(real_t d) const {
+    if (!periodic_) {
+      return d;
+    }
+    return d - periodic_length_ * std::round(d * inverse_periodic_length_);
+  }
+
   std::array<int32_t, 6> GetDimensions() const override {
     return grid_dimensions_;
   }
@@ -350,6 +390,10 @@ class UniformGridEnvironment : public Environment {
   /// Compares the points coordinates against grid_dimensions_ (without bounding
   /// boxes).
   bool ContainedInGrid(const Real3& point) const {
+    if (periodic_) {
+      // positions outside the bounds are wrapped into the grid
+      return true;
+    }
     real_t xmin = static_cast<real_t>(grid_dimensions_[0]) + box_length_;
     real_t xmax = static_cast<real_t>(grid_dimensions_[1]) - box_length_;
     real_t ymin = static_cast<real_t>(grid_dimensions_[2]) + box_length_;
@@ -389,6 +433,41 @@ class UniformGridEnvironment : public Environment {
     return box_coord;
   }
 
+  /// Returns true if the frozen regions have been determined in the last
+  /// update (see `Param::detect_static_regions`)
+  bool HasFrozenRegions() const { return !box_frozen_.empty(); }
+
+  /// Returns true if none of the agents in box `box_idx` and its Moore
+  /// neighborhood moved or changed in the last iteration.
+  bool IsBoxFrozen(uint64_t box_idx) const {
+    return box_idx < box_frozen_.size() && box_frozen_[box_idx];
+  }
+
+  uint64_t GetNumFrozenBoxes() const { return num_frozen_boxes_; }
+
+  bool IsInFrozenRegion(const Agent& agent) const override {
+    return IsBoxFrozen(agent.GetBoxIdx());
+  }
+
+  /// Returns true if cylinders have been registered in all boxes that their
+  /// axis overlaps in the last update (see `Param::cylinder_neighbor_search`)
+  bool HasCylinderIndex() const { return !cylinder_start_.empty(); }
+
+  /// Applies `lambda` to all agents whose surface touches the
+  /// cylinder-shaped agent `query`. The second argument of `lambda` is the
+  /// squared distance between the axis of `query` and the axis (or center)
+  /// of the neighbor.
+  /// Forwards to `ForEachNeighbor` if the cylinder index has not been built.
+  void ForEachNeighborOfCylinder(Functor<void, Agent*, real_t>& lambda,
+                                 const Agent& query,
+                                 real_t squared_radius) override;
+
+  /// Applies `functor` in parallel to all agents in boxes that contain at
+  /// least one agent that is not static, or that moved or changed in the last
+  /// iteration. Visits all agents if the frozen regions have not been
+  /// determined.
+  void ForEachAgentInActiveBoxes(Functor<void, Agent*>& functor);
+
   /// @brief      Applies the given lambda to each neighbor of the specified
   ///             agent is within the squared radius.
   ///
@@ -417,14 +496,7 @@ class UniformGridEnvironment : public Environment {
   void ForEachNeighbor(Functor<void, Agent*, real_t>& lambda,
                        const Real3& query_position, real_t squared_radius,
                        const Agent* query_agent = nullptr) override {
-    if (squared_radius > box_length_squared_) {
-      Log::Fatal(
-          "UniformGridEnvironment::ForEachNeighbor",
-          "The requested search radius (", std::sqrt(squared_radius), ")",
-          " of the neighborhood search exceeds the "
-          "box length (",
-          box_length_, "). The resulting neighborhood would be incomplete.");
-    }
+    CheckSearchRadius(squared_radius);
     const auto& position = query_position;
     // Use uint32_t for compatibility with Agent::GetBoxIdx();
     uint32_t idx{std::numeric_limits<uint32_t>::max()};
@@ -477,13 +549,24 @@ class UniformGridEnvironment : public Environment {
     real_t squared_distance[batch_size] __attribute__((aligned(64)));
 
     auto process_batch = [&]() {
+      if (periodic_) {
 #pragma omp simd
-      for (uint64_t i = 0; i < size; ++i) {
-        const real_t dx = x[i] - position[0];
-        const real_t dy = y[i] - position[1];
-        const real_t dz = z[i] - position[2];
+        for (uint64_t i = 0; i < size; ++i) {
+          const real_t dx = GetMinimumImage(x[i] - position[0]);
+          const real_t dy = GetMinimumImage(y[i] - position[1]);
+          const real_t dz = GetMinimumImage(z[i] - position[2]);
 
-        squared_distance[i] = dx * dx + dy * dy + dz * dz;
+          squared_distance[i] = dx * dx + dy * dy + dz * dz;
+        }
+      } else {
+#pragma omp simd
+        for (uint64_t i = 0; i < size; ++i) {
+          const real_t dx = x[i] - position[0];
+          const real_t dy = y[i] - position[1];
+          const real_t dz = z[i] - position[2];
+
+          squared_distance[i] = dx * dx + dy * dy + dz * dz;
+        }
       }
 
       for (uint64_t i = 0; i < size; ++i) {
@@ -514,6 +597,167 @@ class UniformGridEnvironment : public Environment {
     process_batch();
   };
 
+  // Batched neighbor search ----------------------------------------------
+
+  /// Queries and candidates of a batched neighbor search.
+  /// All agents of one box are queries. The candidates are the agents of the
+  /// same box and its Moore neighborhood. They are gathered only once and
+  /// shared by all queries of the box. Positions are stored as structure of
+  /// arrays to enable vectorized distance computations.
+  struct NeighborBlock {
+    std::vector<Agent*> queries;
+    std::vector<real_t> query_x;
+    std::vector<real_t> query_y;
+    std::vector<real_t> query_z;
+    std::vector<Agent*> candidates;
+    std::vector<real_t> candidate_x;
+    std::vector<real_t> candidate_y;
+    std::vector<real_t> candidate_z;
+    std::vector<real_t> candidate_diameter;
+
+    void Clear() {
+      queries.clear();
+      query_x.clear();
+      query_y.clear();
+      query_z.clear();
+      candidates.clear();
+      candidate_x.clear();
+      candidate_y.clear();
+      candidate_z.clear();
+      candidate_diameter.clear();
+    }
+  };
+
+  /// Fills `block` with the agents of box `box_idx` (queries) and the agents
+  /// of the box and its Moore neighborhood (candidates).
+  void GetNeighborBlock(uint64_t box_idx, NeighborBlock* block) {
+    block->Clear();
+    const auto* box = GetBoxPointer(box_idx);
+    if (box->IsEmpty(timestamp_)) {
+      return;
+    }
+    auto* rm = Simulation::GetActive()->GetResourceManager();
+    for (auto it = box->begin(this); !it.IsAtEnd(); ++it) {
+      auto* agent = rm->GetAgent(*it);
+      const auto& pos = agent->GetPosition();
+      block->queries.push_back(agent);
+      block->query_x.push_back(pos[0]);
+      block->query_y.push_back(pos[1]);
+      block->query_z.push_back(pos[2]);
+    }
+
+    FixedSizeVector<const Box*, 27> neighbor_boxes;
+    GetMooreBoxes(&neighbor_boxes, box_idx);
+    NeighborIterator ni(this, neighbor_boxes, timestamp_);
+    while (!ni.IsAtEnd()) {
+      auto ah = *ni;
+      // increment iterator already here to hide memory latency
+      ++ni;
+      auto* agent = rm->GetAgent(ah);
+      const auto& pos = agent->GetPosition();
+      block->candidates.push_back(agent);
+      block->candidate_x.push_back(pos[0]);
+      block->candidate_y.push_back(pos[1]);
+      block->candidate_z.push_back(pos[2]);
+      block->candidate_diameter.push_back(agent->GetDiameter());
+    }
+  }
+
+  /// Calls `callback(query, neighbor, squared_distance)` for each pair of
+  /// query and candidate in `block` whose squared distance is smaller than
+  /// `squared_radius` (excluding the query itself).
+  /// Distances are computed for tiles of kQueryTile x kCandidateTile pairs.
+  template <typename TCallback>
+  void ForEachNeighborInBlock(const NeighborBlock& block,
+                              real_t squared_radius,
+                              TCallback&& callback) const {
+    constexpr uint64_t kQueryTile = 4;
+    constexpr uint64_t kCandidateTile = 64;
+    real_t squared_distance[kQueryTile][kCandidateTile]
+        __attribute__((aligned(64)));
+
+    const uint64_t num_queries = block.queries.size();
+    const uint64_t num_candidates = block.candidates.size();
+    const real_t* cx = block.candidate_x.data();
+    const real_t* cy = block.candidate_y.data();
+    const real_t* cz = block.candidate_z.data();
+    for (uint64_t q0 = 0; q0 < num_queries; q0 += kQueryTile) {
+      const uint64_t qsize = std::min(kQueryTile, num_queries - q0);
+      for (uint64_t c0 = 0; c0 < num_candidates; c0 += kCandidateTile) {
+        const uint64_t csize = std::min(kCandidateTile, num_candidates - c0);
+        for (uint64_t q = 0; q < qsize; ++q) {
+          const real_t x = block.query_x[q0 + q];
+          const real_t y = block.query_y[q0 + q];
+          const real_t z = block.query_z[q0 + q];
+          real_t* sd = squared_distance[q];
+          if (periodic_) {
+#pragma omp simd
+            for (uint64_t c = 0; c < csize; ++c) {
+              const real_t dx = GetMinimumImage(cx[c0 + c] - x);
+              const real_t dy = GetMinimumImage(cy[c0 + c] - y);
+              const real_t dz = GetMinimumImage(cz[c0 + c] - z);
+              sd[c] = dx * dx + dy * dy + dz * dz;
+            }
+            continue;
+          }
+#pragma omp simd
+          for (uint64_t c = 0; c < csize; ++c) {
+            const real_t dx = cx[c0 + c] - x;
+            const real_t dy = cy[c0 + c] - y;
+            const real_t dz = cz[c0 + c] - z;
+            sd[c] = dx * dx + dy * dy + dz * dz;
+          }
+        }
+        for (uint64_t q = 0; q < qsize; ++q) {
+          auto* query = block.queries[q0 + q];
+          for (uint64_t c = 0; c < csize; ++c) {
+            auto* candidate = block.candidates[c0 + c];
+            if (squared_distance[q][c] < squared_radius &&
+                candidate != query) {
+              callback(query, candidate, squared_distance[q][c]);
+            }
+          }
+        }
+      }
+    }
+  }
+
+  /// Batched version of `ForEachNeighbor` for all agents inside box
+  /// `box_idx`. Calls `callback(query, neighbor, squared_distance)`.
+  /// In contrast to `ForEachNeighbor` the callback is a template parameter
+  /// and can therefore be inlined.
+  template <typename TCallback>
+  void ForEachNeighborInBox(uint64_t box_idx, real_t squared_radius,
+                            TCallback&& callback) {
+    CheckSearchRadius(squared_radius);
+    thread_local NeighborBlock block;
+    GetNeighborBlock(box_idx, &block);
+    ForEachNeighborInBlock(block, squared_radius, callback);
+  }
+
+  /// Batched neighbor search for all agents in the simulation.
+  /// Calls `callback(query, neighbor, squared_distance)` for each agent and
+  /// each of its neighbors within `squared_radius`. Boxes are processed in
+  /// parallel. All calls for the same query agent are made by the same
+  /// thread. Therefore, the callback can modify the query without
+  /// synchronization, but must not modify the neighbor.
+  template <typename TCallback>
+  void ForEachNeighborBatched(real_t squared_radius, TCallback&& callback) {
+    CheckSearchRadius(squared_radius);
+#pragma omp parallel
+    {
+      NeighborBlock block;
+#pragma omp for schedule(dynamic, 64)
+      for (uint64_t i = 0; i < total_num_boxes_; ++i) {
+        if (boxes_[i].IsEmpty(timestamp_)) {
+          continue;
+        }
+        GetNeighborBlock(i, &block);
+        ForEachNeighborInBlock(block, squared_radius, callback);
+      }
+    }
+  }
+
   /// @brief      Applies the given functor to each neighbor of the specified
   ///             agent that is within the same box as the query agent
   ///             or in the 26 surrounding boxes.
@@ -682,6 +926,35 @@ class UniformGridEnvironment : public Environment {
   /// Stores the min / max dimension value that need to be surpassed in order
   /// to trigger a diffusion grid change
   std::array<int32_t, 2> threshold_dimensions_;
+  /// True if the grid is periodic (`Param::bound_space` is `kTorus`).
+  /// The periodic cube [min_bound, max_bound) is divided into
+  /// `num_periodic_boxes_` boxes per axis, which are surrounded by empty
+  /// padding boxes. The Moore neighborhood of boxes at the border wraps
+  /// around to the opposite side of the cube.
+  bool periodic_ = false;
+  real_t periodic_origin_ = 0;
+  real_t periodic_length_ = 1;
+  real_t inverse_periodic_length_ = 1;
+  /// Length of a periodic box. Is larger or equal than `box_length_`.
+  real_t periodic_box_length_ = 1;
+  uint64_t num_periodic_boxes_ = 1;
+  /// Non-zero if the box and its Moore neighborhood are frozen.
+  /// Empty if `Param::detect_static_regions` is turned off.
+  std::vector<uint8_t> box_frozen_;
+  uint64_t num_frozen_boxes_ = 0;
+
+  /// Entry of a cylinder in the cylinder index
+  struct CylinderEntry {
+    AgentHandle ah;
+    /// Coordinates of the first box that the axis of the cylinder overlaps.
+    /// Used to visit each cylinder only once per query.
+    std::array<uint32_t, 3> first_box;
+  };
+  /// The cylinders whose axis overlaps box `i` are stored in
+  /// `cylinders_[cylinder_start_[i]]` to `cylinders_[cylinder_start_[i + 1]]`
+  /// (exclusive). Empty if `Param::cylinder_neighbor_search` is turned off.
+  std::vector<uint64_t> cylinder_start_;
+  std::vector<CylinderEntry> cylinders_;
 
   LoadBalanceInfoUG lbi_;  //!
 
@@ -691,6 +964,28 @@ class UniformGridEnvironment : public Environment {
   std::unique_ptr<GridNeighborMutexBuilder> nb_mutex_builder_ =
       std::make_unique<GridNeighborMutexBuilder>();
 
+  /// Determines which boxes are frozen based on the activity of the agents
+  /// assigned to them.
+  void UpdateFrozenBoxes();
+
+  /// Registers all cylinder-shaped agents in the boxes that their axis
+  /// overlaps (see `Param::cylinder_neighbor_search`).
+  void UpdateCylinderIndex();
+
+  /// Returns the coordinates of the box that contains `position`. Positions
+  /// outside the grid are mapped to the closest box.
+  std::array<uint32_t, 3> GetClampedBoxCoordinates(
+      const Real3& position) const {
+    std::array<uint32_t, 3> box_coord;
+    for (int i = 0; i < 3; ++i) {
+      auto c = std::floor((position[i] - grid_dimensions_[2 * i]) /
+                          static_cast<real_t>(box_length_));
+      auto max = static_cast<real_t>(num_boxes_axis_[i] - 1);
+      box_coord[i] = static_cast<uint32_t>(std::clamp(c, real_t(0), max));
+    }
+    return box_coord;
+  }
+
   void CheckGridGrowth() {
     // Determine if the grid dimensions have changed (changed in the sense that
     // the grid has grown outwards)
@@ -712,6 +1007,67 @@ class UniformGridEnvironment : public Environment {
     }
   }
 
+  /// Neighbor searches are limited to the Moore neighborhood of a box.
+  /// Hence, the search radius must not exceed the box length.
+  void CheckSearchRadius(real_t squared_radius) const {
+    if (squared_radius > box_length_squared_) {
+      Log::Fatal(
+          "UniformGridEnvironment::ForEachNeighbor",
+          "The requested search radius (", std::sqrt(squared_radius), ")",
+          " of the neighborhood search exceeds the "
+          "box length (",
+          box_length_, "). The resulting neighborhood would be incomplete.");
+    }
+  }
+
+  /// Divides the periodic cube [min_bound, max_bound) into the largest
+  /// number of boxes per axis that are not smaller than `box_length_`.
+  void InitializePeriodicGrid(real_t min_bound, real_t max_bound);
+
+  /// Returns the coordinate of the periodic box that contains `x` along one
+  /// axis (without padding). `x` is wrapped into the periodic cube.
+  uint64_t GetPeriodicBoxCoordinate(real_t x) const {
+    real_t rel = x - periodic_origin_;
+    rel -= periodic_length_ * std::floor(rel * inverse_periodic_length_);
+    auto coord = static_cast<int64_t>(rel / periodic_box_length_);
+    coord = std::max(int64_t{0}, coord);
+    return std::min(static_cast<uint64_t>(coord), num_periodic_boxes_ - 1);
+  }
+
+  /// Periodic version of `GetMooreBoxIndices`. Box coordinates wrap around
+  /// at the border of the periodic cube. If there are less than three boxes
+  /// per axis, the same box is reachable through several offsets; it is only
+  /// added once.
+  void GetPeriodicMooreBoxIndices(FixedSizeVector<uint64_t, 27>* box_indices,
+                                  size_t box_idx) const {
+    box_indices->push_back(box_idx);
+    const auto center = GetBoxCoordinates(box_idx);
+    const int64_t n = static_cast<int64_t>(num_periodic_boxes_);
+    for (int64_t dz = -1; dz <= 1; ++dz) {
+      for (int64_t dy = -1; dy <= 1; ++dy) {
+        for (int64_t dx = -1; dx <= 1; ++dx) {
+          // number of axes in which the box differs from the center box
+          int distance = (dx != 0) + (dy != 0) + (dz != 0);
+          if (distance == 0 || distance > static_cast<int>(adjacency_) + 1) {
+            continue;
+          }
+          const std::array<int64_t, 3> offset = {dx, dy, dz};
+          std::array<uint64_t, 3> coord;
+          for (int i = 0; i < 3; ++i) {
+            // box coordinates include one padding box
+            int64_t c = static_cast<int64_t>(center[i]) - 1 + offset[i];
+            coord[i] = static_cast<uint64_t>((c + n) % n) + 1;
+          }
+          auto idx = GetBoxIndex(coord);
+          if (std::find(box_indices->begin(), box_indices->end(), idx) ==
+              box_indices->end()) {
+            box_indices->push_back(idx);
+          }
+        }
+      }
+    }
+  }
+
   void RoundOffGridDimensions(const std::array<real_t, 6>& grid_dimensions) {
     // Check if conversion can be done without losing information
     assert(floor(grid_dimensions_[0]) >= std::numeric_limits<int32_t>::min());
@@ -737,6 +1093,14 @@ class UniformGridEnvironment : public Environment {
   ///
   void GetMooreBoxes(FixedSizeVector<const Box*, 27>* neighbor_boxes,
                      size_t box_idx) const {
+    if (periodic_) {
+      FixedSizeVector<uint64_t, 27> box_indices;
+      GetPeriodicMooreBoxIndices(&box_indices, box_idx);
+      for (auto idx : box_indices) {
+        neighbor_boxes->push_back(GetBoxPointer(idx));
+      }
+      return;
+    }
     neighbor_boxes->push_back(GetBoxPointer(box_idx));
 
     // Adjacent 6 (top, down, left, right, front and back)
@@ -802,6 +1166,10 @@ class UniformGridEnvironment : public Environment {
   ///
   void GetMooreBoxIndices(FixedSizeVector<uint64_t, 27>* box_indices,
                           size_t box_idx) const {
+    if (periodic_) {
+      GetPeriodicMooreBoxIndices(box_indices, box_idx);
+      return;
+    }
     box_indices->push_back(box_idx);
 
     // Adjacent 6 (top, down, left, right, front and back)
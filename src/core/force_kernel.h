@@ -0,0 +1,214 @@
+// -----------------------------------------------------------------------------
+//
+// Copyright (C) 2021 CERN & University of Surrey for the benefit of the
+// BioDynaMo collaboration. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+//
+// See the LICENSE file distributed with this work for details.
+// See the NOTICE file distributed with this work for additional information
+// regarding copyright ownership.
+//
+// -----------------------------------------------------------------------------
+
+#ifndef CORE_FORCE_KERNEL_H_
+#define CORE_FORCE_KERNEL_H_
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+#include "core/agent/agent.h"
+#include "core/container/math_array.h"
+#include "core/interaction_force.h"
+#include "core/param/param.h"
+#include "core/shape.h"
+#include "core/simulation.h"
+#include "core/util/minimum_image.h"
+#include "core/util/random.h"
+
+namespace bdm {
+
+/// Parameters of the default force between two spheres
+struct ForceKernelParam {
+  /// Inter object force coefficient. Spheres interact if they are closer than
+  /// the sum of their radii plus `2 * 10 * iof_coefficient`.
+  real_t iof_coefficient = 0.15;
+  /// Attraction coefficient (gamma)
+  real_t attraction_coeff = 1;
+  /// Repulsion coefficient (k)
+  real_t repulsion_coeff = 2;
+};
+
+/// Force between an agent with shape `TShapeLhs` and an agent with shape
+/// `TShapeRhs`. Specializations define the parameter struct `Param` and a
+/// static `Calculate` function. Only the sphere-sphere kernel is defined.
+/// Forces that involve cylinders are calculated by `InteractionForce`.
+template <Shape TShapeLhs, Shape TShapeRhs>
+struct ForceKernel;
+
+template <>
+struct ForceKernel<Shape::kSphere, Shape::kSphere> {
+  using Param = ForceKernelParam;
+
+  /// Returns the force on sphere 1 divided by the distance between the two
+  /// centers. The force itself is `result * (c1 - c2)`.
+  /// The function does not branch, such that it can be vectorized inside a
+  /// loop over many neighbors. `center_distance` must not be zero.
+  static inline real_t Calculate(const Param& param, real_t diameter1,
+                                 real_t diameter2, real_t center_distance) {
+    // We take virtual bigger radii to have a distant interaction, to get a
+    // desired density.
+    real_t additional_radius = 10 * param.iof_coefficient;
+    real_t r1 = real_t(0.5) * diameter1 + additional_radius;
+    real_t r2 = real_t(0.5) * diameter2 + additional_radius;
+    // the overlap distance (how much one penetrates in the other)
+    // if no overlap : no force
+    real_t delta = std::max(r1 + r2 - center_distance, real_t(0));
+    real_t r = (r1 * r2) / (r1 + r2);
+    real_t f = param.repulsion_coeff * delta -
+               param.attraction_coeff * std::sqrt(r * delta);
+    return f / center_distance;
+  }
+
+  /// Returns the derivative of the force magnitude with respect to the
+  /// overlap of the two spheres. Negative values are clamped to zero.
+  /// Used by implicit integrators (see `ImplicitMechanicalForcesOp`).
+  static inline real_t Stiffness(const Param& param, real_t diameter1,
+                                 real_t diameter2, real_t center_distance) {
+    real_t additional_radius = 10 * param.iof_coefficient;
+    real_t r1 = real_t(0.5) * diameter1 + additional_radius;
+    real_t r2 = real_t(0.5) * diameter2 + additional_radius;
+    real_t delta = r1 + r2 - center_distance;
+    if (delta <= 0) {
+      return 0;
+    }
+    real_t r = (r1 * r2) / (r1 + r2);
+    real_t stiffness =
+        param.repulsion_coeff -
+        real_t(0.5) * param.attraction_coeff * std::sqrt(r / delta);
+    return std::max(stiffness, real_t(0));
+  }
+};
+
+/// Interaction force whose sphere-sphere interactions are calculated by
+/// `TKernel`. All other shape combinations are forwarded to
+/// `InteractionForce`.
+/// Since the kernel is a template parameter, it is inlined into the loop over
+/// all neighbors of a sphere (see `CalculateSphereBlock`). Custom forces are
+/// plugged in by passing a different kernel (or different parameters) and
+/// registering the force with `MechanicalForcesOp::SetInteractionForce`.
+template <typename TKernel = ForceKernel<Shape::kSphere, Shape::kSphere>>
+class KernelInteractionForce : public InteractionForce {
+ public:
+  using Param = typename TKernel::Param;
+
+  explicit KernelInteractionForce(const Param& param = Param())
+      : param_(param) {}
+  ~KernelInteractionForce() override = default;
+
+  const Param& GetParam() const { return param_; }
+  void SetParam(const Param& param) { param_ = param; }
+
+  Real4 Calculate(const Agent* lhs, const Agent* rhs) const override {
+    if (lhs->GetShape() != Shape::kSphere ||
+        rhs->GetShape() != Shape::kSphere) {
+      return InteractionForce::Calculate(lhs, rhs);
+    }
+    // the 3 components of the vector c2 -> c1
+    // (from the nearest periodic image of c2 if the space is a torus)
+    auto c2_c1 = GetMinimumImageDisplacement(
+        rhs->GetPosition(), lhs->GetPosition(), this->bound_space_,
+        this->min_bound_, this->max_bound_);
+    real_t center_distance = c2_c1.Norm();
+    // to avoid a division by 0 if the centers are (almost) at the same
+    // location
+    if (center_distance < kMinDistance) {
+      auto* random = Simulation::GetActive()->GetRandom();
+      auto force2on1 = random->template UniformArray<3>(-3.0, 3.0);
+      return {force2on1[0], force2on1[1], force2on1[2], 0};
+    }
+    real_t module = TKernel::Calculate(param_, lhs->GetDiameter(),
+                                       rhs->GetDiameter(), center_distance);
+    return {module * c2_c1[0], module * c2_c1[1], module * c2_c1[2], 0};
+  }
+
+  Real3 CalculateSphereBlock(const Agent* sphere,
+                             const SphereNeighborBlock& block,
+                             uint64_t* num_non_zero) const override {
+    // the 3 components of the vector c2 -> c1 are wrapped to the nearest
+    // periodic image if the space is a torus
+    const bool periodic =
+        this->bound_space_ == bdm::Param::BoundSpaceMode::kTorus;
+    const real_t length = periodic ? this->max_bound_ - this->min_bound_ : 0;
+    const real_t inv_length = periodic ? 1 / length : 0;
+
+    const Real3& c1 = sphere->GetPosition();
+    const real_t d1 = sphere->GetDiameter();
+    const real_t* x = block.x_.data();
+    const real_t* y = block.y_.data();
+    const real_t* z = block.z_.data();
+    const real_t* d2 = block.diameter_.data();
+    const uint64_t size = block.size();
+
+    real_t fx = 0;
+    real_t fy = 0;
+    real_t fz = 0;
+    uint64_t non_zero = 0;
+    uint64_t coincident = 0;
+#pragma omp simd reduction(+ : fx, fy, fz, non_zero, coincident)
+    for (uint64_t i = 0; i < size; ++i) {
+      real_t dx = c1[0] - x[i];
+      real_t dy = c1[1] - y[i];
+      real_t dz = c1[2] - z[i];
+      dx -= length * std::round(dx * inv_length);
+      dy -= length * std::round(dy * inv_length);
+      dz -= length * std::round(dz * inv_length);
+      real_t distance = std::sqrt(dx * dx + dy * dy + dz * dz);
+      // centers at (almost) the same location are handled below to avoid a
+      // division by zero
+      bool is_coincident = distance < kMinDistance;
+      real_t module = TKernel::Calculate(param_, d1, d2[i],
+                                         is_coincident ? 1 : distance);
+      module = is_coincident ? 0 : module;
+      fx += module * dx;
+      fy += module * dy;
+      fz += module * dz;
+      non_zero += module != 0;
+      coincident += is_coincident;
+    }
+
+    Real3 force = {fx, fy, fz};
+    if (coincident != 0) {
+      // spheres with coincident centers always overlap
+      auto* random = Simulation::GetActive()->GetRandom();
+      for (uint64_t i = 0; i < size; ++i) {
+        auto diff = GetMinimumImageDisplacement({x[i], y[i], z[i]}, c1,
+                                                this->bound_space_,
+                                                this->min_bound_,
+                                                this->max_bound_);
+        if (diff.Norm() < kMinDistance) {
+          force += random->template UniformArray<3>(-3.0, 3.0);
+          non_zero++;
+        }
+      }
+    }
+    *num_non_zero += non_zero;
+    return force;
+  }
+
+  InteractionForce* NewCopy() const override {
+    return new KernelInteractionForce(*this);
+  }
+
+ private:
+  /// Centers closer than this are considered to be at the same location
+  static constexpr real_t kMinDistance = 0.00000001;
+
+  Param param_;
+};
+
+}  // namespace bdm
+
+#endif  // CORE_FORCE_KERNEL_H_
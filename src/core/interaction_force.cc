@@ -18,10 +18,12 @@
 #include <cmath>
 
 #include "core/agent/agent.h"
+#include "core/force_kernel.h"
 #include "core/shape.h"
 #include "core/simulation.h"
 #include "core/util/log.h"
 #include "core/util/math.h"
+#include "core/util/minimum_image.h"
 #include "core/util/random.h"
 #include "core/util/type.h"
 #include "neuroscience/neurite_element.h"
@@ -30,6 +32,45 @@ namespace bdm {
 
 using neuroscience::NeuriteElement;
 
+void SphereNeighborBlock::Add(const Agent* agent) {
+  const auto& position = agent->GetPosition();
+  agents_.push_back(agent);
+  x_.push_back(position[0]);
+  y_.push_back(position[1]);
+  z_.push_back(position[2]);
+  diameter_.push_back(agent->GetDiameter());
+}
+
+InteractionForce::InteractionForce() {
+  if (Simulation::GetActive() != nullptr) {
+    Update();
+  }
+}
+
+void InteractionForce::Update() {
+  auto* param = Simulation::GetActive()->GetParam();
+  bound_space_ = param->bound_space;
+  min_bound_ = param->min_bound;
+  max_bound_ = param->max_bound;
+}
+
+Real3 InteractionForce::CalculateSphereBlock(const Agent* sphere,
+                                             const SphereNeighborBlock& block,
+                                             uint64_t* num_non_zero) const {
+  Real3 result = {0, 0, 0};
+  for (auto* neighbor : block.agents_) {
+    auto neighbor_force = Calculate(sphere, neighbor);
+    if (neighbor_force[0] != 0 || neighbor_force[1] != 0 ||
+        neighbor_force[2] != 0) {
+      (*num_non_zero)++;
+      result[0] += neighbor_force[0];
+      result[1] += neighbor_force[1];
+      result[2] += neighbor_force[2];
+    }
+  }
+  return result;
+}
+
 Real4 InteractionForce::Calculate(const Agent* lhs, const Agent* rhs) const {
   if (lhs->GetShape() == Shape::kSphere && rhs->GetShape() == Shape::kSphere) {
     Real3 result;
@@ -60,36 +101,12 @@ Real4 InteractionForce::Calculate(const Agent* lhs, const Agent* rhs) const {
 void InteractionForce::ForceBetweenSpheres(const Agent* sphere_lhs,
                                            const Agent* sphere_rhs,
                                            Real3* result) const {
-  const Real3& ref_mass_location = sphere_lhs->GetPosition();
-  real_t ref_diameter = sphere_lhs->GetDiameter();
-  real_t ref_iof_coefficient = 0.15;
-  const Real3& nb_mass_location = sphere_rhs->GetPosition();
-  real_t nb_diameter = sphere_rhs->GetDiameter();
-  real_t nb_iof_coefficient = 0.15;
-
-  auto c1 = ref_mass_location;
-  real_t r1 = 0.5 * ref_diameter;
-  auto c2 = nb_mass_location;
-  real_t r2 = 0.5 * nb_diameter;
-  // We take virtual bigger radii to have a distant interaction, to get a
-  // desired density.
-  real_t additional_radius =
-      10.0 * std::min(ref_iof_coefficient, nb_iof_coefficient);
-  r1 += additional_radius;
-  r2 += additional_radius;
   // the 3 components of the vector c2 -> c1
-  real_t comp1 = c1[0] - c2[0];
-  real_t comp2 = c1[1] - c2[1];
-  real_t comp3 = c1[2] - c2[2];
-  real_t center_distance =
-      std::sqrt(comp1 * comp1 + comp2 * comp2 + comp3 * comp3);
-  // the overlap distance (how much one penetrates in the other)
-  real_t delta = r1 + r2 - center_distance;
-  // if no overlap : no force
-  if (delta < 0) {
-    *result = {0.0, 0.0, 0.0};
-    return;
-  }
+  // (to the nearest periodic image of c2 if the space is a torus)
+  auto c2_c1 = GetMinimumImageDisplacement(
+      sphere_rhs->GetPosition(), sphere_lhs->GetPosition(), bound_space_,
+      min_bound_, max_bound_);
+  real_t center_distance = c2_c1.Norm();
   // to avoid a division by 0 if the centers are (almost) at the same
   //  location
   if (center_distance < 0.00000001) {
@@ -99,15 +116,10 @@ void InteractionForce::ForceBetweenSpheres(const Agent* sphere_lhs,
     return;
   }
   // the force itself
-  real_t r = (r1 * r2) / (r1 + r2);
-  real_t gamma = 1;  // attraction coeff
-  real_t k = 2;      // repulsion coeff
-  real_t f = k * delta - gamma * std::sqrt(r * delta);
-
-  real_t force_module = f / center_distance;
-  Real3 force2on1(
-      {force_module * comp1, force_module * comp2, force_module * comp3});
-  *result = force2on1;
+  real_t force_module = ForceKernel<Shape::kSphere, Shape::kSphere>::Calculate(
+      ForceKernelParam(), sphere_lhs->GetDiameter(), sphere_rhs->GetDiameter(),
+      center_distance);
+  *result = c2_c1 * force_module;
 }
 
 void InteractionForce::ForceOnACylinderFromASphere(const Agent* cylinder,
@@ -122,6 +134,12 @@ void InteractionForce::ForceOnACylinderFromASphere(const Agent* cylinder,
   real_t d = ne->GetDiameter();
   auto c = sphere->GetPosition();
   real_t r = 0.5 * sphere->GetDiameter();
+  if (bound_space_ == Param::BoundSpaceMode::kTorus) {
+    // use the periodic image of the sphere closest to the cylinder
+    c = proximal_end + GetMinimumImageDisplacement(
+                           proximal_end, c, bound_space_, min_bound_,
+                           max_bound_);
+  }
 
   // I. If the cylinder is small with respect to the sphere:
   // we only consider the interaction between the sphere and the point mass
@@ -221,6 +239,13 @@ void InteractionForce::ForceBetweenCylinders(const Agent* cylinder1,
   auto c = c2->ProximalEnd();
   auto d = c2->GetMassLocation();
   real_t d2 = c2->GetDiameter();
+  if (bound_space_ == Param::BoundSpaceMode::kTorus) {
+    // use the periodic image of cylinder2 closest to cylinder1
+    Real3 shift = a - c + GetMinimumImageDisplacement(a, c, bound_space_,
+                                                      min_bound_, max_bound_);
+    c += shift;
+    d += shift;
+  }
 
   real_t k = 0.5;  // part devoted to the distal node
 
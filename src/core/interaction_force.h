@@ -16,23 +16,72 @@
 #define CORE_INTERACTION_FORCE_H_
 
 #include <array>
+#include <cstdint>
+#include <vector>
 
 #include "core/container/math_array.h"
+#include "core/param/param.h"
 
 namespace bdm {
 
 class Agent;
 
+/// Sphere-shaped neighbors of an agent stored as structure of arrays, such
+/// that the forces of all of them can be calculated in one vectorized loop.
+struct SphereNeighborBlock {
+  std::vector<const Agent*> agents_;
+  std::vector<real_t> x_;
+  std::vector<real_t> y_;
+  std::vector<real_t> z_;
+  std::vector<real_t> diameter_;
+
+  uint64_t size() const { return agents_.size(); }
+
+  void clear() {
+    agents_.clear();
+    x_.clear();
+    y_.clear();
+    z_.clear();
+    diameter_.clear();
+  }
+
+  void Add(const Agent* agent);
+};
+
 class InteractionForce {
  public:
-  InteractionForce() = default;
+  /// Caches the bound space parameters of the active simulation, if there is
+  /// one (see `Update`)
+  InteractionForce();
   virtual ~InteractionForce() = default;
 
   virtual Real4 Calculate(const Agent* lhs, const Agent* rhs) const;
+
+  /// Returns the sum of the forces of all spheres in `block` on `sphere` and
+  /// increments `num_non_zero` for each neighbor whose force is not zero.
+  /// The default implementation calls `Calculate` for each neighbor.
+  /// `KernelInteractionForce` replaces it with an inlined loop.
+  virtual Real3 CalculateSphereBlock(const Agent* sphere,
+                                     const SphereNeighborBlock& block,
+                                     uint64_t* num_non_zero) const;
+
+  /// Is called once per iteration before the forces are calculated
+  /// (see `MechanicalForcesOp::SetUp`). Not thread-safe.
+  /// Caches the bound space parameters, such that they are not looked up
+  /// for each pair of agents. Derived classes that override this function
+  /// must call it.
+  virtual void Update();
+
   virtual InteractionForce* NewCopy() const {
     return new InteractionForce(*this);
   }
 
+ protected:
+  /// Bound space mode and bounds of the simulation space (see `Update`)
+  Param::BoundSpaceMode bound_space_ = Param::BoundSpaceMode::kOpen;
+  real_t min_bound_ = 0;
+  real_t max_bound_ = 0;
+
  private:
   void ForceBetweenSpheres(const Agent* sphere_lhs, const Agent* sphere_rhs,
                            Real3* result) const;
@@ -13,6 +13,7 @@
 // -----------------------------------------------------------------------------
 
 #include "core/model_initializer.h"
+#include "core/diffusion/adi_grid.h"
 #include "core/diffusion/diffusion_grid.h"
 #include "core/diffusion/euler_depletion_grid.h"
 #include "core/diffusion/euler_grid.h"
@@ -70,6 +71,14 @@ void ModelInitializer::DefineSubstance(
     }
     dgrid = new RungeKuttaGrid(substance_id, substance_name, diffusion_coeff,
                                resolution);
+  } else if (param->diffusion_method == "adi") {
+    if (!binding_substances.empty()) {
+      Log::Warning("ModelInitializer::DefineSubstance",
+                   "ADIGrid does not support depletion. Depleting "
+                   "substances removed.");
+    }
+    dgrid = new ADIGrid(substance_id, substance_name, diffusion_coeff,
+                        decay_constant, resolution);
   } else {
     Log::Error("ModelInitializer::DefineSubstance", "Diffusion method '",
                param->diffusion_method,
@@ -27,6 +27,7 @@
 #include "core/simulation.h"
 #include "core/util/random.h"
 
+class ADIGrid;
 class EulerGrid;
 class RungeKuttaGrid;
 class EulerDepletionGrid;
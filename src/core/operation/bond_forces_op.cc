@@ -0,0 +1,117 @@
+// -----------------------------------------------------------------------------
+//
+// Copyright (C) 2021 CERN & University of Surrey for the benefit of the
+// BioDynaMo collaboration. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+//
+// See the LICENSE file distributed with this work for details.
+// See the NOTICE file distributed with this work for additional information
+// regarding copyright ownership.
+//
+// -----------------------------------------------------------------------------
+
+#include "core/operation/bond_forces_op.h"
+
+#include <omp.h>
+#include <cmath>
+
+#include "core/agent/agent.h"
+#include "core/agent/cell.h"
+#include "core/bond_store.h"
+#include "core/functor.h"
+#include "core/operation/bound_space_op.h"
+#include "core/param/param.h"
+#include "core/resource_manager.h"
+#include "core/simulation.h"
+#include "core/util/thread_info.h"
+
+namespace bdm {
+
+// -----------------------------------------------------------------------------
+void BondForcesOp::operator()() {
+  auto* sim = Simulation::GetActive();
+  auto* param = sim->GetParam();
+  auto* rm = sim->GetResourceManager();
+  auto* store = sim->GetBondStore();
+
+  const real_t delta_time = time_step_.Update();
+  store->Commit();
+  if (store->GetNumBonds() == 0) {
+    return;
+  }
+
+  auto* tinfo = ThreadInfo::GetInstance();
+  flat_idx_map_.Update();
+  const int64_t num_agents = rm->GetNumAgents();
+  force_.resize(num_agents);
+#pragma omp parallel for schedule(static)
+  for (int64_t i = 0; i < num_agents; ++i) {
+    force_[i] = {0, 0, 0};
+  }
+  broken_.resize(tinfo->GetMaxThreads());
+
+  // Calculate the forces of all bonds
+  for (BondStore::BondTypeId t = 0; t < store->GetNumBondTypes(); ++t) {
+    const auto& type = store->GetBondType(t);
+    const auto& bonds = store->GetBonds(t);
+    const int64_t num_bonds = bonds.size();
+    for (auto& broken : broken_) {
+      broken.clear();
+    }
+#pragma omp parallel for schedule(static)
+    for (int64_t i = 0; i < num_bonds; ++i) {
+      auto* first = rm->GetAgent(bonds.first[i]);
+      auto* second = rm->GetAgent(bonds.second[i]);
+      auto direction = GetMinimumImageDisplacement(
+          first->GetPosition(), second->GetPosition(), param->bound_space,
+          param->min_bound, param->max_bound);
+      auto length = direction.Norm();
+      if (length > type.breaking_length) {
+        broken_[omp_get_thread_num()].push_back(i);
+        continue;
+      }
+      if (length == 0) {
+        continue;
+      }
+      // pulls the agents together if the bond is stretched
+      auto force =
+          direction * (type.stiffness * (length - bonds.rest_length[i]) /
+                       length);
+      auto& first_force = force_[GetIndex(bonds.first[i])];
+      auto& second_force = force_[GetIndex(bonds.second[i])];
+      for (int d = 0; d < 3; ++d) {
+#pragma omp atomic
+        first_force[d] += force[d];
+#pragma omp atomic
+        second_force[d] -= force[d];
+      }
+    }
+    store->BreakBonds(t, broken_);
+  }
+
+  // Move the agents
+  auto move = L2F([&](Agent* agent, AgentHandle ah) {
+    const auto& force = force_[GetIndex(ah)];
+    if (force[0] == 0 && force[1] == 0 && force[2] == 0) {
+      return;
+    }
+    auto* cell = dynamic_cast<Cell*>(agent);
+    real_t mass = cell != nullptr ? cell->GetMass() : 1;
+    Real3 displacement = force * (delta_time / mass);
+    // avoid huge jumps in the simulation
+    if (displacement.Norm() > param->simulation_max_displacement) {
+      displacement.Normalize();
+      displacement *= param->simulation_max_displacement;
+    }
+    agent->ApplyDisplacement(displacement);
+    if (param->bound_space) {
+      ApplyBoundingBox(agent, param->bound_space, param->min_bound,
+                       param->max_bound);
+    }
+  });
+  rm->ForEachAgentParallel(param->scheduling_batch_size, move);
+}
+
+}  // namespace bdm
@@ -0,0 +1,69 @@
+// -----------------------------------------------------------------------------
+//
+// Copyright (C) 2021 CERN & University of Surrey for the benefit of the
+// BioDynaMo collaboration. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+//
+// See the LICENSE file distributed with this work for details.
+// See the NOTICE file distributed with this work for additional information
+// regarding copyright ownership.
+//
+// -----------------------------------------------------------------------------
+
+#ifndef CORE_OPERATION_BOND_FORCES_OP_H_
+#define CORE_OPERATION_BOND_FORCES_OP_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "core/agent/agent_handle.h"
+#include "core/container/agent_flat_idx_map.h"
+#include "core/container/math_array.h"
+#include "core/operation/mechanical_forces_op.h"
+#include "core/operation/operation.h"
+#include "core/operation/operation_registry.h"
+
+namespace bdm {
+
+/// Moves agents according to the spring forces of their bonds
+/// (see `BondStore`).
+///
+/// The operation commits all pending bond requests, then calculates the
+/// force of each bond in a parallel pass over the edge lists:
+///
+///     force = stiffness * (length - rest_length) * direction
+///
+/// Bonds that are stretched beyond the breaking length of their type are
+/// broken instead. Afterwards, each agent is moved by `dt * force / mass`
+/// (with mass 1 for agents that are not cells), limited to
+/// `Param::simulation_max_displacement`.
+///
+/// The operation is registered as "bond forces" and is not scheduled by
+/// default:
+///
+///     scheduler->ScheduleOp(NewOperation("bond forces"));
+class BondForcesOp : public StandaloneOperationImpl {
+  BDM_OP_HEADER(BondForcesOp);
+
+ public:
+  void operator()() override;
+
+ private:
+  OperationTimeStep time_step_;
+
+  /// Maps the agents to their index in `force_`
+  AgentFlatIdxMap flat_idx_map_;
+  std::vector<Real3> force_;
+  /// Indices of the bonds that broke in this iteration for each thread
+  std::vector<std::vector<uint64_t>> broken_;
+
+  uint64_t GetIndex(AgentHandle ah) const {
+    return flat_idx_map_.GetFlatIdx(ah);
+  }
+};
+
+}  // namespace bdm
+
+#endif  // CORE_OPERATION_BOND_FORCES_OP_H_
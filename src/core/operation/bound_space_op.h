@@ -15,11 +15,14 @@
 #ifndef CORE_OPERATION_BOUND_SPACE_OP_H_
 #define CORE_OPERATION_BOUND_SPACE_OP_H_
 
+#include <cmath>
+
 #include "core/agent/agent.h"
 #include "core/operation/operation.h"
 #include "core/operation/operation_registry.h"
 #include "core/param/param.h"
 #include "core/simulation.h"
+#include "core/util/minimum_image.h"
 
 namespace bdm {
 
@@ -43,6 +43,11 @@ class ContinuumOp : public StandaloneOperationImpl {
     const auto* env = sim->GetEnvironment();
     const auto* param = sim->GetParam();
 
+    // Apply the concentration changes of the agents in this iteration (see
+    // `Param::deferred_concentration_changes`)
+    rm->ForEachDiffusionGrid(
+        [](DiffusionGrid* dgrid) { dgrid->ApplyDeferredChanges(); });
+
     // Compute the passed time to update the diffusion grid accordingly.
     real_t current_time = sim->GetScheduler()->GetSimulatedTime();
     delta_t_ = current_time - last_time_run_;
@@ -56,13 +61,20 @@ class ContinuumOp : public StandaloneOperationImpl {
     rm->ForEachContinuum([this, &env, &param](Continuum* cm) {
       // Update the diffusion grid dimension if the environment dimensions
       // have changed. If the space is bound, we do not need to update the
-      // dimensions, because these should not be changing anyway
-      if (env->HasGrown() &&
-          param->bound_space == Param::BoundSpaceMode::kOpen) {
+      // dimensions of cubic grids, because these should not be changing
+      // anyway
+      auto* dgrid = dynamic_cast<DiffusionGrid*>(cm);
+      if (param->non_cubic_diffusion_grid) {
+        // A single axis can grow without changing the dimension thresholds of
+        // the environment (e.g. the short axis of a flat grid)
+        if (env->HasGrown() || (dgrid && !dgrid->CoversDomain())) {
+          cm->Update();
+        }
+      } else if (env->HasGrown() &&
+                 param->bound_space == Param::BoundSpaceMode::kOpen) {
         cm->Update();
       }
       cm->IntegrateTimeAsynchronously(delta_t_);
-      auto* dgrid = dynamic_cast<DiffusionGrid*>(cm);
       if (dgrid && param->calculate_gradients) {
         dgrid->CalculateGradient();
       }
@@ -13,18 +13,25 @@
 // -----------------------------------------------------------------------------
 
 #include "core/analysis/time_series.h"
+#include "core/environment/uniform_grid_environment.h"
+#include "core/operation/bond_forces_op.h"
 #include "core/operation/bound_space_op.h"
 #include "core/operation/continuum_op.h"
 #include "core/operation/dividing_cell_op.h"
+#include "core/operation/implicit_mechanical_forces_op.h"
 #include "core/operation/load_balancing_op.h"
 #include "core/operation/mechanical_forces_op.h"
 #include "core/operation/mechanical_forces_op_cuda.h"
 #include "core/operation/mechanical_forces_op_opencl.h"
 #include "core/operation/operation.h"
+#include "core/operation/sphere_mechanical_forces_op.h"
+#include "core/operation/two_phase_mechanical_forces_op.h"
 #include "core/operation/visualization_op.h"
 
 namespace bdm {
 
+BDM_REGISTER_OP(BondForcesOp, "bond forces", kCpu);
+
 BDM_REGISTER_OP(BoundSpace, "bound space", kCpu);
 
 BDM_REGISTER_OP(ContinuumOp, "continuum", kCpu);
@@ -39,6 +46,14 @@ BDM_REGISTER_OP(MechanicalForcesOp, "mechanical forces", kCpu);
 BDM_REGISTER_OP(MechanicalForcesOpCuda, "mechanical forces", kCuda);
 #endif
 
+BDM_REGISTER_OP(ImplicitMechanicalForcesOp, "implicit mechanical forces",
+                kCpu);
+
+BDM_REGISTER_OP(SphereMechanicalForcesOp, "sphere mechanical forces", kCpu);
+
+BDM_REGISTER_OP(TwoPhaseMechanicalForcesOp, "two phase mechanical forces",
+                kCpu);
+
 BDM_REGISTER_OP(DividingCellOp, "DividingCellOp", kCpu);
 
 #if defined(USE_OPENCL) && !defined(__ROOTCLING__)
@@ -48,7 +63,15 @@ BDM_REGISTER_OP(MechanicalForcesOpOpenCL, "mechanical forces", kOpenCl);
 struct UpdateStaticnessOp : public AgentOperationImpl {
   BDM_OP_HEADER(UpdateStaticnessOp);
 
-  void operator()(Agent* agent) override { agent->UpdateStaticness(); }
+  void operator()(Agent* agent) override {
+    // Agents in frozen regions remain static
+    // (see `Param::detect_static_regions`)
+    auto* env = Simulation::GetActive()->GetEnvironment();
+    if (!agent->GetPropagateStaticness() && env->IsInFrozenRegion(*agent)) {
+      return;
+    }
+    agent->UpdateStaticness();
+  }
 };
 
 BDM_REGISTER_OP(UpdateStaticnessOp, "update staticness", kCpu);
@@ -133,6 +156,16 @@ struct PropagateStaticnessOp : public StandaloneOperationImpl {
     if (!Simulation::GetActive()->GetParam()->detect_static_agents) {
       return;
     }
+    // Only agents that moved or changed need to propagate their staticness.
+    // They are contained in the active boxes of the grid.
+    auto* grid = dynamic_cast<UniformGridEnvironment*>(
+        Simulation::GetActive()->GetEnvironment());
+    if (grid != nullptr && grid->HasFrozenRegions()) {
+      auto function =
+          L2F([](Agent* agent) { agent->PropagateStaticness(true); });
+      grid->ForEachAgentInActiveBoxes(function);
+      return;
+    }
     auto function = L2F(
         [](Agent* agent, AgentHandle) { agent->PropagateStaticness(true); });
     auto* rm = Simulation::GetActive()->GetResourceManager();
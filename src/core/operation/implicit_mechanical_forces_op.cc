@@ -0,0 +1,258 @@
+// -----------------------------------------------------------------------------
+//
+// Copyright (C) 2021 CERN & University of Surrey for the benefit of the
+// BioDynaMo collaboration. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+//
+// See the LICENSE file distributed with this work for details.
+// See the NOTICE file distributed with this work for additional information
+// regarding copyright ownership.
+//
+// -----------------------------------------------------------------------------
+
+#include "core/operation/implicit_mechanical_forces_op.h"
+
+#include <cmath>
+
+#include "core/agent/agent.h"
+#include "core/agent/cell.h"
+#include "core/environment/environment.h"
+#include "core/functor.h"
+#include "core/operation/bound_space_op.h"
+#include "core/param/param.h"
+#include "core/resource_manager.h"
+#include "core/shape.h"
+#include "core/simulation.h"
+#include "core/util/random.h"
+
+namespace bdm {
+
+// -----------------------------------------------------------------------------
+/// Returns the dot product of `a` and `b` over all agents.
+static real_t Dot(const std::vector<Real3>& a, const std::vector<Real3>& b) {
+  real_t result = 0;
+  const int64_t size = a.size();
+#pragma omp parallel for reduction(+ : result)
+  for (int64_t i = 0; i < size; ++i) {
+    result += a[i] * b[i];
+  }
+  return result;
+}
+
+// -----------------------------------------------------------------------------
+void ImplicitMechanicalForcesOp::operator()() {
+  auto* sim = Simulation::GetActive();
+  auto* param = sim->GetParam();
+  auto* rm = sim->GetResourceManager();
+  auto* env = sim->GetEnvironment();
+  force_.Update();
+
+  const real_t delta_time = time_step_.Update();
+  flat_idx_map_.Update();
+  auto num_agents = rm->GetNumAgents();
+  agents_.resize(num_agents);
+  contacts_.resize(num_agents);
+  damping_.resize(num_agents);
+  fixed_displacement_.resize(num_agents);
+  rhs_.resize(num_agents);
+  inv_diagonal_.resize(num_agents);
+  displacement_.resize(num_agents);
+  residual_.resize(num_agents);
+  preconditioned_.resize(num_agents);
+  direction_.resize(num_agents);
+  product_.resize(num_agents);
+
+  auto squared_radius = env->GetLargestAgentSizeSquared();
+  Assemble(squared_radius, delta_time);
+  Solve();
+
+  // Move the agents after all displacements have been calculated
+  auto move = L2F([&](Agent* agent, AgentHandle ah) {
+    auto idx = GetIndex(ah);
+    agent->ApplyDisplacement(IsFixed(idx) ? fixed_displacement_[idx]
+                                          : displacement_[idx]);
+    if (param->bound_space) {
+      ApplyBoundingBox(agent, param->bound_space, param->min_bound,
+                       param->max_bound);
+    }
+  });
+  rm->ForEachAgentParallel(1000, move);
+}
+
+// -----------------------------------------------------------------------------
+void ImplicitMechanicalForcesOp::Assemble(real_t squared_radius, real_t dt) {
+  auto* sim = Simulation::GetActive();
+  auto* param = sim->GetParam();
+  auto* rm = sim->GetResourceManager();
+  auto* env = sim->GetEnvironment();
+  using Kernel = ForceKernel<Shape::kSphere, Shape::kSphere>;
+
+  // Contact forces at the current positions and explicit displacements of
+  // agents that are not part of the linear system.
+  auto assemble = L2F([&](Agent* agent, AgentHandle ah) {
+    auto idx = GetIndex(ah);
+    agents_[idx] = agent;
+    auto& contacts = contacts_[idx];
+    contacts.clear();
+    damping_[idx] = 0;
+
+    auto* cell = dynamic_cast<Cell*>(agent);
+    if (cell == nullptr || agent->GetShape() != Shape::kSphere) {
+      fixed_displacement_[idx] =
+          agent->CalculateDisplacement(&force_, squared_radius, dt);
+      return;
+    }
+    fixed_displacement_[idx] = cell->GetTractorForce() * dt;
+    if (cell->IsStatic()) {
+      return;
+    }
+
+    Real3 force = {0, 0, 0};
+    uint64_t non_zero_neighbor_forces = 0;
+    const Real3& position = cell->GetPosition();
+    const real_t diameter = cell->GetDiameter();
+    auto calculate_neighbor_forces = L2F([&](Agent* neighbor,
+                                             real_t squared_distance) {
+      Real3 neighbor_force = {0, 0, 0};
+      if (neighbor->GetShape() != Shape::kSphere) {
+        auto f = force_.Calculate(cell, neighbor);
+        neighbor_force = {f[0], f[1], f[2]};
+      } else {
+        auto c2_c1 = GetMinimumImageDisplacement(
+            neighbor->GetPosition(), position, param->bound_space,
+            param->min_bound, param->max_bound);
+        auto distance = c2_c1.Norm();
+        if (distance < 0.00000001) {
+          // centers at the same location
+          neighbor_force = sim->GetRandom()->UniformArray<3>(-3.0, 3.0);
+        } else {
+          auto nb_diameter = neighbor->GetDiameter();
+          neighbor_force =
+              c2_c1 *
+              Kernel::Calculate(kernel_param_, diameter, nb_diameter, distance);
+          auto stiffness =
+              Kernel::Stiffness(kernel_param_, diameter, nb_diameter, distance);
+          if (stiffness > 0) {
+            auto nb_idx = GetIndex(rm->GetAgentHandle(neighbor->GetUid()));
+            contacts.push_back({nb_idx, c2_c1 / distance, stiffness});
+          }
+        }
+      }
+      if (neighbor_force[0] != 0 || neighbor_force[1] != 0 ||
+          neighbor_force[2] != 0) {
+        non_zero_neighbor_forces++;
+        force += neighbor_force;
+      }
+    });
+    env->ForEachNeighbor(calculate_neighbor_forces, *cell, squared_radius);
+    if (non_zero_neighbor_forces > 1) {
+      cell->SetStaticnessNextTimestep(false);
+    }
+
+    // the force must overcome the adherence of the cell
+    if (force.Norm() <= cell->GetAdherence()) {
+      contacts.clear();
+      return;
+    }
+    damping_[idx] = cell->GetMass() / dt;
+    rhs_[idx] = force + cell->GetTractorForce() * cell->GetMass();
+  });
+  rm->ForEachAgentParallel(1000, assemble);
+
+  // Contacts with agents whose displacement is fixed contribute to the right
+  // hand side. Calculate the Jacobi preconditioner.
+  const int64_t size = agents_.size();
+#pragma omp parallel for
+  for (int64_t i = 0; i < size; ++i) {
+    if (IsFixed(i)) {
+      rhs_[i] = {0, 0, 0};
+      inv_diagonal_[i] = {0, 0, 0};
+      continue;
+    }
+    Real3 diagonal = {damping_[i], damping_[i], damping_[i]};
+    for (auto& c : contacts_[i]) {
+      for (int k = 0; k < 3; ++k) {
+        diagonal[k] += c.stiffness * c.normal[k] * c.normal[k];
+      }
+      if (IsFixed(c.neighbor)) {
+        auto& fixed = fixed_displacement_[c.neighbor];
+        rhs_[i] += c.normal * (c.stiffness * (c.normal * fixed));
+      }
+    }
+    for (int k = 0; k < 3; ++k) {
+      inv_diagonal_[i][k] = 1 / diagonal[k];
+    }
+  }
+}
+
+// -----------------------------------------------------------------------------
+void ImplicitMechanicalForcesOp::Multiply(const std::vector<Real3>& x,
+                                          std::vector<Real3>* result) const {
+  const int64_t size = x.size();
+#pragma omp parallel for
+  for (int64_t i = 0; i < size; ++i) {
+    if (IsFixed(i)) {
+      (*result)[i] = {0, 0, 0};
+      continue;
+    }
+    Real3 sum = x[i] * damping_[i];
+    for (auto& c : contacts_[i]) {
+      // x is zero for fixed agents
+      sum += c.normal * (c.stiffness * (c.normal * (x[i] - x[c.neighbor])));
+    }
+    (*result)[i] = sum;
+  }
+}
+
+// -----------------------------------------------------------------------------
+void ImplicitMechanicalForcesOp::Solve() {
+  const int64_t size = agents_.size();
+  num_iterations_ = 0;
+
+  // Start with the explicit displacement (x0 = b * dt / mass)
+#pragma omp parallel for
+  for (int64_t i = 0; i < size; ++i) {
+    displacement_[i] = {0, 0, 0};
+    if (!IsFixed(i)) {
+      displacement_[i] = rhs_[i] / damping_[i];
+    }
+  }
+  Multiply(displacement_, &product_);
+#pragma omp parallel for
+  for (int64_t i = 0; i < size; ++i) {
+    residual_[i] = rhs_[i] - product_[i];
+    for (int k = 0; k < 3; ++k) {
+      preconditioned_[i][k] = residual_[i][k] * inv_diagonal_[i][k];
+    }
+    direction_[i] = preconditioned_[i];
+  }
+
+  real_t rhs_norm = std::sqrt(Dot(rhs_, rhs_));
+  real_t threshold = tolerance_ * tolerance_ * rhs_norm * rhs_norm;
+  real_t rz = Dot(residual_, preconditioned_);
+  while (num_iterations_ < max_iterations_ &&
+         Dot(residual_, residual_) > threshold) {
+    Multiply(direction_, &product_);
+    real_t alpha = rz / Dot(direction_, product_);
+#pragma omp parallel for
+    for (int64_t i = 0; i < size; ++i) {
+      displacement_[i] += direction_[i] * alpha;
+      residual_[i] -= product_[i] * alpha;
+      for (int k = 0; k < 3; ++k) {
+        preconditioned_[i][k] = residual_[i][k] * inv_diagonal_[i][k];
+      }
+    }
+    real_t rz_new = Dot(residual_, preconditioned_);
+    real_t beta = rz_new / rz;
+    rz = rz_new;
+#pragma omp parallel for
+    for (int64_t i = 0; i < size; ++i) {
+      direction_[i] = preconditioned_[i] + direction_[i] * beta;
+    }
+    num_iterations_++;
+  }
+}
+
+}  // namespace bdm
@@ -0,0 +1,144 @@
+// -----------------------------------------------------------------------------
+//
+// Copyright (C) 2021 CERN & University of Surrey for the benefit of the
+// BioDynaMo collaboration. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+//
+// See the LICENSE file distributed with this work for details.
+// See the NOTICE file distributed with this work for additional information
+// regarding copyright ownership.
+//
+// -----------------------------------------------------------------------------
+
+#ifndef CORE_OPERATION_IMPLICIT_MECHANICAL_FORCES_OP_H_
+#define CORE_OPERATION_IMPLICIT_MECHANICAL_FORCES_OP_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "core/agent/agent_handle.h"
+#include "core/container/agent_flat_idx_map.h"
+#include "core/container/math_array.h"
+#include "core/force_kernel.h"
+#include "core/interaction_force.h"
+#include "core/operation/mechanical_forces_op.h"
+#include "core/operation/operation.h"
+#include "core/operation/operation_registry.h"
+
+namespace bdm {
+
+class Agent;
+
+/// Mechanical forces with implicit (backward Euler) integration of the
+/// overdamped equations of motion.
+///
+/// `MechanicalForcesOp` moves each cell by `dt / mass * force`, evaluated at
+/// the current positions, and clamps the displacement to
+/// `Param::simulation_max_displacement`. This becomes unstable for stiff,
+/// densely packed tissues unless the time step is small. This operation
+/// instead solves
+///
+///     (mass_i / dt) * d_i + sum_j K_ij * (d_i - d_j) = F_i + mass_i * t_i
+///
+/// for the displacements `d` of all cells, where `F_i` is the contact force
+/// at the current positions, `t_i` the tractor force and
+/// `K_ij = s_ij * n_ij * n_ij^T` the linearized contact stiffness along the
+/// contact normal. The system is symmetric positive definite. It is
+/// assembled in parallel from the neighbor lists of the environment and
+/// solved matrix-free with the conjugate gradient method and a Jacobi
+/// preconditioner. Displacements are not clamped.
+///
+/// Sphere-sphere contacts are calculated with
+/// `ForceKernel<Shape::kSphere, Shape::kSphere>`. Static cells, cells whose
+/// force does not overcome their adherence, and agents that are not cells
+/// keep their explicit displacement.
+///
+/// The operation is registered as "implicit mechanical forces" and replaces
+/// the default operation:
+///
+///     param->unschedule_default_operations = {"mechanical forces"};
+///     ...
+///     scheduler->ScheduleOp(NewOperation("implicit mechanical forces"));
+class ImplicitMechanicalForcesOp : public StandaloneOperationImpl {
+  BDM_OP_HEADER(ImplicitMechanicalForcesOp);
+
+ public:
+  /// Linearized contact between two spheres
+  struct Contact {
+    /// Index of the neighbor in the linear system
+    uint64_t neighbor;
+    /// Unit vector from the neighbor to the agent
+    Real3 normal;
+    /// Derivative of the contact force w.r.t. the overlap
+    real_t stiffness;
+  };
+
+  ImplicitMechanicalForcesOp() = default;
+  ~ImplicitMechanicalForcesOp() override = default;
+
+  const ForceKernelParam& GetForceKernelParam() const { return kernel_param_; }
+  void SetForceKernelParam(const ForceKernelParam& param) {
+    kernel_param_ = param;
+  }
+
+  uint64_t GetMaxIterations() const { return max_iterations_; }
+  void SetMaxIterations(uint64_t max_iterations) {
+    max_iterations_ = max_iterations;
+  }
+
+  /// Returns the tolerance of the relative residual of the solver
+  real_t GetTolerance() const { return tolerance_; }
+  void SetTolerance(real_t tolerance) { tolerance_ = tolerance; }
+
+  /// Returns the number of solver iterations of the last time step
+  uint64_t GetNumIterations() const { return num_iterations_; }
+
+  void operator()() override;
+
+ private:
+  /// Used for all contacts that do not involve two spheres
+  InteractionForce force_;
+  ForceKernelParam kernel_param_;
+  uint64_t max_iterations_ = 100;
+  real_t tolerance_ = 1e-6;
+  uint64_t num_iterations_ = 0;
+  OperationTimeStep time_step_;
+
+  /// Maps the agents to their index in the linear system
+  AgentFlatIdxMap flat_idx_map_;
+  std::vector<Agent*> agents_;
+  std::vector<std::vector<Contact>> contacts_;
+  /// mass / dt of each agent. Zero if the displacement of the agent is fixed.
+  std::vector<real_t> damping_;
+  /// Displacement of agents that are not part of the linear system
+  std::vector<Real3> fixed_displacement_;
+  std::vector<Real3> rhs_;
+  std::vector<Real3> inv_diagonal_;
+  std::vector<Real3> displacement_;
+  std::vector<Real3> residual_;
+  std::vector<Real3> preconditioned_;
+  std::vector<Real3> direction_;
+  std::vector<Real3> product_;
+
+  uint64_t GetIndex(AgentHandle ah) const {
+    return flat_idx_map_.GetFlatIdx(ah);
+  }
+
+  bool IsFixed(uint64_t idx) const { return damping_[idx] == 0; }
+
+  /// Calculates the contact forces and stiffnesses at the current positions.
+  void Assemble(real_t squared_radius, real_t dt);
+
+  /// result = A * x. Elements of fixed agents are zero.
+  void Multiply(const std::vector<Real3>& x, std::vector<Real3>* result) const;
+
+  /// Solves the linear system with the preconditioned conjugate gradient
+  /// method.
+  void Solve();
+};
+
+}  // namespace bdm
+
+#endif  // CORE_OPERATION_IMPLICIT_MECHANICAL_FORCES_OP_H_
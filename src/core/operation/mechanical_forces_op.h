@@ -22,6 +22,7 @@
 
 #include "core/agent/agent.h"
 #include "core/environment/environment.h"
+#include "core/force_kernel.h"
 #include "core/interaction_force.h"
 #include "core/operation/bound_space_op.h"
 #include "core/operation/operation.h"
@@ -34,12 +35,45 @@
 
 namespace bdm {
 
-/// Defines the 3D physical interactions between physical objects
+/// Time step of an operation that moves agents: the time that passed since
+/// the previous iteration in which the operation was executed. It is
+/// determined in the first call of each iteration and does not change if the
+/// operation is called several times within the iteration.
+class OperationTimeStep {
+ public:
+  /// Returns the time step of the current iteration
+  real_t Update() {
+    auto* sim = Simulation::GetActive();
+    auto current_iteration = sim->GetScheduler()->GetSimulatedSteps();
+    if (last_iteration_ != current_iteration) {
+      last_iteration_ = current_iteration;
+      auto current_time =
+          (current_iteration + 1) * sim->GetParam()->simulation_time_step;
+      delta_time_ = current_time - last_time_run_;
+      last_time_run_ = current_time;
+    }
+    return delta_time_;
+  }
+
+  /// Returns the time step of the last call to `Update`
+  real_t Get() const { return delta_time_; }
+
+ private:
+  real_t last_time_run_ = 0;
+  real_t delta_time_ = 0;
+  uint64_t last_iteration_ = std::numeric_limits<uint64_t>::max();
+};
+
+/// Defines the 3D physical interactions between physical objects.
+/// By default, sphere-sphere forces are calculated by the inlined
+/// `ForceKernel<Shape::kSphere, Shape::kSphere>` (see
+/// `KernelInteractionForce`). A custom force can be set with
+/// `SetInteractionForce`.
 class MechanicalForcesOp : public AgentOperationImpl {
   BDM_OP_HEADER(MechanicalForcesOp);
 
  public:
-  MechanicalForcesOp() : force_(new InteractionForce()) {
+  MechanicalForcesOp() : force_(new KernelInteractionForce<>()) {
     auto* tinfo = ThreadInfo::GetInstance();
     last_iteration_.resize(tinfo->GetMaxThreads(),
                            std::numeric_limits<uint64_t>::max());
@@ -73,6 +107,8 @@ class MechanicalForcesOp : public AgentOperationImpl {
     force_ = force;
   }
 
+  void SetUp() override { force_->Update(); }
+
   void operator()(Agent* agent) override {
     auto* sim = Simulation::GetActive();
     auto* scheduler = sim->GetScheduler();
@@ -93,6 +129,13 @@ class MechanicalForcesOp : public AgentOperationImpl {
       last_time_run_[tid] = current_time;
     }
 
+    // Static agents in frozen regions do not move
+    // (see `Param::detect_static_regions`)
+    if (!agent->GetPropagateStaticness() &&
+        sim->GetEnvironment()->IsInFrozenRegion(*agent)) {
+      return;
+    }
+
     const auto& displacement =
         agent->CalculateDisplacement(force_, squared_radius_, delta_time_[tid]);
     agent->ApplyDisplacement(displacement);
@@ -0,0 +1,253 @@
+// -----------------------------------------------------------------------------
+//
+// Copyright (C) 2021 CERN & University of Surrey for the benefit of the
+// BioDynaMo collaboration. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+//
+// See the LICENSE file distributed with this work for details.
+// See the NOTICE file distributed with this work for additional information
+// regarding copyright ownership.
+//
+// -----------------------------------------------------------------------------
+
+#include "core/operation/sphere_mechanical_forces_op.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+#include "core/agent/cell.h"
+#include "core/execution_context/in_place_exec_ctxt.h"
+#include "core/functor.h"
+#include "core/operation/bound_space_op.h"
+#include "core/operation/mechanical_forces_op.h"
+#include "core/param/param.h"
+#include "core/resource_manager.h"
+#include "core/shape.h"
+#include "core/simulation.h"
+#include "core/util/random.h"
+
+namespace bdm {
+
+// -----------------------------------------------------------------------------
+SphereMechanicalForcesOp::SphereMechanicalForcesOp() = default;
+
+// -----------------------------------------------------------------------------
+SphereMechanicalForcesOp::SphereMechanicalForcesOp(
+    const SphereMechanicalForcesOp& other)
+    : kernel_param_(other.kernel_param_),
+      time_step_(other.time_step_) {
+  if (other.fallback_) {
+    fallback_ = other.fallback_->Clone();
+  }
+}
+
+// -----------------------------------------------------------------------------
+SphereMechanicalForcesOp::~SphereMechanicalForcesOp() { delete fallback_; }
+
+// -----------------------------------------------------------------------------
+void SphereMechanicalForcesOp::SetForceKernelParam(
+    const ForceKernelParam& param) {
+  kernel_param_ = param;
+  if (fallback_) {
+    auto* impl = fallback_->GetImplementation<MechanicalForcesOp>();
+    impl->SetInteractionForce(new KernelInteractionForce<>(param));
+  }
+}
+
+// -----------------------------------------------------------------------------
+Operation* SphereMechanicalForcesOp::GetFallback() {
+  // Created on first use, because the prototype of this operation is
+  // constructed during static initialization.
+  if (fallback_ == nullptr) {
+    fallback_ = NewOperation("mechanical forces");
+    auto* impl = fallback_->GetImplementation<MechanicalForcesOp>();
+    impl->SetInteractionForce(new KernelInteractionForce<>(kernel_param_));
+  }
+  return fallback_;
+}
+
+// -----------------------------------------------------------------------------
+bool SphereMechanicalForcesOp::IsSphereOnly() {
+  std::atomic<bool> sphere_only(true);
+  auto check = L2F([&](Agent* agent) {
+    if (agent->GetShape() != Shape::kSphere ||
+        dynamic_cast<Cell*>(agent) == nullptr) {
+      sphere_only = false;
+    }
+  });
+  Simulation::GetActive()->GetResourceManager()->ForEachAgentParallel(check);
+  return sphere_only;
+}
+
+// -----------------------------------------------------------------------------
+void SphereMechanicalForcesOp::operator()() {
+  auto* sim = Simulation::GetActive();
+  auto* param = sim->GetParam();
+  auto* rm = sim->GetResourceManager();
+  auto* grid = dynamic_cast<UniformGridEnvironment*>(sim->GetEnvironment());
+
+  auto squared_radius =
+      grid != nullptr ? grid->GetLargestAgentSizeSquared() : 0;
+  used_fast_path_ =
+      grid != nullptr &&
+      squared_radius <= grid->GetBoxLength() * grid->GetBoxLength() &&
+      IsSphereOnly();
+  if (!used_fast_path_) {
+    // The scheduler only sets up the scheduled operations. The fallback
+    // must update its interaction force (e.g. cached tables) itself.
+    auto* fallback = GetFallback();
+    fallback->SetUp();
+    auto execute = L2F([&](Agent* agent, AgentHandle ah) {
+      sim->GetExecutionContext()->Execute(agent, ah, {fallback});
+    });
+    rm->ForEachAgentParallel(1000, execute);
+    fallback->TearDown();
+    return;
+  }
+
+  time_step_.Update();
+  flat_idx_map_.Update();
+  displacement_.resize(rm->GetNumAgents());
+
+  // Calculate all displacements
+  const uint64_t num_boxes = grid->GetNumBoxes();
+#pragma omp parallel
+  {
+    UniformGridEnvironment::NeighborBlock block;
+#pragma omp for schedule(dynamic, 64)
+    for (uint64_t i = 0; i < num_boxes; ++i) {
+      grid->GetNeighborBlock(i, &block);
+      if (!block.queries.empty()) {
+        CalculateDisplacements(block, squared_radius, grid->IsBoxFrozen(i));
+      }
+    }
+  }
+
+  // Apply them in a second pass. Static agents in frozen regions do not move
+  // (see `MechanicalForcesOp`).
+  auto is_frozen = [&](Agent* agent) {
+    return !agent->GetPropagateStaticness() && grid->IsInFrozenRegion(*agent);
+  };
+  if (param->bound_space) {
+    const auto bound_space = param->bound_space;
+    const real_t min_bound = param->min_bound;
+    const real_t max_bound = param->max_bound;
+    auto move = L2F([&](Agent* agent, AgentHandle ah) {
+      if (!is_frozen(agent)) {
+        agent->ApplyDisplacement(displacement_[GetIndex(ah)]);
+        ApplyBoundingBox(agent, bound_space, min_bound, max_bound);
+      }
+    });
+    rm->ForEachAgentParallel(1000, move);
+  } else {
+    auto move = L2F([&](Agent* agent, AgentHandle ah) {
+      if (!is_frozen(agent)) {
+        agent->ApplyDisplacement(displacement_[GetIndex(ah)]);
+      }
+    });
+    rm->ForEachAgentParallel(1000, move);
+  }
+}
+
+// -----------------------------------------------------------------------------
+void SphereMechanicalForcesOp::CalculateDisplacements(
+    const UniformGridEnvironment::NeighborBlock& block, real_t squared_radius,
+    bool frozen) {
+  using Kernel = ForceKernel<Shape::kSphere, Shape::kSphere>;
+  constexpr real_t kMinDistance = 0.00000001;
+  auto* sim = Simulation::GetActive();
+  auto* param = sim->GetParam();
+  auto* rm = sim->GetResourceManager();
+  const bool periodic = param->bound_space == Param::BoundSpaceMode::kTorus;
+  const real_t length = periodic ? param->max_bound - param->min_bound : 0;
+  const real_t inv_length = periodic ? 1 / length : 0;
+  const real_t dt = time_step_.Get();
+
+  const uint64_t num_candidates = block.candidates.size();
+  Agent* const* candidates = block.candidates.data();
+  const real_t* cx = block.candidate_x.data();
+  const real_t* cy = block.candidate_y.data();
+  const real_t* cz = block.candidate_z.data();
+  const real_t* cd = block.candidate_diameter.data();
+
+  for (uint64_t q = 0; q < block.queries.size(); ++q) {
+    auto* cell = static_cast<Cell*>(block.queries[q]);
+    if (frozen && !cell->GetPropagateStaticness()) {
+      // not moved in the second pass
+      continue;
+    }
+    auto idx = GetIndex(rm->GetAgentHandle(cell->GetUid()));
+    // BIOLOGY : start with the tractor force
+    Real3 movement = cell->GetTractorForce() * dt;
+    if (cell->IsStatic()) {
+      displacement_[idx] = movement;
+      continue;
+    }
+
+    // PHYSICS : sum of the forces of all neighbors
+    const real_t x = block.query_x[q];
+    const real_t y = block.query_y[q];
+    const real_t z = block.query_z[q];
+    const real_t diameter = cell->GetDiameter();
+    real_t fx = 0;
+    real_t fy = 0;
+    real_t fz = 0;
+    uint64_t non_zero = 0;
+    uint64_t coincident = 0;
+    for (uint64_t c0 = 0; c0 < num_candidates; c0 += kCandidateTile) {
+      const uint64_t cend = std::min(c0 + kCandidateTile, num_candidates);
+#pragma omp simd reduction(+ : fx, fy, fz, non_zero, coincident)
+      for (uint64_t c = c0; c < cend; ++c) {
+        real_t dx = x - cx[c];
+        real_t dy = y - cy[c];
+        real_t dz = z - cz[c];
+        dx -= length * std::round(dx * inv_length);
+        dy -= length * std::round(dy * inv_length);
+        dz -= length * std::round(dz * inv_length);
+        real_t squared_distance = dx * dx + dy * dy + dz * dz;
+        real_t distance = std::sqrt(squared_distance);
+        bool in_range =
+            squared_distance < squared_radius && candidates[c] != cell;
+        bool is_coincident = in_range && distance < kMinDistance;
+        bool valid = in_range && !is_coincident;
+        real_t module =
+            Kernel::Calculate(kernel_param_, diameter, cd[c],
+                              valid ? distance : real_t(1));
+        module = valid ? module : 0;
+        fx += module * dx;
+        fy += module * dy;
+        fz += module * dz;
+        non_zero += module != 0;
+        coincident += is_coincident;
+      }
+    }
+    Real3 force = {fx, fy, fz};
+    // to avoid a division by 0 if the centers are (almost) at the same
+    // location
+    for (uint64_t i = 0; i < coincident; ++i) {
+      force += sim->GetRandom()->UniformArray<3>(-3.0, 3.0);
+      non_zero++;
+    }
+    if (non_zero > 1) {
+      cell->SetStaticnessNextTimestep(false);
+    }
+
+    // the force must overcome the adherence of the cell
+    real_t norm_of_force = force.Norm();
+    if (norm_of_force > cell->GetAdherence()) {
+      real_t mh = dt / cell->GetMass();
+      movement += force * mh;
+      // avoid huge jumps in the simulation
+      if (norm_of_force * mh > param->simulation_max_displacement) {
+        movement.Normalize();
+        movement *= param->simulation_max_displacement;
+      }
+    }
+    displacement_[idx] = movement;
+  }
+}
+
+}  // namespace bdm
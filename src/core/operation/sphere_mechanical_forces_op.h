@@ -0,0 +1,104 @@
+// -----------------------------------------------------------------------------
+//
+// Copyright (C) 2021 CERN & University of Surrey for the benefit of the
+// BioDynaMo collaboration. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+//
+// See the LICENSE file distributed with this work for details.
+// See the NOTICE file distributed with this work for additional information
+// regarding copyright ownership.
+//
+// -----------------------------------------------------------------------------
+
+#ifndef CORE_OPERATION_SPHERE_MECHANICAL_FORCES_OP_H_
+#define CORE_OPERATION_SPHERE_MECHANICAL_FORCES_OP_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "core/agent/agent_handle.h"
+#include "core/container/agent_flat_idx_map.h"
+#include "core/container/math_array.h"
+#include "core/environment/uniform_grid_environment.h"
+#include "core/force_kernel.h"
+#include "core/operation/mechanical_forces_op.h"
+#include "core/operation/operation.h"
+#include "core/operation/operation_registry.h"
+
+namespace bdm {
+
+/// Mechanical forces for simulations that only contain cells.
+///
+/// Uses the same force and displacement model as `MechanicalForcesOp` with
+/// the default force, but processes the agents box by box of the
+/// `UniformGridEnvironment`: the positions and diameters of the candidates
+/// of a box are gathered once as structure of arrays, and the forces of all
+/// candidates on a query are computed in a vectorized loop over tiles of 64
+/// candidates with the inlined `ForceKernel<Shape::kSphere, Shape::kSphere>`.
+/// The displacements are stored in a separate buffer that is applied in a
+/// second pass. Hence, all forces are calculated from the positions at the
+/// beginning of the operation.
+///
+/// Like `MechanicalForcesOp`, static agents in frozen regions are not moved
+/// (see `Param::detect_static_regions`).
+///
+/// If the simulation contains agents that are not cells, or the environment
+/// is not a `UniformGridEnvironment`, the operation falls back to the generic
+/// `MechanicalForcesOp`.
+///
+/// The operation is registered as "sphere mechanical forces":
+///
+///     param->unschedule_default_operations = {"mechanical forces"};
+///     ...
+///     scheduler->ScheduleOp(NewOperation("sphere mechanical forces"));
+class SphereMechanicalForcesOp : public StandaloneOperationImpl {
+  BDM_OP_HEADER(SphereMechanicalForcesOp);
+
+ public:
+  SphereMechanicalForcesOp();
+  SphereMechanicalForcesOp(const SphereMechanicalForcesOp& other);
+  ~SphereMechanicalForcesOp() override;
+
+  const ForceKernelParam& GetForceKernelParam() const { return kernel_param_; }
+  void SetForceKernelParam(const ForceKernelParam& param);
+
+  /// Returns true if the last call used the vectorized path
+  bool UsedFastPath() const { return used_fast_path_; }
+
+  void operator()() override;
+
+ private:
+  /// Number of candidates that are processed in one vectorized loop
+  static constexpr uint64_t kCandidateTile = 64;
+
+  ForceKernelParam kernel_param_;
+  /// Generic implementation for populations with other shapes
+  Operation* fallback_ = nullptr;
+  bool used_fast_path_ = false;
+  OperationTimeStep time_step_;
+
+  /// Maps the agents to their index in the buffers below
+  AgentFlatIdxMap flat_idx_map_;
+  std::vector<Real3> displacement_;
+
+  uint64_t GetIndex(AgentHandle ah) const {
+    return flat_idx_map_.GetFlatIdx(ah);
+  }
+
+  Operation* GetFallback();
+
+  /// Returns true if all agents are cells
+  bool IsSphereOnly();
+
+  /// Calculates the displacement of all queries in `block`. Static queries
+  /// are skipped if the box is `frozen`.
+  void CalculateDisplacements(
+      const UniformGridEnvironment::NeighborBlock& block,
+      real_t squared_radius, bool frozen);
+};
+
+}  // namespace bdm
+
+#endif  // CORE_OPERATION_SPHERE_MECHANICAL_FORCES_OP_H_
@@ -0,0 +1,138 @@
+// -----------------------------------------------------------------------------
+//
+// Copyright (C) 2021 CERN & University of Surrey for the benefit of the
+// BioDynaMo collaboration. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+//
+// See the LICENSE file distributed with this work for details.
+// See the NOTICE file distributed with this work for additional information
+// regarding copyright ownership.
+//
+// -----------------------------------------------------------------------------
+
+#include "core/operation/two_phase_mechanical_forces_op.h"
+
+#include "core/agent/agent.h"
+#include "core/environment/environment.h"
+#include "core/execution_context/in_place_exec_ctxt.h"
+#include "core/force_kernel.h"
+#include "core/functor.h"
+#include "core/operation/bound_space_op.h"
+#include "core/param/param.h"
+#include "core/resource_manager.h"
+#include "core/simulation.h"
+
+namespace bdm {
+
+namespace {
+
+/// Calculates the displacement of an agent and stores it in a buffer.
+/// Executed through the execution context, such that the neighbor cache and
+/// `Param::thread_safety_mechanism` are handled as for other agent
+/// operations.
+struct CalculateDisplacementImpl : public AgentOperationImpl {
+  CalculateDisplacementImpl(
+      const InteractionForce* force, real_t squared_radius, real_t dt,
+      Real3* buffer, const AgentFlatIdxMap& flat_idx_map)
+      : force_(force),
+        squared_radius_(squared_radius),
+        dt_(dt),
+        buffer_(buffer),
+        flat_idx_map_(flat_idx_map) {}
+
+  CalculateDisplacementImpl* Clone() override {
+    return new CalculateDisplacementImpl(*this);
+  }
+
+  void operator()(Agent* agent) override {
+    auto ah = Simulation::GetActive()->GetResourceManager()->GetAgentHandle(
+        agent->GetUid());
+    buffer_[flat_idx_map_.GetFlatIdx(ah)] =
+        agent->CalculateDisplacement(force_, squared_radius_, dt_);
+  }
+
+  const InteractionForce* force_;
+  real_t squared_radius_;
+  real_t dt_;
+  Real3* buffer_;
+  const AgentFlatIdxMap& flat_idx_map_;
+};
+
+/// Returns true if `agent` is a static agent in a frozen region
+/// (see `Param::detect_static_regions`)
+inline bool IsFrozen(const Agent* agent, const Environment* env) {
+  return !agent->GetPropagateStaticness() && env->IsInFrozenRegion(*agent);
+}
+
+}  // namespace
+
+// -----------------------------------------------------------------------------
+TwoPhaseMechanicalForcesOp::TwoPhaseMechanicalForcesOp()
+    : force_(new KernelInteractionForce<>()) {}
+
+// -----------------------------------------------------------------------------
+TwoPhaseMechanicalForcesOp::TwoPhaseMechanicalForcesOp(
+    const TwoPhaseMechanicalForcesOp& other)
+    : time_step_(other.time_step_) {
+  if (other.force_) {
+    force_ = other.force_->NewCopy();
+  }
+}
+
+// -----------------------------------------------------------------------------
+TwoPhaseMechanicalForcesOp::~TwoPhaseMechanicalForcesOp() { delete force_; }
+
+// -----------------------------------------------------------------------------
+void TwoPhaseMechanicalForcesOp::SetInteractionForce(InteractionForce* force) {
+  if (force == force_) {
+    return;
+  }
+  delete force_;
+  force_ = force;
+}
+
+// -----------------------------------------------------------------------------
+void TwoPhaseMechanicalForcesOp::operator()() {
+  auto* sim = Simulation::GetActive();
+  auto* param = sim->GetParam();
+  auto* rm = sim->GetResourceManager();
+  auto* env = sim->GetEnvironment();
+  force_->Update();
+
+  const real_t delta_time = time_step_.Update();
+  flat_idx_map_.Update();
+  displacement_.resize(rm->GetNumAgents());
+
+  // Phase 1: calculate all displacements from the current positions
+  Operation calculate("calculate displacement");
+  calculate.AddOperationImpl(
+      kCpu, new CalculateDisplacementImpl(
+                force_, env->GetLargestAgentSizeSquared(), delta_time,
+                displacement_.data(), flat_idx_map_));
+  auto calculate_displacement = L2F([&](Agent* agent, AgentHandle ah) {
+    if (IsFrozen(agent, env)) {
+      displacement_[GetIndex(ah)] = {0, 0, 0};
+      return;
+    }
+    sim->GetExecutionContext()->Execute(agent, ah, {&calculate});
+  });
+  rm->ForEachAgentParallel(param->scheduling_batch_size,
+                           calculate_displacement);
+
+  // Phase 2: move the agents
+  auto apply_displacement = L2F([&](Agent* agent, AgentHandle ah) {
+    if (IsFrozen(agent, env)) {
+      return;
+    }
+    agent->ApplyDisplacement(displacement_[GetIndex(ah)]);
+    if (param->bound_space) {
+      ApplyBoundingBox(agent, param->bound_space, param->min_bound,
+                       param->max_bound);
+    }
+  });
+  rm->ForEachAgentParallel(param->scheduling_batch_size, apply_displacement);
+}
+
+}  // namespace bdm
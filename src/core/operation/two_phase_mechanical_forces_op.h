@@ -0,0 +1,83 @@
+// -----------------------------------------------------------------------------
+//
+// Copyright (C) 2021 CERN & University of Surrey for the benefit of the
+// BioDynaMo collaboration. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+//
+// See the LICENSE file distributed with this work for details.
+// See the NOTICE file distributed with this work for additional information
+// regarding copyright ownership.
+//
+// -----------------------------------------------------------------------------
+
+#ifndef CORE_OPERATION_TWO_PHASE_MECHANICAL_FORCES_OP_H_
+#define CORE_OPERATION_TWO_PHASE_MECHANICAL_FORCES_OP_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "core/agent/agent_handle.h"
+#include "core/container/agent_flat_idx_map.h"
+#include "core/container/math_array.h"
+#include "core/interaction_force.h"
+#include "core/operation/mechanical_forces_op.h"
+#include "core/operation/operation.h"
+#include "core/operation/operation_registry.h"
+
+namespace bdm {
+
+/// Mechanical forces with separate calculation and application of the
+/// displacements.
+///
+/// `MechanicalForcesOp` moves each agent right after its displacement has
+/// been calculated. Agents that are processed later in the same iteration
+/// therefore see a mix of old and new neighbor positions, and the thread
+/// safety mechanism has to protect position reads. This operation works in
+/// two phases:
+///  1. The displacements of all agents are calculated from the positions at
+///     the beginning of the operation and stored in a buffer. Positions do
+///     not change in this phase.
+///  2. The displacements are applied in a parallel sweep over all agents.
+///
+/// The result does not depend on the order in which agents are processed.
+/// For agents whose displacement only depends on the positions of their
+/// neighbors (e.g. `Cell`), `Param::ThreadSafetyMechanism::kNone` can be
+/// used. Neurite elements exchange forces with their mother during phase 1
+/// and still require a locking mechanism.
+///
+/// The operation is registered as "two phase mechanical forces" and replaces
+/// the default operation:
+///
+///     param->unschedule_default_operations = {"mechanical forces"};
+///     ...
+///     scheduler->ScheduleOp(NewOperation("two phase mechanical forces"));
+class TwoPhaseMechanicalForcesOp : public StandaloneOperationImpl {
+  BDM_OP_HEADER(TwoPhaseMechanicalForcesOp);
+
+ public:
+  TwoPhaseMechanicalForcesOp();
+  TwoPhaseMechanicalForcesOp(const TwoPhaseMechanicalForcesOp& other);
+  ~TwoPhaseMechanicalForcesOp() override;
+
+  void SetInteractionForce(InteractionForce* force);
+
+  void operator()() override;
+
+ private:
+  InteractionForce* force_ = nullptr;
+  OperationTimeStep time_step_;
+
+  /// Maps the agents to their index in `displacement_`
+  AgentFlatIdxMap flat_idx_map_;
+  std::vector<Real3> displacement_;
+
+  uint64_t GetIndex(AgentHandle ah) const {
+    return flat_idx_map_.GetFlatIdx(ah);
+  }
+};
+
+}  // namespace bdm
+
+#endif  // CORE_OPERATION_TWO_PHASE_MECHANICAL_FORCES_OP_H_
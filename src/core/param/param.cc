@@ -228,6 +228,8 @@ void Param::AssignFromConfig(const std::shared_ptr<cpptoml::table>& config) {
   BDM_ASSIGN_CONFIG_VALUE(output_dir, "simulation.output_dir");
   BDM_ASSIGN_CONFIG_VALUE(environment, "simulation.environment");
   BDM_ASSIGN_CONFIG_VALUE(nanoflann_depth, "simulation.nanoflann_depth");
+  BDM_ASSIGN_CONFIG_VALUE(sparse_grid_occupancy_threshold,
+                          "simulation.sparse_grid_occupancy_threshold");
   BDM_ASSIGN_CONFIG_VALUE(unibn_bucketsize, "simulation.unibn_bucketsize");
   BDM_ASSIGN_CONFIG_VALUE(backup_file, "simulation.backup_file");
   BDM_ASSIGN_CONFIG_VALUE(restore_file, "simulation.restore_file");
@@ -242,6 +244,12 @@ void Param::AssignFromConfig(const std::shared_ptr<cpptoml::table>& config) {
   BDM_ASSIGN_CONFIG_VALUE(diffusion_method, "simulation.diffusion_method");
   BDM_ASSIGN_CONFIG_VALUE(calculate_gradients,
                           "simulation.calculate_gradients");
+  BDM_ASSIGN_CONFIG_VALUE(non_cubic_diffusion_grid,
+                          "simulation.non_cubic_diffusion_grid");
+  BDM_ASSIGN_CONFIG_VALUE(deferred_concentration_changes,
+                          "simulation.deferred_concentration_changes");
+  BDM_ASSIGN_CONFIG_VALUE(diffusion_grid_growth_margin,
+                          "simulation.diffusion_grid_growth_margin");
   AssignBoundSpaceMode(config, this);
   AssignThreadSafetyMechanism(config, this);
 
@@ -340,6 +348,14 @@ void Param::AssignFromConfig(const std::shared_ptr<cpptoml::table>& config) {
                           "performance.scheduling_batch_size");
   BDM_ASSIGN_CONFIG_VALUE(detect_static_agents,
                           "performance.detect_static_agents");
+  BDM_ASSIGN_CONFIG_VALUE(detect_static_regions,
+                          "performance.detect_static_regions");
+  BDM_ASSIGN_CONFIG_VALUE(cylinder_neighbor_search,
+                          "performance.cylinder_neighbor_search");
+  BDM_ASSIGN_CONFIG_VALUE(diffusion_temporal_blocking,
+                          "performance.diffusion_temporal_blocking");
+  BDM_ASSIGN_CONFIG_VALUE(diffusion_tile_size,
+                          "performance.diffusion_tile_size");
   BDM_ASSIGN_CONFIG_VALUE(cache_neighbors, "performance.cache_neighbors");
   BDM_ASSIGN_CONFIG_VALUE(use_bdm_mem_mgr, "performance.use_bdm_mem_mgr");
   BDM_ASSIGN_CONFIG_VALUE(mem_mgr_aligned_pages_shift,
@@ -114,7 +114,7 @@ struct Param {
 
   /// The method used to query the environment of a simulation object.
   /// Default value: `"uniform_grid"`\n
-  /// Other allowed values: `"kd_tree", "octree"`\n
+  /// Other allowed values: `"kd_tree", "octree", "sparse_grid"`\n
   /// TOML config file:
   ///
   ///     [simulation]
@@ -130,9 +130,22 @@ struct Param {
   ///     nanoflann_depth = 10
   uint32_t nanoflann_depth = 10;
 
+  /// If the environment is `"uniform_grid"` and the fraction of non-empty
+  /// boxes of the grid is smaller than this threshold at the beginning of
+  /// `Scheduler::Simulate`, the uniform grid is replaced with a
+  /// `SparseGridEnvironment`, which only stores non-empty boxes.
+  /// A value of zero disables the replacement.\n
+  /// Default value: `0`\n
+  /// TOML config file:
+  ///
+  ///     [simulation]
+  ///     sparse_grid_occupancy_threshold = 0
+  real_t sparse_grid_occupancy_threshold = 0;
+
   /// The bucket size of the octree if it's set as the environment (see
-  /// Param::environment). For more information see:
-  /// https://github.com/jbehley/octree
+  /// Param::environment), i.e. the maximum number of agents in a leaf.
+  /// The name is kept for backwards compatibility with the previous octree
+  /// implementation (https://github.com/jbehley/octree).\n
   /// TOML config file:
   ///
   ///     [simulation]
@@ -205,7 +218,10 @@ struct Param {
     /// The dimensions of this cube are determined by parameter
     /// `min_bound` and `max_bound`.\n
     /// Agents that move outside the cube are moved back in on the opposite
-    /// side.
+    /// side.\n
+    /// The neighbor search of the `UniformGridEnvironment` and the default
+    /// `InteractionForce` treat the space as periodic (minimum image
+    /// convention). Hence, agents close to opposite faces interact.
     kTorus
   };
 
@@ -244,7 +260,8 @@ struct Param {
   std::string diffusion_boundary_condition = "Neumann";
 
   /// A string for determining diffusion type within the simulation space.
-  /// current inputs include "euler" and "runge-kutta".
+  /// current inputs include "euler", "runge-kutta" and "adi" (implicit
+  /// scheme without stability limit on the time step, see `ADIGrid`).
   /// Default value: `"euler"`\n
   /// TOML config file:
   ///
@@ -262,6 +279,48 @@ struct Param {
   ///     calculate_gradients = true
   bool calculate_gradients = true;
 
+  /// If true, diffusion grids cover the simulation space along each axis
+  /// individually (see `Environment::GetDimensions`) instead of a cube with
+  /// the extent of the longest axis. `DiffusionGrid::GetResolution` then
+  /// defines the number of boxes along the longest axis. The boxes remain
+  /// cubes, hence shorter axes are covered by fewer boxes. This saves memory
+  /// and compute time for flat or elongated domains (e.g. monolayers).
+  /// Grids also follow the growth of the simulation space if
+  /// `bound_space` is set.\n
+  /// Default value: `false`\n
+  /// TOML config file:
+  ///
+  ///     [simulation]
+  ///     non_cubic_diffusion_grid = false
+  bool non_cubic_diffusion_grid = false;
+
+  /// If true, `DiffusionGrid::ChangeConcentrationBy` stores the changes in a
+  /// buffer of the calling thread instead of locking the box. The buffers are
+  /// applied in parallel before the next diffusion step (see
+  /// `DiffusionGrid::ApplyDeferredChanges`). This avoids contention if many
+  /// agents secrete into the same box, and the grids do not allocate a lock
+  /// per box. Changes are not visible to `GetValue` before they are applied.
+  /// Must be set before the diffusion grids are initialized.\n
+  /// Default value: `false`\n
+  /// TOML config file:
+  ///
+  ///     [simulation]
+  ///     deferred_concentration_changes = false
+  bool deferred_concentration_changes = false;
+
+  /// If a diffusion grid has to grow with the simulation space, it is
+  /// extended by this fraction of its number of boxes beyond the simulation
+  /// space (half on each side). Further growth within this margin does not
+  /// reallocate and copy the grid, which reduces the number of growth events
+  /// for expanding tissues. Zero grows the grid by the boxes that are needed
+  /// to cover the simulation space.\n
+  /// Default value: `0`\n
+  /// TOML config file:
+  ///
+  ///     [simulation]
+  ///     diffusion_grid_growth_margin = 0
+  real_t diffusion_grid_growth_margin = 0;
+
   /// List of thread-safety mechanisms \n
   /// `kNone`: \n
   /// `kUserSpecified`: The user has to define all agent that must
@@ -467,6 +526,58 @@ struct Param {
   ///     detect_static_agents = false
   bool detect_static_agents = false;
 
+  /// Extends `detect_static_agents` to whole regions of the
+  /// `UniformGridEnvironment`. A box is frozen if neither its agents nor the
+  /// agents in its Moore neighborhood moved or changed in the last iteration.
+  /// Mechanical forces and the staticness updates are skipped for agents in
+  /// frozen boxes, and the propagation of staticness only visits active
+  /// boxes. Behaviors are still executed for all agents.
+  /// Has no effect if `detect_static_agents` is turned off.\n
+  /// Default value: `false`\n
+  /// TOML config file:
+  ///
+  ///     [performance]
+  ///     detect_static_regions = false
+  bool detect_static_regions = false;
+
+  /// Cylinder-shaped agents (e.g. neurite elements) are indexed by their
+  /// center in the `UniformGridEnvironment`. Since the box length is
+  /// determined by the largest diameter, long cylinders might miss contacts.
+  /// If this parameter is turned on, the environment additionally registers
+  /// each cylinder in all boxes that its axis overlaps. The neighbor search
+  /// for cylinders then returns exactly the agents whose surface touches
+  /// them, which avoids force calculations between distant pairs.
+  /// Not supported for `BoundSpaceMode::kTorus`.\n
+  /// Default value: `false`\n
+  /// TOML config file:
+  ///
+  ///     [performance]
+  ///     cylinder_neighbor_search = false
+  bool cylinder_neighbor_search = false;
+
+  /// Maximum number of diffusion steps that are fused if a diffusion grid
+  /// performs several steps per iteration (see `Continuum::SetTimeStep`).
+  /// Fused steps are calculated tile by tile, such that each tile is
+  /// advanced by several steps while it resides in the cache (see
+  /// `DiffusionGrid::MultiStep`). The value `1` turns temporal blocking off.
+  /// \n
+  /// Default value: `1`\n
+  /// TOML config file:
+  ///
+  ///     [performance]
+  ///     diffusion_temporal_blocking = 1
+  uint64_t diffusion_temporal_blocking = 1;
+
+  /// Edge length (in boxes) of the tiles that are used for temporal
+  /// blocking (see `diffusion_temporal_blocking`). Each thread allocates two
+  /// buffers with (edge length + 2 * (fused steps - 1))^3 boxes.\n
+  /// Default value: `32`\n
+  /// TOML config file:
+  ///
+  ///     [performance]
+  ///     diffusion_tile_size = 32
+  uint64_t diffusion_tile_size = 32;
+
   /// Neighbors of an agent can be cached so to avoid consecutive
   /// searches. This of course only makes sense if there is more than one
   /// `ForEachNeighbor*` operation.\n
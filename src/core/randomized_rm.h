@@ -88,6 +88,7 @@ void RandomizedRm<TBaseRm>::RandomizeAgentsOrder() {
     this->uid_ah_map_.Insert(a->GetUid(), ah);
   });
   TBaseRm::ForEachAgentParallel(update_agent_map);
+  this->agent_handle_version_++;
 }
 
 // -----------------------------------------------------------------------------
@@ -21,6 +21,7 @@
 #include "core/container/shared_data.h"
 #include "core/environment/environment.h"
 #include "core/simulation.h"
+#include "core/simulation_backup.h"
 #include "core/util/partition.h"
 #include "core/util/plot_memory_layout.h"
 #include "core/util/timing.h"
@@ -198,6 +199,37 @@ void ResourceManager::ForEachAgentParallel(
   }
 }
 
+namespace {
+
+/// Determines the address of agents using the given uid map and agent
+/// containers. Agents in `removed` are mapped to nullptr.
+class AgentPointerUpdateImpl : public AgentPointerUpdate {
+ public:
+  AgentPointerUpdateImpl(const AgentUidMap<AgentHandle>& uid_ah_map,
+                         const std::vector<std::vector<Agent*>>& agents,
+                         const AgentUidMap<uint8_t>* removed = nullptr,
+                         bool from_uid = false)
+      : AgentPointerUpdate(from_uid),
+        uid_ah_map_(uid_ah_map),
+        agents_(agents),
+        removed_(removed) {}
+
+  Agent* GetAgent(const AgentUid& uid) const override {
+    if (!uid_ah_map_.Contains(uid) || (removed_ && removed_->Contains(uid))) {
+      return nullptr;
+    }
+    auto ah = uid_ah_map_[uid];
+    return agents_[ah.GetNumaNode()][ah.GetElementIdx()];
+  }
+
+ private:
+  const AgentUidMap<AgentHandle>& uid_ah_map_;
+  const std::vector<std::vector<Agent*>>& agents_;
+  const AgentUidMap<uint8_t>* removed_;
+};
+
+}  // namespace
+
 struct LoadBalanceFunctor : public Functor<void, Iterator<AgentHandle>*> {
   bool minimize_memory;
   uint64_t offset;
@@ -276,7 +308,12 @@ void ResourceManager::LoadBalance() {
   auto* env = Simulation::GetActive()->GetEnvironment();
   auto lbi = env->GetLoadBalanceInfo();
 
-  const bool minimize_memory = param->minimize_memory_while_rebalancing;
+  // In the direct agent pointer mode, the old agents are required to update
+  // the agent pointers of the copies. Hence, they cannot be deleted right
+  // after they have been copied.
+  const bool minimize_memory =
+      param->minimize_memory_while_rebalancing &&
+      gAgentPointerMode == AgentPointerMode::kIndirect;
 
 // create new agents
 #pragma omp parallel
@@ -310,6 +347,10 @@ void ResourceManager::LoadBalance() {
     lbi->CallHandleIteratorConsumer(start, end, f);
   }
 
+  // the copies still point to the old agents
+  UpdateAgentPointers(AgentPointerUpdateImpl(uid_ah_map_, agents_lb_),
+                      agents_lb_);
+
   // delete old objects. This approach has a high chance that a thread
   // in the right numa node will delete the object, thus minimizing thread
   // synchronization overheads. The bdm memory allocator does not have this
@@ -330,6 +371,8 @@ void ResourceManager::LoadBalance() {
     PlotNeighborMemoryHistogram();
   }
 
+  agent_handle_version_++;
+
   if (Simulation::GetActive()->GetParam()->debug_numa) {
     std::cout << *this << std::endl;
   }
@@ -362,6 +405,19 @@ void ResourceManager::RemoveAgents(
   std::set<AgentUid> toberemoved;
 #endif  // NDEBUG
 
+  // set agent pointers to removed agents to nullptr before they are deleted
+  if (gAgentPointerMode == AgentPointerMode::kDirect) {
+    AgentUidMap<uint8_t> removed(uid_ah_map_.size());
+#pragma omp parallel for schedule(static, 1)
+    for (uint64_t i = 0; i < uids.size(); ++i) {
+      for (auto& uid : *uids[i]) {
+        removed.Insert(uid, 1);
+      }
+    }
+    UpdateAgentPointers(AgentPointerUpdateImpl(uid_ah_map_, agents_, &removed),
+                        agents_);
+  }
+
   // determine how many agents will be removed in each numa domain
 #pragma omp parallel for schedule(static, 1)
   for (uint64_t i = 0; i < uids.size(); ++i) {
@@ -572,6 +628,7 @@ void ResourceManager::RemoveAgents(
   for (uint64_t n = 0; n < agents_.size(); ++n) {
     agents_[n].resize(lowest[n]);
   }
+  agent_handle_version_++;
   MarkEnvironmentOutOfSync();
 }
 
@@ -583,6 +640,31 @@ size_t ResourceManager::GetAgentVectorCapacity(int numa_node) {
 // -----------------------------------------------------------------------------
 void ResourceManager::SwapAgents(std::vector<std::vector<Agent*>>* agents) {
   agents_.swap(*agents);
+  agent_handle_version_++;
+}
+
+// -----------------------------------------------------------------------------
+void ResourceManager::UpdateAgentPointers(
+    const AgentPointerUpdate& update,
+    const std::vector<std::vector<Agent*>>& agents) {
+  if (gAgentPointerMode != AgentPointerMode::kDirect) {
+    return;
+  }
+  for (auto& numa_agents : agents) {
+#pragma omp parallel for schedule(static)
+    for (uint64_t i = 0; i < numa_agents.size(); ++i) {
+      numa_agents[i]->UpdateAgentPointers(update);
+    }
+  }
+}
+
+// -----------------------------------------------------------------------------
+void ResourceManager::RestoreAgentPointers() {
+  if (!SimulationBackup::restore_in_progress_) {
+    return;
+  }
+  UpdateAgentPointers(
+      AgentPointerUpdateImpl(uid_ah_map_, agents_, nullptr, true), agents_);
 }
 
 void ResourceManager::MarkEnvironmentOutOfSync() const {
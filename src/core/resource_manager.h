@@ -73,9 +73,11 @@ class ResourceManager {
     }
     agents_ = std::move(other.agents_);
     agents_lb_.resize(agents_.size());
+    agent_handle_version_++;
     continuum_models_ = std::move(other.continuum_models_);
 
     RebuildAgentUidMap();
+    RestoreAgentPointers();
     // restore type_index_
     if (type_index_) {
       for (auto& numa_agents : agents_) {
@@ -90,6 +92,7 @@ class ResourceManager {
   void RebuildAgentUidMap() {
     // rebuild uid_ah_map_
     uid_ah_map_.clear();
+    agent_handle_version_++;
     auto* agent_uid_generator = Simulation::GetActive()->GetAgentUidGenerator();
     uid_ah_map_.resize(agent_uid_generator->GetHighestIndex() + 1);
     for (AgentHandle::NumaNode_t n = 0; n < agents_.size(); ++n) {
@@ -118,6 +121,13 @@ class ResourceManager {
 
   void SwapAgents(std::vector<std::vector<Agent*>>* agents);
 
+  /// Returns a number that is incremented whenever the `AgentHandle` of
+  /// existing agents might have changed (e.g. after load balancing or
+  /// removal of agents). Adding agents does not change it.
+  /// Data structures that cache agent handles can compare it with the value
+  /// at the time they were built to decide if they must be remapped.
+  uint64_t GetAgentHandleVersion() const { return agent_handle_version_; }
+
   [[deprecated("Use AddContinuum() instead")]] void AddDiffusionGrid(
       DiffusionGrid* dgrid) {
     AddContinuum(dgrid);
@@ -372,6 +382,7 @@ class ResourceManager {
   /// not affected.
   void ClearAgents() {
     uid_ah_map_.clear();
+    agent_handle_version_++;
     for (auto& numa_agents : agents_) {
       for (auto* agent : numa_agents) {
         delete agent;
@@ -462,6 +473,7 @@ class ResourceManager {
     if (uid_ah_map_.Contains(uid)) {
       auto ah = uid_ah_map_[uid];
       uid_ah_map_.Remove(uid);
+      agent_handle_version_++;
       // remove from vector
       auto& numa_agents = agents_[ah.GetNumaNode()];
       Agent* agent = nullptr;
@@ -497,12 +509,23 @@ class ResourceManager {
   /// it is aware of the changes.
   void MarkEnvironmentOutOfSync() const;
 
+  /// Calls `Agent::UpdateAgentPointers` for all agents in `agents` if
+  /// `gAgentPointerMode` is `AgentPointerMode::kDirect`.
+  void UpdateAgentPointers(const AgentPointerUpdate& update,
+                           const std::vector<std::vector<Agent*>>& agents);
+
+  /// Replaces the uids of restored `AgentPointer`s with the raw pointers
+  /// in `AgentPointerMode::kDirect`. \see `AgentPointer::Streamer`
+  void RestoreAgentPointers();
+
   /// Maps an AgentUid to its storage location in `agents_` \n
   AgentUidMap<AgentHandle> uid_ah_map_ = AgentUidMap<AgentHandle>(100u);  //!
   /// Pointer container for all agents
   std::vector<std::vector<Agent*>> agents_;
   /// Container used during load balancing
   std::vector<std::vector<Agent*>> agents_lb_;  //!
+  /// \see GetAgentHandleVersion
+  uint64_t agent_handle_version_ = 0;  //!
 
   ThreadInfo* thread_info_ = ThreadInfo::GetInstance();  //!
 
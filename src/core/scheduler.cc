@@ -17,6 +17,7 @@
 #include <iomanip>
 #include <string>
 #include <utility>
+#include "core/environment/sparse_grid_environment.h"
 #include "core/execution_context/in_place_exec_ctxt.h"
 #include "core/operation/bound_space_op.h"
 #include "core/operation/continuum_op.h"
@@ -482,6 +483,11 @@ void Scheduler::Initialize(uint64_t steps) {
   // Update the uid generator in case the number of threads has changed.
   sim->GetAgentUidGenerator()->Update();
 
+  // Avoid allocating a mostly empty uniform grid for large domains
+  if (SparseGridEnvironment::ReplaceUniformGridIfSparse(sim)) {
+    env = sim->GetEnvironment();
+  }
+
   // We force-update the environment in this function because users may apply
   // certain operations such as shifting them in space in between two Simulate()
   // or SimulateUntil() calls. In contrast to adding or removing agents, such
@@ -30,9 +30,11 @@
 #include "bdm_version.h"
 #include "core/agent/agent_uid_generator.h"
 #include "core/analysis/time_series.h"
+#include "core/bond_store.h"
 #include "core/environment/environment.h"
 #include "core/environment/kd_tree_environment.h"
 #include "core/environment/octree_environment.h"
+#include "core/environment/sparse_grid_environment.h"
 #include "core/environment/uniform_grid_environment.h"
 #include "core/execution_context/in_place_exec_ctxt.h"
 #include "core/gpu/gpu_helper.h"
@@ -235,6 +237,7 @@ Simulation::~Simulation() {
   if (time_series_) {
     delete time_series_;
   }
+  delete bond_store_;
   active_ = tmp;
 }
 
@@ -286,6 +289,8 @@ const std::string& Simulation::GetOutputDir() const { return output_dir_; }
 
 experimental::TimeSeries* Simulation::GetTimeSeries() { return time_series_; }
 
+BondStore* Simulation::GetBondStore() { return bond_store_; }
+
 void Simulation::ReplaceScheduler(Scheduler* scheduler) {
   delete scheduler_;
   scheduler_ = scheduler;
@@ -344,6 +349,8 @@ void Simulation::InitializeMembers() {
     environment_ = new OctreeEnvironment();
   } else if (param_->environment == "uniform_grid") {
     environment_ = new UniformGridEnvironment();
+  } else if (param_->environment == "sparse_grid") {
+    environment_ = new SparseGridEnvironment();
   } else {
     Log::Error("Simulation::Initialize", "No such neighboring method '",
                param_->environment, "'. Defaulting to 'uniform_grid'");
@@ -351,6 +358,7 @@ void Simulation::InitializeMembers() {
   }
   scheduler_ = new Scheduler();
   time_series_ = new experimental::TimeSeries();
+  bond_store_ = new BondStore();
 }
 
 void Simulation::SetEnvironment(Environment* env) {
@@ -35,6 +35,7 @@ struct Param;
 class ExecutionContext;
 class CommandLineOptions;
 class AgentUidGenerator;
+class BondStore;
 
 class SimulationTest;
 class ParaviewAdaptorTest;
@@ -137,6 +138,9 @@ class Simulation {
 
   experimental::TimeSeries* GetTimeSeries();
 
+  /// Returns the persistent bonds between agents
+  BondStore* GetBondStore();
+
   /// Replaces the scheduler for this simulation.
   /// Existing scheduler will be deleted! Therefore, pointers to the old
   /// scheduler (obtained with `GetScheduler()`) will be invalidated. \n
@@ -183,6 +187,8 @@ class Simulation {
   int64_t dtor_ts_ = 0;  //!
   /// Collects time series information during the simulation
   experimental::TimeSeries* time_series_ = nullptr;
+  /// Bonds between agents
+  BondStore* bond_store_ = nullptr;  //!
 
   /// Initialize Simulation
   void Initialize(CommandLineOptions* clo,
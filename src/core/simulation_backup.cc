@@ -68,4 +68,6 @@ const std::string SimulationBackup::kRuntimeVariableName = "runtime_variable";
 
 std::vector<std::function<void()>> SimulationBackup::after_restore_event_ = {};
 
+bool SimulationBackup::restore_in_progress_ = false;
+
 }  // namespace bdm
@@ -46,6 +46,11 @@ class SimulationBackup {
   /// updated.
   static std::vector<std::function<void()>> after_restore_event_;
 
+  /// True while a whole simulation is restored. Restored `AgentPointer`s
+  /// keep the uid in the direct mode until the ResourceManager has been
+  /// updated (see `ResourceManager::RestoreAgentPointers`).
+  static bool restore_in_progress_;
+
   /// If `backup_file` is an empty string no backups will be made
   /// If `restore_file` is an empty string no restore will be made
   SimulationBackup(const std::string& backup_file,
@@ -96,8 +101,10 @@ class SimulationBackup {
                    "Restoring simulation executed on a different system!");
     }
     Simulation* restored_simulation = nullptr;
+    restore_in_progress_ = true;
     file.Get()->GetObject(kSimulationName.c_str(), restored_simulation);
     Simulation::GetActive()->Restore(std::move(*restored_simulation));
+    restore_in_progress_ = false;
     Log::Info("Scheduler", "Restored simulation from ", restore_file);
     delete restored_simulation;
 
@@ -15,6 +15,7 @@
 #ifndef CORE_UTIL_MATH_H_
 #define CORE_UTIL_MATH_H_
 
+#include <algorithm>
 #include <array>
 #include <cmath>
 #include <numeric>
@@ -118,6 +119,49 @@ struct Math {
     return b * k;
   }
 
+  /// Returns the squared shortest distance between the line segments [p1, q1]
+  /// and [p2, q2]. Degenerated segments (p == q) are treated as points.
+  static real_t SquaredSegmentDistance(const Real3& p1, const Real3& q1,
+                                       const Real3& p2, const Real3& q2) {
+    // Based on C. Ericson, Real-Time Collision Detection, Section 5.1.9
+    const real_t kEpsilon = 1e-12;
+    Real3 d1 = q1 - p1;
+    Real3 d2 = q2 - p2;
+    Real3 r = p1 - p2;
+    real_t a = d1 * d1;
+    real_t e = d2 * d2;
+    real_t f = d2 * r;
+    real_t s = 0;
+    real_t t = 0;
+    if (a <= kEpsilon && e <= kEpsilon) {
+      return r * r;
+    }
+    if (a <= kEpsilon) {
+      t = std::clamp(f / e, real_t(0), real_t(1));
+    } else {
+      real_t c = d1 * r;
+      if (e <= kEpsilon) {
+        s = std::clamp(-c / a, real_t(0), real_t(1));
+      } else {
+        real_t b = d1 * d2;
+        real_t denom = a * e - b * b;
+        if (denom > kEpsilon) {
+          s = std::clamp((b * f - c * e) / denom, real_t(0), real_t(1));
+        }
+        t = (b * s + f) / e;
+        if (t < 0) {
+          t = 0;
+          s = std::clamp(-c / a, real_t(0), real_t(1));
+        } else if (t > 1) {
+          t = 1;
+          s = std::clamp((b - c) / a, real_t(0), real_t(1));
+        }
+      }
+    }
+    Real3 diff = (p1 + d1 * s) - (p2 + d2 * t);
+    return diff * diff;
+  }
+
   /// Returns the mean squared error between two vectors
   static real_t MSE(const std::vector<real_t>& v1,
                     const std::vector<real_t>& v2) {
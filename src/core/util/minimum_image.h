@@ -0,0 +1,44 @@
+// -----------------------------------------------------------------------------
+//
+// Copyright (C) 2021 CERN & University of Surrey for the benefit of the
+// BioDynaMo collaboration. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+//
+// See the LICENSE file distributed with this work for details.
+// See the NOTICE file distributed with this work for additional information
+// regarding copyright ownership.
+//
+// -----------------------------------------------------------------------------
+
+#ifndef CORE_UTIL_MINIMUM_IMAGE_H_
+#define CORE_UTIL_MINIMUM_IMAGE_H_
+
+#include <cmath>
+
+#include "core/container/math_array.h"
+#include "core/param/param.h"
+
+namespace bdm {
+
+/// Returns the vector from `from` to `to`. If `mode` is `kTorus`, the
+/// simulation space is periodic with period `rb - lb` along each axis and the
+/// vector to the nearest periodic image of `to` is returned (minimum image
+/// convention).
+inline Real3 GetMinimumImageDisplacement(const Real3& from, const Real3& to,
+                                         Param::BoundSpaceMode mode,
+                                         real_t lb, real_t rb) {
+  Real3 displacement = to - from;
+  if (mode == Param::BoundSpaceMode::kTorus) {
+    auto length = rb - lb;
+    for (auto& el : displacement) {
+      el -= length * std::round(el / length);
+    }
+  }
+  return displacement;
+}
+
+}  // namespace bdm
+
+#endif  // CORE_UTIL_MINIMUM_IMAGE_H_
@@ -229,6 +229,16 @@ void ParaviewAdaptor::BuildDiffusionGridVTKStructures() {
       it->second->Update(grid);
     }
   });
+  rm->ForEachContinuum([&](Continuum* cm) {
+    auto* grid = dynamic_cast<BrickedGrid*>(cm);
+    if (grid == nullptr) {
+      return;
+    }
+    auto it = impl_->vtk_dgrids_.find(grid->GetContinuumName());
+    if (it != impl_->vtk_dgrids_.end()) {
+      it->second->Update(grid);
+    }
+  });
 }
 
 // ----------------------------------------------------------------------------
@@ -105,12 +105,40 @@ bool VtkDiffusionGrid::IsUsed() const { return used_; }
 
 // -----------------------------------------------------------------------------
 void VtkDiffusionGrid::Update(const DiffusionGrid* grid) {
+  auto dims = grid->GetDimensions();
+  const std::array<real_t, 3> lower = {static_cast<real_t>(dims[0]),
+                                       static_cast<real_t>(dims[2]),
+                                       static_cast<real_t>(dims[4])};
+  UpdateImageData(grid->GetNumBoxesArray(), lower, grid->GetBoxLength(),
+                  grid->GetAllConcentrations(), grid->GetAllGradients());
+}
+
+// -----------------------------------------------------------------------------
+void VtkDiffusionGrid::Update(const BrickedGrid* grid) {
+  const size_t total_boxes = grid->GetNumBoxes();
+  concentrations_.resize(total_boxes);
+  grid->CopyConcentrations(concentrations_.data());
+  const real_t* gradients = nullptr;
+  if (gradient_array_idx_ != -1) {
+    gradients_.resize(3 * total_boxes);
+    grid->CopyGradients(gradients_.data());
+    gradients = gradients_.data();
+  }
+  const size_t n = grid->GetResolution();
+  const real_t lower = grid->GetDimensions()[0];
+  UpdateImageData({n, n, n}, {lower, lower, lower}, grid->GetBoxLength(),
+                  concentrations_.data(), gradients);
+}
+
+// -----------------------------------------------------------------------------
+void VtkDiffusionGrid::UpdateImageData(const std::array<size_t, 3>& num_boxes,
+                                       const std::array<real_t, 3>& lower,
+                                       real_t box_length,
+                                       const real_t* concentrations,
+                                       const real_t* gradients) {
   used_ = true;
 
-  auto num_boxes = grid->GetNumBoxesArray();
-  auto grid_dimensions = grid->GetDimensions();
-  auto box_length = grid->GetBoxLength();
-  auto total_boxes = grid->GetNumBoxes();
+  auto total_boxes = num_boxes[0] * num_boxes[1] * num_boxes[2];
 
   auto* tinfo = ThreadInfo::GetInstance();
   whole_extent_ = {{0, std::max(static_cast<int>(num_boxes[0]) - 1, 0), 0,
@@ -119,9 +147,9 @@ void VtkDiffusionGrid::Update(const DiffusionGrid* grid) {
   Dissect(num_boxes[2], tinfo->GetMaxThreads());
   CalcPieceExtents(num_boxes);
   uint64_t xy_num_boxes = num_boxes[0] * num_boxes[1];
-  real_t origin_x = grid_dimensions[0] + box_length / 2.;
-  real_t origin_y = grid_dimensions[2] + box_length / 2.;
-  real_t origin_z = grid_dimensions[4] + box_length / 2.;
+  real_t origin_x = lower[0] + box_length / 2.;
+  real_t origin_y = lower[1] + box_length / 2.;
+  real_t origin_z = lower[2] + box_length / 2.;
 
   // do not partition data for insitu visualization
   if (data_.size() == 1) {
@@ -130,14 +158,14 @@ void VtkDiffusionGrid::Update(const DiffusionGrid* grid) {
     data_[0]->SetSpacing(box_length, box_length, box_length);
 
     if (concentration_array_idx_ != -1) {
-      auto* co_ptr = const_cast<real_t*>(grid->GetAllConcentrations());
+      auto* co_ptr = const_cast<real_t*>(concentrations);
       auto elements = static_cast<vtkIdType>(total_boxes);
       auto* array = static_cast<vtkRealArray*>(
           data_[0]->GetPointData()->GetArray(concentration_array_idx_));
       array->SetArray(co_ptr, elements, 1);
     }
     if (gradient_array_idx_ != -1) {
-      auto gr_ptr = const_cast<real_t*>(grid->GetAllGradients());
+      auto gr_ptr = const_cast<real_t*>(gradients);
       auto elements = static_cast<vtkIdType>(total_boxes * 3);
       auto* array = static_cast<vtkRealArray*>(
           data_[0]->GetPointData()->GetArray(gradient_array_idx_));
@@ -166,7 +194,7 @@ void VtkDiffusionGrid::Update(const DiffusionGrid* grid) {
     data_[i]->SetSpacing(box_length, box_length, box_length);
 
     if (concentration_array_idx_ != -1) {
-      auto* co_ptr = const_cast<real_t*>(grid->GetAllConcentrations());
+      auto* co_ptr = const_cast<real_t*>(concentrations);
       auto elements = static_cast<vtkIdType>(piece_elements);
       auto* array = static_cast<vtkRealArray*>(
           data_[i]->GetPointData()->GetArray(concentration_array_idx_));
@@ -177,7 +205,7 @@ void VtkDiffusionGrid::Update(const DiffusionGrid* grid) {
       }
     }
     if (gradient_array_idx_ != -1) {
-      auto gr_ptr = const_cast<real_t*>(grid->GetAllGradients());
+      auto gr_ptr = const_cast<real_t*>(gradients);
       auto elements = static_cast<vtkIdType>(piece_elements * 3);
       auto* array = static_cast<vtkRealArray*>(
           data_[i]->GetPointData()->GetArray(gradient_array_idx_));
@@ -24,6 +24,7 @@
 #include <vtkCPDataDescription.h>
 #include <vtkImageData.h>
 // BioDynaMo
+#include "core/diffusion/bricked_grid.h"
 #include "core/diffusion/diffusion_grid.h"
 
 namespace bdm {
@@ -41,10 +42,16 @@ class VtkDiffusionGrid {
 
   bool IsUsed() const;
   void Update(const DiffusionGrid* grid);
+  /// The bricked storage is copied to the layout of `DiffusionGrid` first
+  void Update(const BrickedGrid* grid);
   void WriteToFile(uint64_t step) const;
 
  private:
   std::vector<vtkImageData*> data_;
+  /// Copies of the values of grids that are not stored in the layout of
+  /// `DiffusionGrid`
+  std::vector<real_t> concentrations_;
+  std::vector<real_t> gradients_;
   std::string name_;
   bool used_ = false;
   int concentration_array_idx_ = -1;
@@ -67,6 +74,12 @@ class VtkDiffusionGrid {
 
   void CalcPieceExtents(const std::array<size_t, 3>& num_boxes);
 
+  /// Points the vtkImageData objects to the concentrations and gradients of
+  /// a grid with `num_boxes` boxes (x fastest) that starts at `lower`
+  void UpdateImageData(const std::array<size_t, 3>& num_boxes,
+                       const std::array<real_t, 3>& lower, real_t box_length,
+                       const real_t* concentrations, const real_t* gradients);
+
   friend class ParaviewAdaptorTest_GenerateSimulationInfoJson_Test;
 };
 
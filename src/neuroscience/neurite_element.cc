@@ -14,6 +14,7 @@
 
 #include "neuroscience/neurite_element.h"
 #include <string>
+#include "core/environment/environment.h"
 
 namespace bdm {
 namespace neuroscience {
@@ -131,6 +132,12 @@ void NeuriteElement::CriticalRegion(std::vector<AgentPointer<>>* aptrs) {
   }
 }
 
+void NeuriteElement::UpdateAgentPointers(const AgentPointerUpdate& update) {
+  mother_.Update(update);
+  daughter_left_.Update(update);
+  daughter_right_.Update(update);
+}
+
 std::set<std::string> NeuriteElement::GetRequiredVisDataMembers() const {
   return {"mass_location_", "diameter_", "actual_length_", "spring_axis_"};
 }
@@ -566,8 +573,15 @@ Real3 NeuriteElement::CalculateDisplacement(const InteractionForce* force,
     MechanicalForcesFunctor calculate_neighbor_forces(
         force, this, force_from_neighbors, force_on_my_mothers_point_mass,
         h_over_m, has_neurite_neighbor_, non_zero_neighbor_force);
-    auto* ctxt = Simulation::GetActive()->GetExecutionContext();
-    ctxt->ForEachNeighbor(calculate_neighbor_forces, *this, squared_radius);
+    if (core_param->cylinder_neighbor_search) {
+      // only visits neighbors that touch this cylinder
+      auto* env = Simulation::GetActive()->GetEnvironment();
+      env->ForEachNeighborOfCylinder(calculate_neighbor_forces, *this,
+                                     squared_radius);
+    } else {
+      auto* ctxt = Simulation::GetActive()->GetExecutionContext();
+      ctxt->ForEachNeighbor(calculate_neighbor_forces, *this, squared_radius);
+    }
 
     if (non_zero_neighbor_force > 1) {
       SetStaticnessNextTimestep(false);
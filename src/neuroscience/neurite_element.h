@@ -69,6 +69,8 @@ class NeuriteElement : public Agent, public NeuronOrNeurite {
 
   void CriticalRegion(std::vector<AgentPointer<>>* aptrs) override;
 
+  void UpdateAgentPointers(const AgentPointerUpdate& update) override;
+
   Shape GetShape() const override { return Shape::kCylinder; }
 
   /// Returns the data members that are required to visualize this simulation
@@ -74,6 +74,12 @@ void NeuronSoma::CriticalRegion(std::vector<AgentPointer<>>* aptrs) {
   }
 }
 
+void NeuronSoma::UpdateAgentPointers(const AgentPointerUpdate& update) {
+  for (auto& daughter : daughters_) {
+    daughter.Update(update);
+  }
+}
+
 NeuriteElement* NeuronSoma::ExtendNewNeurite(const Real3& direction,
                                              NeuriteElement* prototype) {
   auto dir = direction + GetPosition();
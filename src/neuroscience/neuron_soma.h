@@ -63,6 +63,8 @@ class NeuronSoma : public Cell, public NeuronOrNeurite {
 
   void CriticalRegion(std::vector<AgentPointer<>>* aptrs) override;
 
+  void UpdateAgentPointers(const AgentPointerUpdate& update) override;
+
   // ***************************************************************************
   //      METHODS FOR NEURON TREE STRUCTURE *
   // ***************************************************************************
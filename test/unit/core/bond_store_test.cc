@@ -0,0 +1,178 @@
+// -----------------------------------------------------------------------------
+//
+// Copyright (C) 2021 CERN & University of Surrey for the benefit of the
+// BioDynaMo collaboration. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+//
+// See the LICENSE file distributed with this work for details.
+// See the NOTICE file distributed with this work for additional information
+// regarding copyright ownership.
+//
+// -----------------------------------------------------------------------------
+
+#include "core/bond_store.h"
+#include <vector>
+#include "core/agent/cell.h"
+#include "core/behavior/stateless_behavior.h"
+#include "core/environment/environment.h"
+#include "core/operation/bond_forces_op.h"
+#include "core/resource_manager.h"
+#include "core/scheduler.h"
+#include "gtest/gtest.h"
+#include "unit/test_util/test_util.h"
+
+namespace bdm {
+
+TEST(BondStoreTest, CommitAndRemap) {
+  Simulation simulation(TEST_NAME);
+  auto* rm = simulation.GetResourceManager();
+  auto* store = simulation.GetBondStore();
+
+  // agent pointers are invalidated by load balancing
+  std::vector<AgentUid> uids;
+  for (int i = 0; i < 10; ++i) {
+    auto* cell = new Cell({i * 10.0, 0, 0});
+    cell->SetDiameter(10);
+    rm->AddAgent(cell);
+    uids.push_back(cell->GetUid());
+  }
+
+  uint64_t num_created = 0;
+  uint64_t num_broken = 0;
+  uint64_t num_removed = 0;
+  BondType type;
+  type.on_create = [&](Agent*, Agent*) { num_created++; };
+  type.on_break = [&](Agent* first, Agent* second) {
+    num_broken++;
+    num_removed += first == nullptr || second == nullptr;
+  };
+  auto id = store->AddBondType(type);
+  EXPECT_EQ(1u, store->GetNumBondTypes());
+
+  // a chain of bonds
+  for (int i = 0; i < 9; ++i) {
+    store->AddBond(id, uids[i], uids[i + 1], 10);
+  }
+  EXPECT_EQ(0u, store->GetNumBonds());
+  store->Commit();
+  EXPECT_EQ(9u, store->GetNumBonds());
+  EXPECT_EQ(9u, num_created);
+
+  auto check_handles = [&]() {
+    const auto& bonds = store->GetBonds(id);
+    for (uint64_t i = 0; i < bonds.size(); ++i) {
+      EXPECT_EQ(bonds.first_uid[i], rm->GetAgent(bonds.first[i])->GetUid());
+      EXPECT_EQ(bonds.second_uid[i], rm->GetAgent(bonds.second[i])->GetUid());
+    }
+  };
+  check_handles();
+
+  simulation.GetEnvironment()->Update();
+  rm->LoadBalance();
+  store->Commit();
+  EXPECT_EQ(9u, store->GetNumBonds());
+  check_handles();
+
+  // the order of the agents does not matter
+  store->BreakBond(id, uids[5], uids[4]);
+  store->Commit();
+  EXPECT_EQ(8u, store->GetNumBonds());
+  EXPECT_EQ(1u, num_broken);
+  EXPECT_EQ(0u, num_removed);
+
+  // removing the first agent breaks its bond
+  rm->RemoveAgent(uids[0]);
+  store->Commit();
+  EXPECT_EQ(7u, store->GetNumBonds());
+  EXPECT_EQ(2u, num_broken);
+  EXPECT_EQ(1u, num_removed);
+  check_handles();
+}
+
+// A bond between a mother and its daughter is requested before the daughter
+// is added to the simulation
+TEST(BondStoreTest, BondAtDivision) {
+  Simulation simulation(TEST_NAME);
+  auto* rm = simulation.GetResourceManager();
+  auto* store = simulation.GetBondStore();
+  auto* scheduler = simulation.GetScheduler();
+
+  uint64_t num_created = 0;
+  uint64_t num_broken = 0;
+  BondType type;
+  type.on_create = [&](Agent* first, Agent* second) {
+    EXPECT_NE(nullptr, first);
+    EXPECT_NE(nullptr, second);
+    num_created++;
+  };
+  type.on_break = [&](Agent*, Agent*) { num_broken++; };
+  auto id = store->AddBondType(type);
+
+  ASSERT_EQ(0u, id);
+
+  StatelessBehavior divide([](Agent* agent) {
+    auto* sim = Simulation::GetActive();
+    if (sim->GetScheduler()->GetSimulatedSteps() != 0) {
+      return;
+    }
+    auto* mother = bdm_static_cast<Cell*>(agent);
+    auto* daughter = mother->Divide(0.5);
+    sim->GetBondStore()->AddBond(0, mother->GetUid(), daughter->GetUid(), 10);
+  });
+  auto* cell = new Cell(10);
+  cell->AddBehavior(divide.NewCopy());
+  rm->AddAgent(cell);
+  scheduler->ScheduleOp(NewOperation("bond forces"));
+
+  scheduler->Simulate(1);
+  EXPECT_EQ(2u, rm->GetNumAgents());
+  EXPECT_EQ(0u, store->GetNumBonds());
+  scheduler->Simulate(2);
+  EXPECT_EQ(1u, store->GetNumBonds());
+  EXPECT_EQ(1u, num_created);
+  EXPECT_EQ(0u, num_broken);
+
+  const auto& bonds = store->GetBonds(id);
+  EXPECT_EQ(cell->GetUid(), bonds.first_uid[0]);
+  EXPECT_EQ(cell->GetUid(), rm->GetAgent(bonds.first[0])->GetUid());
+  EXPECT_EQ(bonds.second_uid[0], rm->GetAgent(bonds.second[0])->GetUid());
+}
+
+TEST(BondForcesOpTest, StretchedBond) {
+  Simulation simulation(TEST_NAME);
+  auto* rm = simulation.GetResourceManager();
+  auto* store = simulation.GetBondStore();
+
+  auto* cell0 = new Cell({0, 0, 0});
+  auto* cell1 = new Cell({12, 0, 0});
+  auto* cell2 = new Cell({100, 0, 0});
+  for (auto* cell : {cell0, cell1, cell2}) {
+    cell->SetDiameter(10);
+    cell->SetMass(1);
+    rm->AddAgent(cell);
+  }
+
+  BondType spring;
+  spring.stiffness = 2;
+  spring.breaking_length = 50;
+  auto id = store->AddBondType(spring);
+  store->AddBond(id, cell0->GetUid(), cell1->GetUid(), 10);
+  store->AddBond(id, cell1->GetUid(), cell2->GetUid(), 10);
+
+  auto* op = NewOperation("bond forces");
+  (*op)();
+
+  // the second bond is longer than the breaking length
+  EXPECT_EQ(1u, store->GetNumBonds());
+  // force = 2 * (12 - 10) = 4, displacement = dt * force / mass
+  auto dt = simulation.GetParam()->simulation_time_step;
+  EXPECT_NEAR(4 * dt, cell0->GetPosition()[0], abs_error<real_t>::value);
+  EXPECT_NEAR(12 - 4 * dt, cell1->GetPosition()[0], abs_error<real_t>::value);
+  EXPECT_NEAR(100, cell2->GetPosition()[0], abs_error<real_t>::value);
+
+  delete op;
+}
+
+}  // namespace bdm
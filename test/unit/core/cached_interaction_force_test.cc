@@ -0,0 +1,84 @@
+// -----------------------------------------------------------------------------
+//
+// Copyright (C) 2021 CERN & University of Surrey for the benefit of the
+// BioDynaMo collaboration. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+//
+// See the LICENSE file distributed with this work for details.
+// See the NOTICE file distributed with this work for additional information
+// regarding copyright ownership.
+//
+// -----------------------------------------------------------------------------
+
+#include "core/cached_interaction_force.h"
+#include "core/agent/cell.h"
+#include "core/force_kernel.h"
+#include "gtest/gtest.h"
+#include "unit/test_util/test_util.h"
+
+namespace bdm {
+
+inline void ExpectEqualForce(const Real4& expected, const Real4& actual) {
+  for (int i = 0; i < 4; ++i) {
+    EXPECT_NEAR(expected[i], actual[i], abs_error<real_t>::value);
+  }
+}
+
+TEST(CachedInteractionForceTest, ReuseWithinTolerance) {
+  Simulation simulation(TEST_NAME);
+
+  Cell cell({1.1, 1.0, 0.9});
+  cell.SetDiameter(8);
+  Cell nb({0, 0, 0});
+  nb.SetDiameter(5);
+
+  KernelInteractionForce<> reference;
+  CachedInteractionForce force(new KernelInteractionForce<>(), 0.1);
+  force.Update();
+
+  auto expected = reference.Calculate(&cell, &nb);
+  ExpectEqualForce(expected, force.Calculate(&cell, &nb));
+  EXPECT_EQ(0u, force.GetNumHits());
+
+  // small displacement: the stored force is returned
+  force.Update();
+  nb.SetPosition({0.05, 0, 0});
+  ExpectEqualForce(expected, force.Calculate(&cell, &nb));
+  EXPECT_EQ(1u, force.GetNumHits());
+
+  // displacement larger than the tolerance: the force is recalculated
+  force.Update();
+  nb.SetPosition({0.5, 0, 0});
+  expected = reference.Calculate(&cell, &nb);
+  ExpectEqualForce(expected, force.Calculate(&cell, &nb));
+  EXPECT_EQ(1u, force.GetNumHits());
+
+  // a changed diameter invalidates the entry
+  force.Update();
+  cell.SetDiameter(9);
+  expected = reference.Calculate(&cell, &nb);
+  ExpectEqualForce(expected, force.Calculate(&cell, &nb));
+  EXPECT_EQ(1u, force.GetNumHits());
+}
+
+// Pairs that did not interact in the last iteration are removed
+TEST(CachedInteractionForceTest, Eviction) {
+  Simulation simulation(TEST_NAME);
+
+  Cell cell({1.1, 1.0, 0.9});
+  cell.SetDiameter(8);
+  Cell nb({0, 0, 0});
+  nb.SetDiameter(5);
+
+  CachedInteractionForce force(new KernelInteractionForce<>(), 0.1);
+  force.Update();
+  force.Calculate(&cell, &nb);
+  force.Update();
+  force.Update();
+  force.Calculate(&cell, &nb);
+  EXPECT_EQ(0u, force.GetNumHits());
+}
+
+}  // namespace bdm
@@ -12,6 +12,9 @@
 //
 // -----------------------------------------------------------------------------
 
+#include <cmath>
+#include <vector>
+
 #include "gtest/gtest.h"
 
 #include "core/container/math_array.h"
@@ -196,6 +199,46 @@ TEST(MathArray, NormalizeZeroVectorDeath) {
       ".*You tried to normalize a zero vector..*");
 }
 
+TEST(MathArray, SquaredNorm) {
+  Real3 a = {1, 2, 3};
+  EXPECT_REAL_EQ(14, a.SquaredNorm());
+  EXPECT_REAL_EQ(std::sqrt(14), a.Norm());
+}
+
+// The batch operations must produce the same result as the operations on
+// single arrays
+TEST(MathArray, BatchOperations) {
+  std::vector<Real3> a = {{1, 2, 3}, {-4, 0.5, 2}, {0, 0, 0}, {3, 4, 0}};
+  std::vector<Real3> b = {{3, 2, 1}, {1, 1, 1}, {5, 6, 7}, {-1, 0, 2}};
+  const uint64_t n = a.size();
+  std::vector<real_t> result(n);
+
+  DotN(a.data(), b.data(), n, result.data());
+  for (uint64_t i = 0; i < n; ++i) {
+    EXPECT_REAL_EQ(a[i] * b[i], result[i]);
+  }
+
+  SquaredNormN(a.data(), n, result.data());
+  for (uint64_t i = 0; i < n; ++i) {
+    EXPECT_REAL_EQ(a[i].SquaredNorm(), result[i]);
+  }
+
+  NormN(a.data(), n, result.data());
+  for (uint64_t i = 0; i < n; ++i) {
+    EXPECT_REAL_EQ(a[i].Norm(), result[i]);
+  }
+
+  auto normalized = a;
+  NormalizeN(normalized.data(), n);
+  for (uint64_t i = 0; i < n; ++i) {
+    // zero vectors are not modified
+    auto expected = a[i].IsZero() ? a[i] : a[i].GetNormalizedArray();
+    for (int j = 0; j < 3; ++j) {
+      EXPECT_REAL_EQ(expected[j], normalized[i][j]);
+    }
+  }
+}
+
 #ifdef USE_DICT
 TEST_F(IOTest, MathArray) {
   MathArray<real_t, 4> test{0.5, -1, 10, 500};
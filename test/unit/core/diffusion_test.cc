@@ -15,9 +15,13 @@
 #include <fstream>
 
 #include "core/agent/cell.h"
+#include "core/diffusion/adi_grid.h"
+#include "core/diffusion/amr_grid.h"
+#include "core/diffusion/bricked_grid.h"
 #include "core/diffusion/diffusion_grid.h"
 #include "core/diffusion/euler_depletion_grid.h"
 #include "core/diffusion/euler_grid.h"
+#include "core/diffusion/multi_substance_grid.h"
 #include "core/diffusion/runge_kutta_grid.h"
 #include "core/environment/environment.h"
 #include "core/model_initializer.h"
@@ -119,18 +123,161 @@ TEST(DiffusionTest, UpdateGrid) {
 
   dgrid->Update();
 
+  // The new boxes are added on the lattice of the old grid (box length 30)
+  // until the space [-90, 210] is covered
   auto d_dims = dgrid->GetDimensions();
 
-  EXPECT_EQ(-90, d_dims[0]);
-  EXPECT_EQ(-90, d_dims[2]);
-  EXPECT_EQ(-90, d_dims[4]);
-  EXPECT_EQ(210, d_dims[1]);
-  EXPECT_EQ(210, d_dims[3]);
-  EXPECT_EQ(210, d_dims[5]);
+  EXPECT_EQ(-100, d_dims[0]);
+  EXPECT_EQ(-100, d_dims[2]);
+  EXPECT_EQ(-100, d_dims[4]);
+  EXPECT_EQ(230, d_dims[1]);
+  EXPECT_EQ(230, d_dims[3]);
+  EXPECT_EQ(230, d_dims[5]);
 
   delete dgrid;
 }
 
+// Test if the diffusion grid grows beyond the simulation space with
+// Param::diffusion_grid_growth_margin, and does not grow again as long as the
+// simulation space stays within the grid
+TEST(DiffusionTest, UpdateGridWithMargin) {
+  auto set_param = [](auto* param) {
+    param->diffusion_grid_growth_margin = 0.5;
+  };
+  Simulation simulation(TEST_NAME, set_param);
+  auto* env = simulation.GetEnvironment();
+
+  CellFactory({{-10, -10, -10}, {90, 90, 90}});
+
+  EulerGrid dgrid(0, "Kalium", 0.4, 0, 6);
+
+  env->ForcedUpdate();
+  dgrid.Initialize();
+
+  CellFactory({{-30, -10, -10}, {90, 150, 90}});
+  env->ForcedUpdate();
+  dgrid.Update();
+
+  // 11 boxes are needed, 3 boxes are added on each side
+  auto dims = dgrid.GetDimensions();
+  for (int i = 0; i < 3; i++) {
+    EXPECT_EQ(-190, dims[2 * i]);
+    EXPECT_EQ(320, dims[2 * i + 1]);
+    EXPECT_EQ(17u, dgrid.GetNumBoxesArray()[i]);
+  }
+  Real3 position = {100, 100, 100};
+  dgrid.ChangeConcentrationBy(position, 5);
+
+  auto old_thresholds = env->GetDimensionThresholds();
+  CellFactory({{190, 190, 190}});
+  env->ForcedUpdate();
+  auto thresholds = env->GetDimensionThresholds();
+  ASSERT_LT(old_thresholds[1], thresholds[1]);
+  ASSERT_GE(320, thresholds[1]);
+  dgrid.Update();
+
+  EXPECT_EQ(dims, dgrid.GetDimensions());
+  EXPECT_EQ(17u * 17u * 17u, dgrid.GetNumBoxes());
+  EXPECT_REAL_EQ(5, dgrid.GetValue(position));
+}
+
+// Test if the boxes keep their position in space if the grid grows, with and
+// without Param::diffusion_grid_growth_margin
+TEST(DiffusionTest, UpdateGridKeepsDataInPlace) {
+  for (real_t margin : {0.0, 0.5}) {
+    auto set_param = [&](auto* param) {
+      param->diffusion_grid_growth_margin = margin;
+    };
+    Simulation simulation(TEST_NAME, set_param);
+    auto* env = simulation.GetEnvironment();
+
+    CellFactory({{-10, -10, -10}, {90, 90, 90}});
+
+    EulerGrid dgrid(0, "Kalium", 0.4, 0, 6);
+    env->ForcedUpdate();
+    dgrid.Initialize();
+    std::vector<Real3> markers = {{-35, -35, -35}, {25, 55, 85}, {135, 5, 5}};
+    for (size_t i = 0; i < markers.size(); i++) {
+      dgrid.ChangeConcentrationBy(markers[i], i + 1);
+    }
+
+    // The grid grows by a number of boxes that is not the same on both sides
+    CellFactory({{-30, -10, -10}, {90, 150, 90}});
+    env->ForcedUpdate();
+    dgrid.Update();
+    CellFactory({{300, 90, 90}});
+    env->ForcedUpdate();
+    dgrid.Update();
+
+    for (size_t i = 0; i < markers.size(); i++) {
+      EXPECT_REAL_EQ(i + 1, dgrid.GetValue(markers[i]));
+    }
+    auto* conc = dgrid.GetAllConcentrations();
+    real_t sum = 0;
+    for (size_t i = 0; i < dgrid.GetNumBoxes(); i++) {
+      sum += conc[i];
+    }
+    EXPECT_REAL_EQ(6, sum);
+  }
+}
+
+// Test if the boxes stay on the lattice of the old grid if the grid grows and
+// the box length is not an integer
+TEST(DiffusionTest, UpdateGridNonIntegerBoxLength) {
+  for (real_t margin : {0.0, 0.5}) {
+    auto set_param = [&](auto* param) {
+      param->diffusion_grid_growth_margin = margin;
+    };
+    Simulation simulation(TEST_NAME, set_param);
+    auto* env = simulation.GetEnvironment();
+
+    CellFactory({{-10, -10, -10}, {90, 90, 90}});
+
+    // The grid covers [-40, 140] with 7 boxes per axis
+    EulerGrid dgrid(0, "Kalium", 0.4, 0, 7);
+    env->ForcedUpdate();
+    dgrid.Initialize();
+    const real_t box_length = dgrid.GetBoxLength();
+    ASSERT_NE(std::round(box_length), box_length);
+
+    // Mark the centers of a few boxes
+    const auto old_dims = dgrid.GetDimensions();
+    std::vector<std::array<int, 3>> boxes = {{0, 0, 0}, {3, 5, 1}, {6, 6, 6}};
+    std::vector<Real3> markers;
+    for (size_t i = 0; i < boxes.size(); i++) {
+      Real3 center;
+      for (int d = 0; d < 3; d++) {
+        center[d] = old_dims[2 * d] + (boxes[i][d] + 0.5) * box_length;
+      }
+      markers.push_back(center);
+      dgrid.ChangeConcentrationBy(center, i + 1);
+    }
+
+    // The grid grows by one box below and above on the x-axis
+    CellFactory({{-45, -10, -10}, {160, 90, 90}});
+    env->ForcedUpdate();
+    dgrid.Update();
+
+    // The markers are still at the centers of their boxes
+    const auto dims = dgrid.GetDimensions();
+    ASSERT_LT(dims[0], old_dims[0]);
+    for (size_t i = 0; i < markers.size(); i++) {
+      EXPECT_REAL_EQ(i + 1, dgrid.GetValue(markers[i]));
+      const auto box = dgrid.GetBoxCoordinates(markers[i]);
+      for (int d = 0; d < 3; d++) {
+        EXPECT_NEAR(markers[i][d], dims[2 * d] + (box[d] + 0.5) * box_length,
+                    1e-6 * box_length);
+      }
+    }
+    auto* conc = dgrid.GetAllConcentrations();
+    real_t sum = 0;
+    for (size_t i = 0; i < dgrid.GetNumBoxes(); i++) {
+      sum += conc[i];
+    }
+    EXPECT_REAL_EQ(6, sum);
+  }
+}
+
 // Test if the diffusion grid does not change if the neighbor env dimensions
 // do not change
 TEST(DiffusionTest, FalseUpdateGrid) {
@@ -171,6 +318,102 @@ TEST(DiffusionTest, FalseUpdateGrid) {
   delete dgrid;
 }
 
+// Test if a flat agent layer results in fewer boxes along the z-axis if
+// Param::non_cubic_diffusion_grid is set
+TEST(DiffusionTest, NonCubicGridDimensions) {
+  auto set_param = [](auto* param) { param->non_cubic_diffusion_grid = true; };
+  Simulation simulation(TEST_NAME, set_param);
+  auto* env = simulation.GetEnvironment();
+
+  std::vector<Real3> positions;
+  for (real_t x = -10; x <= 190; x += 20) {
+    for (real_t y = -10; y <= 190; y += 20) {
+      positions.push_back({x, y, 0});
+    }
+  }
+  CellFactory(positions);
+
+  EulerGrid dgrid(0, "Kalium", 10, 0, 20);
+
+  env->ForcedUpdate();
+  dgrid.Initialize();
+  dgrid.SetBoundaryConditionType(BoundaryConditionType::kNeumann);
+  dgrid.SetBoundaryCondition(std::make_unique<ConstantBoundaryCondition>(0.0));
+
+  auto env_dims = env->GetDimensions();
+  auto dims = dgrid.GetDimensions();
+  auto num_boxes = dgrid.GetNumBoxesArray();
+  for (int i = 0; i < 6; i += 2) {
+    EXPECT_EQ(env_dims[i], dims[i]);
+    EXPECT_LE(env_dims[i + 1], dims[i + 1]);
+    EXPECT_NEAR(dims[i + 1] - dims[i],
+                num_boxes[i / 2] * dgrid.GetBoxLength(), 1);
+  }
+  EXPECT_EQ(20u, num_boxes[0]);
+  EXPECT_EQ(20u, num_boxes[1]);
+  EXPECT_LT(num_boxes[2], 10u);
+  EXPECT_EQ(num_boxes[0] * num_boxes[1] * num_boxes[2], dgrid.GetNumBoxes());
+  EXPECT_EQ(20u, dgrid.GetResolution());
+
+  // Box indices and coordinates are consistent along each axis
+  for (auto& pos : {positions.front(), positions[37], positions.back()}) {
+    auto coord = dgrid.GetBoxCoordinates(pos);
+    EXPECT_EQ(dgrid.GetBoxIndex(pos), dgrid.GetBoxIndex(coord));
+    dgrid.ChangeConcentrationBy(pos, 1e3);
+    EXPECT_REAL_EQ(1e3, dgrid.GetValue(pos));
+  }
+
+  // The substance is conserved with Neumann boundaries
+  for (int t = 0; t < 100; t++) {
+    dgrid.Diffuse(0.1);
+  }
+  auto* conc = dgrid.GetAllConcentrations();
+  real_t sum = 0;
+  for (size_t i = 0; i < dgrid.GetNumBoxes(); i++) {
+    sum += conc[i];
+  }
+  EXPECT_NEAR(3e3, sum, 1e-6);
+}
+
+// Test if ContinuumOp grows a non-cubic grid along its short axis, which does
+// not change the dimension thresholds of the environment
+TEST(DiffusionTest, NonCubicGridGrowsAlongShortAxis) {
+  auto set_param = [](auto* param) { param->non_cubic_diffusion_grid = true; };
+  Simulation simulation(TEST_NAME, set_param);
+  auto* env = simulation.GetEnvironment();
+  auto* rm = simulation.GetResourceManager();
+  auto* scheduler = simulation.GetScheduler();
+  scheduler->UnscheduleOp(scheduler->GetOps("mechanical forces")[0]);
+
+  std::vector<Real3> positions;
+  for (real_t x = -10; x <= 190; x += 20) {
+    for (real_t y = -10; y <= 190; y += 20) {
+      positions.push_back({x, y, 0});
+    }
+  }
+  CellFactory(positions);
+
+  auto* dgrid = new EulerGrid(0, "Kalium", 10, 0, 20);
+  rm->AddContinuum(dgrid);
+  scheduler->Simulate(2);
+  auto num_boxes = dgrid->GetNumBoxesArray();
+  auto thresholds = env->GetDimensionThresholds();
+
+  CellFactory({{90, 90, 60}});
+  scheduler->Simulate(1);
+  ASSERT_EQ(thresholds, env->GetDimensionThresholds());
+
+  auto env_dims = env->GetDimensions();
+  auto dims = dgrid->GetDimensions();
+  for (int i = 0; i < 6; i += 2) {
+    EXPECT_LE(dims[i], env_dims[i]);
+    EXPECT_GE(dims[i + 1], env_dims[i + 1]);
+  }
+  EXPECT_EQ(num_boxes[0], dgrid->GetNumBoxesArray()[0]);
+  EXPECT_EQ(num_boxes[1], dgrid->GetNumBoxesArray()[1]);
+  EXPECT_LT(num_boxes[2], dgrid->GetNumBoxesArray()[2]);
+}
+
 // Tests if the concentration / gradient values are correctly copied
 // after the env has grown and DiffusionGrid::CopyOldData is called
 TEST(DiffusionTest, CopyOldData) {
@@ -319,6 +562,46 @@ TEST(DiffusionTest, CopyOldData) {
   delete dgrid;
 }
 
+// Test if the boxes keep their position in space if the grid grows on one side
+// of one axis only
+TEST(DiffusionTest, CopyOldDataOneSidedGrowth) {
+  auto set_param = [](auto* param) { param->non_cubic_diffusion_grid = true; };
+  Simulation simulation(TEST_NAME, set_param);
+  auto* env = simulation.GetEnvironment();
+
+  CellFactory({{-10, -10, -10}, {90, 90, 90}});
+
+  // Box length 10
+  EulerGrid dgrid(0, "Kalium", 0.4, 0, 18);
+  env->ForcedUpdate();
+  dgrid.Initialize();
+  dgrid.SetUpperThreshold(1e15);
+  Real3 marker = {35, 5, -25};
+  dgrid.ChangeConcentrationBy(marker, 7);
+  auto old_dims = dgrid.GetDimensions();
+
+  CellFactory({{290, 50, 50}});
+  env->ForcedUpdate();
+  auto env_dims = env->GetDimensions();
+  ASSERT_EQ(old_dims[0], env_dims[0]);
+  ASSERT_LT(old_dims[1], env_dims[1]);
+  dgrid.Update();
+
+  auto dims = dgrid.GetDimensions();
+  EXPECT_EQ(old_dims[0], dims[0]);
+  EXPECT_LE(env_dims[1], dims[1]);
+  for (int i = 2; i < 6; i++) {
+    EXPECT_EQ(old_dims[i], dims[i]);
+  }
+  EXPECT_REAL_EQ(7, dgrid.GetValue(marker));
+  auto* conc = dgrid.GetAllConcentrations();
+  real_t sum = 0;
+  for (size_t i = 0; i < dgrid.GetNumBoxes(); i++) {
+    sum += conc[i];
+  }
+  EXPECT_REAL_EQ(7, sum);
+}
+
 TEST(DiffusionTest, GetBoxCoordinates) {
   Simulation simulation(TEST_NAME);
   auto* env = simulation.GetEnvironment();
@@ -525,6 +808,45 @@ TEST(DiffusionTest, ChangeConcentrationByExponential) {
   delete dgrid;
 }
 
+TEST(DiffusionTest, DeferredConcentrationChanges) {
+  auto set_param = [](auto* param) {
+    param->bound_space = Param::BoundSpaceMode::kClosed;
+    param->min_bound = -100;
+    param->max_bound = 100;
+    param->deferred_concentration_changes = true;
+  };
+  Simulation simulation(TEST_NAME, set_param);
+  simulation.GetEnvironment()->Update();
+  EulerGrid dgrid(0, "Kalium", 0, 0, 20);
+  dgrid.Initialize();
+  dgrid.SetUpperThreshold(1e15);
+
+  // Many threads change the same boxes
+  std::vector<Real3> positions = {{0, 0, 0}, {-95, -95, -95}, {95, 95, 95}};
+  const int num_changes = 10000;
+#pragma omp parallel for
+  for (int i = 0; i < num_changes; i++) {
+    dgrid.ChangeConcentrationBy(positions[i % 3], 1);
+  }
+  EXPECT_REAL_EQ(0, dgrid.GetValue(positions[0]));
+  dgrid.ApplyDeferredChanges();
+  EXPECT_REAL_EQ(3334, dgrid.GetValue(positions[0]));
+  EXPECT_REAL_EQ(3333, dgrid.GetValue(positions[1]));
+  EXPECT_REAL_EQ(3333, dgrid.GetValue(positions[2]));
+
+  // The changes of one thread are applied in order
+  dgrid.ChangeConcentrationBy(positions[0], 2, InteractionMode::kExponential);
+  dgrid.ChangeConcentrationBy(positions[0], -334);
+  dgrid.ChangeConcentrationBy(positions[1], 7 * 1000,
+                              InteractionMode::kAdditive, true);
+  dgrid.SetUpperThreshold(5000);
+  // Pending changes are applied before the diffusion step. The upper
+  // threshold is enforced after each change.
+  dgrid.Diffuse(0.1);
+  EXPECT_REAL_EQ(4666, dgrid.GetValue(positions[0]));
+  EXPECT_REAL_EQ(3340, dgrid.GetValue(positions[1]));
+}
+
 TEST(DiffusionTest, ChangeConcentrationByLogistic) {
   auto set_param = [](auto* param) {
     param->bound_space = Param::BoundSpaceMode::kClosed;
@@ -1133,6 +1455,661 @@ TEST(DiffusionTest, EulerNeumannNonZeroBoundaries) {
   rm->RemoveContinuum(0);
 }
 
+// The implicit scheme must yield the same solution as the explicit one with a
+// ten times larger time step
+TEST(DiffusionTest, ADIComparedToEuler) {
+  auto set_param = [](auto* param) {
+    param->bound_space = Param::BoundSpaceMode::kClosed;
+    param->min_bound = -100;
+    param->max_bound = 100;
+  };
+  Simulation simulation(TEST_NAME, set_param);
+  simulation.GetEnvironment()->Update();
+
+  for (auto bc_type :
+       {BoundaryConditionType::kNeumann, BoundaryConditionType::kDirichlet}) {
+    EulerGrid euler(0, "Euler", 100.0, 0.01, 20);
+    ADIGrid adi(1, "ADI", 100.0, 0.01, 20);
+    for (DiffusionGrid* dgrid : {static_cast<DiffusionGrid*>(&euler),
+                                 static_cast<DiffusionGrid*>(&adi)}) {
+      dgrid->Initialize();
+      dgrid->SetBoundaryConditionType(bc_type);
+      dgrid->SetBoundaryCondition(
+          std::make_unique<ConstantBoundaryCondition>(0.1));
+      dgrid->SetUpperThreshold(1e15);
+      dgrid->ChangeConcentrationBy({0, 0, 0}, 10);
+      dgrid->ChangeConcentrationBy({40, -30, 20}, 5);
+    }
+
+    for (int t = 0; t < 1000; t++) {
+      euler.Diffuse(0.01);
+    }
+    for (int t = 0; t < 100; t++) {
+      adi.Diffuse(0.1);
+    }
+
+    auto* expected = euler.GetAllConcentrations();
+    auto* actual = adi.GetAllConcentrations();
+    for (size_t i = 0; i < euler.GetNumBoxes(); i++) {
+      EXPECT_NEAR(expected[i], actual[i], 5e-2);
+    }
+  }
+}
+
+// Time steps far beyond the explicit stability limit must not diverge
+TEST(DiffusionTest, ADILargeTimeStep) {
+  auto set_param = [](auto* param) {
+    param->bound_space = Param::BoundSpaceMode::kClosed;
+    param->min_bound = -100;
+    param->max_bound = 100;
+    param->diffusion_method = "adi";
+  };
+  Simulation simulation(TEST_NAME, set_param);
+  simulation.GetEnvironment()->Update();
+
+  ModelInitializer::DefineSubstance(0, "Substance", 1000.0, 0.0, 20);
+  auto* dgrid = simulation.GetResourceManager()->GetDiffusionGrid(0);
+  ASSERT_NE(nullptr, dynamic_cast<ADIGrid*>(dgrid));
+  dgrid->Initialize();
+  dgrid->SetBoundaryConditionType(BoundaryConditionType::kNeumann);
+  dgrid->SetBoundaryCondition(std::make_unique<ConstantBoundaryCondition>(0));
+  dgrid->SetUpperThreshold(1e15);
+  const real_t init = 1e3;
+  dgrid->ChangeConcentrationBy({0, 0, 0}, init);
+
+  // The explicit scheme requires dt < 0.017
+  for (int t = 0; t < 10; t++) {
+    dgrid->Diffuse(10);
+  }
+
+  // Zero flux boundaries conserve the total amount, which is distributed
+  // evenly after a long time
+  auto* conc = dgrid->GetAllConcentrations();
+  real_t total = 0;
+  for (size_t i = 0; i < dgrid->GetNumBoxes(); i++) {
+    total += conc[i];
+    EXPECT_NEAR(init / dgrid->GetNumBoxes(), conc[i], 1e-3);
+  }
+  EXPECT_NEAR(init, total, 1e-6);
+}
+
+// Fused steps with temporal blocking must yield the same concentrations as
+// single steps
+TEST(DiffusionTest, EulerTemporalBlocking) {
+  double simulation_time_step{0.1};
+  auto set_param = [](auto* param) {
+    param->bound_space = Param::BoundSpaceMode::kClosed;
+    param->min_bound = -100;
+    param->max_bound = 100;
+    param->diffusion_temporal_blocking = 4;
+    param->diffusion_tile_size = 8;
+  };
+  Simulation simulation(TEST_NAME, set_param);
+  simulation.GetEnvironment()->Update();
+
+  for (auto bc_type : {BoundaryConditionType::kNeumann,
+                       BoundaryConditionType::kDirichlet,
+                       BoundaryConditionType::kClosedBoundaries}) {
+    EulerGrid reference(0, "Reference", 10.0, 0.01, 20);
+    EulerGrid blocked(1, "Blocked", 10.0, 0.01, 20);
+    for (auto* dgrid : {&reference, &blocked}) {
+      dgrid->Initialize();
+      dgrid->SetBoundaryConditionType(bc_type);
+      dgrid->SetBoundaryCondition(
+          std::make_unique<ConstantBoundaryCondition>(0.5));
+      dgrid->SetUpperThreshold(1e15);
+      dgrid->ChangeConcentrationBy({0, 0, 0}, 1e3);
+      dgrid->ChangeConcentrationBy({50, -20, 30}, 2e3);
+      dgrid->ChangeConcentrationBy({-90, 90, -90}, 5e2);
+    }
+
+    // 10 steps are fused into 4 + 4 + 2 steps
+    for (int t = 0; t < 10; t++) {
+      reference.Diffuse(simulation_time_step);
+    }
+    blocked.MultiStep(simulation_time_step, 10);
+
+    auto* expected = reference.GetAllConcentrations();
+    auto* actual = blocked.GetAllConcentrations();
+    for (size_t i = 0; i < reference.GetNumBoxes(); i++) {
+      EXPECT_NEAR(expected[i], actual[i], 1e-6);
+    }
+  }
+}
+
+// Open boundaries are not fused and yield the same concentrations as single
+// steps, also for substance that touches the faces of the grid
+TEST(DiffusionTest, EulerTemporalBlockingOpenBoundaries) {
+  double simulation_time_step{0.1};
+  auto set_param = [](auto* param) {
+    param->bound_space = Param::BoundSpaceMode::kClosed;
+    param->min_bound = -100;
+    param->max_bound = 100;
+    param->diffusion_temporal_blocking = 4;
+    param->diffusion_tile_size = 8;
+  };
+  Simulation simulation(TEST_NAME, set_param);
+  simulation.GetEnvironment()->Update();
+
+  EulerGrid reference(0, "Reference", 10.0, 0.01, 20);
+  EulerGrid blocked(1, "Blocked", 10.0, 0.01, 20);
+  EulerGrid::ExplicitStencil stencil;
+  for (auto* dgrid : {&reference, &blocked}) {
+    dgrid->Initialize();
+    dgrid->SetBoundaryConditionType(BoundaryConditionType::kOpenBoundaries);
+    dgrid->SetUpperThreshold(1e15);
+    EXPECT_FALSE(dgrid->GetExplicitStencil(simulation_time_step, &stencil));
+    // one source on each face of the grid
+    dgrid->ChangeConcentrationBy({-95, 0, 0}, 1e3);
+    dgrid->ChangeConcentrationBy({95, 20, -30}, 2e3);
+    dgrid->ChangeConcentrationBy({10, -95, 40}, 5e2);
+    dgrid->ChangeConcentrationBy({-40, 95, 5}, 7e2);
+    dgrid->ChangeConcentrationBy({60, -60, -95}, 3e3);
+    dgrid->ChangeConcentrationBy({95, 95, 95}, 4e2);
+  }
+
+  for (int t = 0; t < 10; t++) {
+    reference.Diffuse(simulation_time_step);
+  }
+  blocked.MultiStep(simulation_time_step, 10);
+
+  auto* expected = reference.GetAllConcentrations();
+  auto* actual = blocked.GetAllConcentrations();
+  for (size_t i = 0; i < reference.GetNumBoxes(); i++) {
+    EXPECT_REAL_EQ(expected[i], actual[i]);
+  }
+}
+
+TEST(DiffusionTest, EulerDepletionTemporalBlocking) {
+  double simulation_time_step{0.1};
+  auto set_param = [](auto* param) {
+    param->bound_space = Param::BoundSpaceMode::kClosed;
+    param->min_bound = -100;
+    param->max_bound = 100;
+    param->diffusion_temporal_blocking = 4;
+    param->diffusion_tile_size = 8;
+  };
+  Simulation simulation(TEST_NAME, set_param);
+  simulation.GetEnvironment()->Update();
+  auto* rm = simulation.GetResourceManager();
+
+  // Depleting substance is fixed, i.e. no diff and no decay
+  auto* depleting = new EulerGrid(0, "MMP", 0, 0, 20);
+  depleting->Initialize();
+  depleting->SetUpperThreshold(1e15);
+  depleting->ChangeConcentrationBy({0, 0, 0}, 1);
+  depleting->ChangeConcentrationBy({50, -20, 30}, 2);
+  depleting->ChangeConcentrationBy({-90, 90, -90}, 5);
+  rm->AddContinuum(depleting);
+
+  // kClosedBoundaries falls back to single steps
+  for (auto bc_type : {BoundaryConditionType::kNeumann,
+                       BoundaryConditionType::kDirichlet,
+                       BoundaryConditionType::kClosedBoundaries}) {
+    EulerDepletionGrid reference(1, "Reference", 10.0, 0.01, 20);
+    EulerDepletionGrid blocked(2, "Blocked", 10.0, 0.01, 20);
+    for (auto* dgrid : {&reference, &blocked}) {
+      dgrid->Initialize();
+      dgrid->SetBoundaryConditionType(bc_type);
+      dgrid->SetBoundaryCondition(
+          std::make_unique<ConstantBoundaryCondition>(0.5));
+      dgrid->SetUpperThreshold(1e15);
+      dgrid->SetBindingSubstance(depleting->GetContinuumId(), 0.01);
+      dgrid->ChangeConcentrationBy({0, 0, 0}, 1e3);
+      dgrid->ChangeConcentrationBy({50, -20, 30}, 2e3);
+      dgrid->ChangeConcentrationBy({-90, 90, -90}, 5e2);
+    }
+
+    for (int t = 0; t < 10; t++) {
+      reference.Diffuse(simulation_time_step);
+    }
+    blocked.MultiStep(simulation_time_step, 10);
+
+    auto* expected = reference.GetAllConcentrations();
+    auto* actual = blocked.GetAllConcentrations();
+    for (size_t i = 0; i < reference.GetNumBoxes(); i++) {
+      EXPECT_NEAR(expected[i], actual[i], 1e-6);
+    }
+  }
+}
+
+TEST(DiffusionTest, RungeKuttaTemporalBlocking) {
+  double simulation_time_step{0.1};
+  auto set_param = [](auto* param) {
+    param->bound_space = Param::BoundSpaceMode::kClosed;
+    param->min_bound = -100;
+    param->max_bound = 100;
+    param->diffusion_temporal_blocking = 4;
+    param->diffusion_tile_size = 8;
+  };
+  Simulation simulation(TEST_NAME, set_param);
+  simulation.GetEnvironment()->Update();
+
+  RungeKuttaGrid reference(0, "Reference", 0.5, 20);
+  RungeKuttaGrid blocked(1, "Blocked", 0.5, 20);
+  for (auto* dgrid : {&reference, &blocked}) {
+    dgrid->Initialize();
+    dgrid->SetBoundaryConditionType(BoundaryConditionType::kClosedBoundaries);
+    dgrid->SetUpperThreshold(1e15);
+    dgrid->ChangeConcentrationBy({0, 0, 0}, 1e3);
+    dgrid->ChangeConcentrationBy({50, -20, 30}, 2e3);
+    dgrid->ChangeConcentrationBy({-50, 50, -50}, 5e2);
+  }
+
+  for (int t = 0; t < 10; t++) {
+    reference.Diffuse(simulation_time_step);
+  }
+  blocked.MultiStep(simulation_time_step, 10);
+
+  auto* expected = reference.GetAllConcentrations();
+  auto* actual = blocked.GetAllConcentrations();
+  for (size_t i = 0; i < reference.GetNumBoxes(); i++) {
+    EXPECT_NEAR(expected[i], actual[i], 1e-6);
+  }
+}
+
+TEST(DiffusionTest, MultiSubstanceGridComparedToEuler) {
+  double simulation_time_step{0.1};
+  auto set_param = [](auto* param) {
+    param->bound_space = Param::BoundSpaceMode::kClosed;
+    param->min_bound = -100;
+    param->max_bound = 100;
+  };
+  Simulation simulation(TEST_NAME, set_param);
+  simulation.GetEnvironment()->Update();
+  auto* rm = simulation.GetResourceManager();
+
+  std::vector<std::array<real_t, 2>> parameters = {
+      {10.0, 0.01}, {2.0, 0.1}, {20.0, 0}};
+  for (auto bc_type : {BoundaryConditionType::kNeumann,
+                       BoundaryConditionType::kClosedBoundaries}) {
+    auto* grid = new MultiSubstanceGrid(10, "Group", 20);
+    rm->AddContinuum(grid);
+    grid->SetBoundaryConditionType(bc_type);
+    std::vector<std::unique_ptr<EulerGrid>> reference;
+    for (size_t i = 0; i < parameters.size(); i++) {
+      rm->AddContinuum(grid->AddSubstance(i, "Substance",
+                                          parameters[i][0],
+                                          parameters[i][1]));
+      reference.push_back(std::make_unique<EulerGrid>(
+          20 + i, "Reference", parameters[i][0], parameters[i][1], 20));
+    }
+    grid->Initialize();
+
+    std::vector<Real3> positions = {{0, 0, 0}, {50, -20, 30}, {-85, 85, -85}};
+    for (size_t i = 0; i < parameters.size(); i++) {
+      auto* field = dynamic_cast<SubstanceField*>(rm->GetContinuum(i));
+      ASSERT_NE(nullptr, field);
+      reference[i]->Initialize();
+      reference[i]->SetBoundaryConditionType(bc_type);
+      reference[i]->SetUpperThreshold(1e15);
+      for (size_t p = 0; p < positions.size(); p++) {
+        reference[i]->ChangeConcentrationBy(positions[p], 1e3 * (i + p + 1));
+        field->ChangeConcentrationBy(positions[p], 1e3 * (i + p + 1));
+      }
+    }
+
+    for (int t = 0; t < 10; t++) {
+      for (auto& dgrid : reference) {
+        dgrid->Diffuse(simulation_time_step);
+      }
+    }
+    grid->MultiStep(simulation_time_step, 10);
+    grid->CalculateGradient();
+
+    for (size_t i = 0; i < parameters.size(); i++) {
+      auto* field = dynamic_cast<ScalarField*>(rm->GetContinuum(i));
+      reference[i]->CalculateGradient();
+      auto* expected = reference[i]->GetAllConcentrations();
+      for (size_t b = 0; b < reference[i]->GetNumBoxes(); b++) {
+        EXPECT_NEAR(expected[b], grid->GetConcentration(i, b), 1e-6);
+      }
+      for (auto& position : positions) {
+        EXPECT_NEAR(reference[i]->GetValue(position),
+                    field->GetValue(position), 1e-6);
+        auto expected_gradient = reference[i]->GetGradient(position);
+        auto gradient = field->GetGradient(position);
+        for (size_t d = 0; d < 3; d++) {
+          EXPECT_NEAR(expected_gradient[d], gradient[d], 1e-6);
+        }
+      }
+    }
+
+    for (size_t i = 0; i < parameters.size(); i++) {
+      rm->RemoveContinuum(i);
+    }
+    rm->RemoveContinuum(10);
+  }
+}
+
+// Without refined blocks, the AMR grid reduces to the Euler method
+TEST(DiffusionTest, AMRGridWithoutRefinementComparedToEuler) {
+  double simulation_time_step{0.1};
+  auto set_param = [](auto* param) {
+    param->bound_space = Param::BoundSpaceMode::kClosed;
+    param->min_bound = -100;
+    param->max_bound = 100;
+  };
+  Simulation simulation(TEST_NAME, set_param);
+  simulation.GetEnvironment()->Update();
+
+  EulerGrid reference(0, "Reference", 10.0, 0.01, 20);
+  AMRGrid amr(1, "AMR", 10.0, 0.01, 20, 4, 2);
+  reference.Initialize();
+  reference.SetBoundaryConditionType(BoundaryConditionType::kNeumann);
+  reference.SetUpperThreshold(1e15);
+  amr.Initialize();
+  EXPECT_EQ(0u, amr.GetNumRefinedBlocks());
+
+  for (auto& position : std::vector<Real3>{{0, 0, 0}, {50, -20, 30}}) {
+    reference.ChangeConcentrationBy(position, 1e3);
+    amr.ChangeConcentrationBy(position, 1e3);
+  }
+  for (int t = 0; t < 50; t++) {
+    reference.Diffuse(simulation_time_step);
+    amr.Step(simulation_time_step);
+  }
+
+  for (size_t i = 0; i < reference.GetNumBoxes(); i++) {
+    auto coord = reference.GetBoxCoordinates(i);
+    Real3 center = {-95.0 + 10 * coord[0], -95.0 + 10 * coord[1],
+                    -95.0 + 10 * coord[2]};
+    EXPECT_NEAR(reference.GetValue(center), amr.GetValue(center), 1e-9);
+  }
+}
+
+// Tests that blocks with agents are refined, that refinement and coarsening
+// conserve the substance, and that the refined solution is closer to a
+// uniformly fine grid than the coarse one
+TEST(DiffusionTest, AMRGridRefinement) {
+  double simulation_time_step{0.1};
+  auto set_param = [](auto* param) {
+    param->bound_space = Param::BoundSpaceMode::kClosed;
+    param->min_bound = -100;
+    param->max_bound = 100;
+  };
+  Simulation simulation(TEST_NAME, set_param);
+  auto* rm = simulation.GetResourceManager();
+  CellFactory({{1, 1, 1}, {-50, 50, 0}});
+  simulation.GetEnvironment()->Update();
+
+  AMRGrid amr(0, "AMR", 10.0, 0, 20, 4, 2);
+  amr.SetRegridInterval(0);
+  amr.Initialize();
+  EXPECT_EQ(2u, amr.GetNumRefinedBlocks());
+  EXPECT_TRUE(amr.IsRefined({1, 1, 1}));
+  EXPECT_TRUE(amr.IsRefined({-50, 50, 0}));
+  EXPECT_FALSE(amr.IsRefined({60, 60, 60}));
+  EXPECT_REAL_EQ(5, amr.GetFineBoxLength());
+
+  EulerGrid fine(1, "Fine", 10.0, 0, 40);
+  EulerGrid coarse(2, "Coarse", 10.0, 0, 20);
+  for (auto* dgrid : {&fine, &coarse}) {
+    dgrid->Initialize();
+    dgrid->SetBoundaryConditionType(BoundaryConditionType::kNeumann);
+    dgrid->SetUpperThreshold(1e15);
+  }
+  // The same amount of substance on each grid
+  amr.ChangeConcentrationBy({1, 1, 1}, 1e3);
+  fine.ChangeConcentrationBy({1, 1, 1}, 8e3);
+  coarse.ChangeConcentrationBy({1, 1, 1}, 1e3);
+  amr.ChangeConcentrationBy({60, 60, 60}, 1e3);
+  const real_t amount = amr.GetTotalAmount();
+  EXPECT_NEAR(2e6, amount, 1e-5 * amount);
+
+  for (int t = 0; t < 100; t++) {
+    fine.Diffuse(simulation_time_step);
+    coarse.Diffuse(simulation_time_step);
+    amr.Step(simulation_time_step);
+  }
+  for (auto& position :
+       std::vector<Real3>{{1, 1, 1}, {11, 1, 1}, {1, -9, 1}, {26, 1, 1}}) {
+    EXPECT_LT(std::abs(amr.GetValue(position) - fine.GetValue(position)),
+              std::abs(coarse.GetValue(position) - fine.GetValue(position)));
+  }
+  auto gradient = amr.GetGradient({11, 1, 1});
+  EXPECT_GT(0, gradient[0]);
+
+  // Move the agents: the old blocks are coarsened and a new block is refined
+  rm->GetAgent(AgentUid(0))->SetPosition({60, 60, 60});
+  rm->GetAgent(AgentUid(1))->SetPosition({60, 60, 60});
+  amr.Update();
+  EXPECT_EQ(1u, amr.GetNumRefinedBlocks());
+  EXPECT_FALSE(amr.IsRefined({1, 1, 1}));
+  EXPECT_TRUE(amr.IsRefined({60, 60, 60}));
+  EXPECT_NEAR(amount, amr.GetTotalAmount(), 1e-5 * amount);
+  for (int t = 0; t < 100; t++) {
+    amr.Step(simulation_time_step);
+  }
+  EXPECT_NEAR(amount, amr.GetTotalAmount(), 1e-5 * amount);
+}
+
+// ChangeConcentrationBy adds the same amount of substance to refined and to
+// coarse blocks
+TEST(DiffusionTest, AMRGridSecretionDuringRefinement) {
+  double simulation_time_step{0.1};
+  auto set_param = [](auto* param) {
+    param->bound_space = Param::BoundSpaceMode::kClosed;
+    param->min_bound = -100;
+    param->max_bound = 100;
+  };
+  Simulation simulation(TEST_NAME, set_param);
+  auto* rm = simulation.GetResourceManager();
+  CellFactory({{-50, -50, -50}});
+  simulation.GetEnvironment()->Update();
+
+  AMRGrid amr(0, "AMR", 10.0, 0, 20, 4, 2);
+  amr.SetRegridInterval(0);
+  amr.Initialize();
+  const Real3 source = {1, 1, 1};
+  ASSERT_FALSE(amr.IsRefined(source));
+  const real_t box_volume = std::pow(amr.GetCoarseBoxLength(), 3);
+
+  for (int t = 0; t < 20; t++) {
+    if (t == 10) {
+      // Refine the block of the source
+      rm->GetAgent(AgentUid(0))->SetPosition(source);
+      amr.Update();
+      ASSERT_TRUE(amr.IsRefined(source));
+    }
+    amr.ChangeConcentrationBy(source, 1e2);
+    amr.Step(simulation_time_step);
+    const real_t expected = (t + 1) * 1e2 * box_volume;
+    EXPECT_NEAR(expected, amr.GetTotalAmount(), 1e-6 * expected);
+  }
+}
+
+// The bricked storage must not change the result of the Euler method. A
+// resolution of 20 leaves partially filled bricks at the upper boundary.
+TEST(DiffusionTest, BrickedGridComparedToEuler) {
+  double simulation_time_step{0.1};
+  auto set_param = [](auto* param) {
+    param->bound_space = Param::BoundSpaceMode::kClosed;
+    param->min_bound = -100;
+    param->max_bound = 100;
+  };
+  Simulation simulation(TEST_NAME, set_param);
+  simulation.GetEnvironment()->Update();
+
+  auto initializer = [](real_t x, real_t y, real_t z) {
+    return x > 50 ? 1.0 : 0.0;
+  };
+  EulerGrid reference(0, "Reference", 10.0, 0.01, 20);
+  BrickedGrid bricked(1, "Bricked", 10.0, 0.01, 20);
+  reference.AddInitializer(initializer);
+  bricked.AddInitializer(initializer);
+  reference.Initialize();
+  reference.SetBoundaryConditionType(BoundaryConditionType::kNeumann);
+  reference.SetUpperThreshold(1e15);
+  reference.RunInitializers();
+  bricked.Initialize();
+  EXPECT_EQ(27u, bricked.GetNumBricks());
+  EXPECT_EQ(reference.GetNumBoxes(), bricked.GetNumBoxes());
+
+  for (auto& position :
+       std::vector<Real3>{{0, 0, 0}, {50, -20, 30}, {99, 99, 99}}) {
+    reference.ChangeConcentrationBy(position, 1e3);
+    bricked.ChangeConcentrationBy(position, 1e3);
+  }
+  for (int t = 0; t < 50; t++) {
+    reference.Diffuse(simulation_time_step);
+    bricked.Step(simulation_time_step);
+  }
+
+  std::vector<real_t> concentrations(bricked.GetNumBoxes());
+  bricked.CopyConcentrations(concentrations.data());
+  const auto* expected = reference.GetAllConcentrations();
+  real_t amount = 0;
+  for (size_t i = 0; i < reference.GetNumBoxes(); i++) {
+    auto coord = reference.GetBoxCoordinates(i);
+    Real3 center = {-95.0 + 10 * coord[0], -95.0 + 10 * coord[1],
+                    -95.0 + 10 * coord[2]};
+    EXPECT_NEAR(expected[i], bricked.GetValue(center), 1e-9);
+    EXPECT_NEAR(expected[i], concentrations[i], 1e-9);
+    amount += expected[i] * 1000;
+  }
+  EXPECT_NEAR(amount, bricked.GetTotalAmount(), 1e-9 * amount);
+}
+
+// Bricks far away from the source are skipped without changing the result
+TEST(DiffusionTest, BrickedGridSkipsInactiveBricks) {
+  double simulation_time_step{0.1};
+  auto set_param = [](auto* param) {
+    param->bound_space = Param::BoundSpaceMode::kClosed;
+    param->min_bound = -100;
+    param->max_bound = 100;
+  };
+  Simulation simulation(TEST_NAME, set_param);
+  simulation.GetEnvironment()->Update();
+
+  BrickedGrid skipping(0, "Skipping", 10.0, 0.01, 40);
+  BrickedGrid reference(1, "Reference", 10.0, 0.01, 40);
+  reference.SetActivityThreshold(-1);
+  skipping.Initialize();
+  reference.Initialize();
+  EXPECT_EQ(125u, skipping.GetNumBricks());
+
+  auto step = [&]() {
+    skipping.Step(simulation_time_step);
+    reference.Step(simulation_time_step);
+  };
+  skipping.ChangeConcentrationBy({-99, -99, -99}, 1e3);
+  reference.ChangeConcentrationBy({-99, -99, -99}, 1e3);
+  for (int t = 0; t < 10; t++) {
+    step();
+  }
+  EXPECT_EQ(125u, reference.GetNumActiveBricks());
+  const auto num_active = skipping.GetNumActiveBricks();
+  EXPECT_LT(num_active, 30u);
+
+  // A new source wakes up its brick
+  skipping.ChangeConcentrationBy({99, 99, 99}, 1e3);
+  reference.ChangeConcentrationBy({99, 99, 99}, 1e3);
+  step();
+  EXPECT_LT(num_active, skipping.GetNumActiveBricks());
+  for (int t = 0; t < 10; t++) {
+    step();
+  }
+
+  std::vector<real_t> expected(reference.GetNumBoxes());
+  std::vector<real_t> actual(skipping.GetNumBoxes());
+  reference.CopyConcentrations(expected.data());
+  skipping.CopyConcentrations(actual.data());
+  for (size_t i = 0; i < expected.size(); i++) {
+    EXPECT_REAL_EQ(expected[i], actual[i]);
+  }
+  EXPECT_LT(0, skipping.GetValue({99, 99, 99}));
+}
+
+// Sources at the faces of a brick (local coordinate 7) must wake up the
+// neighboring bricks, otherwise the flux across the face is lost
+TEST(DiffusionTest, BrickedGridSourceAtBrickFace) {
+  double simulation_time_step{0.1};
+  auto set_param = [](auto* param) {
+    param->bound_space = Param::BoundSpaceMode::kClosed;
+    param->min_bound = -100;
+    param->max_bound = 100;
+  };
+  Simulation simulation(TEST_NAME, set_param);
+  simulation.GetEnvironment()->Update();
+
+  // Box length 5, i.e. the bricks are 40 units wide
+  BrickedGrid skipping(0, "Skipping", 10.0, 0.01, 40);
+  BrickedGrid reference(1, "Reference", 10.0, 0.01, 40);
+  reference.SetActivityThreshold(-1);
+  skipping.Initialize();
+  reference.Initialize();
+  for (int t = 0; t < 2; t++) {
+    skipping.Step(simulation_time_step);
+    reference.Step(simulation_time_step);
+  }
+  EXPECT_EQ(0u, skipping.GetNumActiveBricks());
+
+  const std::vector<Real3> sources = {
+      {-62.5, -62.5, -62.5}, {-57.5, 0, 0}, {2.5, 17.5, -22.5}};
+  const real_t box_volume = 125;
+  real_t expected = 0;
+  for (int t = 0; t < 10; t++) {
+    for (auto& source : sources) {
+      skipping.ChangeConcentrationBy(source, 1e2);
+      reference.ChangeConcentrationBy(source, 1e2);
+    }
+    skipping.Step(simulation_time_step);
+    reference.Step(simulation_time_step);
+    expected = (expected + sources.size() * 1e2 * box_volume) *
+               (1 - 0.01 * simulation_time_step);
+  }
+
+  std::vector<real_t> expected_values(reference.GetNumBoxes());
+  std::vector<real_t> actual(skipping.GetNumBoxes());
+  reference.CopyConcentrations(expected_values.data());
+  skipping.CopyConcentrations(actual.data());
+  for (size_t i = 0; i < expected_values.size(); i++) {
+    EXPECT_REAL_EQ(expected_values[i], actual[i]);
+  }
+  EXPECT_NEAR(expected, skipping.GetTotalAmount(), 1e-9 * expected);
+  EXPECT_NEAR(expected, reference.GetTotalAmount(), 1e-9 * expected);
+}
+
+// The bricked grid grows with the simulation space and keeps the
+// concentrations in place
+TEST(DiffusionTest, BrickedGridUpdate) {
+  Simulation simulation(TEST_NAME);
+  auto* env = simulation.GetEnvironment();
+
+  CellFactory({{-10, -10, -10}, {90, 90, 90}});
+  env->ForcedUpdate();
+  BrickedGrid grid(0, "Kalium", 0.4, 0, 6);
+  grid.Initialize();
+  const auto old_dims = grid.GetDimensions();
+  const auto old_resolution = grid.GetResolution();
+  std::vector<Real3> markers = {{-5, -5, -5}, {25, 55, 85}, {85, 5, 5}};
+  for (size_t i = 0; i < markers.size(); i++) {
+    grid.ChangeConcentrationBy(markers[i], i + 1);
+  }
+  const real_t amount = grid.GetTotalAmount();
+
+  CellFactory({{-30, -10, -10}, {90, 250, 90}});
+  env->ForcedUpdate();
+  grid.Update();
+
+  const auto dims = grid.GetDimensions();
+  const auto thresholds = env->GetDimensionThresholds();
+  EXPECT_LT(old_resolution, grid.GetResolution());
+  EXPECT_GE(thresholds[0], dims[0]);
+  EXPECT_LE(thresholds[1], dims[1]);
+  EXPECT_REAL_EQ(old_dims[1] - old_dims[0],
+                 old_resolution * grid.GetBoxLength());
+  for (size_t i = 0; i < markers.size(); i++) {
+    EXPECT_REAL_EQ(i + 1, grid.GetValue(markers[i]));
+  }
+  EXPECT_REAL_EQ(amount, grid.GetTotalAmount());
+
+  // The grid does not change as long as the space stays within it
+  grid.Update();
+  EXPECT_EQ(dims, grid.GetDimensions());
+}
+
 TEST(DiffusionTest, DynamicTimeStepping) {
   auto set_param = [](auto* param) {
     param->bound_space = Param::BoundSpaceMode::kClosed;
@@ -1428,6 +2405,96 @@ TEST(DiffusionTest, LazyGradientComputation) {
   }
 }
 
+// The batch version must return the same (normalized) gradients
+TEST(DiffusionTest, GetGradients) {
+  auto set_param = [](auto* param) {
+    param->bound_space = Param::BoundSpaceMode::kClosed;
+    param->min_bound = 0;
+    param->max_bound = 100;
+  };
+  Simulation simulation(TEST_NAME, set_param);
+  auto* rm = simulation.GetResourceManager();
+  auto* param = simulation.GetParam();
+  rm->AddAgent(new Cell({50, 50, 50}));
+
+  DiffusionGrid* d_grid = new EulerGrid(0, "Substance", 0.0, 0.0, 20);
+  rm->AddContinuum(d_grid);
+  ModelInitializer::InitializeSubstance(0, [&](real_t x, real_t y, real_t z) {
+    return x * x + 2 * y + std::sin(z / param->max_bound);
+  });
+  simulation.GetScheduler()->Simulate(1);
+
+  auto* random = simulation.GetRandom();
+  std::vector<Real3> positions(100);
+  for (auto& position : positions) {
+    position = random->UniformArray<3>(1, 99);
+  }
+
+  for (bool normalize : {false, true}) {
+    std::vector<Real3> gradients(positions.size());
+    d_grid->GetGradients(positions.data(), positions.size(), gradients.data(),
+                         normalize);
+    for (uint64_t i = 0; i < positions.size(); ++i) {
+      Real3 expected;
+      d_grid->GetGradient(positions[i], &expected, normalize);
+      for (int j = 0; j < 3; ++j) {
+        EXPECT_NEAR(expected[j], gradients[i][j], abs_error<real_t>::value);
+      }
+    }
+  }
+}
+
+TEST(DiffusionTest, GetValuesInterpolated) {
+  auto set_param = [](auto* param) {
+    param->bound_space = Param::BoundSpaceMode::kClosed;
+    param->min_bound = 0;
+    param->max_bound = 100;
+  };
+  Simulation simulation(TEST_NAME, set_param);
+  auto* rm = simulation.GetResourceManager();
+  rm->AddAgent(new Cell({50, 50, 50}));
+
+  // Linear field. The initializer is evaluated at the lower corner of each
+  // box, i.e. half a box length below the center.
+  auto field = [](real_t x, real_t y, real_t z) {
+    return 2 * x + 3 * y - z + 500;
+  };
+  DiffusionGrid* d_grid = new EulerGrid(0, "Substance", 0.0, 0.0, 20);
+  rm->AddContinuum(d_grid);
+  ModelInitializer::InitializeSubstance(0, field);
+  simulation.GetScheduler()->Simulate(1);
+  const real_t half_box = d_grid->GetBoxLength() / 2;
+
+  auto* random = simulation.GetRandom();
+  std::vector<Real3> positions(100);
+  for (auto& position : positions) {
+    position = random->UniformArray<3>(half_box, 100 - half_box);
+  }
+  positions.push_back({-1, 50, 50});
+
+  std::vector<real_t> values(positions.size());
+  std::vector<real_t> interpolated(positions.size());
+  std::vector<Real3> gradients(positions.size());
+  d_grid->GetValues(positions.data(), positions.size(), values.data());
+  d_grid->GetValues(positions.data(), positions.size(), interpolated.data(),
+                    true);
+  d_grid->GetGradients(positions.data(), positions.size(), gradients.data(),
+                       false, true);
+  for (uint64_t i = 0; i < positions.size() - 1; ++i) {
+    auto& p = positions[i];
+    EXPECT_REAL_EQ(d_grid->GetValue(p), values[i]);
+    EXPECT_NEAR(field(p[0] - half_box, p[1] - half_box, p[2] - half_box),
+                interpolated[i], 1e-6);
+    EXPECT_NEAR(2, gradients[i][0], 1e-6);
+    EXPECT_NEAR(3, gradients[i][1], 1e-6);
+    EXPECT_NEAR(-1, gradients[i][2], 1e-6);
+  }
+  // Positions outside of the grid
+  EXPECT_EQ(0, values.back());
+  EXPECT_EQ(0, interpolated.back());
+  EXPECT_EQ(Real3({0, 0, 0}), gradients.back());
+}
+
 TEST(DiffusionTest, PrintInfoBeforeInititialization) {
   Simulation simulation(TEST_NAME);
 
@@ -103,6 +103,39 @@ TEST(KDTreeTest, Setup) {
   EXPECT_EQ(expected_63, neighbors[AgentUid(63)]);
 }
 
+// The kd-tree operates on a snapshot of the agent positions. Test that the
+// snapshot is refreshed if agents move.
+TEST(KDTreeTest, UpdatePositions) {
+  auto set_param = [](auto* param) { param->environment = "kd_tree"; };
+  Simulation simulation(TEST_NAME, set_param);
+  auto* rm = simulation.GetResourceManager();
+  auto* kdtree = simulation.GetEnvironment();
+
+  CellFactory(rm, 4);
+  kdtree->Update();
+
+  std::unordered_map<AgentUid, std::vector<AgentUid>> neighbors;
+  real_t search_radius_squared = 1201;
+  auto* cell = rm->GetAgent(AgentUid(0));
+  FillNeighborList fill_neighbor_list(&neighbors, cell->GetUid());
+  kdtree->ForEachNeighbor(fill_neighbor_list, *cell, search_radius_squared);
+  EXPECT_EQ(7u, neighbors[AgentUid(0)].size());
+
+  // move cell 0 away from all other cells
+  cell->SetPosition({-1000, -1000, -1000});
+  kdtree->ForcedUpdate();
+
+  neighbors.clear();
+  kdtree->ForEachNeighbor(fill_neighbor_list, *cell, search_radius_squared);
+  EXPECT_EQ(0u, neighbors[AgentUid(0)].size());
+
+  auto dims = kdtree->GetDimensions();
+  EXPECT_EQ(-1000, dims[0]);
+  EXPECT_EQ(60, dims[1]);
+  EXPECT_EQ(-1000, dims[4]);
+  EXPECT_EQ(60, dims[5]);
+}
+
 // Test if SetEnvironment method works correctly for KDTreeEnvironment.
 TEST(KDTreeTest, SetEnvironment) {
   Simulation simulation(TEST_NAME);
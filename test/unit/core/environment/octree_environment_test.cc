@@ -13,6 +13,7 @@
 // -----------------------------------------------------------------------------
 
 #include "core/environment/octree_environment.h"
+#include <random>
 #include "core/agent/cell.h"
 #include "unit/core/count_neighbor_functor.h"
 #include "unit/test_util/test_util.h"
@@ -128,4 +129,110 @@ TEST(OctreeTest, FindAllNeighbors) {
   TestNeighborSearch(simulation);
 }
 
+// Compares the result of LinearOctree::ForEachPointInRadius with a brute
+// force search.
+inline void CompareWithBruteForce(const LinearOctree& octree,
+                                  const std::vector<Real3>& points,
+                                  real_t squared_radius) {
+  for (uint64_t q = 0; q < points.size(); q += 7) {
+    std::vector<uint32_t> expected;
+    for (uint64_t i = 0; i < points.size(); ++i) {
+      auto diff = points[i] - points[q];
+      if (diff * diff < squared_radius) {
+        expected.push_back(static_cast<uint32_t>(i));
+      }
+    }
+    std::vector<uint32_t> actual;
+    octree.ForEachPointInRadius(points[q], squared_radius,
+                                [&](uint32_t idx, real_t squared_distance) {
+                                  actual.push_back(idx);
+                                });
+    std::sort(actual.begin(), actual.end());
+    EXPECT_EQ(expected, actual);
+  }
+}
+
+TEST(LinearOctreeTest, BuildAndRefit) {
+  // Two dense clusters in a large domain
+  std::mt19937 gen(42);
+  std::normal_distribution<real_t> cluster(0, 10);
+  std::vector<Real3> points(2000);
+  for (uint64_t i = 0; i < points.size(); ++i) {
+    real_t offset = i % 2 == 0 ? -500 : 500;
+    points[i] = {offset + cluster(gen), cluster(gen), cluster(gen)};
+  }
+  auto bbox_of = [](const std::vector<Real3>& pts) {
+    auto inf = Math::kInfinity;
+    std::array<real_t, 6> bbox = {{inf, -inf, inf, -inf, inf, -inf}};
+    for (auto& p : pts) {
+      for (int d = 0; d < 3; ++d) {
+        bbox[2 * d] = std::min(bbox[2 * d], p[d]);
+        bbox[2 * d + 1] = std::max(bbox[2 * d + 1], p[d]);
+      }
+    }
+    return bbox;
+  };
+
+  LinearOctree octree;
+  octree.Build(points, bbox_of(points), 16);
+  EXPECT_EQ(2000u, octree.GetNumPoints());
+  for (const auto& node : octree.GetNodes()) {
+    if (node.IsLeaf() && node.level < LinearOctree::kMaxLevel) {
+      EXPECT_GE(16u, node.end - node.begin);
+    }
+  }
+  CompareWithBruteForce(octree, points, 25);
+
+  // Small displacements: the tree is refitted, not rebuilt
+  std::normal_distribution<real_t> jitter(0, 0.5);
+  for (int step = 0; step < 3; ++step) {
+    for (auto& p : points) {
+      p += {jitter(gen), jitter(gen), jitter(gen)};
+    }
+    EXPECT_TRUE(octree.Refit(points));
+    CompareWithBruteForce(octree, points, 25);
+  }
+
+  // Large displacement of one point
+  points[0] = {-500, 0, 0};
+  points[1] = {-500, 1, 1};
+  EXPECT_TRUE(octree.Refit(points));
+  EXPECT_LT(0u, octree.GetNumRebuiltSubtrees());
+  CompareWithBruteForce(octree, points, 25);
+
+  // Point leaves the root node
+  points[2] = {1e5, 0, 0};
+  EXPECT_FALSE(octree.Refit(points));
+  octree.Build(points, bbox_of(points), 16);
+  CompareWithBruteForce(octree, points, 25);
+}
+
+TEST(OctreeTest, MovingAgents) {
+  auto set_param = [](auto* param) { param->environment = "octree"; };
+  Simulation simulation(TEST_NAME, set_param);
+  auto* rm = simulation.GetResourceManager();
+  auto* env = simulation.GetEnvironment();
+
+  CellFactory(rm, 4);
+  env->Update();
+
+  std::unordered_map<AgentUid, std::vector<AgentUid>> neighbors;
+  real_t search_radius_squared = 1201;
+  auto* cell = rm->GetAgent(AgentUid(0));
+  FillNeighborList fill_neighbor_list(&neighbors, cell->GetUid());
+  env->ForEachNeighbor(fill_neighbor_list, *cell, search_radius_squared);
+  EXPECT_EQ(7u, neighbors[AgentUid(0)].size());
+
+  // move cell 0 next to cell 63
+  cell->SetPosition({61, 61, 61});
+  env->ForcedUpdate();
+  neighbors.clear();
+  env->ForEachNeighbor(fill_neighbor_list, *cell, search_radius_squared);
+  std::sort(neighbors[AgentUid(0)].begin(), neighbors[AgentUid(0)].end());
+  std::vector<AgentUid> expected = {AgentUid(42), AgentUid(43), AgentUid(46),
+                                    AgentUid(47), AgentUid(58), AgentUid(59),
+                                    AgentUid(62), AgentUid(63)};
+  EXPECT_EQ(expected, neighbors[AgentUid(0)]);
+}
+
 }  // namespace bdm
@@ -0,0 +1,172 @@
+// -----------------------------------------------------------------------------
+//
+// Copyright (C) 2021 CERN & University of Surrey for the benefit of the
+// BioDynaMo collaboration. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+//
+// See the LICENSE file distributed with this work for details.
+// See the NOTICE file distributed with this work for additional information
+// regarding copyright ownership.
+//
+// -----------------------------------------------------------------------------
+
+#include "core/environment/sparse_grid_environment.h"
+#include <algorithm>
+#include <unordered_map>
+#include <vector>
+#include "core/agent/cell.h"
+#include "core/environment/uniform_grid_environment.h"
+#include "gtest/gtest.h"
+#include "unit/core/count_neighbor_functor.h"
+#include "unit/test_util/test_util.h"
+
+namespace bdm {
+
+// Adds a cube of `cells_per_dim`^3 cells with lower corner `origin`
+inline void AddCluster(ResourceManager* rm, const Real3& origin,
+                       size_t cells_per_dim) {
+  const real_t space = 8;
+  for (size_t i = 0; i < cells_per_dim; i++) {
+    for (size_t j = 0; j < cells_per_dim; j++) {
+      for (size_t k = 0; k < cells_per_dim; k++) {
+        Real3 pos = {k * space, j * space, i * space};
+        Cell* cell = new Cell(origin + pos);
+        cell->SetDiameter(10);
+        rm->AddAgent(cell);
+      }
+    }
+  }
+}
+
+// Two distant clusters: the number of stored boxes depends on the number of
+// agents, not on the size of the domain.
+TEST(SparseGridEnvironmentTest, Occupancy) {
+  auto set_param = [](auto* param) { param->environment = "sparse_grid"; };
+  Simulation simulation(TEST_NAME, set_param);
+  auto* rm = simulation.GetResourceManager();
+  auto* grid =
+      dynamic_cast<SparseGridEnvironment*>(simulation.GetEnvironment());
+  ASSERT_TRUE(grid != nullptr);
+
+  AddCluster(rm, {0, 0, 0}, 4);
+  AddCluster(rm, {10000, 10000, 10000}, 4);
+  grid->Update();
+
+  EXPECT_EQ(10, grid->GetBoxLength());
+  EXPECT_LE(grid->GetNumOccupiedBoxes(), 128u);
+  EXPECT_GT(grid->GetNumDenseBoxes(), 100000000u);
+  EXPECT_EQ(256u, grid->GetCapacity());
+}
+
+// The sparse grid must find the same neighbors as a brute force search.
+TEST(SparseGridEnvironmentTest, ForEachNeighbor) {
+  auto set_param = [](auto* param) { param->environment = "sparse_grid"; };
+  Simulation simulation(TEST_NAME, set_param);
+  auto* rm = simulation.GetResourceManager();
+  auto* env = simulation.GetEnvironment();
+
+  AddCluster(rm, {0, 0, 0}, 5);
+  AddCluster(rm, {5003, -4001, 2999}, 5);
+  env->Update();
+
+  rm->ForEachAgent([&](Agent* query) {
+    std::vector<AgentUid> expected;
+    rm->ForEachAgent([&](Agent* agent) {
+      auto diff = agent->GetPosition() - query->GetPosition();
+      if (agent != query && diff * diff < 100) {
+        expected.push_back(agent->GetUid());
+      }
+    });
+    std::vector<AgentUid> actual;
+    auto fill = L2F([&](Agent* neighbor, real_t squared_distance) {
+      EXPECT_LT(squared_distance, 100);
+      actual.push_back(neighbor->GetUid());
+    });
+    env->ForEachNeighbor(fill, *query, 100);
+
+    std::sort(expected.begin(), expected.end());
+    std::sort(actual.begin(), actual.end());
+    EXPECT_EQ(expected, actual);
+  });
+}
+
+// Load balancing must visit each agent exactly once.
+TEST(SparseGridEnvironmentTest, LoadBalanceInfo) {
+  auto set_param = [](auto* param) { param->environment = "sparse_grid"; };
+  Simulation simulation(TEST_NAME, set_param);
+  auto* rm = simulation.GetResourceManager();
+  auto* env = simulation.GetEnvironment();
+
+  AddCluster(rm, {0, 0, 0}, 4);
+  AddCluster(rm, {-3000, 200, 7000}, 3);
+  env->Update();
+  auto* lbi = env->GetLoadBalanceInfo();
+
+  std::unordered_map<AgentUid, uint64_t> visited;
+  auto count = L2F([&](Iterator<AgentHandle>* it) {
+    while (it->HasNext()) {
+      visited[rm->GetAgent(it->Next())->GetUid()]++;
+    }
+  });
+  // split the agents into uneven ranges
+  uint64_t num_agents = rm->GetNumAgents();
+  for (uint64_t start = 0; start < num_agents; start += 7) {
+    lbi->CallHandleIteratorConsumer(start, std::min(start + 7, num_agents),
+                                    count);
+  }
+
+  EXPECT_EQ(num_agents, visited.size());
+  for (auto& el : visited) {
+    EXPECT_EQ(1u, el.second);
+  }
+}
+
+// The default uniform grid is replaced if it would be sparsely occupied.
+TEST(SparseGridEnvironmentTest, ReplaceUniformGridIfSparse) {
+  auto set_param = [](auto* param) {
+    param->sparse_grid_occupancy_threshold = 0.01;
+  };
+  Simulation simulation(TEST_NAME, set_param);
+  auto* rm = simulation.GetResourceManager();
+
+  AddCluster(rm, {0, 0, 0}, 2);
+  simulation.GetScheduler()->Simulate(1);
+  EXPECT_TRUE(dynamic_cast<UniformGridEnvironment*>(
+                  simulation.GetEnvironment()) != nullptr);
+
+  AddCluster(rm, {5000, 0, 0}, 2);
+  simulation.GetScheduler()->Simulate(1);
+  EXPECT_TRUE(dynamic_cast<SparseGridEnvironment*>(
+                  simulation.GetEnvironment()) != nullptr);
+  EXPECT_EQ(16u, rm->GetNumAgents());
+}
+
+// Tests if ForEachNeighbor of the respective environment finds the correct
+// number of neighbors. The same test is implemented for the other
+// environments.
+TEST(SparseGridEnvironmentTest, FindAllNeighbors) {
+  auto set_param = [](auto* param) {
+    param->environment = "sparse_grid";
+    param->unschedule_default_operations = {"load balancing",
+                                            "mechanical forces"};
+  };
+  Simulation simulation(TEST_NAME, set_param);
+
+  // Please consult the definition of the fuction for more information.
+  TestNeighborSearch(simulation);
+}
+
+TEST(SparseGridEnvironmentTest, FindAllNeighborsLoadBalanced) {
+  auto set_param = [](auto* param) {
+    param->environment = "sparse_grid";
+    param->unschedule_default_operations = {"mechanical forces"};
+  };
+  Simulation simulation(TEST_NAME, set_param);
+
+  // Please consult the definition of the fuction for more information.
+  TestNeighborSearch(simulation);
+}
+
+}  // namespace bdm
@@ -13,12 +13,16 @@
 // -----------------------------------------------------------------------------
 
 #include "core/environment/uniform_grid_environment.h"
+#include <algorithm>
+#include <mutex>
 #include <sstream>
 #include <string>
 #include "core/agent/cell.h"
 #include "core/environment/environment.h"
 #include "core/functor.h"
 #include "gtest/gtest.h"
+#include "neuroscience/module.h"
+#include "neuroscience/neurite_element.h"
 #include "unit/core/count_neighbor_functor.h"
 #include "unit/test_util/test_util.h"
 
@@ -412,6 +416,238 @@ struct ZOrderCallback : Functor<void, const AgentHandle&> {
   }
 };
 
+// The batched neighbor search must find the same neighbors as the search
+// for individual agents.
+TEST(UniformGridEnvironmentTest, ForEachNeighborBatched) {
+  Simulation simulation(TEST_NAME);
+  auto* rm = simulation.GetResourceManager();
+  auto* grid =
+      static_cast<UniformGridEnvironment*>(simulation.GetEnvironment());
+
+  CellFactory(rm, 6);
+  // add a dense cluster such that boxes contain more agents than a tile
+  for (uint64_t i = 0; i < 200; i++) {
+    real_t x = 50 + static_cast<real_t>(i % 10);
+    real_t y = 50 + static_cast<real_t>(i % 7);
+    real_t z = 50 + static_cast<real_t>(i % 13);
+    rm->AddAgent(new Cell({x, y, z}));
+  }
+  grid->Update();
+
+  std::unordered_map<AgentUid, std::vector<AgentUid>> expected;
+  rm->ForEachAgent([&](Agent* agent) {
+    auto uid = agent->GetUid();
+    auto fill_neighbor_list = L2F([&](Agent* neighbor, real_t) {
+      expected[uid].push_back(neighbor->GetUid());
+    });
+    grid->ForEachNeighbor(fill_neighbor_list, *agent, 900);
+  });
+
+  std::unordered_map<AgentUid, std::vector<AgentUid>> actual;
+  std::mutex mutex;
+  grid->ForEachNeighborBatched(
+      900, [&](Agent* query, Agent* neighbor, real_t squared_distance) {
+        EXPECT_LT(squared_distance, 900);
+        std::lock_guard<std::mutex> lock(mutex);
+        actual[query->GetUid()].push_back(neighbor->GetUid());
+      });
+
+  EXPECT_EQ(expected.size(), actual.size());
+  for (auto& el : expected) {
+    auto& neighbors = actual[el.first];
+    std::sort(el.second.begin(), el.second.end());
+    std::sort(neighbors.begin(), neighbors.end());
+    EXPECT_EQ(el.second, neighbors);
+  }
+}
+
+// Agents at opposite faces of a torus must find each other without ghost
+// agents; the reported distance is the minimum image distance.
+TEST(UniformGridEnvironmentTest, ForEachNeighborPeriodic) {
+  auto set_param = [](auto* param) {
+    param->bound_space = Param::BoundSpaceMode::kTorus;
+    param->min_bound = 0;
+    param->max_bound = 95;
+  };
+  Simulation simulation(TEST_NAME, set_param);
+  auto* rm = simulation.GetResourceManager();
+  auto* grid =
+      static_cast<UniformGridEnvironment*>(simulation.GetEnvironment());
+
+  auto* corner_low = new Cell({1, 2, 3});
+  auto* corner_high = new Cell({94, 93, 92});
+  auto* center = new Cell({50, 50, 50});
+  for (auto* cell : {corner_low, corner_high, center}) {
+    cell->SetDiameter(10);
+    rm->AddAgent(cell);
+  }
+  grid->Update();
+
+  EXPECT_TRUE(grid->IsPeriodic());
+  EXPECT_NEAR(-2, grid->GetMinimumImage(93), abs_error<real_t>::value);
+  EXPECT_NEAR(2, grid->GetMinimumImage(-93), abs_error<real_t>::value);
+
+  std::unordered_map<AgentUid, std::vector<real_t>> neighbors;
+  rm->ForEachAgent([&](Agent* agent) {
+    auto fill_neighbor_list = L2F([&](Agent* neighbor, real_t sq_distance) {
+      neighbors[agent->GetUid()].push_back(sq_distance);
+    });
+    grid->ForEachNeighbor(fill_neighbor_list, *agent, 100);
+  });
+
+  // distance vector (2, 4, 6) across the periodic boundary
+  ASSERT_EQ(1u, neighbors[corner_low->GetUid()].size());
+  EXPECT_NEAR(56, neighbors[corner_low->GetUid()][0],
+              abs_error<real_t>::value);
+  ASSERT_EQ(1u, neighbors[corner_high->GetUid()].size());
+  EXPECT_NEAR(56, neighbors[corner_high->GetUid()][0],
+              abs_error<real_t>::value);
+  EXPECT_EQ(0u, neighbors[center->GetUid()].size());
+
+  // the batched search uses the same periodic neighborhood
+  uint64_t num_pairs = 0;
+  grid->ForEachNeighborBatched(
+      100, [&](Agent* query, Agent* neighbor, real_t squared_distance) {
+#pragma omp atomic
+        num_pairs++;
+        EXPECT_NEAR(56, squared_distance, abs_error<real_t>::value);
+      });
+  EXPECT_EQ(2u, num_pairs);
+}
+
+// With less than three boxes per axis a box must not appear several times in
+// the periodic Moore neighborhood.
+TEST(UniformGridEnvironmentTest, ForEachNeighborPeriodicSmallDomain) {
+  auto set_param = [](auto* param) {
+    param->bound_space = Param::BoundSpaceMode::kTorus;
+    param->min_bound = 0;
+    param->max_bound = 25;
+  };
+  Simulation simulation(TEST_NAME, set_param);
+  auto* rm = simulation.GetResourceManager();
+  auto* grid =
+      static_cast<UniformGridEnvironment*>(simulation.GetEnvironment());
+
+  for (real_t x : {1, 13, 24}) {
+    auto* cell = new Cell({x, 5, 5});
+    cell->SetDiameter(10);
+    rm->AddAgent(cell);
+  }
+  grid->Update();
+
+  rm->ForEachAgent([&](Agent* agent) {
+    uint64_t num_neighbors = 0;
+    auto count = L2F([&](Agent*, real_t) { num_neighbors++; });
+    grid->ForEachNeighbor(count, *agent, 100);
+    // x = 1 and x = 24 are neighbors across the boundary
+    EXPECT_EQ(agent->GetPosition()[0] == 13 ? 0u : 1u, num_neighbors);
+  });
+}
+
+TEST(UniformGridEnvironmentTest, FrozenRegions) {
+  auto set_param = [](auto* param) {
+    param->detect_static_agents = true;
+    param->detect_static_regions = true;
+  };
+  Simulation simulation(TEST_NAME, set_param);
+  auto* rm = simulation.GetResourceManager();
+  auto* env =
+      dynamic_cast<UniformGridEnvironment*>(simulation.GetEnvironment());
+
+  // one agent per box along the x axis
+  std::vector<Cell*> cells;
+  for (int i = 0; i < 10; i++) {
+    auto* cell = new Cell({i * 10.0, 0, 0});
+    cell->SetDiameter(10);
+    rm->AddAgent(cell);
+    cells.push_back(cell);
+  }
+
+  env->ForcedUpdate();
+  EXPECT_TRUE(env->HasFrozenRegions());
+  EXPECT_EQ(0u, env->GetNumFrozenBoxes());
+
+  // all agents are static and did not change
+  for (auto* cell : cells) {
+    cell->UpdateStaticness();
+    cell->UpdateStaticness();
+    cell->SetPropagateStaticness(false);
+  }
+  env->ForcedUpdate();
+  EXPECT_EQ(10u, env->GetNumFrozenBoxes());
+
+  // the first agent moved
+  cells[0]->SetPropagateStaticness();
+  env->ForcedUpdate();
+  EXPECT_EQ(8u, env->GetNumFrozenBoxes());
+  for (int i = 0; i < 10; i++) {
+    EXPECT_EQ(i >= 2, env->IsInFrozenRegion(*cells[i]));
+  }
+
+  std::vector<Agent*> visited;
+  auto collect = L2F([&](Agent* agent) {
+#pragma omp critical
+    visited.push_back(agent);
+  });
+  env->ForEachAgentInActiveBoxes(collect);
+  ASSERT_EQ(1u, visited.size());
+  EXPECT_EQ(cells[0], visited[0]);
+}
+
+inline neuroscience::NeuriteElement* AddCylinder(ResourceManager* rm,
+                                                const Real3& proximal,
+                                                const Real3& distal) {
+  auto* cylinder = new neuroscience::NeuriteElement();
+  cylinder->SetSpringAxis(distal - proximal);
+  cylinder->SetMassLocation(distal);
+  cylinder->UpdatePosition();
+  cylinder->SetDiameter(2);
+  rm->AddAgent(cylinder);
+  return cylinder;
+}
+
+TEST(UniformGridEnvironmentTest, ForEachNeighborOfCylinder) {
+  neuroscience::InitModule();
+  auto set_param = [](auto* param) { param->cylinder_neighbor_search = true; };
+  Simulation simulation(TEST_NAME, set_param);
+  auto* rm = simulation.GetResourceManager();
+  auto* env =
+      dynamic_cast<UniformGridEnvironment*>(simulation.GetEnvironment());
+
+  auto* query = AddCylinder(rm, {0, 0, 0}, {30, 0, 0});
+  // touches the proximal end of the query, far away from its center
+  auto* cell = new Cell({1, 2.5, 0});
+  cell->SetDiameter(4);
+  rm->AddAgent(cell);
+  // crosses the distal end of the query
+  auto* crossing = AddCylinder(rm, {28, -5, 1}, {28, 5, 1});
+  // parallel to the query, but not touching
+  AddCylinder(rm, {0, 5, 0}, {30, 5, 0});
+  auto* far_cell = new Cell({15, 20, 0});
+  far_cell->SetDiameter(4);
+  rm->AddAgent(far_cell);
+
+  env->ForcedUpdate();
+  ASSERT_TRUE(env->HasCylinderIndex());
+
+  std::vector<Agent*> neighbors;
+  auto collect = L2F([&](Agent* neighbor, real_t) {
+    neighbors.push_back(neighbor);
+  });
+  env->ForEachNeighborOfCylinder(collect, *query,
+                                 env->GetLargestAgentSizeSquared());
+  ASSERT_EQ(2u, neighbors.size());
+  EXPECT_TRUE(std::find(neighbors.begin(), neighbors.end(), cell) !=
+              neighbors.end());
+  EXPECT_TRUE(std::find(neighbors.begin(), neighbors.end(), crossing) !=
+              neighbors.end());
+
+  // the search based on the center of the query misses both contacts
+  neighbors.clear();
+  env->ForEachNeighbor(collect, *query, env->GetLargestAgentSizeSquared());
+  EXPECT_EQ(0u, neighbors.size());
+}
+
 // Tests if ForEachNeighbor of the respective environment finds the correct
 // number of neighbors. The same test is implemented for kdtree and octree
 // environments.
@@ -14,6 +14,7 @@
 
 #include "core/interaction_force.h"
 #include "core/agent/cell.h"
+#include "core/force_kernel.h"
 #include "gtest/gtest.h"
 #include "neuroscience/module.h"
 #include "neuroscience/neurite_element.h"
@@ -50,6 +51,30 @@ TEST(InteractionForce, GeneralSphere) {
   EXPECT_NEAR(1.3258767422704656, result[2], abs_error<real_t>::value);
 }
 
+/// Spheres at opposite faces of a periodic space interact through the
+/// periodic boundary
+TEST(InteractionForce, PeriodicSphere) {
+  auto set_param = [](auto* param) {
+    param->bound_space = Param::BoundSpaceMode::kTorus;
+    param->min_bound = 0;
+    param->max_bound = 100;
+  };
+  Simulation simulation(TEST_NAME, set_param);
+
+  Cell cell({1.1, 1.0, 0.9});
+  cell.SetDiameter(8);
+  Cell nb({100, 100, 100});
+  nb.SetDiameter(5);
+
+  // same configuration as the first case of GeneralSphere
+  InteractionForce force;
+  auto result = force.Calculate(&cell, &nb);
+
+  EXPECT_NEAR(7.1429184067241138, result[0], abs_error<real_t>::value);
+  EXPECT_NEAR(6.4935621879310119, result[1], abs_error<real_t>::value);
+  EXPECT_NEAR(5.8442059691379109, result[2], abs_error<real_t>::value);
+}
+
 /// Tests the special case that non of the neighbors overlap
 /// with the reference cell
 TEST(InteractionForce, AllNonOverlappingSphere) {
@@ -408,4 +433,70 @@ TEST(InteractionForce, SphereLongCylinderHorizontalpD) {
   EXPECT_ARR_NEAR4({0, -0.5, 0, 0}, result2);
 }
 
+/// The inlined sphere-sphere kernel must calculate the same forces as
+/// `InteractionForce`, both for single pairs and for blocks of neighbors.
+TEST(KernelInteractionForce, SphereBlock) {
+  Simulation simulation(TEST_NAME);
+
+  Cell cell({1.1, 1.0, 0.9});
+  cell.SetDiameter(8);
+  Cell nb1({0, 0, 0});
+  nb1.SetDiameter(5);
+  Cell nb2({5, 5, 0});
+  nb2.SetDiameter(10);
+  Cell nb3({50, 0, 0});
+  nb3.SetDiameter(10);
+
+  InteractionForce reference;
+  KernelInteractionForce<> force;
+  SphereNeighborBlock block;
+  Real3 expected = {0, 0, 0};
+  for (auto* nb : {&nb1, &nb2, &nb3}) {
+    auto ref = reference.Calculate(&cell, nb);
+    auto result = force.Calculate(&cell, nb);
+    for (int i = 0; i < 3; ++i) {
+      EXPECT_NEAR(ref[i], result[i], abs_error<real_t>::value);
+      expected[i] += ref[i];
+    }
+    block.Add(nb);
+  }
+
+  uint64_t non_zero = 0;
+  auto result = force.CalculateSphereBlock(&cell, block, &non_zero);
+  EXPECT_EQ(2u, non_zero);
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_NEAR(expected[i], result[i], abs_error<real_t>::value);
+  }
+
+  // the default implementation calls Calculate for each neighbor
+  non_zero = 0;
+  result = reference.CalculateSphereBlock(&cell, block, &non_zero);
+  EXPECT_EQ(2u, non_zero);
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_NEAR(expected[i], result[i], abs_error<real_t>::value);
+  }
+}
+
+/// Custom parameters are passed to the kernel
+TEST(KernelInteractionForce, CustomParameters) {
+  Simulation simulation(TEST_NAME);
+
+  Cell cell({0, 0, 0});
+  cell.SetDiameter(10);
+  Cell nb({8, 0, 0});
+  nb.SetDiameter(10);
+
+  ForceKernelParam param;
+  param.iof_coefficient = 0;
+  param.attraction_coeff = 0;
+  param.repulsion_coeff = 3;
+  KernelInteractionForce<> force(param);
+  auto result = force.Calculate(&cell, &nb);
+
+  // overlap of 2 times the repulsion coefficient
+  EXPECT_NEAR(-6, result[0], abs_error<real_t>::value);
+  EXPECT_NEAR(0, result[1], abs_error<real_t>::value);
+  EXPECT_NEAR(0, result[2], abs_error<real_t>::value);
+}
+
 }  // namespace bdm
@@ -0,0 +1,103 @@
+// -----------------------------------------------------------------------------
+//
+// Copyright (C) 2021 CERN & University of Surrey for the benefit of the
+// BioDynaMo collaboration. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+//
+// See the LICENSE file distributed with this work for details.
+// See the NOTICE file distributed with this work for additional information
+// regarding copyright ownership.
+//
+// -----------------------------------------------------------------------------
+
+#include "core/operation/implicit_mechanical_forces_op.h"
+#include "core/agent/cell.h"
+#include "core/environment/environment.h"
+#include "core/resource_manager.h"
+#include "gtest/gtest.h"
+#include "unit/test_util/test_util.h"
+
+namespace bdm {
+
+// For small time steps the implicit solution is close to the explicit one
+// (see DisplacementOpTest.ComputeUniformGrid)
+TEST(ImplicitMechanicalForcesOpTest, SmallTimeStep) {
+  Simulation simulation(TEST_NAME);
+  auto* rm = simulation.GetResourceManager();
+
+  Cell* cell0 = new Cell();
+  cell0->SetAdherence(0.3);
+  cell0->SetDiameter(9);
+  cell0->SetMass(1.4);
+  cell0->SetPosition({0, 0, 0});
+  rm->AddAgent(cell0);
+
+  Cell* cell1 = new Cell();
+  cell1->SetAdherence(0.4);
+  cell1->SetDiameter(11);
+  cell1->SetMass(1.1);
+  cell1->SetPosition({0, 5, 0});
+  rm->AddAgent(cell1);
+
+  simulation.GetEnvironment()->Update();
+
+  auto* op = NewOperation("implicit mechanical forces");
+  (*op)();
+
+  auto* impl = op->GetImplementation<ImplicitMechanicalForcesOp>();
+  EXPECT_LT(0u, impl->GetNumIterations());
+
+  auto position = cell0->GetPosition();
+  EXPECT_NEAR(0, position[0], abs_error<real_t>::value);
+  EXPECT_NEAR(-0.07797206232558615, position[1], 0.01);
+  EXPECT_NEAR(0, position[2], abs_error<real_t>::value);
+  position = cell1->GetPosition();
+  EXPECT_NEAR(0, position[0], abs_error<real_t>::value);
+  EXPECT_NEAR(5.0980452768658333, position[1], 0.01);
+  EXPECT_NEAR(0, position[2], abs_error<real_t>::value);
+
+  delete op;
+}
+
+// With a time step for which the explicit displacement would overshoot by
+// far, the implicit solution approaches the equilibrium distance without
+// oscillations.
+TEST(ImplicitMechanicalForcesOpTest, LargeTimeStep) {
+  auto set_param = [](auto* param) {
+    param->simulation_time_step = 1000;
+    param->simulation_max_displacement = 1e6;
+  };
+  Simulation simulation(TEST_NAME, set_param);
+  auto* rm = simulation.GetResourceManager();
+  auto* env = simulation.GetEnvironment();
+
+  Cell* cell0 = new Cell({0, 0, 0});
+  cell0->SetDiameter(10);
+  rm->AddAgent(cell0);
+  Cell* cell1 = new Cell({2, 0, 0});
+  cell1->SetDiameter(10);
+  rm->AddAgent(cell1);
+
+  // the force vanishes at this distance
+  const real_t equilibrium = 12.1875;
+  auto* op = NewOperation("implicit mechanical forces");
+  real_t last_distance = 2;
+  for (int i = 0; i < 10; ++i) {
+    env->Update();
+    (*op)();
+    auto distance = (cell1->GetPosition() - cell0->GetPosition()).Norm();
+    EXPECT_LE(last_distance, distance);
+    EXPECT_GE(equilibrium, distance);
+    last_distance = distance;
+  }
+  // the neighbor search radius is the largest diameter
+  EXPECT_LE(10, last_distance);
+  EXPECT_NEAR(cell0->GetPosition()[0], 2 - cell1->GetPosition()[0],
+              abs_error<real_t>::value);
+
+  delete op;
+}
+
+}  // namespace bdm
@@ -0,0 +1,106 @@
+// -----------------------------------------------------------------------------
+//
+// Copyright (C) 2021 CERN & University of Surrey for the benefit of the
+// BioDynaMo collaboration. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+//
+// See the LICENSE file distributed with this work for details.
+// See the NOTICE file distributed with this work for additional information
+// regarding copyright ownership.
+//
+// -----------------------------------------------------------------------------
+
+#include "core/operation/sphere_mechanical_forces_op.h"
+#include <vector>
+#include "core/agent/cell.h"
+#include "core/agent/spherical_agent.h"
+#include "core/environment/environment.h"
+#include "core/environment/uniform_grid_environment.h"
+#include "core/resource_manager.h"
+#include "gtest/gtest.h"
+#include "unit/test_util/mechanical_forces_test.h"
+#include "unit/test_util/test_util.h"
+
+namespace bdm {
+
+// The fast path must calculate the same displacements as
+// `Cell::CalculateDisplacement` with the default force for all cells at
+// their initial positions.
+TEST(SphereMechanicalForcesOpTest, SameAsGenericPath) {
+  Simulation simulation(TEST_NAME);
+
+  AddOverlappingCells(&simulation, 4);
+  simulation.GetEnvironment()->Update();
+  auto expected = GetExpectedPositions(&simulation);
+
+  auto* op = NewOperation("sphere mechanical forces");
+  (*op)();
+  EXPECT_TRUE(
+      op->GetImplementation<SphereMechanicalForcesOp>()->UsedFastPath());
+  ExpectPositions(&simulation, expected);
+
+  delete op;
+}
+
+// Agents that are not cells require the generic path
+TEST(SphereMechanicalForcesOpTest, Fallback) {
+  Simulation simulation(TEST_NAME);
+  auto* rm = simulation.GetResourceManager();
+
+  AddOverlappingCells(&simulation, 2);
+  rm->AddAgent(new SphericalAgent({100, 100, 100}));
+  simulation.GetEnvironment()->Update();
+
+  auto* op = NewOperation("sphere mechanical forces");
+  (*op)();
+  EXPECT_FALSE(
+      op->GetImplementation<SphereMechanicalForcesOp>()->UsedFastPath());
+
+  delete op;
+}
+
+// Static cells in frozen regions are not moved by the fast path
+TEST(SphereMechanicalForcesOpTest, FrozenRegions) {
+  auto set_param = [](auto* param) {
+    param->detect_static_agents = true;
+    param->detect_static_regions = true;
+  };
+  Simulation simulation(TEST_NAME, set_param);
+  auto* rm = simulation.GetResourceManager();
+  auto* env =
+      dynamic_cast<UniformGridEnvironment*>(simulation.GetEnvironment());
+
+  // one cell per box along the x axis
+  std::vector<Cell*> cells;
+  for (int i = 0; i < 10; i++) {
+    auto* cell = new Cell({i * 10.0, 0, 0});
+    cell->SetDiameter(10);
+    cell->SetTractorForce({0.1, 0, 0});
+    rm->AddAgent(cell);
+    cells.push_back(cell);
+  }
+  for (auto* cell : cells) {
+    cell->UpdateStaticness();
+    cell->UpdateStaticness();
+    cell->SetPropagateStaticness(false);
+  }
+  cells[0]->SetPropagateStaticness();
+  env->ForcedUpdate();
+  ASSERT_EQ(8u, env->GetNumFrozenBoxes());
+
+  auto* op = NewOperation("sphere mechanical forces");
+  (*op)();
+  EXPECT_TRUE(
+      op->GetImplementation<SphereMechanicalForcesOp>()->UsedFastPath());
+  for (int i = 0; i < 10; i++) {
+    const bool frozen = env->IsInFrozenRegion(*cells[i]);
+    EXPECT_EQ(i >= 2, frozen);
+    EXPECT_EQ(frozen, cells[i]->GetPosition()[0] == i * 10.0);
+  }
+
+  delete op;
+}
+
+}  // namespace bdm
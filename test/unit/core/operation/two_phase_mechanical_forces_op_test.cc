@@ -0,0 +1,41 @@
+// -----------------------------------------------------------------------------
+//
+// Copyright (C) 2021 CERN & University of Surrey for the benefit of the
+// BioDynaMo collaboration. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+//
+// See the LICENSE file distributed with this work for details.
+// See the NOTICE file distributed with this work for additional information
+// regarding copyright ownership.
+//
+// -----------------------------------------------------------------------------
+
+#include "core/operation/two_phase_mechanical_forces_op.h"
+#include "gtest/gtest.h"
+#include "unit/test_util/mechanical_forces_test.h"
+#include "unit/test_util/test_util.h"
+
+namespace bdm {
+
+// All displacements must be calculated from the positions at the beginning
+// of the operation, even without a thread safety mechanism.
+TEST(TwoPhaseMechanicalForcesOpTest, DisplacementsFromInitialPositions) {
+  auto set_param = [](Param* param) {
+    param->thread_safety_mechanism = Param::ThreadSafetyMechanism::kNone;
+  };
+  Simulation simulation(TEST_NAME, set_param);
+
+  AddOverlappingCells(&simulation, 4);
+  simulation.GetEnvironment()->Update();
+  auto expected = GetExpectedPositions(&simulation);
+
+  auto* op = NewOperation("two phase mechanical forces");
+  (*op)();
+  ExpectPositions(&simulation, expected);
+
+  delete op;
+}
+
+}  // namespace bdm
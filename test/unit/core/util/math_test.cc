@@ -71,6 +71,25 @@ TEST(MathUtilTest, ProjectionOnto) {
       result, {{2.134020618556701, 1.8969072164948453, 1.6597938144329896}});
 }
 
+TEST(MathUtilTest, SquaredSegmentDistance) {
+  // skew segments
+  EXPECT_NEAR(4, Math::SquaredSegmentDistance({0, 0, 0}, {2, 0, 0}, {1, -1, 2},
+                                              {1, 1, 2}),
+              abs_error<real_t>::value);
+  // closest points are end points
+  EXPECT_NEAR(2, Math::SquaredSegmentDistance({0, 0, 0}, {1, 0, 0}, {2, 1, 0},
+                                              {3, 1, 0}),
+              abs_error<real_t>::value);
+  // parallel segments
+  EXPECT_NEAR(1, Math::SquaredSegmentDistance({0, 0, 0}, {2, 0, 0}, {1, 1, 0},
+                                              {3, 1, 0}),
+              abs_error<real_t>::value);
+  // point and segment
+  EXPECT_NEAR(9, Math::SquaredSegmentDistance({1, 3, 0}, {1, 3, 0}, {0, 0, 0},
+                                              {2, 0, 0}),
+              abs_error<real_t>::value);
+}
+
 TEST(MathUtilTest, MSE) {
   std::vector<real_t> v1 = {1, 2};
   std::vector<real_t> v2 = {4, 9};
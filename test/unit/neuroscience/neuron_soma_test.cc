@@ -20,6 +20,7 @@
 #include "gtest/gtest.h"
 #include "neuroscience/neuron_soma.h"
 
+#include "core/environment/environment.h"
 #include "core/resource_manager.h"
 #include "neuroscience/module.h"
 #include "neuroscience/neurite_element.h"
@@ -838,6 +839,54 @@ TEST(NeuronSomaTest, SWCExport) {
   EXPECT_TRUE(correct_output);
 }
 
+// In the direct agent pointer mode, mother and daughter pointers must be
+// updated if agents are copied during load balancing or removed.
+TEST(NeuronSomaTest, DirectAgentPointersAfterLoadBalanceAndRemoval) {
+  neuroscience::InitModule();
+  Simulation simulation(TEST_NAME);
+  auto* rm = simulation.GetResourceManager();
+  auto* ctxt = simulation.GetExecutionContext();
+
+  auto prev_mode = gAgentPointerMode;
+  gAgentPointerMode = AgentPointerMode::kDirect;
+
+  ctxt->SetupIterationAll(simulation.GetAllExecCtxts());
+  auto* neuron = new NeuronSoma({0, 0, 0});
+  neuron->SetDiameter(20);
+  rm->AddAgent(neuron);
+  auto* neurite = neuron->ExtendNewNeurite({0, 0, 1});
+  neurite->SetDiameter(2);
+  auto daughter = neurite->Bifurcate({0, 1, 1}, {0, -1, 1})[1];
+  ctxt->TearDownIterationAll(simulation.GetAllExecCtxts());
+
+  auto neuron_uid = neuron->GetUid();
+  auto neurite_uid = neurite->GetUid();
+  auto daughter_uid = daughter->GetUid();
+
+  simulation.GetEnvironment()->Update();
+  rm->LoadBalance();
+
+  neuron = dynamic_cast<NeuronSoma*>(rm->GetAgent(neuron_uid));
+  neurite = dynamic_cast<NeuriteElement*>(rm->GetAgent(neurite_uid));
+  daughter = dynamic_cast<NeuriteElement*>(rm->GetAgent(daughter_uid));
+  ASSERT_EQ(1u, neuron->GetDaughters().size());
+  EXPECT_EQ(neurite, neuron->GetDaughters()[0].Get());
+  EXPECT_EQ(neuron, dynamic_cast<NeuronSoma*>(neurite->GetMother().Get()));
+  EXPECT_EQ(daughter, neurite->GetDaughterRight().Get());
+  EXPECT_EQ(neurite,
+            dynamic_cast<NeuriteElement*>(daughter->GetMother().Get()));
+
+  std::vector<AgentUid> remove = {daughter_uid};
+  rm->RemoveAgents({&remove});
+
+  EXPECT_EQ(3u, rm->GetNumAgents());
+  EXPECT_EQ(neurite, neuron->GetDaughters()[0].Get());
+  EXPECT_TRUE(neurite->GetDaughterLeft() != nullptr);
+  EXPECT_TRUE(neurite->GetDaughterRight() == nullptr);
+
+  gAgentPointerMode = prev_mode;
+}
+
 TEST(DISABLED_NeuronSomaNeuriteElementTest, Displacement) {
   // Simulation simulation(TEST_NAME);
   // auto* rm = simulation.GetResourceManager();
@@ -0,0 +1,78 @@
+// -----------------------------------------------------------------------------
+//
+// Copyright (C) 2021 CERN & University of Surrey for the benefit of the
+// BioDynaMo collaboration. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+//
+// See the LICENSE file distributed with this work for details.
+// See the NOTICE file distributed with this work for additional information
+// regarding copyright ownership.
+//
+// -----------------------------------------------------------------------------
+
+#ifndef UNIT_TEST_UTIL_MECHANICAL_FORCES_TEST_H_
+#define UNIT_TEST_UTIL_MECHANICAL_FORCES_TEST_H_
+
+#include <unordered_map>
+#include "core/agent/cell.h"
+#include "core/environment/environment.h"
+#include "core/force_kernel.h"
+#include "core/resource_manager.h"
+#include "core/simulation.h"
+#include "unit/test_util/test_util.h"
+
+namespace bdm {
+
+/// Adds a jittered cube of `cells_per_dim`^3 overlapping cells
+inline void AddOverlappingCells(Simulation* sim, size_t cells_per_dim) {
+  auto* rm = sim->GetResourceManager();
+  auto* random = sim->GetRandom();
+  for (size_t i = 0; i < cells_per_dim; i++) {
+    for (size_t j = 0; j < cells_per_dim; j++) {
+      for (size_t k = 0; k < cells_per_dim; k++) {
+        Real3 pos = {k * 7.0, j * 7.0, i * 7.0};
+        Cell* cell = new Cell(pos + random->UniformArray<3>(-1, 1));
+        cell->SetDiameter(random->Uniform(8, 10));
+        cell->SetTractorForce({0.1, 0, 0});
+        rm->AddAgent(cell);
+      }
+    }
+  }
+}
+
+/// Returns the position of each agent after `Agent::CalculateDisplacement`
+/// with the default force, calculated from the current positions of all
+/// agents. The environment must be up to date.
+inline std::unordered_map<AgentUid, Real3> GetExpectedPositions(
+    Simulation* sim) {
+  auto* env = sim->GetEnvironment();
+  KernelInteractionForce<> force;
+  auto squared_radius = env->GetLargestAgentSizeSquared();
+  std::unordered_map<AgentUid, Real3> expected;
+  sim->GetResourceManager()->ForEachAgent([&](Agent* agent) {
+    expected[agent->GetUid()] =
+        agent->GetPosition() +
+        agent->CalculateDisplacement(&force, squared_radius,
+                                     sim->GetParam()->simulation_time_step);
+  });
+  return expected;
+}
+
+/// Checks that all agents are at the positions that were returned by
+/// `GetExpectedPositions`
+inline void ExpectPositions(
+    Simulation* sim, const std::unordered_map<AgentUid, Real3>& expected) {
+  sim->GetResourceManager()->ForEachAgent([&](Agent* agent) {
+    const auto& position = agent->GetPosition();
+    const auto& expected_position = expected.at(agent->GetUid());
+    for (int i = 0; i < 3; ++i) {
+      EXPECT_NEAR(expected_position[i], position[i], abs_error<real_t>::value);
+    }
+  });
+}
+
+}  // namespace bdm
+
+#endif  // UNIT_TEST_UTIL_MECHANICAL_FORCES_TEST_H_